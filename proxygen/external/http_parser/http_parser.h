@@ -294,6 +294,25 @@ struct http_parser_url {
 void http_parser_init(http_parser *parser, enum http_parser_type type);
 
 
+/* Implementations available for skipping over runs of header name, header
+ * value and request URL bytes. HTTP_PARSER_SCAN_AUTO picks the widest one the
+ * CPU supports; this is also what is in effect at startup.
+ */
+enum http_parser_scan_mode
+  { HTTP_PARSER_SCAN_AUTO   = 0
+  , HTTP_PARSER_SCAN_SCALAR = 1
+  , HTTP_PARSER_SCAN_SSE42  = 2
+  , HTTP_PARSER_SCAN_AVX2   = 3
+  };
+
+/* Select the implementation used by all parsers in the process and return
+ * the one actually in effect, which is narrower than requested if the CPU
+ * lacks support. Not thread-safe; meant for tests and benchmarks.
+ */
+enum http_parser_scan_mode http_parser_set_scan_mode(
+  enum http_parser_scan_mode mode);
+
+
 size_t http_parser_execute(http_parser *parser,
                            const http_parser_settings *settings,
                            const char *data,
@@ -28,6 +28,13 @@
 #include <limits.h>
 #include <stdlib.h>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# define HTTP_PARSER_X86_SIMD 1
+# include <immintrin.h>
+#else
+# define HTTP_PARSER_X86_SIMD 0
+#endif
+
 #if __cplusplus
 #include <limits>
 
@@ -426,6 +433,207 @@ enum http_host_state
 #define IS_HEADER_CHAR(ch)                                                     \
   (ch == CR || ch == LF || ch == 9 || ((unsigned char)ch > 31 && ch != 127))
 
+/**
+ * Characters that can be skipped without a state transition while in
+ * h_general inside a header value: anything that passes IS_HEADER_CHAR
+ * except the delimiters the state machine has to look at.
+ **/
+#define IS_HEADER_VALUE_RUN_CHAR(ch)                                           \
+  (ch != CR && ch != LF && ch != QT && ch != BS && IS_HEADER_CHAR(ch))
+
+/* Fast-forwarding through runs of uninteresting bytes.
+ *
+ * Header names, header values and the request path spend almost all of
+ * their time in states where a byte is either "more of the same" or a
+ * delimiter. scan_run() returns the first byte in [p, end) that is not part
+ * of such a run, so the caller can skip straight to it. The vector variants
+ * classify 16 (SSE4.2) or 32 (AVX2) bytes at a time using the usual
+ * nibble-lookup trick: each run class is described by two 16-entry tables,
+ * indexed by the low and high nibble of a byte, whose AND is non-zero iff the
+ * (7-bit) byte belongs to the class. Bytes >= 0x80 are accepted by a separate
+ * flag. The tables are derived from the scalar predicates at load time, so
+ * every implementation classifies bytes identically.
+ */
+enum scan_class
+  { SCAN_TOKEN = 0
+  , SCAN_HEADER_VALUE
+  , SCAN_URL
+  , SCAN_MAX
+  };
+
+/* Below this many bytes the vector setup is not worth it */
+#define SCAN_MIN_LEN 16
+
+static const char *
+scan_run_scalar(enum scan_class cls, const char *p, const char *end)
+{
+  switch (cls) {
+    case SCAN_TOKEN:
+      while (p != end && TOKEN(*p)) ++p;
+      break;
+    case SCAN_HEADER_VALUE:
+      while (p != end && IS_HEADER_VALUE_RUN_CHAR(*p)) ++p;
+      break;
+    case SCAN_URL:
+      while (p != end && IS_URL_CHAR(*p)) ++p;
+      break;
+    default:
+      break;
+  }
+  return p;
+}
+
+#if HTTP_PARSER_X86_SIMD
+
+static int
+scan_class_member(enum scan_class cls, unsigned char ch)
+{
+  switch (cls) {
+    case SCAN_TOKEN:
+      return TOKEN(ch) != 0;
+    case SCAN_HEADER_VALUE:
+      return IS_HEADER_VALUE_RUN_CHAR(ch);
+    case SCAN_URL:
+      return IS_URL_CHAR(ch);
+    default:
+      return 0;
+  }
+}
+
+static struct {
+  uint8_t lo[16];
+  uint8_t hi[16];
+  int high_ok;  /* whether bytes >= 0x80 belong to the class */
+} scan_tables[SCAN_MAX];
+
+__attribute__((target("sse4.2")))
+static const char *
+scan_run_sse42(enum scan_class cls, const char *p, const char *end)
+{
+  const __m128i lo_tbl = _mm_loadu_si128((const __m128i *)scan_tables[cls].lo);
+  const __m128i hi_tbl = _mm_loadu_si128((const __m128i *)scan_tables[cls].hi);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  const __m128i zero = _mm_setzero_si128();
+  const int high_ok = scan_tables[cls].high_ok;
+
+  for (; end - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i lo = _mm_shuffle_epi8(lo_tbl, _mm_and_si128(v, nibble));
+    __m128i hi = _mm_shuffle_epi8(hi_tbl,
+                                  _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    unsigned int stop =
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero));
+    if (high_ok) {
+      stop &= ~(unsigned int)_mm_movemask_epi8(v);
+    }
+    if (stop) {
+      return p + __builtin_ctz(stop);
+    }
+  }
+  return scan_run_scalar(cls, p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *
+scan_run_avx2(enum scan_class cls, const char *p, const char *end)
+{
+  const __m256i lo_tbl = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((const __m128i *)scan_tables[cls].lo));
+  const __m256i hi_tbl = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((const __m128i *)scan_tables[cls].hi));
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+  const int high_ok = scan_tables[cls].high_ok;
+
+  for (; end - p >= 32; p += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i lo = _mm256_shuffle_epi8(lo_tbl, _mm256_and_si256(v, nibble));
+    __m256i hi = _mm256_shuffle_epi8(
+      hi_tbl, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    unsigned int stop = (unsigned int)
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero));
+    if (high_ok) {
+      stop &= ~(unsigned int)_mm256_movemask_epi8(v);
+    }
+    if (stop) {
+      return p + __builtin_ctz(stop);
+    }
+  }
+  /* Finish with at most one 16-byte block before going byte-by-byte */
+  return scan_run_sse42(cls, p, end);
+}
+
+#endif /* HTTP_PARSER_X86_SIMD */
+
+static enum http_parser_scan_mode scan_mode = HTTP_PARSER_SCAN_SCALAR;
+
+static enum http_parser_scan_mode
+scan_mode_supported(enum http_parser_scan_mode mode)
+{
+#if HTTP_PARSER_X86_SIMD
+  __builtin_cpu_init();
+  if (mode == HTTP_PARSER_SCAN_AUTO) {
+    mode = HTTP_PARSER_SCAN_AVX2;
+  }
+  if (mode == HTTP_PARSER_SCAN_AVX2 && !__builtin_cpu_supports("avx2")) {
+    mode = HTTP_PARSER_SCAN_SSE42;
+  }
+  if (mode == HTTP_PARSER_SCAN_SSE42 && !__builtin_cpu_supports("sse4.2")) {
+    mode = HTTP_PARSER_SCAN_SCALAR;
+  }
+  return mode;
+#else
+  (void)mode;
+  return HTTP_PARSER_SCAN_SCALAR;
+#endif
+}
+
+#if HTTP_PARSER_X86_SIMD
+__attribute__((constructor))
+static void
+scan_init(void)
+{
+  int cls;
+  unsigned int ch;
+
+  for (cls = 0; cls < SCAN_MAX; cls++) {
+    for (ch = 0; ch < 0x80; ch++) {
+      if (scan_class_member((enum scan_class)cls, (unsigned char)ch)) {
+        scan_tables[cls].lo[ch & 0x0f] |= (uint8_t)(1 << (ch >> 4));
+      }
+    }
+    for (ch = 0; ch < 8; ch++) {
+      scan_tables[cls].hi[ch] = (uint8_t)(1 << ch);
+    }
+    /* The vector code treats the upper half of the byte range as a single
+     * block; the scalar predicates have to agree. */
+    scan_tables[cls].high_ok =
+      scan_class_member((enum scan_class)cls, (unsigned char)0x80);
+    for (ch = 0x80; ch < 0x100; ch++) {
+      assert(scan_class_member((enum scan_class)cls, (unsigned char)ch) ==
+             scan_tables[cls].high_ok);
+    }
+  }
+
+  scan_mode = scan_mode_supported(HTTP_PARSER_SCAN_AUTO);
+}
+#endif /* HTTP_PARSER_X86_SIMD */
+
+static const char *
+scan_run(enum scan_class cls, const char *p, const char *end)
+{
+  switch (scan_mode) {
+#if HTTP_PARSER_X86_SIMD
+    case HTTP_PARSER_SCAN_AVX2:
+      return scan_run_avx2(cls, p, end);
+    case HTTP_PARSER_SCAN_SSE42:
+      return scan_run_sse42(cls, p, end);
+#endif
+    default:
+      return scan_run_scalar(cls, p, end);
+  }
+}
+
 #define start_state (parser->type == HTTP_REQUEST ? s_pre_start_req : s_pre_start_res)
 
 #define STRICT_CHECK(cond)
@@ -1144,7 +1352,13 @@ size_t http_parser_execute (http_parser *parser,
 
       case s_req_path:
       {
-        if (IS_URL_CHAR(ch)) break;
+        if (IS_URL_CHAR(ch)) {
+          if (data + len - p > SCAN_MIN_LEN) {
+            /* resume the state machine at the first non-URL byte */
+            p = scan_run(SCAN_URL, p + 1, data + len) - 1;
+          }
+          break;
+        }
 
         switch (ch) {
           case ' ':
@@ -1216,7 +1430,13 @@ size_t http_parser_execute (http_parser *parser,
 
       case s_req_query_string:
       {
-        if (IS_URL_CHAR(ch)) break;
+        if (IS_URL_CHAR(ch)) {
+          if (data + len - p > SCAN_MIN_LEN) {
+            /* resume the state machine at the first non-URL byte */
+            p = scan_run(SCAN_URL, p + 1, data + len) - 1;
+          }
+          break;
+        }
 
         switch (ch) {
           case '?':
@@ -1288,7 +1508,13 @@ size_t http_parser_execute (http_parser *parser,
 
       case s_req_fragment:
       {
-        if (IS_URL_CHAR(ch)) break;
+        if (IS_URL_CHAR(ch)) {
+          if (data + len - p > SCAN_MIN_LEN) {
+            /* resume the state machine at the first non-URL byte */
+            p = scan_run(SCAN_URL, p + 1, data + len) - 1;
+          }
+          break;
+        }
 
         switch (ch) {
           case ' ':
@@ -1512,7 +1738,16 @@ size_t http_parser_execute (http_parser *parser,
                 }                        \
               } while(0);
 
-              if (data + len - p >= 9) {
+              if (data + len - p > SCAN_MIN_LEN) {
+                const char *run_end = scan_run(SCAN_TOKEN, p + 1, data + len);
+                if (run_end == data + len) {
+                  p = run_end - 1;
+                  break;
+                }
+                p = run_end;
+                ch = *p;
+                goto notatoken;
+              } else if (data + len - p >= 9) {
                 MOVE_THE_HEAD
                 MOVE_THE_HEAD
                 MOVE_THE_HEAD
@@ -1712,7 +1947,17 @@ size_t http_parser_execute (http_parser *parser,
               }                                       \
             } while(0);
 
-            if (data + len - p >= 12) {
+            if (data + len - p > SCAN_MIN_LEN) {
+              const char *run_end =
+                scan_run(SCAN_HEADER_VALUE, p + 1, data + len);
+              if (run_end == data + len) {
+                p = run_end - 1;
+                break;
+              }
+              p = run_end;
+              ch = *p;
+              goto cr_or_lf_or_qt;
+            } else if (data + len - p >= 12) {
               MOVE_FAST
               MOVE_FAST
               MOVE_FAST
@@ -2428,6 +2673,12 @@ http_parser_parse_url(const char *buf, size_t buflen, int is_connect,
   return 0;
 }
 
+enum http_parser_scan_mode
+http_parser_set_scan_mode(enum http_parser_scan_mode mode) {
+  scan_mode = scan_mode_supported(mode);
+  return scan_mode;
+}
+
 void
 http_parser_pause(http_parser *parser, int paused) {
   /* Users should only be pausing/unpausing a parser that is not in an error
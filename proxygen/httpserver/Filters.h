@@ -9,8 +9,11 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <glog/logging.h>
 #include <proxygen/httpserver/RequestHandler.h>
 #include <proxygen/httpserver/ResponseHandler.h>
+#include <proxygen/lib/http/session/HTTPFileSegments.h>
 
 namespace proxygen {
 
@@ -88,6 +91,19 @@ class Filter : public RequestHandler, public ResponseHandler {
     downstream_->sendBody(std::move(body));
   }
 
+  /**
+   * Reads the range and hands it to sendBody(), a chunk at a time, so that
+   * filters overriding only sendBody() see every body. Filters which let the
+   * bytes through untouched override this with forwardFileBody().
+   */
+  void sendFileBody(std::shared_ptr<folly::File> file,
+                    off_t offset,
+                    size_t length) noexcept override {
+    if (!readFileBody(*file, offset, length)) {
+      sendAbort();
+    }
+  }
+
   void sendChunkTerminator() noexcept override {
     downstream_->sendChunkTerminator();
   }
@@ -124,6 +140,38 @@ class Filter : public RequestHandler, public ResponseHandler {
     downstream_->getCurrentTransportInfo(tinfo);
   }
 
+ protected:
+  /**
+   * Pass the file range on unread, for sendfile(2) further down.
+   */
+  void forwardFileBody(std::shared_ptr<folly::File> file,
+                       off_t offset,
+                       size_t length) noexcept {
+    downstream_->sendFileBody(std::move(file), offset, length);
+  }
+
+  /**
+   * Read the range in chunks of HTTPFileSegments::kReadChunkSize, handing
+   * each to sendBody() as it is read. Returns false, having sent what came
+   * before, if the file could not be read or is too short.
+   */
+  bool readFileBody(const folly::File& file,
+                    off_t offset,
+                    size_t length) noexcept {
+    while (length > 0) {
+      size_t len = std::min(length, HTTPFileSegments::kReadChunkSize);
+      auto body = HTTPFileSegments::read(file.fd(), offset, len);
+      if (!body) {
+        LOG(ERROR) << "Failed to read " << len << " bytes of file body at "
+                   << offset;
+        return false;
+      }
+      sendBody(std::move(body));
+      offset += len;
+      length -= len;
+    }
+    return true;
+  }
 };
 
 }
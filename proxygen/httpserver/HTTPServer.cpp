@@ -10,11 +10,14 @@
 
 #include <proxygen/httpserver/HTTPServer.h>
 
+#include <folly/ScopeGuard.h>
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/system/ThreadName.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <proxygen/httpserver/HTTPServerAcceptor.h>
 #include <proxygen/httpserver/SignalHandler.h>
+#include <proxygen/httpserver/SocketTakeover.h>
+#include <proxygen/httpserver/WorkerListenerPool.h>
 #include <proxygen/httpserver/filters/RejectConnectFilter.h>
 #include <proxygen/httpserver/filters/ZlibServerFilter.h>
 #include <wangle/ssl/SSLContextManager.h>
@@ -90,6 +93,37 @@ void HTTPServer::bind(std::vector<IPConfig> const& addrs) {
   addresses_ = addrs;
 }
 
+namespace {
+
+// Also runs f if evb is not looping yet, when start() fails
+void runInThreadAndWait(EventBase* evb, folly::Function<void()> f) {
+  if (evb->isInEventBaseThread()) {
+    f();
+  } else {
+    evb->runInEventBaseThreadAndWait(std::move(f));
+  }
+}
+
+}
+
+// Tells the handler factories that a thread stopped as its event base is
+// destroyed, which happens once the connections of a retired thread drained
+class ServerStopCallback : public EventBase::LoopCallback {
+ public:
+  explicit ServerStopCallback(std::shared_ptr<HTTPServerOptions> options)
+      : options_(std::move(options)) {}
+
+  void runLoopCallback() noexcept override {
+    for (auto& factory: options_->handlerFactories) {
+      factory->onServerStop();
+    }
+    delete this;
+  }
+
+ private:
+  std::shared_ptr<HTTPServerOptions> options_;
+};
+
 class HandlerCallbacks : public ThreadPoolExecutor::Observer {
  public:
   explicit HandlerCallbacks(std::shared_ptr<HTTPServerOptions> options) : options_(options) {}
@@ -104,11 +138,8 @@ class HandlerCallbacks : public ThreadPoolExecutor::Observer {
     });
   }
   void threadStopped(ThreadPoolExecutor::ThreadHandle* h) override {
-    IOThreadPoolExecutor::getEventBase(h)->runInEventBaseThread([&](){
-      for (auto& factory: options_->handlerFactories) {
-        factory->onServerStop();
-      }
-    });
+    IOThreadPoolExecutor::getEventBase(h)->runOnDestruction(
+      new ServerStopCallback(options_));
   }
 
  private:
@@ -119,13 +150,32 @@ class HandlerCallbacks : public ThreadPoolExecutor::Observer {
 void HTTPServer::start(std::function<void()> onSuccess,
                        std::function<void(std::exception_ptr)> onError) {
   mainEventBase_ = EventBaseManager::get()->getEventBase();
-
-  auto accExe = std::make_shared<IOThreadPoolExecutor>(1);
-  auto exe = std::make_shared<IOThreadPoolExecutor>(options_->threads,
-    std::make_shared<folly::NamedThreadFactory>("HTTPSrvExec"));
-  auto exeObserver = std::make_shared<HandlerCallbacks>(options_);
-  // Observer has to be set before bind(), so onServerStart() callbacks run
-  exe->addObserver(exeObserver);
+  HTTPMemoryBudget::setProcessLimits(options_->processMemoryBudgetHighWater,
+                                     options_->processMemoryBudgetLowWater);
+
+  // Without IO threads the connections are served on this thread, which
+  // listens on its own. Existing sockets are given per address, they can't
+  // be split by thread either.
+  bool runInline = options_->threads == 0;
+  bool perWorker = !runInline && options_->perWorkerListeners &&
+    options_->preboundSockets_.empty();
+  std::shared_ptr<IOThreadPoolExecutor> accExe;
+  std::shared_ptr<IOThreadPoolExecutor> exe;
+  if (runInline) {
+    for (auto& factory: options_->handlerFactories) {
+      factory->onServerStart(mainEventBase_);
+    }
+  } else {
+    if (!perWorker) {
+      accExe = std::make_shared<IOThreadPoolExecutor>(1);
+    }
+    exe = std::make_shared<IOThreadPoolExecutor>(options_->threads,
+      std::make_shared<folly::NamedThreadFactory>("HTTPSrvExec"));
+    auto exeObserver = std::make_shared<HandlerCallbacks>(options_);
+    // Observer has to be set before bind(), so onServerStart() callbacks run
+    exe->addObserver(exeObserver);
+    workerExecutor_ = exe;
+  }
 
   try {
     FOR_EACH_RANGE (i, 0, addresses_.size()) {
@@ -136,6 +186,22 @@ void HTTPServer::start(std::function<void()> onSuccess,
           codecFactory,
           accConfig,
           sessionInfoCb_);
+      if (runInline || perWorker) {
+        auto pool = std::make_shared<WorkerListenerPool>(
+          accConfig, factory, perWorker, options_->steerListenersByCpu);
+        listenerPools_.push_back(pool);
+        if (runInline) {
+          if (options_->preboundSockets_.size() > 0) {
+            pool->useExistingSocket(std::move(options_->preboundSockets_[i]));
+          }
+          pool->addWorker(mainEventBase_);
+        } else {
+          // Each running thread binds its socket right away
+          exe->addObserver(pool);
+        }
+        addresses_[i].address = pool->getAddress();
+        continue;
+      }
       bootstrap_.push_back(
           wangle::ServerBootstrap<wangle::DefaultPipeline>());
       bootstrap_[i].childHandler(factory);
@@ -155,6 +221,17 @@ void HTTPServer::start(std::function<void()> onSuccess,
         bootstrap_[i].bind(addresses_[i].address);
       }
     }
+
+    if (options_->socketTakeoverChannel_) {
+      // The old server can stop listening now that this one does
+      SocketTakeover::acknowledge(options_->socketTakeoverChannel_);
+      options_->socketTakeoverChannel_.closeNoThrow();
+    }
+    if (!options_->socketTakeoverPath.empty()) {
+      takeoverServer_ = std::make_unique<SocketTakeoverServer>(
+        mainEventBase_, this);
+      takeoverServer_->start(options_->socketTakeoverPath);
+    }
   } catch (const std::exception& ex) {
     stop();
 
@@ -189,14 +266,79 @@ void HTTPServer::stopListening() {
   for (auto& bootstrap : bootstrap_) {
     bootstrap.stop();
   }
+  for (auto& pool : listenerPools_) {
+    pool->stopListening();
+  }
+}
+
+void HTTPServer::drain() {
+  stopListening();
+  forEachAcceptor([&](wangle::Acceptor* acceptor) {
+    if (!acceptor) {
+      return;
+    }
+    auto evb = acceptor->getEventBase();
+    if (!evb) {
+      return;
+    }
+    // Idle connections close after the acceptor's graceful shutdown timeout
+    evb->runInEventBaseThread([acceptor] {
+      acceptor->drainAllConnections();
+    });
+  });
+}
+
+void HTTPServer::setThreads(size_t threads,
+                            std::chrono::milliseconds drainTimeout) {
+  CHECK(workerExecutor_) << "No IO threads to resize";
+  CHECK_GT(threads, 0);
+  std::lock_guard<std::mutex> guard(resizeMutex_);
+  if (threads < workerExecutor_->numThreads() && !bootstrap_.empty()) {
+    throw std::logic_error(
+      "Can't retire the IO threads of a shared listener");
+  }
+  // The pools are told which threads stop by the executor, from this thread
+  for (auto& pool : listenerPools_) {
+    pool->setRetireDrainTimeout(drainTimeout);
+  }
+  SCOPE_EXIT {
+    for (auto& pool : listenerPools_) {
+      pool->setRetireDrainTimeout(std::chrono::milliseconds(0));
+    }
+  };
+  workerExecutor_->setNumThreads(threads);
+}
+
+size_t HTTPServer::getThreads() const {
+  return workerExecutor_ ? workerExecutor_->numThreads() : 0;
 }
 
 void HTTPServer::stop() {
+  runInThreadAndWait(mainEventBase_, [this] {
+    takeoverServer_.reset();
+  });
   stopListening();
 
   for (auto& bootstrap : bootstrap_) {
     bootstrap.join();
   }
+  if (workerExecutor_) {
+    // Already joined by the bootstraps, unless the threads listen themselves
+    workerExecutor_->join();
+    workerExecutor_.reset();
+  }
+  if (options_->threads == 0) {
+    // What the IO threads do as they stop
+    runInThreadAndWait(mainEventBase_, [this] {
+      for (auto& pool : listenerPools_) {
+        pool->removeWorker(mainEventBase_);
+      }
+      for (auto& factory: options_->handlerFactories) {
+        factory->onServerStop();
+      }
+    });
+  }
+  listenerPools_.clear();
 
   signalHandler_.reset();
   mainEventBase_->terminateLoopSoon();
@@ -213,22 +355,37 @@ const std::vector<const folly::AsyncSocketBase*>
       sockets.push_back(bootstrapSockets[j].get());
     }
   }
+  for (auto& pool : listenerPools_) {
+    for (auto& socket : pool->getSockets()) {
+      sockets.push_back(socket.get());
+    }
+  }
 
   return sockets;
 }
 
 int HTTPServer::getListenSocket() const {
-  if (bootstrap_.size() == 0) {
-    return -1;
-  }
+  std::shared_ptr<folly::AsyncServerSocket> serverSocket;
+  if (!listenerPools_.empty()) {
+    // Any of the threads' sockets, they share the same port
+    auto poolSockets = listenerPools_[0]->getSockets();
+    if (poolSockets.size() == 0) {
+      return -1;
+    }
+    serverSocket = poolSockets[0];
+  } else {
+    if (bootstrap_.size() == 0) {
+      return -1;
+    }
 
-  auto& bootstrapSockets = bootstrap_[0].getSockets();
-  if (bootstrapSockets.size() == 0) {
-    return -1;
-  }
+    auto& bootstrapSockets = bootstrap_[0].getSockets();
+    if (bootstrapSockets.size() == 0) {
+      return -1;
+    }
 
-  auto serverSocket =
-      std::dynamic_pointer_cast<folly::AsyncServerSocket>(bootstrapSockets[0]);
+    serverSocket = std::dynamic_pointer_cast<folly::AsyncServerSocket>(
+      bootstrapSockets[0]);
+  }
   auto socketFds = serverSocket->getSockets();
   if (socketFds.size() == 0) {
     return -1;
@@ -237,40 +394,69 @@ int HTTPServer::getListenSocket() const {
   return socketFds[0];
 }
 
+std::vector<std::vector<int>> HTTPServer::getListenSockets() const {
+  std::vector<std::vector<int>> sockets;
+  auto addFds = [&](std::vector<int>& fds, const folly::AsyncSocketBase* s) {
+    auto serverSocket = dynamic_cast<const folly::AsyncServerSocket*>(s);
+    if (serverSocket) {
+      auto socketFds = serverSocket->getSockets();
+      fds.insert(fds.end(), socketFds.begin(), socketFds.end());
+    }
+  };
+  for (auto& bootstrap : bootstrap_) {
+    sockets.emplace_back();
+    for (auto& socket : bootstrap.getSockets()) {
+      addFds(sockets.back(), socket.get());
+    }
+  }
+  for (auto& pool : listenerPools_) {
+    sockets.emplace_back();
+    for (auto& socket : pool->getSockets()) {
+      addFds(sockets.back(), socket.get());
+    }
+  }
+  return sockets;
+}
 
-void HTTPServer::updateTLSCredentials() {
+
+void HTTPServer::forEachAcceptor(std::function<void(wangle::Acceptor*)> f) {
   for (auto& bootstrap : bootstrap_) {
-    bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
-      if (!acceptor) {
-        return;
-      }
-      auto evb = acceptor->getEventBase();
-      if (!evb) {
-        return;
-      }
-      evb->runInEventBaseThread([acceptor] {
-        acceptor->resetSSLContextConfigs();
-      });
-    });
+    bootstrap.forEachWorker(f);
+  }
+  for (auto& pool : listenerPools_) {
+    pool->forEachAcceptor(f);
   }
 }
 
+void HTTPServer::updateTLSCredentials() {
+  forEachAcceptor([&](wangle::Acceptor* acceptor) {
+    if (!acceptor) {
+      return;
+    }
+    auto evb = acceptor->getEventBase();
+    if (!evb) {
+      return;
+    }
+    evb->runInEventBaseThread([acceptor] {
+      acceptor->resetSSLContextConfigs();
+    });
+  });
+}
+
 void HTTPServer::updateTicketSeeds(wangle::TLSTicketKeySeeds seeds) {
-  for (auto& bootstrap : bootstrap_) {
-    bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
-      if (!acceptor) {
-        return;
-      }
-      auto evb = acceptor->getEventBase();
-      if (!evb) {
-        return;
-      }
-      evb->runInEventBaseThread([acceptor, seeds] {
-        acceptor->setTLSTicketSecrets(
-            seeds.oldSeeds, seeds.currentSeeds, seeds.newSeeds);
-      });
+  forEachAcceptor([&](wangle::Acceptor* acceptor) {
+    if (!acceptor) {
+      return;
+    }
+    auto evb = acceptor->getEventBase();
+    if (!evb) {
+      return;
+    }
+    evb->runInEventBaseThread([acceptor, seeds] {
+      acceptor->setTLSTicketSecrets(
+          seeds.oldSeeds, seeds.currentSeeds, seeds.newSeeds);
     });
-  }
+  });
 }
 
 }
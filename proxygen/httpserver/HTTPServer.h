@@ -15,12 +15,16 @@
 #include <proxygen/httpserver/HTTPServerOptions.h>
 #include <proxygen/lib/http/codec/HTTPCodecFactory.h>
 #include <proxygen/lib/http/session/HTTPSession.h>
+#include <chrono>
+#include <mutex>
 #include <thread>
 
 namespace proxygen {
 
 class SignalHandler;
+class SocketTakeoverServer;
 class HTTPServerAcceptor;
+class WorkerListenerPool;
 
 /**
  * HTTPServer based on proxygen http libraries
@@ -99,7 +103,8 @@ class HTTPServer final {
    * Start HTTPServer.
    *
    * Note this is a blocking call and the current thread will be used to listen
-   * for incoming connections. Throws exception if something goes wrong (say
+   * for incoming connections, and to serve them if `HTTPServerOptions::threads`
+   * is 0. Throws exception if something goes wrong (say
    * somebody else is already listening on that socket).
    *
    * `onSuccess` callback will be invoked from the event loop which shows that
@@ -121,6 +126,34 @@ class HTTPServer final {
    */
   void stopListening();
 
+  /**
+   * Stop listening, and close the connections as they finish their requests.
+   * HTTP/2 connections send GOAWAY right away, idle connections are closed
+   * after the graceful shutdown timeout. Can be called from any thread, but
+   * only after start() has called onSuccess.
+   */
+  void drain();
+
+  /**
+   * Change the number of IO threads of the running server. Added threads get
+   * their share of the new connections right away. Retired threads stop
+   * listening and drain their connections from their own event loop, which
+   * keeps running until they are done, or drainTimeout passed and the
+   * remaining ones are dropped. Returns once the retired threads exited.
+   *
+   * Only perWorkerListeners servers can retire threads: the acceptors of the
+   * shared listener drop their connections as their thread stops, and this
+   * throws std::logic_error rather than do that.
+   *
+   * Can be called from any thread but the IO threads, once start() has
+   * called onSuccess, unless the server has no IO threads.
+   */
+  void setThreads(size_t threads,
+                  std::chrono::milliseconds drainTimeout =
+                    std::chrono::milliseconds(10000));
+
+  size_t getThreads() const;
+
   /**
    * Stop HTTPServer.
    *
@@ -154,6 +187,11 @@ class HTTPServer final {
    */
   int getListenSocket() const;
 
+  /**
+   * Returns the file descriptors of the listening sockets of each address
+   */
+  std::vector<std::vector<int>> getListenSockets() const;
+
   /**
    * Re-reads the certificate / key pair for all SSL vips on all acceptors
    */
@@ -165,6 +203,8 @@ class HTTPServer final {
   void updateTicketSeeds(wangle::TLSTicketKeySeeds seeds);
 
  private:
+  void forEachAcceptor(std::function<void(wangle::Acceptor*)> f);
+
   std::shared_ptr<HTTPServerOptions> options_;
 
   /**
@@ -177,12 +217,30 @@ class HTTPServer final {
    */
   std::unique_ptr<SignalHandler> signalHandler_;
 
+  /**
+   * Hands the listening sockets over to a new server, if enabled
+   */
+  std::unique_ptr<SocketTakeoverServer> takeoverServer_;
+
   /**
    * Addresses we are listening on
    */
   std::vector<IPConfig> addresses_;
   std::vector<wangle::ServerBootstrap<wangle::DefaultPipeline>> bootstrap_;
 
+  /**
+   * With perWorkerListeners or without IO threads, the listeners of each
+   * address instead of their bootstrap, and the IO threads they follow
+   */
+  std::vector<std::shared_ptr<WorkerListenerPool>> listenerPools_;
+  std::shared_ptr<folly::IOThreadPoolExecutor> workerExecutor_;
+
+  /**
+   * Serializes setThreads(), which has the pools drain the threads stopping
+   * meanwhile
+   */
+  std::mutex resizeMutex_;
+
   /**
    * Callback for session create/destruction
    */
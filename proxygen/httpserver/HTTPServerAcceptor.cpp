@@ -32,6 +32,25 @@ AcceptorConfiguration HTTPServerAcceptor::makeConfig(
   conf.receiveSessionWindowSize = opts.receiveSessionWindowSize;
   conf.acceptBacklog = opts.listenBacklog;
   conf.maxConcurrentIncomingStreams = opts.maxConcurrentIncomingStreams;
+  conf.zeroCopyIngressHeaders = opts.zeroCopyIngressHeaders;
+  conf.internHeaderValues = opts.internHeaderValues;
+  conf.extensiblePrioritiesEnabled = opts.extensiblePrioritiesEnabled;
+  conf.hibernateTimeout = opts.hibernateTimeout;
+  conf.zeroCopyThreshold = opts.zeroCopyThreshold;
+  conf.egressPacingRate = opts.egressPacingRate;
+  conf.egressPacingBurst = opts.egressPacingBurst;
+  conf.useSocketPacing = opts.useSocketPacing;
+  conf.egressPacingClasses = opts.egressPacingClasses;
+  conf.notSentLowat = opts.notSentLowat;
+  conf.readByteBudget = opts.readByteBudget;
+  conf.readTimeBudget = opts.readTimeBudget;
+  conf.memoryBudgetHighWater = opts.memoryBudgetHighWater;
+  conf.memoryBudgetLowWater = opts.memoryBudgetLowWater;
+  conf.maxEventLoopLag = opts.maxEventLoopLag;
+  conf.maxEventLoopQueueDepth = opts.maxEventLoopQueueDepth;
+  conf.eventLoopCheckInterval = opts.eventLoopCheckInterval;
+  conf.overloadRespondWith503 = opts.overloadRespondWith503;
+  conf.overloadIdleConnectionsToDrop = opts.overloadIdleConnectionsToDrop;
 
   if (ipConfig.protocol == HTTPServer::Protocol::SPDY) {
     conf.plaintextProtocol = "spdy/3.1";
@@ -69,15 +88,19 @@ std::unique_ptr<HTTPServerAcceptor> HTTPServerAcceptor::make(
   std::reverse(handlerFactories.begin(), handlerFactories.end());
 
   return std::unique_ptr<HTTPServerAcceptor>(
-      new HTTPServerAcceptor(conf, codecFactory, handlerFactories));
+      new HTTPServerAcceptor(conf, codecFactory, handlerFactories,
+                             opts.sessionStats));
 }
 
 HTTPServerAcceptor::HTTPServerAcceptor(
     const AcceptorConfiguration& conf,
     const std::shared_ptr<HTTPCodecFactory>& codecFactory,
-    std::vector<RequestHandlerFactory*> handlerFactories)
+    std::vector<RequestHandlerFactory*> handlerFactories,
+    HTTPSessionStats* sessionStats)
     : HTTPSessionAcceptor(conf, codecFactory),
-      handlerFactories_(handlerFactories) {}
+      handlerFactories_(handlerFactories) {
+  downstreamSessionStats_ = sessionStats;
+}
 
 void HTTPServerAcceptor::setCompletionCallback(std::function<void()> f) {
   completionCallback_ = f;
@@ -36,7 +36,8 @@ class HTTPServerAcceptor final : public HTTPSessionAcceptor {
  private:
   HTTPServerAcceptor(const AcceptorConfiguration& conf,
                      const std::shared_ptr<HTTPCodecFactory>& codecFactory,
-                     std::vector<RequestHandlerFactory*> handlerFactories);
+                     std::vector<RequestHandlerFactory*> handlerFactories,
+                     HTTPSessionStats* sessionStats);
 
   // HTTPSessionAcceptor
   HTTPTransaction::Handler* newHandler(HTTPTransaction& txn,
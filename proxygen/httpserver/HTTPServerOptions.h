@@ -13,6 +13,9 @@
 #include <folly/SocketAddress.h>
 #include <proxygen/httpserver/Filters.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/SocketTakeover.h>
+#include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/services/AcceptorConfiguration.h>
 #include <signal.h>
 
 namespace proxygen {
@@ -29,10 +32,12 @@ class HTTPServerOptions {
    * Number of threads to start to handle requests. Note that this excludes
    * the thread you call `HTTPServer.start()` in.
    *
+   * With `threads == 0` no thread is created, and that thread accepts and
+   * serves the connections itself. This saves the threads and the handoff
+   * of each connection between them, for servers with little load.
+   *
    * XXX: Put some perf numbers to help user decide how many threads to
    *      create.
-   * XXX: Maybe support not creating any more worker threads and doing all
-   *      the work in same thread when `threads == 0`.
    */
   size_t threads = 1;
 
@@ -68,6 +73,28 @@ class HTTPServerOptions {
    */
   uint32_t listenBacklog{1024};
 
+  /**
+   * Give each IO thread a listening socket of its own for every address,
+   * bound with SO_REUSEPORT, on which its acceptor accepts directly. The
+   * kernel spreads the connections over the sockets, instead of a single
+   * acceptor thread handing each of them over to an IO thread, which limits
+   * the accept rate under connection storms. Addresses given an existing
+   * socket (see useExistingSocket) keep a single listener.
+   *
+   * On Linux a BPF program picks the listener, so that setThreads() can stop
+   * giving connections to a retired thread before closing its listener.
+   */
+  bool perWorkerListeners{false};
+
+  /**
+   * With perWorkerListeners, have the BPF program picking the listener of
+   * each connection give it to the listener of index CPU % threads, for the
+   * CPU which received it, instead of a random one. A connection then stays
+   * on one CPU from the NIC queue to its handler, if the IO threads are
+   * pinned in that order. Linux only.
+   */
+  bool steerListenersByCpu{false};
+
   /**
    * Enable cleartext upgrades to HTTP/2
    */
@@ -100,6 +127,134 @@ class HTTPServerOptions {
    */
   uint32_t maxConcurrentIncomingStreams{100};
 
+  /**
+   * Set to true to keep HTTP/1.x request header values in the read buffer
+   * they arrived in rather than copying each one into its own string. This
+   * saves allocations on header-heavy requests, at the cost of pinning the
+   * read buffer for as long as the request headers are alive. HTTP/2 values
+   * are referenced the same way when sent as plain literals, and decoded
+   * into a memory block shared by the header block otherwise.
+   */
+  bool zeroCopyIngressHeaders{false};
+
+  /**
+   * Set to true to have the HTTP/2 connections of a thread share one copy of
+   * each header value held in their HPACK tables, such as popular user
+   * agents or cookies, rather than each connection holding its own.
+   */
+  bool internHeaderValues{false};
+
+  /**
+   * Set to true to schedule the responses of HTTP/2 connections by the
+   * urgency and incremental parameters of RFC 9218, sent by clients in the
+   * priority header and PRIORITY_UPDATE frames, rather than by the HTTP/2
+   * dependency tree.
+   */
+  bool extensiblePrioritiesEnabled{false};
+
+  /**
+   * How long a connection can go without requests before it hibernates,
+   * freeing its header compression tables and other state that is rebuilt
+   * on the next request. Meant to be shorter than idleTimeout, 0 disables
+   * hibernation.
+   */
+  std::chrono::milliseconds hibernateTimeout{0};
+
+  /**
+   * Send writes of at least this many bytes with MSG_ZEROCOPY on plaintext
+   * connections, sparing the kernel a copy of large response bodies. Body
+   * IOBufs must then be left untouched once sent, as the kernel reads them
+   * after the write completes. Below about 10KB the page pinning costs
+   * more than the copy. 0 disables it; it also needs Linux 4.14 or later.
+   */
+  size_t zeroCopyThreshold{0};
+
+  /**
+   * Record the stats of every session here, such as its zero copy writes.
+   * It's shared by all the IO threads so it must be thread safe, and must
+   * outlive the server. Not owned; nullptr records nothing.
+   */
+  HTTPSessionStats* sessionStats{nullptr};
+
+  /**
+   * Pace the responses of each connection to this many bytes per second,
+   * in bursts of up to egressPacingBurst bytes, to smooth out the bursts
+   * that bloat buffers and lose packets further down the path. 0 disables
+   * pacing.
+   */
+  uint64_t egressPacingRate{0};
+  uint64_t egressPacingBurst{0};
+
+  /**
+   * Leave the pacing of each connection to the kernel, through
+   * SO_MAX_PACING_RATE, where it supports it.
+   */
+  bool useSocketPacing{false};
+
+  /**
+   * Pace the connections of clients in some networks together, the first
+   * class matching the client applies on top of the per connection rate.
+   * Each thread paces its own connections of a class to the class rate.
+   */
+  std::vector<EgressPacingClass> egressPacingClasses;
+
+  /**
+   * Set TCP_NOTSENT_LOWAT to this on each connection, and only write when
+   * the socket has less than that left to send, rather than filling its
+   * send buffer. HTTP/2 then picks the next frames by priority when they
+   * can go out soon, not seconds ahead on a slow link. 16KB to 128KB is a
+   * good range; 0 disables it.
+   */
+  uint32_t notSentLowat{0};
+
+  /**
+   * Let a connection parse at most this many bytes, or for at most this
+   * long, each time the event loop comes around to it. A client pipelining
+   * thousands of requests, or sending a burst of HTTP/2 frames, then only
+   * delays the other connections of its thread by that much. 0 leaves
+   * either unbounded.
+   */
+  size_t readByteBudget{0};
+  std::chrono::microseconds readTimeBudget{0};
+
+  /**
+   * Ingress and egress bytes the connections of a worker thread may buffer
+   * together. Past the high water mark the connections holding the most
+   * stop reading and pause their handlers' egress, until the total is back
+   * under the low water mark. 0 disables the budget.
+   */
+  uint64_t memoryBudgetHighWater{0};
+  uint64_t memoryBudgetLowWater{0};
+
+  /**
+   * The same, for the connections of all threads together. Only applies to
+   * threads with a budget of their own.
+   */
+  uint64_t processMemoryBudgetHighWater{0};
+  uint64_t processMemoryBudgetLowWater{0};
+
+  /**
+   * A worker thread is overloaded while its event loop runs timeouts this
+   * late, or has this many callbacks queued from other threads, sampled
+   * every eventLoopCheckInterval. It then closes new connections right
+   * away, or answers their first request with a 503 if
+   * overloadRespondWith503, and drops up to overloadIdleConnectionsToDrop
+   * idle connections per sample. 0 disables either check.
+   */
+  std::chrono::milliseconds maxEventLoopLag{0};
+  size_t maxEventLoopQueueDepth{0};
+  std::chrono::milliseconds eventLoopCheckInterval{100};
+  bool overloadRespondWith503{false};
+  size_t overloadIdleConnectionsToDrop{0};
+
+  /**
+   * Unix socket path on which to hand the listening sockets over to a new
+   * server, see SocketTakeover. This one then stops listening and drains
+   * its connections. Only servers running as the same user may take over.
+   * Empty to refuse takeovers.
+   */
+  std::string socketTakeoverPath;
+
   /**
    * Set to true to enable gzip content compression. Currently false for
    * backwards compatibility.
@@ -159,5 +314,25 @@ class HTTPServerOptions {
     socket->useExistingSockets(socketFds);
     useExistingSocket(std::move(socket));
   }
+
+  /**
+   * Take over the listening sockets of the server accepting takeovers on
+   * path, rather than binding new ones. Its addresses must be bound in the
+   * same order. It stops listening once this server listens. Throws if the
+   * sockets can't be had.
+   */
+  void takeOverSockets(const std::string& path) {
+    auto sockets = SocketTakeover::receiveSockets(
+      path, socketTakeoverChannel_);
+    for (auto& socketFds: sockets) {
+      useExistingSockets(socketFds);
+    }
+  }
+
+  /**
+   * Connection to the server whose sockets were taken over, to tell it when
+   * they are listened on.
+   */
+  folly::File socketTakeoverChannel_;
 };
 }
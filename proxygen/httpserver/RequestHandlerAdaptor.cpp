@@ -143,6 +143,12 @@ void RequestHandlerAdaptor::sendBody(std::unique_ptr<folly::IOBuf> b) noexcept {
   txn_->sendBody(std::move(b));
 }
 
+void RequestHandlerAdaptor::sendFileBody(std::shared_ptr<folly::File> file,
+                                         off_t offset,
+                                         size_t length) noexcept {
+  txn_->sendFileBody(std::move(file), offset, length);
+}
+
 void RequestHandlerAdaptor::sendChunkTerminator() noexcept {
   txn_->sendChunkTerminator();
 }
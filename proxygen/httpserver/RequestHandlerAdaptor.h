@@ -55,6 +55,9 @@ class RequestHandlerAdaptor
   void sendHeaders(HTTPMessage& msg) noexcept override;
   void sendChunkHeader(size_t len) noexcept override;
   void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override;
+  void sendFileBody(std::shared_ptr<folly::File> file,
+                    off_t offset,
+                    size_t length) noexcept override;
   void sendChunkTerminator() noexcept override;
   void sendEOM() noexcept override;
   void sendAbort() noexcept override;
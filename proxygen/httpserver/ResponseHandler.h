@@ -61,6 +61,15 @@ class ResponseHandler {
 
   virtual void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept = 0;
 
+  /**
+   * Send length bytes of file from offset as body, see
+   * HTTPTransaction::sendFileBody. Filters that need to see the body get
+   * the bytes read into an IOBuf instead.
+   */
+  virtual void sendFileBody(std::shared_ptr<folly::File> file,
+                            off_t offset,
+                            size_t length) noexcept = 0;
+
   virtual void sendChunkTerminator() noexcept = 0;
 
   virtual void sendEOM() noexcept = 0;
@@ -0,0 +1,279 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/SocketTakeover.h>
+
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <glog/logging.h>
+#include <proxygen/httpserver/HTTPServer.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_CMSG_CLOEXEC
+#define MSG_CMSG_CLOEXEC 0
+#endif
+
+namespace proxygen {
+
+namespace {
+
+// The user id of the process at the other end of the Unix socket fd
+bool getPeerUid(int fd, uid_t& uid) {
+#ifdef SO_PEERCRED
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) {
+    return false;
+  }
+  uid = cred.uid;
+  return true;
+#else
+  gid_t gid;
+  return getpeereid(fd, &uid, &gid) == 0;
+#endif
+}
+
+}
+
+const size_t SocketTakeover::kMaxSockets;
+
+bool SocketTakeover::sendSockets(
+    int fd, const std::vector<std::vector<int>>& sockets) {
+  // The number of addresses, then the number of sockets of each
+  std::vector<uint32_t> header{uint32_t(sockets.size())};
+  std::vector<int> fds;
+  for (auto& addressFds: sockets) {
+    header.push_back(addressFds.size());
+    fds.insert(fds.end(), addressFds.begin(), addressFds.end());
+  }
+  if (sockets.size() > kMaxSockets || fds.size() > kMaxSockets) {
+    LOG(ERROR) << "Too many sockets to hand over: " << fds.size();
+    return false;
+  }
+
+  struct iovec iov;
+  iov.iov_base = header.data();
+  iov.iov_len = header.size() * sizeof(uint32_t);
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+  if (!fds.empty()) {
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+  }
+
+  ssize_t rc;
+  do {
+    rc = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+  } while (rc < 0 && errno == EINTR);
+  if (rc != ssize_t(iov.iov_len)) {
+    LOG(ERROR) << "Failed to hand sockets over, rc=" << rc
+               << " errno=" << errno;
+    return false;
+  }
+  return true;
+}
+
+std::vector<std::vector<int>> SocketTakeover::receiveSockets(
+    const std::string& path,
+    folly::File& channel,
+    std::chrono::milliseconds timeout) {
+  folly::File sock(::socket(AF_UNIX, SOCK_STREAM, 0), true);
+  folly::checkUnixError(sock.fd(), "socket takeover: socket() failed");
+  struct timeval tv;
+  tv.tv_sec = timeout.count() / 1000;
+  tv.tv_usec = (timeout.count() % 1000) * 1000;
+  folly::checkUnixError(
+    ::setsockopt(sock.fd(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)),
+    "socket takeover: setsockopt() failed");
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::invalid_argument("socket takeover path too long: " + path);
+  }
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path, path.data(), path.size());
+  folly::checkUnixError(
+    ::connect(sock.fd(), reinterpret_cast<struct sockaddr*>(&addr),
+              sizeof(addr)),
+    "socket takeover: connect() to ", path, " failed");
+
+  uint32_t header[kMaxSockets + 1];
+  struct iovec iov;
+  iov.iov_base = header;
+  iov.iov_len = sizeof(header);
+  union {
+    char buf[CMSG_SPACE(sizeof(int) * kMaxSockets)];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  ssize_t rc;
+  do {
+    rc = ::recvmsg(sock.fd(), &msg, MSG_CMSG_CLOEXEC);
+  } while (rc < 0 && errno == EINTR);
+  folly::checkUnixError(rc, "socket takeover: recvmsg() failed");
+
+  // Taken first, so that they are closed if the message is invalid
+  std::vector<int> fds;
+  for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      auto data = reinterpret_cast<int*>(CMSG_DATA(cmsg));
+      fds.insert(fds.end(), data, data + count);
+    }
+  }
+
+  size_t addresses = rc >= ssize_t(sizeof(uint32_t)) ? header[0] : 0;
+  size_t total = 0;
+  bool valid = rc >= ssize_t(sizeof(uint32_t)) &&
+    addresses <= kMaxSockets &&
+    size_t(rc) == (addresses + 1) * sizeof(uint32_t) &&
+    !(msg.msg_flags & MSG_CTRUNC);
+  for (size_t i = 0; valid && i < addresses; i++) {
+    total += header[i + 1];
+  }
+  if (!valid || total != fds.size()) {
+    for (auto fd: fds) {
+      ::close(fd);
+    }
+    throw std::runtime_error("socket takeover: invalid message from " + path);
+  }
+
+  std::vector<std::vector<int>> sockets(addresses);
+  auto it = fds.begin();
+  for (size_t i = 0; i < addresses; i++) {
+    sockets[i].assign(it, it + header[i + 1]);
+    it += header[i + 1];
+  }
+  channel = std::move(sock);
+  return sockets;
+}
+
+void SocketTakeover::acknowledge(folly::File& channel) {
+  char ack = 1;
+  if (folly::writeNoInt(channel.fd(), &ack, 1) != 1) {
+    // the old server keeps listening
+    LOG(ERROR) << "Failed to acknowledge socket takeover, errno=" << errno;
+  }
+}
+
+SocketTakeoverServer::SocketTakeoverServer(folly::EventBase* evb,
+                                           HTTPServer* server,
+                                           PeerCheck peerCheck)
+    : folly::EventHandler(evb),
+      evb_(evb),
+      server_(server),
+      peerCheck_(std::move(peerCheck)) {
+  if (!peerCheck_) {
+    peerCheck_ = [](uid_t uid) { return uid == geteuid(); };
+  }
+}
+
+SocketTakeoverServer::~SocketTakeoverServer() {
+  closeChannel();
+  if (socket_) {
+    // Not taken over, nobody listens on the path anymore
+    socket_.reset();
+    ::unlink(path_.c_str());
+  }
+}
+
+void SocketTakeoverServer::start(const std::string& path) {
+  path_ = path;
+  // Left by a server which didn't stop, or handed over to this one
+  ::unlink(path.c_str());
+  folly::SocketAddress addr;
+  addr.setFromPath(path);
+  socket_.reset(new folly::AsyncServerSocket(evb_));
+  socket_->bind(addr);
+  // Whoever connects gets the listening sockets, and can have this server
+  // drain. Nobody can connect before listen().
+  folly::checkUnixError(::chmod(path.c_str(), S_IRUSR | S_IWUSR),
+                        "socket takeover: chmod() of ", path, " failed");
+  socket_->listen(1);
+  socket_->addAcceptCallback(this, nullptr);
+  socket_->startAccepting();
+}
+
+void SocketTakeoverServer::connectionAccepted(
+    int fd, const folly::SocketAddress&) noexcept {
+  if (channel_ >= 0) {
+    LOG(WARNING) << "Socket takeover already in progress";
+    ::close(fd);
+    return;
+  }
+  uid_t uid;
+  if (!getPeerUid(fd, uid)) {
+    LOG(ERROR) << "Socket takeover refused, failed to get the peer's "
+               << "credentials, errno=" << errno;
+    ::close(fd);
+    return;
+  }
+  if (!peerCheck_(uid)) {
+    LOG(ERROR) << "Socket takeover refused to user " << uid;
+    ::close(fd);
+    return;
+  }
+  if (!SocketTakeover::sendSockets(fd, server_->getListenSockets())) {
+    ::close(fd);
+    return;
+  }
+  channel_ = fd;
+  changeHandlerFD(fd);
+  registerHandler(EventHandler::READ | EventHandler::PERSIST);
+}
+
+void SocketTakeoverServer::acceptError(const std::exception& ex) noexcept {
+  LOG(ERROR) << "Failed to accept socket takeover: " << ex.what();
+}
+
+void SocketTakeoverServer::handlerReady(uint16_t) noexcept {
+  char ack;
+  auto rc = ::read(channel_, &ack, 1);
+  if (rc < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return;
+  }
+  closeChannel();
+  if (rc != 1) {
+    LOG(WARNING) << "Socket takeover aborted by the new server";
+    return;
+  }
+  LOG(INFO) << "Listening sockets taken over, draining connections";
+  // The new server listens for takeovers on the path from now on
+  socket_.reset();
+  server_->drain();
+}
+
+void SocketTakeoverServer::closeChannel() {
+  if (channel_ < 0) {
+    return;
+  }
+  unregisterHandler();
+  changeHandlerFD(-1);
+  ::close(channel_);
+  channel_ = -1;
+}
+
+}
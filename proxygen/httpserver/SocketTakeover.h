@@ -0,0 +1,111 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <folly/File.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/EventHandler.h>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace proxygen {
+
+class HTTPServer;
+
+/**
+ * Hands the listening sockets of a server over to a new one on the same
+ * host, so that restarts don't refuse connections nor lose those waiting in
+ * the accept queue.
+ *
+ * The new server connects to the Unix socket the old one listens on, which
+ * only its user may connect to, and gets its listening sockets through
+ * SCM_RIGHTS, those of each address of
+ * the old server in the order they were bound. Both then accept from the
+ * same sockets, until the new server sends a byte to tell it is listening.
+ * The old server then stops listening and drains its connections. Closing
+ * the connection instead leaves the old server as it was.
+ */
+class SocketTakeover {
+ public:
+  /**
+   * Send the listening sockets of each address over the Unix socket fd.
+   * Returns false on failure.
+   */
+  static bool sendSockets(int fd, const std::vector<std::vector<int>>& sockets);
+
+  /**
+   * Connect to the server listening for takeovers on path and get its
+   * listening sockets. channel is left connected to it, for acknowledge().
+   * Throws on failure.
+   */
+  static std::vector<std::vector<int>> receiveSockets(
+    const std::string& path,
+    folly::File& channel,
+    std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
+
+  /**
+   * Tell the old server that the new one now listens on its sockets.
+   */
+  static void acknowledge(folly::File& channel);
+
+  // As many descriptors as Linux passes in a message (SCM_MAX_FD)
+  static const size_t kMaxSockets = 253;
+};
+
+/**
+ * The old server's side, running on the EventBase of the thread which
+ * started it.
+ */
+class SocketTakeoverServer :
+    private folly::AsyncServerSocket::AcceptCallback,
+    private folly::EventHandler {
+ public:
+  /**
+   * Whether a peer of the given user id may take the sockets over. By
+   * default only the effective user of this process.
+   */
+  using PeerCheck = std::function<bool(uid_t)>;
+
+  SocketTakeoverServer(folly::EventBase* evb,
+                       HTTPServer* server,
+                       PeerCheck peerCheck = nullptr);
+  ~SocketTakeoverServer() override;
+
+  /**
+   * Listen for takeovers on path, only accessible to this process' user.
+   * Throws on failure.
+   */
+  void start(const std::string& path);
+
+ private:
+  // AsyncServerSocket::AcceptCallback
+  void connectionAccepted(int fd,
+                          const folly::SocketAddress& clientAddr)
+    noexcept override;
+  void acceptError(const std::exception& ex) noexcept override;
+
+  // EventHandler, for the new server's acknowledgement
+  void handlerReady(uint16_t events) noexcept override;
+
+  void closeChannel();
+
+  folly::EventBase* evb_;
+  HTTPServer* server_;
+  PeerCheck peerCheck_;
+  std::string path_;
+  folly::AsyncServerSocket::UniquePtr socket_;
+  // The connection of the new server being handed the sockets
+  int channel_{-1};
+};
+
+}
@@ -0,0 +1,362 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/WorkerListenerPool.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <linux/filter.h>
+#include <netinet/tcp.h>
+#endif
+
+using folly::EventBase;
+using folly::IOThreadPoolExecutor;
+using folly::ThreadPoolExecutor;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace proxygen {
+
+namespace {
+
+// How often a retired worker checks whether its connections are gone
+const milliseconds kRetirePollInterval(10);
+
+// How long a retired listener keeps accepting after the kernel stopped
+// steering connections to it, for the handshakes it had started
+const milliseconds kRetireLinger(100);
+
+// The connections the kernel queued for the socket, not accepted yet
+uint32_t acceptQueueLength(const folly::AsyncServerSocket& socket) {
+  uint32_t queued = 0;
+#ifdef __linux__
+  for (auto fd : socket.getSockets()) {
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    // For a listening socket, the length of its accept queue
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+      queued += info.tcpi_unacked;
+    }
+  }
+#endif
+  return queued;
+}
+
+void runInThreadAndWait(EventBase* evb, folly::Function<void()> f) {
+  if (evb->isInEventBaseThread()) {
+    f();
+  } else {
+    evb->runInEventBaseThreadAndWait(std::move(f));
+  }
+}
+
+}
+
+WorkerListenerPool::WorkerListenerPool(
+  const AcceptorConfiguration& config,
+  std::shared_ptr<wangle::AcceptorFactory> acceptorFactory,
+  bool reusePort,
+  bool steerByCpu)
+    : config_(config),
+      acceptorFactory_(std::move(acceptorFactory)),
+      reusePort_(reusePort),
+      steerByCpu_(steerByCpu),
+      address_(config.bindAddress) {}
+
+void WorkerListenerPool::useExistingSocket(
+    folly::AsyncServerSocket::UniquePtr socket) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  existingSocket_ = std::move(socket);
+}
+
+void WorkerListenerPool::threadStarted(ThreadPoolExecutor::ThreadHandle* h) {
+  auto evb = IOThreadPoolExecutor::getEventBase(h);
+  CHECK(evb) << "Invariant violated - started thread must have an EventBase";
+  addWorker(evb);
+}
+
+void WorkerListenerPool::threadStopped(ThreadPoolExecutor::ThreadHandle* h) {
+  auto evb = IOThreadPoolExecutor::getEventBase(h);
+  milliseconds drainTimeout;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    drainTimeout = retireDrainTimeout_;
+  }
+  if (drainTimeout.count() > 0) {
+    retireWorker(evb, drainTimeout);
+  } else {
+    removeWorker(evb);
+  }
+}
+
+void WorkerListenerPool::setRetireDrainTimeout(milliseconds drainTimeout) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  retireDrainTimeout_ = drainTimeout;
+}
+
+void WorkerListenerPool::addWorker(EventBase* evb) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  Worker worker;
+  worker.evb = evb;
+  std::exception_ptr ex;
+  runInThreadAndWait(evb, [&] {
+    try {
+      worker.acceptor = acceptorFactory_->newAcceptor(evb);
+      if (listening_) {
+        worker.socket = listen(evb, worker.acceptor.get());
+      }
+    } catch (...) {
+      ex = std::current_exception();
+      worker.acceptor.reset();
+    }
+  });
+  if (ex) {
+    std::rethrow_exception(ex);
+  }
+  workers_.emplace(evb, std::move(worker));
+  updateSteering();
+}
+
+void WorkerListenerPool::removeWorker(EventBase* evb) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = workers_.find(evb);
+  if (it == workers_.end()) {
+    // it failed to start listening
+    return;
+  }
+  auto worker = std::move(it->second);
+  workers_.erase(it);
+  runInThreadAndWait(worker.evb, [&] {
+    closeListener(worker);
+    worker.acceptor->dropAllConnections();
+    worker.acceptor.reset();
+  });
+  updateSteering();
+}
+
+void WorkerListenerPool::retireWorker(EventBase* evb,
+                                      milliseconds drainTimeout) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = workers_.find(evb);
+  if (it == workers_.end()) {
+    return;
+  }
+  auto worker = std::move(it->second);
+  workers_.erase(it);
+  // Closing the listener would reset the connections it has queued, the
+  // kernel gives the others the new ones first
+  bool linger = false;
+  if (worker.socket) {
+    for (auto& member : group_) {
+      if (member.socket == worker.socket.get()) {
+        member.retiring = true;
+      }
+    }
+    linger = updateSteering();
+  }
+  // Taken before the thread stops looping, the token keeps its event base
+  // looping as it is destroyed
+  evb->runInEventBaseThread(
+    [this, worker = std::move(worker), drainTimeout, linger,
+     keepAlive = evb->getKeepAliveToken()]() mutable {
+      auto retirement = new Retirement(
+        this, std::move(worker), drainTimeout, linger, std::move(keepAlive));
+      retirement->start();
+    });
+}
+
+WorkerListenerPool::Retirement::Retirement(
+  WorkerListenerPool* pool,
+  Worker worker,
+  milliseconds drainTimeout,
+  bool linger,
+  folly::Executor::KeepAlive keepAlive)
+    : folly::AsyncTimeout(worker.evb),
+      pool_(pool),
+      worker_(std::move(worker)),
+      keepAlive_(std::move(keepAlive)),
+      lingerDeadline_(steady_clock::now() +
+                      (linger ? kRetireLinger : milliseconds(0))),
+      deadline_(steady_clock::now() + drainTimeout) {}
+
+void WorkerListenerPool::Retirement::start() {
+  if (!worker_.socket) {
+    worker_.acceptor->drainAllConnections();
+  }
+  timeoutExpired();
+}
+
+void WorkerListenerPool::Retirement::timeoutExpired() noexcept {
+  auto now = steady_clock::now();
+  if (worker_.socket) {
+    if (now < lingerDeadline_ ||
+        (now < deadline_ && acceptQueueLength(*worker_.socket) > 0)) {
+      scheduleTimeout(kRetirePollInterval);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> guard(pool_->mutex_);
+      pool_->closeListener(worker_);
+      pool_->updateSteering();
+    }
+    // Idle connections close after the acceptor's graceful shutdown timeout
+    worker_.acceptor->drainAllConnections();
+  }
+  auto connections = worker_.acceptor->getNumConnections();
+  if (connections > 0 && now < deadline_) {
+    scheduleTimeout(kRetirePollInterval);
+    return;
+  }
+  if (connections > 0) {
+    LOG(WARNING) << "Dropping " << connections
+                 << " connections of a retired IO thread";
+    worker_.acceptor->dropAllConnections();
+  }
+  worker_.acceptor.reset();
+  // Lets the event base of the stopped thread be destroyed
+  delete this;
+}
+
+std::shared_ptr<folly::AsyncServerSocket> WorkerListenerPool::listen(
+    EventBase* evb, wangle::Acceptor* acceptor) {
+  std::shared_ptr<folly::AsyncServerSocket> socket;
+  if (existingSocket_) {
+    socket = std::move(existingSocket_);
+    socket->attachEventBase(evb);
+    socket->getAddress(&address_);
+  } else {
+    socket = folly::AsyncServerSocket::newSocket(evb);
+    socket->setReusePortEnabled(reusePort_);
+    if (config_.enableTCPFastOpen) {
+      socket->setTFOEnabled(true, config_.fastOpenQueueSize);
+    }
+    socket->bind(address_);
+    if (address_.getPort() == 0) {
+      // the other threads bind to the port chosen for this one
+      socket->getAddress(&address_);
+    }
+  }
+  socket->listen(config_.acceptBacklog);
+  if (reusePort_) {
+    group_.push_back(GroupMember{socket.get(), false});
+  }
+  // Accepted connections go to the acceptor right away, on this thread
+  socket->addAcceptCallback(acceptor, nullptr);
+  socket->startAccepting();
+  return socket;
+}
+
+void WorkerListenerPool::closeListener(Worker& worker) {
+  if (!worker.socket) {
+    return;
+  }
+  worker.socket->stopAccepting();
+  // As the kernel does, the last socket of the group takes its index
+  auto it = std::find_if(group_.begin(), group_.end(),
+                         [&](const GroupMember& member) {
+                           return member.socket == worker.socket.get();
+                         });
+  if (it != group_.end()) {
+    *it = group_.back();
+    group_.pop_back();
+  }
+  worker.socket.reset();
+}
+
+bool WorkerListenerPool::updateSteering() {
+  if (!reusePort_) {
+    return false;
+  }
+  // The indexes in the group of the sockets to give connections to
+  std::vector<uint32_t> listeners;
+  for (uint32_t i = 0; i < group_.size(); i++) {
+    if (!group_[i].retiring) {
+      listeners.push_back(i);
+    }
+  }
+  if (listeners.empty()) {
+    return false;
+  }
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+  std::vector<struct sock_filter> code;
+  // A = the CPU the connection was received on, or a random number
+  code.push_back({ BPF_LD | BPF_W | BPF_ABS, 0, 0,
+    uint32_t(SKF_AD_OFF + (steerByCpu_ ? SKF_AD_CPU : SKF_AD_RANDOM)) });
+  // A = A % listeners
+  code.push_back({ BPF_ALU | BPF_MOD | BPF_K, 0, 0,
+                   uint32_t(listeners.size()) });
+  // the index of the A-th listener, skipping those retiring
+  for (uint32_t i = 0; i < listeners.size(); i++) {
+    code.push_back({ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, i });
+    code.push_back({ BPF_RET | BPF_K, 0, 0, listeners[i] });
+  }
+  code.push_back({ BPF_RET | BPF_K, 0, 0, listeners[0] });
+  if (code.size() > BPF_MAXINSNS) {
+    LOG(WARNING) << "Too many listeners on " << address_ << " to steer";
+    return false;
+  }
+  // The program of any socket applies to all those sharing its port. An
+  // index past the group, if other processes' sockets changed it, has the
+  // kernel hash the connection's addresses instead.
+  struct sock_fprog prog = { uint16_t(code.size()), code.data() };
+  if (setsockopt(group_.front().socket->getSocket(), SOL_SOCKET,
+                 SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) != 0) {
+    LOG(WARNING) << "Failed to steer listeners of " << address_
+                 << ", errno=" << errno;
+    return false;
+  }
+  return true;
+#else
+  if (steerByCpu_) {
+    LOG(WARNING) << "Steering listeners by CPU is not supported";
+  }
+  return false;
+#endif
+}
+
+void WorkerListenerPool::stopListening() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  listening_ = false;
+  for (auto& it: workers_) {
+    auto& worker = it.second;
+    runInThreadAndWait(worker.evb, [&] {
+      closeListener(worker);
+    });
+  }
+}
+
+folly::SocketAddress WorkerListenerPool::getAddress() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return address_;
+}
+
+std::vector<std::shared_ptr<folly::AsyncServerSocket>>
+WorkerListenerPool::getSockets() const {
+  std::vector<std::shared_ptr<folly::AsyncServerSocket>> sockets;
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& it: workers_) {
+    if (it.second.socket) {
+      sockets.push_back(it.second.socket);
+    }
+  }
+  return sockets;
+}
+
+void WorkerListenerPool::forEachAcceptor(
+    std::function<void(wangle::Acceptor*)> f) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& it: workers_) {
+    f(it.second.acceptor.get());
+  }
+}
+
+}
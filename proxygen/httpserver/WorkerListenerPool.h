@@ -0,0 +1,163 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/SocketAddress.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <proxygen/lib/services/AcceptorConfiguration.h>
+#include <wangle/acceptor/Acceptor.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Listens on an address with a socket per IO thread, all bound with
+ * SO_REUSEPORT, the kernel balancing the connections between them. Each
+ * thread's acceptor accepts from its own socket, on its own thread.
+ *
+ * Observes the IO thread pool: threads get their acceptor and socket when
+ * they start, and lose them when they stop. Event bases can also be added
+ * directly, such as the one of the thread starting a server without IO
+ * threads.
+ *
+ * Threads stopping while a retire drain timeout is set are retired instead:
+ * their connections are drained from their own event loop, which is kept
+ * running after the thread stopped until they are gone.
+ *
+ * With SO_REUSEPORT a BPF program picks the listener of each connection, on
+ * Linux. A retired thread's listener is left out of it, and only closed
+ * once it accepted what the kernel had queued for it: closing it right away
+ * would reset those connections.
+ */
+class WorkerListenerPool : public folly::ThreadPoolExecutor::Observer {
+ public:
+  WorkerListenerPool(
+    const AcceptorConfiguration& config,
+    std::shared_ptr<wangle::AcceptorFactory> acceptorFactory,
+    bool reusePort,
+    bool steerByCpu);
+
+  /**
+   * Have the next worker listen on socket, already bound, instead of binding
+   * a new one.
+   */
+  void useExistingSocket(folly::AsyncServerSocket::UniquePtr socket);
+
+  /**
+   * Start accepting connections on evb, with an acceptor of its own, and
+   * stop. Must not be called from another worker's thread.
+   */
+  void addWorker(folly::EventBase* evb);
+  void removeWorker(folly::EventBase* evb);
+
+  /**
+   * Stop giving evb new connections, then drain its connections from its
+   * loop and drop those left after drainTimeout, without waiting. The event
+   * base is kept alive until then.
+   */
+  void retireWorker(folly::EventBase* evb,
+                    std::chrono::milliseconds drainTimeout);
+
+  /**
+   * Retire the threads stopping from now on, rather than remove them, until
+   * this is set back to 0.
+   */
+  void setRetireDrainTimeout(std::chrono::milliseconds drainTimeout);
+
+  // ThreadPoolExecutor::Observer
+  void threadStarted(folly::ThreadPoolExecutor::ThreadHandle* h) override;
+  void threadStopped(folly::ThreadPoolExecutor::ThreadHandle* h) override;
+
+  /**
+   * Close the listening sockets. The acceptors keep their connections.
+   */
+  void stopListening();
+
+  /**
+   * The address the sockets are bound to, with the port chosen by the
+   * first one if the configuration asked for port 0.
+   */
+  folly::SocketAddress getAddress() const;
+
+  std::vector<std::shared_ptr<folly::AsyncServerSocket>> getSockets() const;
+
+  void forEachAcceptor(std::function<void(wangle::Acceptor*)> f) const;
+
+ private:
+  struct Worker {
+    folly::EventBase* evb{nullptr};
+    std::shared_ptr<wangle::Acceptor> acceptor;
+    std::shared_ptr<folly::AsyncServerSocket> socket;
+  };
+
+  // A listening socket, in the order of the kernel's SO_REUSEPORT group
+  struct GroupMember {
+    folly::AsyncServerSocket* socket{nullptr};
+    bool retiring{false};
+  };
+
+  // Drains a retired worker from its loop, which its keep-alive token keeps
+  // running after the thread stopped, then deletes itself. Its listener, if
+  // the kernel no longer steers connections to it, first accepts what it
+  // has queued.
+  class Retirement : private folly::AsyncTimeout {
+   public:
+    Retirement(WorkerListenerPool* pool,
+               Worker worker,
+               std::chrono::milliseconds drainTimeout,
+               bool linger,
+               folly::Executor::KeepAlive keepAlive);
+
+    void start();
+
+   private:
+    void timeoutExpired() noexcept override;
+
+    // Its owner joins the IO threads before destroying it
+    WorkerListenerPool* pool_;
+    Worker worker_;
+    folly::Executor::KeepAlive keepAlive_;
+    std::chrono::steady_clock::time_point lingerDeadline_;
+    std::chrono::steady_clock::time_point deadline_;
+  };
+
+  std::shared_ptr<folly::AsyncServerSocket> listen(folly::EventBase* evb,
+                                                   wangle::Acceptor* acceptor);
+
+  // Closes the socket of worker, from its thread with mutex_ held
+  void closeListener(Worker& worker);
+
+  // Points the BPF program of the sockets at those not retiring, returns
+  // whether it was attached
+  bool updateSteering();
+
+  const AcceptorConfiguration config_;
+  const std::shared_ptr<wangle::AcceptorFactory> acceptorFactory_;
+  const bool reusePort_;
+  const bool steerByCpu_;
+
+  mutable std::mutex mutex_;
+  folly::SocketAddress address_;
+  bool listening_{true};
+  std::chrono::milliseconds retireDrainTimeout_{0};
+  folly::AsyncServerSocket::UniquePtr existingSocket_;
+  std::map<folly::EventBase*, Worker> workers_;
+  // A socket joins the group as it listens, and the last one takes the index
+  // of a socket that closes
+  std::vector<GroupMember> group_;
+};
+
+}
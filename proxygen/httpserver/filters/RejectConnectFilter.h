@@ -65,6 +65,10 @@ class RejectConnectFilter : public Filter {
 
   void sendBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {}
 
+  void sendFileBody(std::shared_ptr<folly::File> /*file*/,
+                    off_t /*offset*/,
+                    size_t /*length*/) noexcept override {}
+
   void sendChunkTerminator() noexcept override {
   }
 
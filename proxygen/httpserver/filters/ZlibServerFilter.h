@@ -15,6 +15,7 @@
 #include <proxygen/httpserver/RequestHandlerFactory.h>
 #include <proxygen/lib/utils/ZlibStreamCompressor.h>
 #include <proxygen/lib/http/RFC2616.h>
+#include <proxygen/lib/http/session/HTTPFileSegments.h>
 
 namespace proxygen {
 
@@ -83,41 +84,56 @@ class ZlibServerFilter : public Filter {
       return;
     }
 
-    //First time through the compressor
-    if (compressor_ == nullptr) {
-      compressor_ = std::make_unique<ZlibStreamCompressor>(
-          proxygen::ZlibCompressionType::GZIP, compressionLevel_);
-
-      if (!compressor_ || compressor_->hasError()) {
-        return fail();
-      }
+    if (!startCompressor()) {
+      return fail();
     }
-    DCHECK(compressor_ != nullptr);
 
     // If it's chunked, never write the trailer, it will be written on EOM
     auto compressed = compressor_->compress(body.get(), !chunked_);
     if (compressor_->hasError()) {
       return fail();
     }
+    sendCompressed(std::move(compressed));
+  }
 
-    auto compressedBodyLength = compressed->computeChainDataLength();
-
+  // The compressor needs the bytes, read a chunk at a time
+  void sendFileBody(std::shared_ptr<folly::File> file,
+                    off_t offset,
+                    size_t length) noexcept override {
+    if (!compress_) {
+      forwardFileBody(std::move(file), offset, length);
+      return;
+    }
     if (chunked_) {
-        // Send on the swallowed chunk header.
-        Filter::sendChunkHeader(compressedBodyLength);
-    } else {
-      //Send the content length on compressed, non-chunked messages
-      DCHECK(header_ == false);
-      DCHECK(compress_ == true);
-      auto& headers = responseMessage_->getHeaders();
-      headers.set(HTTP_HEADER_CONTENT_LENGTH,
-          folly::to<std::string>(compressedBodyLength));
-
-      Filter::sendHeaders(*responseMessage_);
-      header_  = true;
+      // Each chunk read is compressed into a chunk of its own
+      if (!readFileBody(*file, offset, length)) {
+        fail();
+      }
+      return;
     }
 
-    Filter::sendBody(std::move(compressed));
+    // A single body has its length sent before it, only known once all of it
+    // went through the compressor
+    if (!startCompressor()) {
+      return fail();
+    }
+    folly::IOBufQueue compressed(folly::IOBufQueue::cacheChainLength());
+    do {
+      size_t len = std::min(length, HTTPFileSegments::kReadChunkSize);
+      auto body = HTTPFileSegments::read(file->fd(), offset, len);
+      if (!body) {
+        LOG(ERROR) << "Failed to read " << len << " bytes of file body at "
+                   << offset;
+        return fail();
+      }
+      offset += len;
+      length -= len;
+      compressed.append(compressor_->compress(body.get(), length == 0));
+      if (compressor_->hasError()) {
+        return fail();
+      }
+    } while (length > 0);
+    sendCompressed(compressed.move());
   }
 
   void sendEOM() noexcept override {
@@ -147,6 +163,43 @@ class ZlibServerFilter : public Filter {
     Filter::sendAbort();
   }
 
+  // Creates the compressor the first time through, returns false on error
+  bool startCompressor() {
+    if (compressor_ == nullptr) {
+      compressor_ = std::make_unique<ZlibStreamCompressor>(
+          proxygen::ZlibCompressionType::GZIP, compressionLevel_);
+
+      if (!compressor_ || compressor_->hasError()) {
+        return false;
+      }
+    }
+    DCHECK(compressor_ != nullptr);
+    return true;
+  }
+
+  // Sends compressed output, preceded by its chunk header if chunked, or the
+  // headers with its length otherwise
+  void sendCompressed(std::unique_ptr<folly::IOBuf> compressed) {
+    auto compressedBodyLength = compressed->computeChainDataLength();
+
+    if (chunked_) {
+        // Send on the swallowed chunk header.
+        Filter::sendChunkHeader(compressedBodyLength);
+    } else {
+      //Send the content length on compressed, non-chunked messages
+      DCHECK(header_ == false);
+      DCHECK(compress_ == true);
+      auto& headers = responseMessage_->getHeaders();
+      headers.set(HTTP_HEADER_CONTENT_LENGTH,
+          folly::to<std::string>(compressedBodyLength));
+
+      Filter::sendHeaders(*responseMessage_);
+      header_  = true;
+    }
+
+    Filter::sendBody(std::move(compressed));
+  }
+
   //Verify the response is large enough to compress
   bool isMinimumCompressibleSize(const HTTPMessage& msg) const noexcept {
     auto contentLengthHeader =
@@ -0,0 +1,129 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/Mocks.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+// Sees the body through sendBody() only, like most filters
+class ByteCountingFilter : public Filter {
+ public:
+  explicit ByteCountingFilter(RequestHandler* upstream) : Filter(upstream) {}
+
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    bytes += body->computeChainDataLength();
+    Filter::sendBody(std::move(body));
+  }
+
+  size_t bytes{0};
+};
+
+class PassThroughFilter : public Filter {
+ public:
+  explicit PassThroughFilter(RequestHandler* upstream) : Filter(upstream) {}
+
+  void sendFileBody(std::shared_ptr<folly::File> file,
+                    off_t offset,
+                    size_t length) noexcept override {
+    forwardFileBody(std::move(file), offset, length);
+  }
+};
+
+}
+
+class FilterTest : public Test {
+ public:
+  void SetUp() override {
+    std::string content("0123456789");
+    ASSERT_EQ(ssize_t(content.size()),
+              folly::writeFull(tmp_.fd(), content.data(), content.size()));
+    file_ = std::make_shared<folly::File>(tmp_.path().string());
+  }
+
+  template <typename FilterType>
+  FilterType* makeFilter() {
+    auto filter = new FilterType(&requestHandler_);
+    EXPECT_CALL(requestHandler_, setResponseHandler(filter));
+    filter->setResponseHandler(&responseHandler_);
+    return filter;
+  }
+
+  void destroy(Filter* filter) {
+    EXPECT_CALL(requestHandler_, requestComplete());
+    filter->requestComplete();
+  }
+
+ protected:
+  folly::test::TemporaryFile tmp_;
+  std::shared_ptr<folly::File> file_;
+  MockRequestHandler requestHandler_;
+  MockResponseHandler responseHandler_{&requestHandler_};
+};
+
+TEST_F(FilterTest, FileBodyReadForSendBodyFilter) {
+  auto filter = makeFilter<ByteCountingFilter>();
+  std::string sent;
+  EXPECT_CALL(responseHandler_, sendFileBody(_, _, _)).Times(0);
+  EXPECT_CALL(responseHandler_, sendBody(_))
+    .WillOnce(Invoke([&](std::shared_ptr<folly::IOBuf> body) {
+          sent = body->moveToFbString().toStdString();
+        }));
+  filter->sendFileBody(file_, 2, 5);
+  EXPECT_EQ(5, filter->bytes);
+  EXPECT_EQ("23456", sent);
+  destroy(filter);
+}
+
+TEST_F(FilterTest, FileBodyReadInChunks) {
+  folly::test::TemporaryFile tmp;
+  std::string content(2 * HTTPFileSegments::kReadChunkSize + 10, 'a');
+  ASSERT_EQ(ssize_t(content.size()),
+            folly::writeFull(tmp.fd(), content.data(), content.size()));
+  auto file = std::make_shared<folly::File>(tmp.path().string());
+
+  auto filter = makeFilter<ByteCountingFilter>();
+  std::vector<size_t> chunks;
+  EXPECT_CALL(responseHandler_, sendBody(_))
+    .WillRepeatedly(Invoke([&](std::shared_ptr<folly::IOBuf> body) {
+          chunks.push_back(body->computeChainDataLength());
+        }));
+  filter->sendFileBody(file, 0, content.size());
+  EXPECT_EQ(content.size(), filter->bytes);
+  EXPECT_EQ(std::vector<size_t>({HTTPFileSegments::kReadChunkSize,
+                                 HTTPFileSegments::kReadChunkSize,
+                                 10}),
+            chunks);
+  destroy(filter);
+}
+
+TEST_F(FilterTest, FileBodyPastEndAborts) {
+  auto filter = makeFilter<ByteCountingFilter>();
+  EXPECT_CALL(responseHandler_, sendBody(_)).Times(0);
+  EXPECT_CALL(responseHandler_, sendAbort());
+  filter->sendFileBody(file_, 8, 5);
+  EXPECT_EQ(0, filter->bytes);
+  destroy(filter);
+}
+
+TEST_F(FilterTest, FileBodyForwardedByPassThroughFilter) {
+  auto filter = makeFilter<PassThroughFilter>();
+  EXPECT_CALL(responseHandler_, sendBody(_)).Times(0);
+  EXPECT_CALL(responseHandler_, sendFileBody(file_, 2, 5));
+  filter->sendFileBody(file_, 2, 5);
+  destroy(filter);
+}
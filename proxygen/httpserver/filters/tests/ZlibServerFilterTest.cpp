@@ -8,7 +8,10 @@
  *
  */
 #include <folly/Conv.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
 #include <folly/ScopeGuard.h>
+#include <folly/experimental/TestUtil.h>
 #include <folly/io/IOBuf.h>
 
 #include <folly/portability/GMock.h>
@@ -363,3 +366,72 @@ TEST_F(ZlibServerFilterTest, small_chunks_compress) {
                          1000);
   });
 }
+
+class ZlibServerFilterFileBodyTest : public ZlibServerFilterTest {
+ public:
+  void SetUp() override {
+    ZlibServerFilterTest::SetUp();
+    // More than one read of the file
+    content_ = std::string(HTTPFileSegments::kReadChunkSize + 10, 'a');
+    ASSERT_EQ(ssize_t(content_.size()),
+              folly::writeFull(tmp_.fd(), content_.data(), content_.size()));
+    file_ = std::make_shared<folly::File>(tmp_.path().string());
+
+    filter_ = new ZlibServerFilter(
+      requestHandler_, 4, 1,
+      std::make_shared<std::set<std::string>>(
+        std::set<std::string>{"text/html"}));
+    EXPECT_CALL(*requestHandler_, setResponseHandler(filter_));
+    filter_->setResponseHandler(responseHandler_.get());
+  }
+
+  void sendHeaders() {
+    HTTPMessage msg;
+    msg.setStatusCode(200);
+    msg.getHeaders().set(HTTP_HEADER_CONTENT_TYPE, "text/html");
+    msg.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                         folly::to<std::string>(content_.size()));
+    filter_->sendHeaders(msg);
+  }
+
+ protected:
+  folly::test::TemporaryFile tmp_;
+  std::string content_;
+  std::shared_ptr<folly::File> file_;
+};
+
+TEST_F(ZlibServerFilterFileBodyTest, compressed_in_one_body) {
+  std::string contentLength;
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+    .WillOnce(Invoke([&](HTTPMessage& msg) {
+          contentLength = msg.getHeaders().getSingleOrEmpty(
+            HTTP_HEADER_CONTENT_LENGTH);
+        }));
+  std::unique_ptr<folly::IOBuf> decompressed;
+  size_t compressedLength = 0;
+  EXPECT_CALL(*responseHandler_, sendBody(_))
+    .WillOnce(Invoke([&](std::shared_ptr<folly::IOBuf> body) {
+          compressedLength = body->computeChainDataLength();
+          decompressed = zd_->decompress(body.get());
+        }));
+  EXPECT_CALL(*responseHandler_, sendAbort()).Times(0);
+  EXPECT_CALL(*responseHandler_, sendEOM());
+  sendHeaders();
+  filter_->sendFileBody(file_, 0, content_.size());
+  filter_->sendEOM();
+  filter_->requestComplete();
+
+  EXPECT_FALSE(zd_->hasError());
+  EXPECT_EQ(folly::to<std::string>(compressedLength), contentLength);
+  EXPECT_THAT(decompressed, IOBufEquals(content_));
+}
+
+TEST_F(ZlibServerFilterFileBodyTest, short_read_aborts) {
+  EXPECT_CALL(*responseHandler_, sendHeaders(_)).Times(0);
+  EXPECT_CALL(*responseHandler_, sendBody(_)).Times(0);
+  EXPECT_CALL(*responseHandler_, sendAbort());
+  sendHeaders();
+  // The file ends within the second read
+  filter_->sendFileBody(file_, 0, content_.size() + 1);
+  filter_->requestComplete();
+}
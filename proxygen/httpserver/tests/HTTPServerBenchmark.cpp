@@ -0,0 +1,195 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/FileUtil.h>
+#include <proxygen/httpserver/ScopedHTTPServer.h>
+
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using namespace folly;
+using namespace proxygen;
+
+namespace {
+
+struct HelloHandler {
+  void operator()(const HTTPMessage&,
+                  std::unique_ptr<folly::IOBuf>,
+                  ResponseBuilder& response) {
+    response.status(200, "OK").body("hello");
+  }
+};
+
+std::unique_ptr<ScopedHTTPServer> startServer(HTTPServerOptions options) {
+  HTTPServer::IPConfig cfg{SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  options.listenBacklog = 4096;
+  options.handlerFactories.push_back(
+    std::make_unique<ScopedHandlerFactory<HelloHandler>>(HelloHandler()));
+  return ScopedHTTPServer::start(cfg, std::move(options));
+}
+
+// A request on a new connection, from connect() to the end of the response
+void getOnNewConnection(const SocketAddress& address) {
+  int fd = ::socket(address.getFamily(), SOCK_STREAM, 0);
+  CHECK_GE(fd, 0);
+  sockaddr_storage addr;
+  auto addrLen = address.getAddress(&addr);
+  CHECK_EQ(0, ::connect(fd, reinterpret_cast<sockaddr*>(&addr), addrLen));
+  static const std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n"
+                                   "Connection: close\r\n\r\n");
+  CHECK_EQ(static_cast<ssize_t>(request.size()),
+           folly::writeFull(fd, request.data(), request.size()));
+  char buf[4096];
+  while (folly::readNoInt(fd, buf, sizeof(buf)) > 0) {
+  }
+  ::close(fd);
+}
+
+// Connections opened back to back by a number of clients at once, each for
+// a single request, like the reconnects after a failover. The time per
+// iteration is the inverse of the accept rate, the latency of each
+// connection is that times the number of clients.
+void connectionStormBench(int iters, size_t threads, bool perWorker,
+                          size_t clients) {
+  std::unique_ptr<ScopedHTTPServer> server;
+  BENCHMARK_SUSPEND {
+    HTTPServerOptions options;
+    options.threads = threads;
+    options.perWorkerListeners = perWorker;
+    server = startServer(std::move(options));
+  }
+  auto address = server->getAddresses().front().address;
+  std::vector<std::thread> clientThreads;
+  for (size_t i = 0; i < clients; i++) {
+    clientThreads.emplace_back([&, i] {
+      for (size_t j = i; j < size_t(iters); j += clients) {
+        getOnNewConnection(address);
+      }
+    });
+  }
+  for (auto& thread: clientThreads) {
+    thread.join();
+  }
+  BENCHMARK_SUSPEND {
+    server.reset();
+  }
+}
+
+// Requests sent one after the other on a keep-alive connection, the time
+// per iteration is the latency of a request
+void keepAliveBench(int iters, size_t threads) {
+  std::unique_ptr<ScopedHTTPServer> server;
+  int fd = -1;
+  BENCHMARK_SUSPEND {
+    HTTPServerOptions options;
+    options.threads = threads;
+    server = startServer(std::move(options));
+    auto address = server->getAddresses().front().address;
+    fd = ::socket(address.getFamily(), SOCK_STREAM, 0);
+    CHECK_GE(fd, 0);
+    sockaddr_storage addr;
+    auto addrLen = address.getAddress(&addr);
+    CHECK_EQ(0, ::connect(fd, reinterpret_cast<sockaddr*>(&addr), addrLen));
+  }
+  static const std::string request("GET / HTTP/1.1\r\n"
+                                   "Host: localhost\r\n\r\n");
+  std::string response;
+  char buf[4096];
+  for (int i = 0; i < iters; i++) {
+    CHECK_EQ(static_cast<ssize_t>(request.size()),
+             folly::writeFull(fd, request.data(), request.size()));
+    // the body is the end of the response
+    response.clear();
+    while (response.size() < 5 ||
+           response.compare(response.size() - 5, 5, "hello") != 0) {
+      auto n = folly::readNoInt(fd, buf, sizeof(buf));
+      CHECK_GT(n, 0);
+      response.append(buf, n);
+    }
+  }
+  BENCHMARK_SUSPEND {
+    ::close(fd);
+    server.reset();
+  }
+}
+
+#ifdef __linux__
+// A line of /proc/self/status, such as the thread count or the RSS
+uint64_t readProcStatus(const std::string& field) {
+  std::string status;
+  folly::readFile("/proc/self/status", status);
+  auto pos = status.find("\n" + field + ":");
+  if (pos == std::string::npos) {
+    return 0;
+  }
+  return std::strtoull(status.c_str() + pos + field.size() + 2, nullptr, 10);
+}
+
+// What each of a number of idle servers costs the process
+void printFootprint(size_t threads, size_t servers) {
+  auto threadsBefore = readProcStatus("Threads");
+  auto rssBefore = readProcStatus("VmRSS");
+  std::vector<std::unique_ptr<ScopedHTTPServer>> running;
+  for (size_t i = 0; i < servers; i++) {
+    HTTPServerOptions options;
+    options.threads = threads;
+    running.push_back(startServer(std::move(options)));
+  }
+  LOG(INFO) << "threads=" << threads << ": "
+            << double(readProcStatus("Threads") - threadsBefore) / servers
+            << " threads and "
+            << double(readProcStatus("VmRSS") - rssBefore) / servers
+            << " KB RSS per server";
+}
+#endif
+
+}
+
+BENCHMARK_NAMED_PARAM(keepAliveBench, 1thread, 1);
+BENCHMARK_RELATIVE_NAMED_PARAM(keepAliveBench, inline, 0);
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(connectionStormBench, 1thread_1client, 1, false, 1);
+BENCHMARK_RELATIVE_NAMED_PARAM(connectionStormBench, inline_1client,
+                               0, false, 1);
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(connectionStormBench, shared_4threads_1client,
+                      4, false, 1);
+BENCHMARK_RELATIVE_NAMED_PARAM(connectionStormBench,
+                               perWorker_4threads_1client, 4, true, 1);
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(connectionStormBench, shared_4threads_16clients,
+                      4, false, 16);
+BENCHMARK_RELATIVE_NAMED_PARAM(connectionStormBench,
+                               perWorker_4threads_16clients, 4, true, 16);
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(connectionStormBench, shared_16threads_64clients,
+                      16, false, 64);
+BENCHMARK_RELATIVE_NAMED_PARAM(connectionStormBench,
+                               perWorker_16threads_64clients, 16, true, 64);
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+#ifdef __linux__
+  printFootprint(1, 16);
+  printFootprint(0, 16);
+#endif
+  folly::runBenchmarks();
+  return 0;
+}
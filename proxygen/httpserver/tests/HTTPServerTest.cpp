@@ -9,6 +9,7 @@
  */
 #include <boost/thread.hpp>
 #include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
 #include <folly/experimental/TestUtil.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/io/async/AsyncServerSocket.h>
@@ -17,6 +18,7 @@
 #include <proxygen/httpserver/HTTPServer.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
 #include <proxygen/httpserver/ScopedHTTPServer.h>
+#include <proxygen/httpserver/SocketTakeover.h>
 #include <proxygen/lib/utils/TestUtils.h>
 #include <proxygen/lib/http/HTTPConnector.h>
 #include <proxygen/httpclient/samples/curl/CurlClient.h>
@@ -666,3 +668,703 @@ TEST_F(ScopedServerTest, startSSLWithInsecure) {
   resp = client->getResponse();
   EXPECT_EQ(200, resp->getStatusCode());
 }
+
+namespace {
+
+std::string makeLargeBody() {
+  std::string body(1024 * 1024, '\0');
+  for (size_t i = 0; i < body.size(); i++) {
+    body[i] = 'a' + i % 26;
+  }
+  return body;
+}
+
+}
+
+class LargeBodyHandlerFactory : public RequestHandlerFactory {
+ public:
+  class LargeBodyHandler : public proxygen::RequestHandler {
+    void onRequest(std::unique_ptr<proxygen::HTTPMessage>) noexcept override {}
+    void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {}
+    void onUpgrade(proxygen::UpgradeProtocol) noexcept override {}
+
+    void onEOM() noexcept override {
+      ResponseBuilder(downstream_)
+          .status(200, "OK")
+          .body(IOBuf::copyBuffer(makeLargeBody()))
+          .sendWithEOM();
+    }
+
+    void requestComplete() noexcept override { delete this; }
+
+    void onError(ProxygenError) noexcept override { delete this; }
+  };
+
+  RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
+    return new LargeBodyHandler();
+  }
+
+  void onServerStart(folly::EventBase*) noexcept override {}
+  void onServerStop() noexcept override {}
+};
+
+// GET / with a blocking socket, reads the whole response
+void getOverLoopback(const folly::SocketAddress& address,
+                     std::string* response) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  SCOPE_EXIT {
+    ::close(fd);
+  };
+  sockaddr_storage addr;
+  auto addrLen = address.getAddress(&addr);
+  ASSERT_EQ(0, ::connect(fd, reinterpret_cast<sockaddr*>(&addr), addrLen));
+  std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n"
+                      "Connection: close\r\n\r\n");
+  ASSERT_EQ(static_cast<ssize_t>(request.size()),
+            folly::writeFull(fd, request.data(), request.size()));
+  char buf[64 * 1024];
+  ssize_t n;
+  while ((n = folly::readNoInt(fd, buf, sizeof(buf))) > 0) {
+    response->append(buf, n);
+  }
+}
+
+// The response is empty if the request couldn't be sent
+std::string getOverLoopback(const folly::SocketAddress& address) {
+  std::string response;
+  getOverLoopback(address, &response);
+  return response;
+}
+
+std::string getOverLoopback(const ScopedHTTPServer& server) {
+  return getOverLoopback(server.getAddresses().front().address);
+}
+
+// Counts what the server's sessions record, from any IO thread
+class CountingSessionStats : public HTTPSessionStats {
+ public:
+  void recordTransactionOpened() noexcept override {}
+  void recordTransactionClosed() noexcept override {}
+  void recordTransactionsServed(uint64_t) noexcept override {}
+  void recordSessionReused() noexcept override {}
+  void recordTransactionStalled() noexcept override {}
+  void recordSessionStalled() noexcept override {}
+  void recordTTLBAExceedLimit() noexcept override {}
+  void recordTTLBAIOBSplitByEom() noexcept override {}
+  void recordTTLBANotFound() noexcept override {}
+  void recordTTLBAReceived() noexcept override {}
+  void recordTTLBATimeout() noexcept override {}
+  void recordTTLBAEomPassed() noexcept override {}
+  void recordTTLBATracked() noexcept override {}
+
+  void recordZeroCopyWrite(uint64_t bytes) noexcept override {
+    zeroCopyBytes += bytes;
+  }
+  void recordEgressBlockedTime(std::chrono::milliseconds) noexcept override {
+    egressBlocked++;
+  }
+
+  std::atomic<uint64_t> zeroCopyBytes{0};
+  std::atomic<uint64_t> egressBlocked{0};
+};
+
+// Whether this kernel has SO_ZEROCOPY for TCP sockets
+bool zeroCopySupported() {
+#ifdef SO_ZEROCOPY
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  bool supported = fd >= 0 &&
+    ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+  ::close(fd);
+  return supported;
+#else
+  return false;
+#endif
+}
+
+TEST(ZeroCopy, LargeBodyOverLoopback) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 1;
+  options.zeroCopyThreshold = 16 * 1024;
+  CountingSessionStats stats;
+  options.sessionStats = &stats;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<LargeBodyHandlerFactory>().build();
+  auto server = ScopedHTTPServer::start(cfg, std::move(options));
+
+  // kernels without SO_ZEROCOPY fall back to regular sends, either way the
+  // body has to arrive intact
+  auto response = getOverLoopback(*server);
+  auto headerEnd = response.find("\r\n\r\n");
+  ASSERT_NE(std::string::npos, headerEnd);
+  EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+  EXPECT_TRUE(response.substr(headerEnd + 4) == makeLargeBody());
+  server.reset();
+  if (zeroCopySupported()) {
+    // the body went out in writes past the threshold
+    EXPECT_GT(stats.zeroCopyBytes, 0);
+  } else {
+    EXPECT_EQ(0, stats.zeroCopyBytes);
+  }
+}
+
+TEST(NotSentLowat, LargeBodyOverLoopback) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 1;
+  options.notSentLowat = 16 * 1024;
+  CountingSessionStats stats;
+  options.sessionStats = &stats;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<LargeBodyHandlerFactory>().build();
+  auto server = ScopedHTTPServer::start(cfg, std::move(options));
+
+  // the session writes 16KB at a time as the socket drains
+  auto response = getOverLoopback(*server);
+  auto headerEnd = response.find("\r\n\r\n");
+  ASSERT_NE(std::string::npos, headerEnd);
+  EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+  EXPECT_TRUE(response.substr(headerEnd + 4) == makeLargeBody());
+  server.reset();
+  // so it waited on the socket with more of the body to send
+  EXPECT_GT(stats.egressBlocked, 0);
+}
+
+TEST(PerWorkerListeners, AcceptOnEachThread) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 4;
+  options.perWorkerListeners = true;
+  options.steerListenersByCpu = true;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<TestHandlerFactory>().build();
+  auto server = ScopedHTTPServer::start(cfg, std::move(options));
+
+  // Whichever socket the kernel picks, the thread owning it answers
+  for (int i = 0; i < 20; i++) {
+    auto response = getOverLoopback(*server);
+    EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+    EXPECT_NE(std::string::npos, response.find("hello"));
+  }
+}
+
+TEST(PerWorkerListeners, SocketPerThread) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 4;
+  options.perWorkerListeners = true;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<TestHandlerFactory>().build();
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+  server->bind(ips);
+  ServerThread st(server.get());
+  EXPECT_TRUE(st.start());
+
+  auto port = server->addresses().front().address.getPort();
+  EXPECT_NE(0, port);
+  auto sockets = server->getSockets();
+  ASSERT_EQ(4, sockets.size());
+  for (auto socket : sockets) {
+    folly::SocketAddress addr;
+    socket->getAddress(&addr);
+    EXPECT_EQ(port, addr.getPort());
+  }
+  EXPECT_NE(-1, server->getListenSocket());
+
+  server->stopListening();
+  EXPECT_TRUE(server->getSockets().empty());
+  EXPECT_EQ(-1, server->getListenSocket());
+}
+
+class ThreadIdHandlerFactory : public RequestHandlerFactory {
+ public:
+  class ThreadIdHandler : public proxygen::RequestHandler {
+   public:
+    explicit ThreadIdHandler(ThreadIdHandlerFactory* factory)
+        : factory_(factory) {}
+
+    void onRequest(std::unique_ptr<proxygen::HTTPMessage>) noexcept override {}
+    void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {}
+    void onUpgrade(proxygen::UpgradeProtocol) noexcept override {}
+
+    void onEOM() noexcept override {
+      factory_->requestThread = std::this_thread::get_id();
+      ResponseBuilder(downstream_)
+          .status(200, "OK")
+          .body(IOBuf::copyBuffer("hello"))
+          .sendWithEOM();
+    }
+
+    void requestComplete() noexcept override { delete this; }
+
+    void onError(ProxygenError) noexcept override { delete this; }
+
+   private:
+    ThreadIdHandlerFactory* factory_;
+  };
+
+  RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
+    return new ThreadIdHandler(this);
+  }
+
+  void onServerStart(folly::EventBase*) noexcept override {
+    startThread = std::this_thread::get_id();
+  }
+  void onServerStop() noexcept override {
+    stopped = true;
+  }
+
+  std::atomic<std::thread::id> startThread;
+  std::atomic<std::thread::id> requestThread;
+  std::atomic<bool> stopped{false};
+};
+
+TEST(InlineServer, ServeOnStartThread) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 0;
+  auto factory = new ThreadIdHandlerFactory();
+  options.handlerFactories.emplace_back(factory);
+  auto server = ScopedHTTPServer::start(cfg, std::move(options));
+
+  auto response = getOverLoopback(*server);
+  EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+  EXPECT_NE(std::string::npos, response.find("hello"));
+  // no thread but the one in start()
+  EXPECT_NE(std::thread::id(), factory->startThread.load());
+  EXPECT_EQ(factory->startThread.load(), factory->requestThread.load());
+  EXPECT_NE(std::this_thread::get_id(), factory->requestThread.load());
+  EXPECT_FALSE(factory->stopped);
+}
+
+TEST(InlineServer, ExistingSocket) {
+  AsyncServerSocket::UniquePtr serverSocket(new folly::AsyncServerSocket);
+  serverSocket->bind(0);
+  auto existingFd = serverSocket->getSocket();
+
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 0;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<TestHandlerFactory>().build();
+  options.useExistingSocket(std::move(serverSocket));
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+  server->bind(ips);
+  ServerThread st(server.get());
+  EXPECT_TRUE(st.start());
+
+  EXPECT_EQ(existingFd, server->getListenSocket());
+  EXPECT_NE(0, server->addresses().front().address.getPort());
+  server->stopListening();
+  EXPECT_EQ(-1, server->getListenSocket());
+}
+
+namespace {
+
+struct NamedHandler {
+  void operator()(const HTTPMessage&,
+                  std::unique_ptr<folly::IOBuf>,
+                  ResponseBuilder& response) {
+    response.status(200, "OK").body(name);
+  }
+
+  std::string name;
+};
+
+HTTPServerOptions makeNamedOptions(const std::string& name) {
+  HTTPServerOptions options;
+  options.threads = 2;
+  options.handlerFactories.push_back(
+    std::make_unique<ScopedHandlerFactory<NamedHandler>>(NamedHandler{name}));
+  return options;
+}
+
+bool endsWith(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size() &&
+    str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}
+
+TEST(SocketTakeover, HandOverToNewServer) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "takeover.sock").string();
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+
+  auto optionsA = makeNamedOptions("server A");
+  optionsA.socketTakeoverPath = path;
+  auto serverA = std::make_unique<HTTPServer>(std::move(optionsA));
+  serverA->bind(ips);
+  ServerThread stA(serverA.get());
+  ASSERT_TRUE(stA.start());
+  auto address = serverA->addresses().front().address;
+
+  // A keep-alive connection to A, left open across the takeover
+  int conn = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(conn, 0);
+  sockaddr_storage addr;
+  auto addrLen = address.getAddress(&addr);
+  ASSERT_EQ(0, ::connect(conn, reinterpret_cast<sockaddr*>(&addr), addrLen));
+  struct timeval tv{10, 0};
+  ASSERT_EQ(0, setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)));
+  std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  std::string response;
+  char buf[4096];
+  ASSERT_EQ(static_cast<ssize_t>(request.size()),
+            folly::writeFull(conn, request.data(), request.size()));
+  while (!endsWith(response, "server A")) {
+    auto n = folly::readNoInt(conn, buf, sizeof(buf));
+    ASSERT_GT(n, 0);
+    response.append(buf, n);
+  }
+
+  // B listens on the socket of A, which then stops listening
+  auto optionsB = makeNamedOptions("server B");
+  optionsB.takeOverSockets(path);
+  optionsB.socketTakeoverPath = path;
+  auto serverB = std::make_unique<HTTPServer>(std::move(optionsB));
+  serverB->bind(ips);
+  ServerThread stB(serverB.get());
+  ASSERT_TRUE(stB.start());
+
+  // Connections go to either until A gets the acknowledgement, then to B
+  size_t fromB = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (fromB < 20 && std::chrono::steady_clock::now() < deadline) {
+    auto resp = getOverLoopback(address);
+    if (endsWith(resp, "server B")) {
+      fromB++;
+    } else {
+      EXPECT_TRUE(endsWith(resp, "server A"));
+      fromB = 0;
+    }
+  }
+  EXPECT_EQ(20, fromB);
+
+  // A answers the request left on its connection, and closes it
+  response.clear();
+  ASSERT_EQ(static_cast<ssize_t>(request.size()),
+            folly::writeFull(conn, request.data(), request.size()));
+  ssize_t n;
+  while ((n = folly::readNoInt(conn, buf, sizeof(buf))) > 0) {
+    response.append(buf, n);
+  }
+  EXPECT_EQ(0, n);
+  EXPECT_TRUE(endsWith(response, "server A"));
+  ::close(conn);
+
+  // B can be taken over in turn
+  HTTPServerOptions optionsC;
+  optionsC.takeOverSockets(path);
+  ASSERT_EQ(1, optionsC.preboundSockets_.size());
+}
+
+TEST(SocketTakeover, RefusesOtherUsers) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "takeover.sock").string();
+  HTTPServer server{HTTPServerOptions()};
+  folly::EventBase evb;
+  std::vector<uid_t> peers;
+  SocketTakeoverServer takeover(&evb, &server, [&](uid_t uid) {
+      peers.push_back(uid);
+      return false;
+    });
+  takeover.start(path);
+
+  // Other users can't even connect
+  struct stat st;
+  ASSERT_EQ(0, ::stat(path.c_str(), &st));
+  EXPECT_EQ(S_IRUSR | S_IWUSR, st.st_mode & 0777);
+
+  // A peer the check refuses is closed without getting the sockets
+  std::thread client([&] {
+      folly::File channel;
+      EXPECT_THROW(SocketTakeover::receiveSockets(path, channel),
+                   std::runtime_error);
+      evb.terminateLoopSoon();
+    });
+  evb.loopForever();
+  client.join();
+  ASSERT_EQ(1, peers.size());
+  EXPECT_EQ(geteuid(), peers[0]);
+}
+
+namespace {
+
+// Requests one after the other on new connections until stopped, counting
+// those not answered with a 200
+class LoadThread {
+ public:
+  explicit LoadThread(const folly::SocketAddress& address)
+      : thread_([this, address] {
+          while (!stop_) {
+            auto response = getOverLoopback(address);
+            requests_++;
+            if (response.find("HTTP/1.1 200 OK") != 0) {
+              failures_++;
+            }
+          }
+        }) {}
+
+  ~LoadThread() {
+    join();
+  }
+
+  void join() {
+    stop_ = true;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  size_t requests() const { return requests_; }
+  size_t failures() const { return failures_; }
+
+ private:
+  std::atomic<bool> stop_{false};
+  std::atomic<size_t> requests_{0};
+  std::atomic<size_t> failures_{0};
+  std::thread thread_;
+};
+
+}
+
+TEST(SetThreads, ResizeUnderLoad) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 2;
+  options.perWorkerListeners = true;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<TestHandlerFactory>().build();
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+  server->bind(ips);
+  ServerThread st(server.get());
+  ASSERT_TRUE(st.start());
+
+  // Retired threads finish what they were given, the others take the rest
+  LoadThread load(server->addresses().front().address);
+  for (size_t threads : {4, 1, 3, 2}) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    server->setThreads(threads);
+    EXPECT_EQ(threads, server->getThreads());
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  load.join();
+  EXPECT_LT(0, load.requests());
+  EXPECT_EQ(0, load.failures());
+}
+
+TEST(SetThreads, PerWorkerListeners) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 2;
+  options.perWorkerListeners = true;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<TestHandlerFactory>().build();
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+  server->bind(ips);
+  ServerThread st(server.get());
+  ASSERT_TRUE(st.start());
+  auto address = server->addresses().front().address;
+
+  // The listeners follow the threads, on the same port, and the retired
+  // ones accept the connections the kernel gave them before closing
+  std::vector<std::unique_ptr<LoadThread>> load;
+  for (int i = 0; i < 4; i++) {
+    load.push_back(std::make_unique<LoadThread>(address));
+  }
+  for (size_t threads : {4, 1, 3}) {
+    server->setThreads(threads);
+    EXPECT_EQ(threads, server->getThreads());
+    auto sockets = server->getSockets();
+    EXPECT_EQ(threads, sockets.size());
+    for (auto socket : sockets) {
+      folly::SocketAddress addr;
+      socket->getAddress(&addr);
+      EXPECT_EQ(address.getPort(), addr.getPort());
+    }
+    for (int i = 0; i < 10; i++) {
+      auto response = getOverLoopback(address);
+      EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+    }
+  }
+  for (auto& thread : load) {
+    thread->join();
+    EXPECT_LT(0, thread->requests());
+    EXPECT_EQ(0, thread->failures());
+  }
+}
+
+TEST(SetThreads, SharedListenerCantShrink) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 2;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<TestHandlerFactory>().build();
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+  server->bind(ips);
+  ServerThread st(server.get());
+  ASSERT_TRUE(st.start());
+
+  server->setThreads(4);
+  EXPECT_EQ(4, server->getThreads());
+  EXPECT_THROW(server->setThreads(1), std::logic_error);
+  EXPECT_EQ(4, server->getThreads());
+  auto response = getOverLoopback(server->addresses().front().address);
+  EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+}
+
+class DelayedHandlerFactory : public RequestHandlerFactory {
+ public:
+  class DelayedHandler : public proxygen::RequestHandler {
+    void onRequest(std::unique_ptr<proxygen::HTTPMessage>) noexcept override {}
+    void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {}
+    void onUpgrade(proxygen::UpgradeProtocol) noexcept override {}
+
+    void onEOM() noexcept override {
+      EventBaseManager::get()->getEventBase()->runAfterDelay([this] {
+          ResponseBuilder(downstream_)
+              .status(200, "OK")
+              .body(IOBuf::copyBuffer("hello"))
+              .sendWithEOM();
+        }, 200);
+    }
+
+    void requestComplete() noexcept override { delete this; }
+
+    void onError(ProxygenError) noexcept override { delete this; }
+  };
+
+  RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
+    return new DelayedHandler();
+  }
+
+  void onServerStart(folly::EventBase*) noexcept override {}
+  void onServerStop() noexcept override { stopped++; }
+
+  static std::atomic<int> stopped;
+};
+
+std::atomic<int> DelayedHandlerFactory::stopped{0};
+
+TEST(SetThreads, RetiredThreadsFinishRequests) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 4;
+  options.perWorkerListeners = true;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<DelayedHandlerFactory>().build();
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+  server->bind(ips);
+  ServerThread st(server.get());
+  ASSERT_TRUE(st.start());
+  auto address = server->addresses().front().address;
+
+  // The requests are all waiting for their response as the threads retire
+  std::vector<std::string> responses(16);
+  std::vector<std::thread> clients;
+  for (auto& response : responses) {
+    clients.emplace_back([&response, address] {
+        response = getOverLoopback(address);
+      });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  DelayedHandlerFactory::stopped = 0;
+  server->setThreads(1);
+  EXPECT_EQ(1, server->getThreads());
+  // The handlers of a thread stop after its connections
+  EXPECT_EQ(3, DelayedHandlerFactory::stopped);
+  for (auto& client : clients) {
+    client.join();
+  }
+  for (auto& response : responses) {
+    EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+  }
+}
+
+class BlockingHandlerFactory : public RequestHandlerFactory {
+ public:
+  class BlockingHandler : public proxygen::RequestHandler {
+    void onRequest(std::unique_ptr<proxygen::HTTPMessage>) noexcept override {}
+    void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {}
+    void onUpgrade(proxygen::UpgradeProtocol) noexcept override {}
+
+    void onEOM() noexcept override {
+      // New connections queue in the kernel meanwhile
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      ResponseBuilder(downstream_)
+          .status(200, "OK")
+          .body(IOBuf::copyBuffer("hello"))
+          .sendWithEOM();
+    }
+
+    void requestComplete() noexcept override { delete this; }
+
+    void onError(ProxygenError) noexcept override { delete this; }
+  };
+
+  RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
+    return new BlockingHandler();
+  }
+
+  void onServerStart(folly::EventBase*) noexcept override {}
+  void onServerStop() noexcept override {}
+};
+
+TEST(SetThreads, RetiredListenersAcceptQueuedConnections) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 4;
+  options.perWorkerListeners = true;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<BlockingHandlerFactory>().build();
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+  server->bind(ips);
+  ServerThread st(server.get());
+  ASSERT_TRUE(st.start());
+  auto address = server->addresses().front().address;
+
+  // The first requests block the IO threads, the kernel queues the next
+  // connections on the listeners, which retire before accepting them
+  std::vector<std::string> responses(24);
+  std::vector<std::thread> clients;
+  for (size_t i = 0; i < responses.size(); i++) {
+    if (i == 8) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    clients.emplace_back([&responses, i, address] {
+        responses[i] = getOverLoopback(address);
+      });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  server->setThreads(1);
+  EXPECT_EQ(1, server->getSockets().size());
+  for (auto& client : clients) {
+    client.join();
+  }
+  for (auto& response : responses) {
+    EXPECT_EQ(0, response.find("HTTP/1.1 200 OK"));
+  }
+}
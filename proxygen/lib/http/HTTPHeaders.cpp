@@ -83,6 +83,37 @@ void HTTPHeaders::addFromCodec(const char* str, size_t len, string&& value) {
   headerValues_.emplace_back(std::move(value));
 }
 
+void HTTPHeaders::addFromCodec(const char* str, size_t len,
+                               folly::StringPiece value,
+                               const folly::IOBuf& buf) {
+  DCHECK(buf.isManagedOne());
+  DCHECK(value.begin() >= (const char*)buf.data() &&
+         value.end() <= (const char*)buf.tail());
+  // Headers come from a handful of buffers (HPACK alternates between the
+  // ingress and its decode arena), so the pinned chain stays short and is
+  // searched newest first
+  if (!viewBufs_) {
+    viewBufs_ = buf.cloneOne();
+  } else {
+    const folly::IOBuf* pinned = viewBufs_->prev();
+    while (pinned->buffer() != buf.buffer() && pinned != viewBufs_.get()) {
+      pinned = pinned->prev();
+    }
+    if (pinned->buffer() != buf.buffer()) {
+      viewBufs_->prependChain(buf.cloneOne());
+    }
+  }
+  addFromCodec(str, len, std::string());
+  valueViews_.resize(codes_.size() - 1);
+  valueViews_.push_back(value);
+}
+
+void HTTPHeaders::materializeValue(size_t pos) const {
+  auto& view = valueViews_[pos];
+  headerValues_[pos].assign(view.data(), view.size());
+  view.clear();
+}
+
 bool HTTPHeaders::exists(folly::StringPiece name) const {
   const HTTPHeaderCode code = HTTPCommonHeaders::hash(name.data(),
                                                       name.size());
@@ -159,6 +190,8 @@ HTTPHeaders::HTTPHeaders(const HTTPHeaders& hdrs) :
   codes_(hdrs.codes_),
   headerNames_(hdrs.headerNames_),
   headerValues_(hdrs.headerValues_),
+  valueViews_(hdrs.valueViews_),
+  viewBufs_(hdrs.viewBufs_ ? hdrs.viewBufs_->clone() : nullptr),
   deletedCount_(hdrs.deletedCount_) {
   for (size_t i = 0; i < codes_.size(); ++i) {
     if (codes_[i] == HTTP_HEADER_OTHER) {
@@ -171,6 +204,8 @@ HTTPHeaders::HTTPHeaders(HTTPHeaders&& hdrs) noexcept :
     codes_(std::move(hdrs.codes_)),
     headerNames_(std::move(hdrs.headerNames_)),
     headerValues_(std::move(hdrs.headerValues_)),
+    valueViews_(std::move(hdrs.valueViews_)),
+    viewBufs_(std::move(hdrs.viewBufs_)),
     deletedCount_(hdrs.deletedCount_) {
   hdrs.removeAll();
 }
@@ -181,6 +216,8 @@ HTTPHeaders& HTTPHeaders::operator= (const HTTPHeaders& hdrs) {
     codes_ = hdrs.codes_;
     headerNames_ = hdrs.headerNames_;
     headerValues_ = hdrs.headerValues_;
+    valueViews_ = hdrs.valueViews_;
+    viewBufs_ = hdrs.viewBufs_ ? hdrs.viewBufs_->clone() : nullptr;
     deletedCount_ = hdrs.deletedCount_;
     for (size_t i = 0; i < codes_.size(); ++i) {
       if (codes_[i] == HTTP_HEADER_OTHER) {
@@ -196,6 +233,8 @@ HTTPHeaders& HTTPHeaders::operator= (HTTPHeaders&& hdrs) {
     codes_ = std::move(hdrs.codes_);
     headerNames_ = std::move(hdrs.headerNames_);
     headerValues_ = std::move(hdrs.headerValues_);
+    valueViews_ = std::move(hdrs.valueViews_);
+    viewBufs_ = std::move(hdrs.viewBufs_);
     deletedCount_ = hdrs.deletedCount_;
 
     hdrs.removeAll();
@@ -210,6 +249,8 @@ void HTTPHeaders::removeAll() {
   codes_.clear();
   headerNames_.clear();
   headerValues_.clear();
+  valueViews_.clear();
+  viewBufs_.reset();
   deletedCount_ = 0;
 }
 
@@ -228,7 +269,7 @@ HTTPHeaders::transferHeaderIfPresent(folly::StringPiece name,
       strippedHeaders.codes_.push_back(HTTP_HEADER_OTHER);
       // in the next line, ownership of pointer goes to strippedHeaders
       strippedHeaders.headerNames_.push_back(headerNames_[pos]);
-      strippedHeaders.headerValues_.push_back(headerValues_[pos]);
+      strippedHeaders.headerValues_.push_back(getValue(pos));
       codes_[pos] = HTTP_HEADER_NONE;
       transferred = true;
       ++deletedCount_;
@@ -237,7 +278,7 @@ HTTPHeaders::transferHeaderIfPresent(folly::StringPiece name,
     ITERATE_OVER_CODES(code, {
       strippedHeaders.codes_.push_back(code);
       strippedHeaders.headerNames_.push_back(headerNames_[pos]);
-      strippedHeaders.headerValues_.push_back(headerValues_[pos]);
+      strippedHeaders.headerValues_.push_back(getValue(pos));
       codes_[pos] = HTTP_HEADER_NONE;
       transferred = true;
       ++deletedCount_;
@@ -298,7 +339,7 @@ HTTPHeaders::stripPerHopHeaders(HTTPHeaders& strippedHeaders) {
     if (perHopHeaders[codes_[i]]) {
       strippedHeaders.codes_.push_back(codes_[i]);
       strippedHeaders.headerNames_.push_back(headerNames_[i]);
-      strippedHeaders.headerValues_.push_back(headerValues_[i]);
+      strippedHeaders.headerValues_.push_back(getValue(i));
       codes_[i] = HTTP_HEADER_NONE;
       ++deletedCount_;
       VLOG(5) << "Stripped hop-by-hop header " << *headerNames_[i];
@@ -312,7 +353,7 @@ void HTTPHeaders::copyTo(HTTPHeaders& hdrs) const {
       hdrs.codes_.push_back(codes_[i]);
       hdrs.headerNames_.push_back((codes_[i] == HTTP_HEADER_OTHER) ?
           new string(*headerNames_[i]) : headerNames_[i]);
-      hdrs.headerValues_.push_back(headerValues_[i]);
+      hdrs.headerValues_.push_back(getValue(i));
     }
   }
 }
@@ -10,7 +10,9 @@
 #pragma once
 
 #include <folly/FBVector.h>
+#include <folly/Likely.h>
 #include <folly/Range.h>
+#include <folly/io/IOBuf.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
 #include <proxygen/lib/utils/Export.h>
 #include <proxygen/lib/utils/UtilInl.h>
@@ -64,6 +66,13 @@ inline bool isLWS(char c) {
  *     headers.add(HTTP_HEADER_LOCATION, location);
  * rather than:
  *     headers.add("Location", location);
+ *
+ * Codecs may add values as views into their ingress buffer (see the
+ * IOBuf overload of addFromCodec). Such values are copied into a string
+ * the first time they are accessed through one of the std::string based
+ * accessors; forEachWithCodeView() reads them without copying. Because of
+ * this, even const accessors may modify internal state, so an HTTPHeaders
+ * object must not be read from several threads at once.
  */
 class HTTPHeaders {
  public:
@@ -112,6 +121,14 @@ class HTTPHeaders {
 
   void addFromCodec(const char* str, size_t len, std::string&& value);
 
+  /**
+   * Add a header whose value is a view into buf. buf must be managed and
+   * its contents must not change while it is shared; a reference on it is
+   * held for as long as any view may point into it.
+   */
+  void addFromCodec(const char* str, size_t len, folly::StringPiece value,
+                    const folly::IOBuf& buf);
+
   /**
    * For the header 'name', set its value to the single header 'value',
    * removing any other instances of this header.
@@ -172,6 +189,20 @@ class HTTPHeaders {
   template <typename LAMBDA>
   inline void forEachWithCode(LAMBDA func) const;
 
+  /**
+   * Same as forEachWithCode(), but the value is passed as a
+   * folly::StringPiece so that values still backed by a codec's ingress
+   * buffer are not copied. The StringPiece is only valid until the next
+   * modification of this object. Example use:
+   *     hdrs.forEachWithCodeView([&] (HTTPHeaderCode code,
+   *                                   const string& header,
+   *                                   folly::StringPiece val) {
+   *       std::cout << header << "(" << code << "): " << val;
+   *     });
+   */
+  template <typename LAMBDA>
+  inline void forEachWithCodeView(LAMBDA func) const;
+
   /**
    * Process the list of all headers, in the order that they were seen:
    * for each header:value pair, the function/functor/lambda-expression
@@ -270,7 +301,19 @@ class HTTPHeaders {
    */
   folly::fbvector<const std::string *> headerNames_;
 
-  folly::fbvector<std::string> headerValues_;
+  // mutable so that views can be materialized from const accessors
+  mutable folly::fbvector<std::string> headerValues_;
+
+  /**
+   * Values added as views by addFromCodec(). An entry with non-null data()
+   * takes precedence over the (empty) string at the same position in
+   * headerValues_ until it is materialized. Only grows as far as the last
+   * view, and stays empty if views are never used.
+   */
+  mutable folly::fbvector<folly::StringPiece> valueViews_;
+
+  // References on the buffers that valueViews_ point into
+  std::unique_ptr<folly::IOBuf> viewBufs_;
 
   size_t deletedCount_;
 
@@ -289,6 +332,27 @@ class HTTPHeaders {
 
   // deletes the strings in headerNames_ that we own
   void disposeOfHeaderNames();
+
+  bool isView(size_t pos) const {
+    return pos < valueViews_.size() && valueViews_[pos].data() != nullptr;
+  }
+
+  // copies the view at pos (if any) into headerValues_
+  const std::string& getValue(size_t pos) const {
+    if (UNLIKELY(isView(pos))) {
+      materializeValue(pos);
+    }
+    return headerValues_[pos];
+  }
+
+  folly::StringPiece getValueView(size_t pos) const {
+    if (isView(pos)) {
+      return valueViews_[pos];
+    }
+    return headerValues_[pos];
+  }
+
+  void materializeValue(size_t pos) const;
 };
 
 // Implementation follows - it has to be in the .h because of the templates
@@ -336,7 +400,7 @@ template <typename LAMBDA> // (const string &, const string &) -> void
 void HTTPHeaders::forEach(LAMBDA func) const {
   for (size_t i = 0; i < codes_.size(); ++i) {
     if (codes_[i] != HTTP_HEADER_NONE) {
-      func(*headerNames_[i], headerValues_[i]);
+      func(*headerNames_[i], getValue(i));
     }
   }
 }
@@ -345,7 +409,16 @@ template <typename LAMBDA>
 void HTTPHeaders::forEachWithCode(LAMBDA func) const {
   for (size_t i = 0; i < codes_.size(); ++i) {
     if (codes_[i] != HTTP_HEADER_NONE) {
-      func(codes_[i], *headerNames_[i], headerValues_[i]);
+      func(codes_[i], *headerNames_[i], getValue(i));
+    }
+  }
+}
+
+template <typename LAMBDA>
+void HTTPHeaders::forEachWithCodeView(LAMBDA func) const {
+  for (size_t i = 0; i < codes_.size(); ++i) {
+    if (codes_[i] != HTTP_HEADER_NONE) {
+      func(codes_[i], *headerNames_[i], getValueView(i));
     }
   }
 }
@@ -358,7 +431,7 @@ bool HTTPHeaders::forEachValueOfHeader(folly::StringPiece name,
     return forEachValueOfHeader(code, func);
   } else {
     ITERATE_OVER_STRINGS(name, {
-      if (func(headerValues_[pos])) {
+      if (func(getValue(pos))) {
         return true;
       }
     });
@@ -370,7 +443,7 @@ template <typename LAMBDA> // const string & -> bool
 bool HTTPHeaders::forEachValueOfHeader(HTTPHeaderCode code,
                                        LAMBDA func) const {
   ITERATE_OVER_CODES(code, {
-    if (func(headerValues_[pos])) {
+    if (func(getValue(pos))) {
       return true;
     }
   });
@@ -398,7 +471,7 @@ bool HTTPHeaders::removeByPredicate(LAMBDA func) {
   bool removed = false;
   for (size_t i = 0; i < codes_.size(); ++i) {
     if (codes_[i] == HTTP_HEADER_NONE ||
-        !func(codes_[i], *headerNames_[i], headerValues_[i])) {
+        !func(codes_[i], *headerNames_[i], getValue(i))) {
       continue;
     }
 
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/RFC9218.h>
+
+#include <algorithm>
+#include <folly/Conv.h>
+#include <folly/String.h>
+
+using folly::StringPiece;
+
+namespace proxygen { namespace RFC9218 {
+
+const uint8_t Priority::kDefaultUrgency;
+const uint8_t Priority::kMaxUrgency;
+
+namespace {
+
+void parseMember(StringPiece member, Priority& priority) {
+  // parameters of the member carry nothing we use
+  member = member.subpiece(0, member.find(';'));
+  auto eq = member.find('=');
+  auto key = folly::trimWhitespace(member.subpiece(0, eq));
+  if (key == "u") {
+    if (eq == StringPiece::npos) {
+      // a bare key is the boolean true, not an urgency
+      return;
+    }
+    auto value = folly::trimWhitespace(member.subpiece(eq + 1));
+    if (value.empty() || value.size() > 15) {
+      return;
+    }
+    uint64_t urgency = 0;
+    for (char c: value) {
+      if (c < '0' || c > '9') {
+        return;
+      }
+      urgency = urgency * 10 + (c - '0');
+    }
+    if (urgency <= Priority::kMaxUrgency) {
+      priority.urgency = urgency;
+    }
+  } else if (key == "i") {
+    if (eq == StringPiece::npos) {
+      priority.incremental = true;
+      return;
+    }
+    auto value = folly::trimWhitespace(member.subpiece(eq + 1));
+    if (value == "?1") {
+      priority.incremental = true;
+    } else if (value == "?0") {
+      priority.incremental = false;
+    }
+  }
+}
+
+}
+
+Priority parsePriority(StringPiece value) {
+  Priority priority;
+  size_t i = 0;
+  while (i < value.size()) {
+    // split on the commas between dictionary members, skipping the ones
+    // inside quoted strings
+    size_t start = i;
+    bool quoted = false;
+    for (; i < value.size(); i++) {
+      char c = value[i];
+      if (quoted) {
+        if (c == '\\') {
+          i++;
+        } else if (c == '"') {
+          quoted = false;
+        }
+      } else if (c == '"') {
+        quoted = true;
+      } else if (c == ',') {
+        break;
+      }
+    }
+    i = std::min(i, value.size());
+    parseMember(value.subpiece(start, i - start), priority);
+    i++;
+  }
+  return priority;
+}
+
+std::string toString(const Priority& priority) {
+  std::string result;
+  if (priority.urgency != Priority::kDefaultUrgency) {
+    result = folly::to<std::string>("u=", (uint32_t)priority.urgency);
+  }
+  if (priority.incremental) {
+    if (!result.empty()) {
+      result.append(", ");
+    }
+    result.append("i");
+  }
+  return result;
+}
+
+}}
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <folly/Range.h>
+#include <string>
+
+namespace proxygen { namespace RFC9218 {
+
+/**
+ * This file contains the priority parameters of the Extensible
+ * Prioritization Scheme for HTTP, which clients send in the priority header
+ * and the HTTP/2 PRIORITY_UPDATE frame.
+ */
+
+/**
+ * Responses with a lower urgency are sent first. Incremental responses of
+ * the same urgency share the connection, the others are sent one after the
+ * other.
+ */
+struct Priority {
+  static const uint8_t kDefaultUrgency = 3;
+  static const uint8_t kMaxUrgency = 7;
+
+  uint8_t urgency;
+  bool incremental;
+
+  Priority(): urgency(kDefaultUrgency), incremental(false) {}
+
+  Priority(uint8_t u, bool i): urgency(u), incremental(i) {}
+
+  bool operator==(const Priority& other) const {
+    return urgency == other.urgency && incremental == other.incremental;
+  }
+};
+
+/**
+ * Parse a priority field value, a structured field dictionary such as
+ * "u=5, i". Parameters that are missing or have an invalid value keep their
+ * default, unknown ones are ignored.
+ */
+Priority parsePriority(folly::StringPiece value);
+
+/**
+ * Serialize a priority, leaving out the parameters with default values.
+ */
+std::string toString(const Priority& priority);
+
+}}
@@ -107,7 +107,9 @@ HTTP1xCodec::HTTP1xCodec(TransportDirection direction, bool forceUpstream1_1)
     ingressUpgradeComplete_(false),
     egressUpgrade_(false),
     nativeUpgrade_(false),
-    headersComplete_(false) {
+    headersComplete_(false),
+    zeroCopyIngressHeaders_(false),
+    ingressBufViewable_(false) {
   switch (direction) {
   case TransportDirection::DOWNSTREAM:
     http_parser_init(&parser_, HTTP_REQUEST);
@@ -182,6 +184,7 @@ HTTP1xCodec::onIngress(const IOBuf& buf) {
     CHECK(!parserActive_);
     parserActive_ = true;
     currentIngressBuf_ = &buf;
+    ingressBufViewable_ = zeroCopyIngressHeaders_ && buf.isManagedOne();
     if (transportDirection_ == TransportDirection::UPSTREAM &&
         parser_.http_major == 0 && parser_.http_minor == 9) {
       // HTTP/0.9 responses have no header block, so create a fake 200 response
@@ -215,7 +218,14 @@ HTTP1xCodec::onIngress(const IOBuf& buf) {
       currentHeaderName_.assign(currentHeaderNameStringPiece_.begin(),
                                 currentHeaderNameStringPiece_.size());
     }
+    if (!currentHeaderValueStringPiece_.empty()) {
+      // same for a header value we were planning to reference in place
+      currentHeaderValue_.assign(currentHeaderValueStringPiece_.begin(),
+                                 currentHeaderValueStringPiece_.size());
+      currentHeaderValueStringPiece_.clear();
+    }
     currentIngressBuf_ = nullptr;
+    ingressBufViewable_ = false;
     if (pendingEOF_) {
       onIngressEOF();
       pendingEOF_ = false;
@@ -430,17 +440,19 @@ HTTP1xCodec::generateHeader(IOBufQueue& writeBuf,
     parser_.http_minor = 9;
     return;
   }
-  const string* deferredContentLength = nullptr;
+  folly::Optional<StringPiece> deferredContentLength;
   bool hasTransferEncodingChunked = false;
   bool hasDateHeader = false;
   std::vector<StringPiece> connectionTokens;
   size_t lastConnectionToken = 0;
-  msg.getHeaders().forEachWithCode([&] (HTTPHeaderCode code,
-                                        const string& header,
-                                        const string& value) {
+  // Use views so that headers forwarded from a zero-copy ingress codec are
+  // written straight from the ingress buffer
+  msg.getHeaders().forEachWithCodeView([&] (HTTPHeaderCode code,
+                                            const string& header,
+                                            StringPiece value) {
     if (code == HTTP_HEADER_CONTENT_LENGTH) {
       // Write the Content-Length last (t1071703)
-      deferredContentLength = &value;
+      deferredContentLength = value;
       return; // continue
     } else if (code == HTTP_HEADER_CONNECTION && !is1xxResponse_) {
       static const string kClose = "close";
@@ -461,7 +473,7 @@ HTTP1xCodec::generateHeader(IOBufQueue& writeBuf,
       return;
     } else if (code == HTTP_HEADER_UPGRADE && upstream && txn == 1) {
       // save in case we get a 101 Switching Protocols
-      upgradeHeader_ = value;
+      upgradeHeader_ = value.str();
     } else if (!hasTransferEncodingChunked &&
                code == HTTP_HEADER_TRANSFER_ENCODING) {
       if (!caseInsensitiveEqual(value, kChunked)) {
@@ -733,7 +745,16 @@ HTTP1xCodec::onReason(const char* buf, size_t len) {
 }
 
 void HTTP1xCodec::pushHeaderNameAndValue(HTTPHeaders& hdrs) {
-  if (LIKELY(currentHeaderName_.empty())) {
+  if (!currentHeaderValueStringPiece_.empty()) {
+    // zero-copy: the value still lives in currentIngressBuf_
+    DCHECK(currentHeaderValue_.empty());
+    StringPiece name = currentHeaderName_.empty() ?
+      currentHeaderNameStringPiece_ : StringPiece(currentHeaderName_);
+    hdrs.addFromCodec(name.begin(), name.size(),
+                      currentHeaderValueStringPiece_, *currentIngressBuf_);
+    currentHeaderName_.clear();
+    currentHeaderValueStringPiece_.clear();
+  } else if (LIKELY(currentHeaderName_.empty())) {
     hdrs.addFromCodec(currentHeaderNameStringPiece_.begin(),
                       currentHeaderNameStringPiece_.size(),
                       std::move(currentHeaderValue_));
@@ -802,6 +823,25 @@ HTTP1xCodec::onHeaderValue(const char* buf, size_t len) {
   } else {
     headerParseState_ = HeaderParseState::kParsingTrailerValue;
   }
+  if (ingressBufViewable_ && currentHeaderValue_.empty()) {
+    if (currentHeaderValueStringPiece_.empty()) {
+      // only reference bytes that actually live in the ingress buffer; the
+      // parser passes a static " " when unfolding multi-line values
+      if (buf >= (const char*)currentIngressBuf_->data() &&
+          buf + len <= (const char*)currentIngressBuf_->tail()) {
+        currentHeaderValueStringPiece_.reset(buf, len);
+        return 0;
+      }
+    } else if (currentHeaderValueStringPiece_.end() == buf) {
+      currentHeaderValueStringPiece_.advance(len);
+      return 0;
+    } else {
+      // discontiguous: fall back to copying
+      currentHeaderValue_.assign(currentHeaderValueStringPiece_.begin(),
+                                 currentHeaderValueStringPiece_.size());
+      currentHeaderValueStringPiece_.clear();
+    }
+  }
   currentHeaderValue_.append(buf, len);
   return 0;
 }
@@ -81,6 +81,17 @@ class HTTP1xCodec : public HTTPCodec {
 
   void setAllowedUpgradeProtocols(std::list<std::string> protocols);
 
+  /**
+   * When enabled, header values that are contiguous in the ingress buffer
+   * are handed to HTTPHeaders as views holding a reference on that buffer
+   * instead of being copied. Values spanning onIngress() calls are still
+   * copied. The ingress buffer must be managed (e.g. not from wrapBuffer)
+   * for views to be used.
+   */
+  void setZeroCopyIngressHeaders(bool enabled) {
+    zeroCopyIngressHeaders_ = enabled;
+  }
+
   /**
    * @returns true if the codec supports the given NPN protocol.
    */
@@ -153,6 +164,7 @@ class HTTP1xCodec : public HTTPCodec {
   std::string currentHeaderName_;
   folly::StringPiece currentHeaderNameStringPiece_;
   std::string currentHeaderValue_;
+  folly::StringPiece currentHeaderValueStringPiece_;
   std::string url_;
   std::string userAgent_;
   std::string reason_;
@@ -187,6 +199,8 @@ class HTTP1xCodec : public HTTPCodec {
   bool egressUpgrade_:1;
   bool nativeUpgrade_:1;
   bool headersComplete_:1;
+  bool zeroCopyIngressHeaders_:1;
+  bool ingressBufViewable_:1;
 
   // C-callable wrappers for the http_parser callbacks
   static int onMessageBeginCB(http_parser* parser);
@@ -220,6 +220,8 @@ ErrorCode HTTP2Codec::parseFrame(folly::io::Cursor& cursor) {
     case http2::FrameType::WINDOW_UPDATE:
       err = parseWindowUpdate(cursor); break;
     case http2::FrameType::CONTINUATION: err = parseContinuation(cursor); break;
+    case http2::FrameType::PRIORITY_UPDATE:
+      err = parsePriorityUpdate(cursor); break;
     case http2::FrameType::ALTSVC:
       // fall through, unimplemented
     default:
@@ -484,6 +486,18 @@ ErrorCode HTTP2Codec::parseHeadersImpl(
 
 void HTTP2Codec::onHeader(const folly::fbstring& name,
                           const folly::fbstring& value) {
+  onHeaderImpl(name, value, nullptr);
+}
+
+void HTTP2Codec::onHeaderView(folly::StringPiece name,
+                              folly::StringPiece value,
+                              const folly::IOBuf& valueBuf) {
+  onHeaderImpl(name, value, &valueBuf);
+}
+
+void HTTP2Codec::onHeaderImpl(folly::StringPiece name,
+                              folly::StringPiece value,
+                              const folly::IOBuf* valueBuf) {
   // Refuse decoding other headers if an error is already found
   if (decodeInfo_.decodeError != HeaderDecodeError::NONE
       || decodeInfo_.parsingError != "") {
@@ -591,7 +605,12 @@ void HTTP2Codec::onHeader(const folly::fbstring& name,
       }
     }
     // Add the (name, value) pair to headers
-    decodeInfo_.msg->getHeaders().add(nameSp, valueSp);
+    if (valueBuf) {
+      decodeInfo_.msg->getHeaders().addFromCodec(nameSp.data(), nameSp.size(),
+                                                 valueSp, *valueBuf);
+    } else {
+      decodeInfo_.msg->getHeaders().add(nameSp, valueSp);
+    }
   }
 }
 
@@ -643,6 +662,25 @@ ErrorCode HTTP2Codec::parsePriority(Cursor& cursor) {
   return ErrorCode::NO_ERROR;
 }
 
+ErrorCode HTTP2Codec::parsePriorityUpdate(Cursor& cursor) {
+  VLOG(4) << "parsing PRIORITY_UPDATE frame length=" << curHeader_.length;
+  uint32_t prioritizedStream = 0;
+  std::string priorityField;
+  auto err = http2::parsePriorityUpdate(cursor, curHeader_,
+                                        prioritizedStream, priorityField);
+  RETURN_IF_ERROR(err);
+  if (transportDirection_ == TransportDirection::UPSTREAM) {
+    // only clients send PRIORITY_UPDATE
+    goawayErrorMessage_ = "GOAWAY error: PRIORITY_UPDATE received by client";
+    VLOG(4) << goawayErrorMessage_;
+    return ErrorCode::PROTOCOL_ERROR;
+  }
+  deliverCallbackIfAllowed(&HTTPCodec::Callback::onExtensiblePriority,
+                           "onExtensiblePriority", prioritizedStream,
+                           RFC9218::parsePriority(priorityField));
+  return ErrorCode::NO_ERROR;
+}
+
 size_t HTTP2Codec::addPriorityNodes(
     PriorityQueue& queue,
     folly::IOBufQueue& writeBuf,
@@ -692,6 +730,12 @@ ErrorCode HTTP2Codec::parseSettings(Cursor& cursor) {
   auto err = http2::parseSettings(cursor, curHeader_, settings);
   RETURN_IF_ERROR(err);
   if (curHeader_.flags & http2::ACK) {
+    if (settingsAcked_ < settingsSent_ &&
+        ++settingsAcked_ == tableResetSettings_) {
+      // the peer emptied its encoder table, empty ours to match
+      headerCodec_.completeDecoderTableReset();
+      tableResetSettings_ = 0;
+    }
     // for stats
     if (callback_) {
       callback_->onSettingsAck();
@@ -713,7 +757,10 @@ ErrorCode HTTP2Codec::handleSettings(const std::deque<SettingPair>& settings) {
             http2::kMaxHeaderTableSize;
           tableSize = http2::kMaxHeaderTableSize;
         }
-        headerCodec_.setEncoderHeaderTableSize(tableSize);
+        if (!hibernating_) {
+          // else wake() applies it
+          headerCodec_.setEncoderHeaderTableSize(tableSize);
+        }
       }
       break;
       case SettingsId::ENABLE_PUSH:
@@ -751,6 +798,15 @@ ErrorCode HTTP2Codec::handleSettings(const std::deque<SettingPair>& settings) {
         break;
       case SettingsId::MAX_HEADER_LIST_SIZE:
         break;
+      case SettingsId::NO_RFC7540_PRIORITIES:
+        if (setting.second != 0 && setting.second != 1) {
+          goawayErrorMessage_ = folly::to<string>(
+              "GOAWAY error: NO_RFC7540_PRIORITIES invalid setting=",
+              setting.second, " for streamID=", curHeader_.stream);
+          VLOG(4) << goawayErrorMessage_;
+          return ErrorCode::PROTOCOL_ERROR;
+        }
+        break;
       default:
         // unknown setting
         break;
@@ -1273,6 +1329,7 @@ size_t HTTP2Codec::generateSettings(folly::IOBufQueue& writeBuf) {
     settings.push_back(SettingPair(setting.id, setting.value));
   }
   VLOG(4) << "generating " << (unsigned)settings.size() << " settings";
+  settingsSent_++;
   return http2::writeSettings(writeBuf, settings);
 }
 
@@ -1303,6 +1360,47 @@ size_t HTTP2Codec::generateSettingsAck(folly::IOBufQueue& writeBuf) {
   return http2::writeSettingsAck(writeBuf);
 }
 
+size_t HTTP2Codec::hibernate(folly::IOBufQueue& writeBuf) {
+  if (hibernating_) {
+    return 0;
+  }
+  VLOG(4) << "hibernating";
+  hibernating_ = true;
+  // the next header block we send tells the peer's decoder
+  headerCodec_.resetEncoderTable();
+  auto tableSize = egressSettings_.getSetting(SettingsId::HEADER_TABLE_SIZE,
+                                              0);
+  if (tableSize == 0) {
+    return 0;
+  }
+  // our decoder table has to wait for the peer to reset its encoder
+  std::deque<SettingPair> settings{
+    SettingPair(SettingsId::HEADER_TABLE_SIZE, 0)};
+  headerCodec_.prepareDecoderTableReset();
+  tableResetSettings_ = ++settingsSent_;
+  return http2::writeSettings(writeBuf, settings);
+}
+
+size_t HTTP2Codec::wake(folly::IOBufQueue& writeBuf) {
+  if (!hibernating_) {
+    return 0;
+  }
+  VLOG(4) << "waking up";
+  hibernating_ = false;
+  headerCodec_.setEncoderHeaderTableSize(
+    std::min(ingressSettings_.getSetting(SettingsId::HEADER_TABLE_SIZE, 4096),
+             http2::kMaxHeaderTableSize));
+  auto tableSize = egressSettings_.getSetting(SettingsId::HEADER_TABLE_SIZE,
+                                              0);
+  if (tableSize == 0) {
+    return 0;
+  }
+  std::deque<SettingPair> settings{
+    SettingPair(SettingsId::HEADER_TABLE_SIZE, tableSize)};
+  settingsSent_++;
+  return http2::writeSettings(writeBuf, settings);
+}
+
 size_t HTTP2Codec::generateWindowUpdate(folly::IOBufQueue& writeBuf,
                                         StreamID stream,
                                         uint32_t delta) {
@@ -31,6 +31,9 @@ class HTTP2Codec: public HTTPParallelCodec, HeaderCodec::StreamingCallback {
 public:
   void onHeader(const folly::fbstring& name,
                 const folly::fbstring& value) override;
+  void onHeaderView(folly::StringPiece name,
+                    folly::StringPiece value,
+                    const folly::IOBuf& valueBuf) override;
   void onHeadersComplete(HTTPHeaderSize decodedSize) override;
   void onDecodeError(HeaderDecodeError decodeError) override;
 
@@ -83,6 +86,8 @@ public:
                            uint64_t uniqueID) override;
   size_t generateSettings(folly::IOBufQueue& writeBuf) override;
   size_t generateSettingsAck(folly::IOBufQueue& writeBuf) override;
+  size_t hibernate(folly::IOBufQueue& writeBuf) override;
+  size_t wake(folly::IOBufQueue& writeBuf) override;
   size_t generateWindowUpdate(folly::IOBufQueue& writeBuf,
                               StreamID stream,
                               uint32_t delta) override;
@@ -107,6 +112,29 @@ public:
   void setHeaderCodecStats(HeaderCodec::Stats* stats) override {
     headerCodec_.setStats(stats);
   }
+  /**
+   * Cache up to maxEntries encoded literals in the HPACK encoder, see
+   * HPACKEncoder::setEncodeCacheSize()
+   */
+  void setHeaderEncodeCacheSize(uint32_t maxEntries) {
+    headerCodec_.setEncodeCacheSize(maxEntries);
+  }
+  /**
+   * Decode header values as views into the ingress and into an arena shared
+   * by the header block, instead of copying each one into its own string.
+   * The HTTPHeaders of a message then keep the underlying buffers alive.
+   */
+  void setZeroCopyIngressHeaders(bool enabled) {
+    headerCodec_.setZeroCopyDecode(enabled);
+  }
+  /**
+   * Have the HPACK tables reference header values in pool, shared with the
+   * other connections using it, rather than holding their own copies. The
+   * pool is not thread safe, see HPACKInternPool.
+   */
+  void setHeaderInternPool(HPACKInternPool* pool) {
+    headerCodec_.setInternPool(pool);
+  }
   size_t addPriorityNodes(
       PriorityQueue& queue,
       folly::IOBufQueue& writeBuf,
@@ -187,6 +215,7 @@ public:
     size_t& parsed);
   ErrorCode parseHeaders(folly::io::Cursor& cursor);
   ErrorCode parsePriority(folly::io::Cursor& cursor);
+  ErrorCode parsePriorityUpdate(folly::io::Cursor& cursor);
   ErrorCode parseRstStream(folly::io::Cursor& cursor);
   ErrorCode parseSettings(folly::io::Cursor& cursor);
   ErrorCode parsePushPromise(folly::io::Cursor& cursor);
@@ -199,6 +228,10 @@ public:
     std::unique_ptr<folly::IOBuf> headerBuf,
     boost::optional<http2::PriorityUpdate> priority,
     boost::optional<uint32_t> promisedStream);
+  // valueBuf is set if value can be kept as a view into it
+  void onHeaderImpl(folly::StringPiece name,
+                    folly::StringPiece value,
+                    const folly::IOBuf* valueBuf);
 
   ErrorCode handleEndStream();
   ErrorCode checkNewStream(uint32_t stream);
@@ -255,6 +288,13 @@ public:
   HeaderDecodeInfo decodeInfo_;
   std::vector<StreamID> virtualPriorityNodes_;
   bool reuseIOBufHeadroomForData_{true};
+
+  // SETTINGS frames sent and acknowledged, ACKs come in order
+  uint32_t settingsSent_{0};
+  uint32_t settingsAcked_{0};
+  // the SETTINGS frame emptying the peer's encoder table, 0 once acked
+  uint32_t tableResetSettings_{0};
+  bool hibernating_{false};
 };
 
 } // proxygen
@@ -38,6 +38,7 @@ const uint32_t kFrameGoawaySize = 8;
 const uint32_t kFrameWindowUpdateSize = 4;
 
 const uint32_t kFrameAltSvcSizeBase = 8;
+const uint32_t kFramePriorityUpdateSizeBase = 4;
 
 const uint32_t kMaxFramePayloadLengthMin = (1u << 14);
 const uint32_t kMaxFramePayloadLength = (1u << 24) - 1;
@@ -29,6 +29,7 @@ extern const uint32_t kFrameWindowUpdateSize;
 
 // These constants indicate the size of the required fields in the frame
 extern const uint32_t kFrameAltSvcSizeBase;
+extern const uint32_t kFramePriorityUpdateSizeBase;
 
 extern const uint32_t kMaxFramePayloadLengthMin;
 extern const uint32_t kMaxFramePayloadLength;
@@ -16,7 +16,8 @@ using namespace folly;
 
 namespace proxygen { namespace http2 {
 
-const uint8_t kMaxFrameType = static_cast<uint8_t>(FrameType::ALTSVC);
+const uint8_t kMaxFrameType =
+  static_cast<uint8_t>(FrameType::PRIORITY_UPDATE);
 const boost::optional<uint8_t> kNoPadding;
 const PriorityUpdate DefaultPriority{0, false, 15};
 
@@ -507,6 +508,27 @@ parseAltSvc(Cursor& cursor,
   return ErrorCode::NO_ERROR;
 }
 
+ErrorCode
+parsePriorityUpdate(Cursor& cursor,
+                    FrameHeader header,
+                    uint32_t& outPrioritizedStream,
+                    std::string& outPriorityField) noexcept {
+  DCHECK_LE(header.length, cursor.totalLength());
+  if (header.length < kFramePriorityUpdateSizeBase) {
+    return ErrorCode::FRAME_SIZE_ERROR;
+  }
+  if (header.stream != 0) {
+    return ErrorCode::PROTOCOL_ERROR;
+  }
+  outPrioritizedStream = parseUint31(cursor);
+  if (outPrioritizedStream == 0) {
+    return ErrorCode::PROTOCOL_ERROR;
+  }
+  outPriorityField = cursor.readFixedString(
+    header.length - kFramePriorityUpdateSizeBase);
+  return ErrorCode::NO_ERROR;
+}
+
 //// Egress ////
 
 size_t
@@ -771,6 +793,22 @@ writeAltSvc(IOBufQueue& queue,
   return kFrameHeaderSize + frameLen;
 }
 
+size_t
+writePriorityUpdate(IOBufQueue& queue,
+                    uint32_t prioritizedStream,
+                    StringPiece priorityField) noexcept {
+  DCHECK_NE(0, prioritizedStream);
+  const auto frameLen = priorityField.size() + kFramePriorityUpdateSizeBase;
+
+  writeFrameHeader(queue, frameLen, FrameType::PRIORITY_UPDATE, 0, 0,
+                   kNoPadding, boost::none, nullptr);
+  QueueAppender appender(&queue, frameLen);
+  appender.writeBE<uint32_t>(prioritizedStream);
+  appender.push(reinterpret_cast<const uint8_t*>(priorityField.data()),
+                priorityField.size());
+  return kFrameHeaderSize + frameLen;
+}
+
 const char* getFrameTypeString(FrameType type) {
   switch (type) {
     case FrameType::DATA: return "DATA";
@@ -784,6 +822,7 @@ const char* getFrameTypeString(FrameType type) {
     case FrameType::WINDOW_UPDATE: return "WINDOW_UPDATE";
     case FrameType::CONTINUATION: return "CONTINUATION";
     case FrameType::ALTSVC: return "ALTSVC";
+    case FrameType::PRIORITY_UPDATE: return "PRIORITY_UPDATE";
     default:
       // can happen when type was cast from uint8_t
       return "Unknown";
@@ -44,6 +44,7 @@ enum class FrameType: uint8_t {
   WINDOW_UPDATE = 8,
   CONTINUATION = 9,
   ALTSVC = 10,  // not in current draft so frame type has not been assigned
+  PRIORITY_UPDATE = 16,  // RFC 9218
 };
 
 enum Flags {
@@ -316,6 +317,25 @@ parseAltSvc(folly::io::Cursor& cursor,
             std::string& outHost,
             std::string& outOrigin) noexcept;
 
+/**
+ * This function parses the section of the PRIORITY_UPDATE frame (RFC 9218)
+ * after the common frame header. The caller must ensure there is
+ * header.length bytes available in the cursor.
+ *
+ * @param cursor The cursor to pull data from.
+ * @param header The frame header for the frame being parsed.
+ * @param outPrioritizedStream The stream the priority applies to.
+ * @param outPriorityField The priority field value, in the format of the
+ *                         priority header.
+ * @return NO_ERROR for successful parse. The connection error code to
+ *         return in a GOAWAY frame if failure.
+ */
+extern ErrorCode
+parsePriorityUpdate(folly::io::Cursor& cursor,
+                    FrameHeader header,
+                    uint32_t& outPrioritizedStream,
+                    std::string& outPriorityField) noexcept;
+
 //// Egress ////
 
 /**
@@ -526,6 +546,22 @@ writeAltSvc(folly::IOBufQueue& writeBuf,
             folly::StringPiece host,
             folly::StringPiece origin) noexcept;
 
+/**
+ * Generate an entire PRIORITY_UPDATE frame (RFC 9218), including the common
+ * frame header.
+ *
+ * @param writeBuf The output queue to write to. It may grow or add
+ *                 underlying buffers inside this function.
+ * @param prioritizedStream The stream the priority applies to.
+ * @param priorityField The priority field value, in the format of the
+ *                      priority header.
+ * @return The number of bytes written to writeBuf.
+ */
+extern size_t
+writePriorityUpdate(folly::IOBufQueue& writeBuf,
+                    uint32_t prioritizedStream,
+                    folly::StringPiece priorityField) noexcept;
+
 /**
  * Get the string representation of the given FrameType
  *
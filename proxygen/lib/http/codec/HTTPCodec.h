@@ -13,6 +13,7 @@
 #include <folly/io/IOBufQueue.h>
 #include <proxygen/lib/http/HTTPException.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
+#include <proxygen/lib/http/RFC9218.h>
 #include <proxygen/lib/http/codec/CodecProtocol.h>
 #include <proxygen/lib/http/codec/ErrorCode.h>
 #include <proxygen/lib/http/codec/HTTPSettings.h>
@@ -240,6 +241,15 @@ class HTTPCodec {
         StreamID /* stream */,
         const HTTPMessage::HTTPPriority& /* pri */) {}
 
+    /**
+     * Called upon receipt of a PRIORITY_UPDATE frame, for protocols that
+     * support the extensible priorities of RFC 9218. The stream may not
+     * have been opened yet.
+     */
+    virtual void onExtensiblePriority(
+        StreamID /* stream */,
+        const RFC9218::Priority& /* pri */) {}
+
     /**
      * Called upon receipt of a valid protocol switch.  Return false if
      * protocol switch could not be completed.
@@ -520,6 +530,23 @@ class HTTPCodec {
     return 0;
   }
 
+  /**
+   * Free the state the codec can rebuild, such as header compression
+   * tables, while the connection has no transactions. The codec may
+   * generate frames to have the peer reset its side as well. Returns the
+   * number of bytes generated.
+   */
+  virtual size_t hibernate(folly::IOBufQueue& /* writeBuf */) {
+    return 0;
+  }
+
+  /**
+   * Restore what hibernate() released, before any new transaction.
+   */
+  virtual size_t wake(folly::IOBufQueue& /* writeBuf */) {
+    return 0;
+  }
+
   /*
    * Generate a WINDOW_UPDATE message, if supported. The delta is the amount
    * of ingress bytes we processed and freed from the current receive window.
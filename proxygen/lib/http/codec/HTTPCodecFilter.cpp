@@ -110,6 +110,12 @@ void PassThroughHTTPCodecFilter::onPriority(
   callback_->onPriority(stream, pri);
 }
 
+void PassThroughHTTPCodecFilter::onExtensiblePriority(
+  StreamID stream,
+  const RFC9218::Priority& pri) {
+  callback_->onExtensiblePriority(stream, pri);
+}
+
 bool PassThroughHTTPCodecFilter::onNativeProtocolUpgrade(
   StreamID streamID, CodecProtocol protocol, const std::string& protocolString,
   HTTPMessage& msg) {
@@ -284,6 +290,14 @@ size_t PassThroughHTTPCodecFilter::generateSettingsAck(folly::IOBufQueue& buf) {
   return call_->generateSettingsAck(buf);
 }
 
+size_t PassThroughHTTPCodecFilter::hibernate(folly::IOBufQueue& buf) {
+  return call_->hibernate(buf);
+}
+
+size_t PassThroughHTTPCodecFilter::wake(folly::IOBufQueue& buf) {
+  return call_->wake(buf);
+}
+
 size_t PassThroughHTTPCodecFilter::generateWindowUpdate(
   folly::IOBufQueue& buf,
   StreamID stream,
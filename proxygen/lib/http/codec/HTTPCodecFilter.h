@@ -86,6 +86,9 @@ class PassThroughHTTPCodecFilter: public HTTPCodecFilter {
   void onPriority(StreamID stream,
                   const HTTPMessage::HTTPPriority& pri) override;
 
+  void onExtensiblePriority(StreamID stream,
+                            const RFC9218::Priority& pri) override;
+
   bool onNativeProtocolUpgrade(StreamID stream,
                                CodecProtocol protocol,
                                const std::string& protocolString,
@@ -180,6 +183,10 @@ class PassThroughHTTPCodecFilter: public HTTPCodecFilter {
 
   size_t generateSettingsAck(folly::IOBufQueue& writeBuf) override;
 
+  size_t hibernate(folly::IOBufQueue& writeBuf) override;
+
+  size_t wake(folly::IOBufQueue& writeBuf) override;
+
   size_t generateWindowUpdate(folly::IOBufQueue& writeBuf,
                               StreamID stream,
                               uint32_t delta) override;
@@ -26,6 +26,9 @@ enum class SettingsId: uint32_t {
   MAX_FRAME_SIZE = 5,
   MAX_HEADER_LIST_SIZE = 6,
 
+  // From RFC 9218
+  NO_RFC7540_PRIORITIES = 9,
+
   // From SPDY, mostly unused
   _SPDY_UPLOAD_BANDWIDTH = SPDY_SETTINGS_MASK | 1,
   _SPDY_DOWNLOAD_BANDWIDTH = SPDY_SETTINGS_MASK | 2,
@@ -59,6 +59,10 @@ unique_ptr<IOBuf> HPACKCodec::encode(vector<Header>& headers,
   encodedSize_.uncompressed = uncompressed;
   if (stats_) {
     stats_->recordEncode(Type::HPACK, encodedSize_);
+    if (encoder_.hasEncodeCache()) {
+      stats_->recordEncodeCache(Type::HPACK, encoder_.getEncodeCacheHits(),
+                                encoder_.getEncodeCacheMisses());
+    }
   }
   return buf;
 }
@@ -133,6 +137,14 @@ void HPACKCodec::onHeader(const folly::fbstring& name,
   streamingCb_->onHeader(name, value);
 }
 
+void HPACKCodec::onHeaderView(folly::StringPiece name,
+                              folly::StringPiece value,
+                              const folly::IOBuf& valueBuf) {
+  assert(streamingCb_ != nullptr);
+  decodedSize_.uncompressed += name.size() + value.size() + 2;
+  streamingCb_->onHeaderView(name, value, valueBuf);
+}
+
 void HPACKCodec::onHeadersComplete(HTTPHeaderSize decodedSize) {
   assert(streamingCb_ != nullptr);
   if (stats_) {
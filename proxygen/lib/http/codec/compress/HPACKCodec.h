@@ -91,6 +91,9 @@ class HPACKCodec : public HeaderCodec, HeaderCodec::StreamingCallback {
   // Callbacks that handle Codec-level stats and errors
   void onHeader(const folly::fbstring& name,
                 const folly::fbstring& value) override;
+  void onHeaderView(folly::StringPiece name,
+                    folly::StringPiece value,
+                    const folly::IOBuf& valueBuf) override;
   void onHeadersComplete(HTTPHeaderSize decodedSize) override;
   void onDecodeError(HeaderDecodeError decodeError) override;
 
@@ -103,10 +106,49 @@ class HPACKCodec : public HeaderCodec, HeaderCodec::StreamingCallback {
     encoder_.setHeaderTableSize(size);
   }
 
+  /**
+   * See HPACKEncoder::resetTable()
+   */
+  void resetEncoderTable() {
+    encoder_.resetTable();
+  }
+
+  /**
+   * See HPACKDecoder::prepareTableReset()
+   */
+  void prepareDecoderTableReset() {
+    decoder_.prepareTableReset();
+  }
+
+  void completeDecoderTableReset() {
+    decoder_.completeTableReset();
+  }
+
+  void setEncodeCacheSize(uint32_t maxEntries) {
+    encoder_.setEncodeCacheSize(maxEntries);
+  }
+
   void setDecoderHeaderTableMaxSize(uint32_t size) {
     decoder_.setHeaderTableMaxSize(size);
   }
 
+  void setHuffmanDecodeMode(huffman::DecodeMode mode) {
+    decoder_.setHuffmanDecodeMode(mode);
+  }
+
+  void setZeroCopyDecode(bool zeroCopy) {
+    decoder_.setZeroCopyDecode(zeroCopy);
+  }
+
+  /**
+   * Share the values of both dynamic tables through pool, see
+   * HeaderTable::setInternPool()
+   */
+  void setInternPool(HPACKInternPool* pool) {
+    encoder_.setInternPool(pool);
+    decoder_.setInternPool(pool);
+  }
+
   void setCommitEpoch(uint16_t commitEpoch) {
     encoder_.setCommitEpoch(commitEpoch);
   }
@@ -28,7 +28,10 @@ HPACKContext::HPACKContext(uint32_t tableSize, bool qcram, bool useBaseIndex) :
 
 uint32_t HPACKContext::getIndex(const HPACKHeader& header, int32_t commitEpoch,
                                 int32_t curEpoch) const {
-  uint32_t index = getStaticTable().getIndex(header);
+  // the static table lookup is a compile time perfect hash, so common headers
+  // are matched without touching the heap
+  uint32_t index = StaticHeaderTable::lookupIndex(header.name.get(),
+                                                  header.value.get());
   if (index) {
     return staticToGlobalIndex(index);
   }
@@ -44,7 +47,7 @@ uint32_t HPACKContext::getIndex(const HPACKHeader& header, int32_t commitEpoch,
 uint32_t HPACKContext::nameIndex(const HPACKHeaderName& headerName,
                                  int32_t commitEpoch,
                                  int32_t curEpoch) const {
-  uint32_t index = getStaticTable().nameIndex(headerName);
+  uint32_t index = StaticHeaderTable::lookupNameIndex(headerName.get());
   if (index) {
     return staticToGlobalIndex(index);
   }
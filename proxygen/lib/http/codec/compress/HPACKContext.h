@@ -51,6 +51,14 @@ class HPACKContext {
     return table_;
   }
 
+  /**
+   * Share the values of the dynamic table through pool, see
+   * HeaderTable::setInternPool
+   */
+  void setInternPool(HPACKInternPool* pool) {
+    table_.setInternPool(pool);
+  }
+
   void seedHeaderTable(std::vector<HPACKHeader>& headers);
 
   void describe(std::ostream& os) const;
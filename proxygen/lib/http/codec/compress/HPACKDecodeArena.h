@@ -0,0 +1,87 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * Append only memory for the header names and values decoded from header
+ * blocks, so they can be handed out as views instead of one string each.
+ *
+ * Memory comes in blocks, each one a separate IOBuf, so a consumer keeping
+ * a view can pin the block it points into by cloning it. Bytes already
+ * handed out are never written again; a block is only recycled once no
+ * clone of it is left.
+ */
+class HPACKDecodeArena {
+ public:
+  static const uint32_t kDefaultBlockSize = 4000;
+
+  explicit HPACKDecodeArena(uint32_t blockSize = kDefaultBlockSize)
+      : blockSize_(blockSize) {}
+
+  /**
+   * Prepare for a header block, sizeHint is a guess of the bytes needed.
+   */
+  void reset(uint32_t sizeHint) {
+    if (block_ && !block_->isSharedOne()) {
+      // nobody references what was decoded so far, start over
+      block_->clear();
+    }
+    if (!block_ || block_->tailroom() < sizeHint) {
+      newBlock(sizeHint);
+    }
+  }
+
+  /**
+   * @return size writable bytes, which are considered used from now on.
+   * block is set to the IOBuf they belong to.
+   */
+  uint8_t* allocate(uint32_t size, const folly::IOBuf*& block) {
+    if (!block_ || block_->tailroom() < size) {
+      newBlock(size);
+    }
+    uint8_t* data = block_->writableTail();
+    block_->append(size);
+    block = block_.get();
+    return data;
+  }
+
+  /**
+   * Free the current block, views into it keep their own reference.
+   */
+  void release() {
+    block_.reset();
+  }
+
+  folly::StringPiece copy(folly::StringPiece str, const folly::IOBuf*& block) {
+    uint8_t* data = allocate(str.size(), block);
+    if (!str.empty()) {
+      memcpy(data, str.data(), str.size());
+    }
+    return folly::StringPiece((const char*)data, str.size());
+  }
+
+ private:
+  void newBlock(uint32_t minSize) {
+    block_ = folly::IOBuf::create(std::max(minSize, blockSize_));
+  }
+
+  uint32_t blockSize_;
+  std::unique_ptr<folly::IOBuf> block_;
+};
+
+}
@@ -41,16 +41,15 @@ uint8_t HPACKDecodeBuffer::peek() {
   return *cursor_.data();
 }
 
-DecodeError HPACKDecodeBuffer::decodeLiteral(folly::fbstring& literal) {
-  literal.clear();
+DecodeError HPACKDecodeBuffer::decodeLiteralSize(bool& huffman,
+                                                 uint32_t& size) {
   if (remainingBytes_ == 0) {
     LOG(ERROR) << "remainingBytes_ == 0";
     return DecodeError::BUFFER_UNDERFLOW;
   }
   auto byte = peek();
-  bool huffman = byte & HPACK::LiteralEncoding::HUFFMAN;
+  huffman = byte & HPACK::LiteralEncoding::HUFFMAN;
   // extract the size
-  uint32_t size;
   DecodeError result = decodeInteger(7, size);
   if (result != DecodeError::NONE) {
     LOG(ERROR) << "Could not decode literal size";
@@ -65,6 +64,17 @@ DecodeError HPACKDecodeBuffer::decodeLiteral(folly::fbstring& literal) {
     LOG(ERROR) << "Literal too large, size=" << size;
     return DecodeError::LITERAL_TOO_LARGE;
   }
+  return DecodeError::NONE;
+}
+
+DecodeError HPACKDecodeBuffer::decodeLiteral(folly::fbstring& literal) {
+  literal.clear();
+  bool huffman;
+  uint32_t size;
+  DecodeError result = decodeLiteralSize(huffman, size);
+  if (result != DecodeError::NONE) {
+    return result;
+  }
   const uint8_t* data;
   unique_ptr<IOBuf> tmpbuf;
   // handle the case where the buffer spans multiple buffers
@@ -79,7 +89,10 @@ DecodeError HPACKDecodeBuffer::decodeLiteral(folly::fbstring& literal) {
     data = tmpbuf->data();
   }
   if (huffman) {
-    huffmanTree_.decode(data, size, literal);
+    if (!huffmanTree_.decode(data, size, literal, huffmanDecodeMode_)) {
+      LOG(ERROR) << "Invalid huffman code, size=" << size;
+      return DecodeError::INVALID_HUFFMAN_CODE;
+    }
   } else {
     literal.append((const char *)data, size);
   }
@@ -87,6 +100,60 @@ DecodeError HPACKDecodeBuffer::decodeLiteral(folly::fbstring& literal) {
   return DecodeError::NONE;
 }
 
+DecodeError HPACKDecodeBuffer::decodeLiteral(folly::StringPiece& literal,
+                                             HPACKDecodeArena& arena,
+                                             IOBuf& ingress,
+                                             const IOBuf*& buf) {
+  bool huffman;
+  uint32_t size;
+  DecodeError result = decodeLiteralSize(huffman, size);
+  if (result != DecodeError::NONE) {
+    return result;
+  }
+  if (size > 0 && cursor_.length() == 0) {
+    // move to the next IOBuf of the chain
+    cursor_.peek();
+  }
+  if (!huffman) {
+    if (cursor_.length() >= size) {
+      // shares the ingress buffer, without allocating
+      cursor_.clone(ingress, size);
+      if (ingress.isManagedOne()) {
+        literal = folly::StringPiece((const char*)ingress.data(), size);
+        buf = &ingress;
+      } else {
+        literal = arena.copy(
+          folly::StringPiece((const char*)ingress.data(), size), buf);
+      }
+    } else {
+      uint8_t* data = arena.allocate(size, buf);
+      cursor_.pull(data, size);
+      literal = folly::StringPiece((const char*)data, size);
+    }
+    remainingBytes_ -= size;
+    return DecodeError::NONE;
+  }
+  const uint8_t* data;
+  unique_ptr<IOBuf> tmpbuf;
+  if (cursor_.length() >= size) {
+    data = cursor_.data();
+    cursor_.skip(size);
+  } else {
+    tmpbuf = IOBuf::create(size);
+    cursor_.pull(tmpbuf->writableData(), size);
+    data = tmpbuf->data();
+  }
+  // the scratch string keeps its capacity across literals
+  huffmanLiteral_.clear();
+  if (!huffmanTree_.decode(data, size, huffmanLiteral_, huffmanDecodeMode_)) {
+    LOG(ERROR) << "Invalid huffman code, size=" << size;
+    return DecodeError::INVALID_HUFFMAN_CODE;
+  }
+  literal = arena.copy(huffmanLiteral_, buf);
+  remainingBytes_ -= size;
+  return DecodeError::NONE;
+}
+
 DecodeError HPACKDecodeBuffer::decodeInteger(uint8_t nbit, uint32_t& integer) {
   if (remainingBytes_ == 0) {
     LOG(ERROR) << "remainingBytes_ == 0";
@@ -14,6 +14,7 @@
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <proxygen/lib/http/codec/compress/HPACKConstants.h>
+#include <proxygen/lib/http/codec/compress/HPACKDecodeArena.h>
 #include <proxygen/lib/http/codec/compress/Huffman.h>
 
 namespace proxygen {
@@ -24,12 +25,15 @@ class HPACKDecodeBuffer {
   explicit HPACKDecodeBuffer(const huffman::HuffTree& huffmanTree,
                              folly::io::Cursor& cursorVal,
                              uint32_t totalBytes,
-                             uint32_t maxLiteralSize)
+                             uint32_t maxLiteralSize,
+                             huffman::DecodeMode huffmanDecodeMode =
+                               huffman::kDefaultDecodeMode)
       : huffmanTree_(huffmanTree),
         cursor_(cursorVal),
         totalBytes_(totalBytes),
         remainingBytes_(totalBytes),
-        maxLiteralSize_(maxLiteralSize) {}
+        maxLiteralSize_(maxLiteralSize),
+        huffmanDecodeMode_(huffmanDecodeMode) {}
 
   ~HPACKDecodeBuffer() {}
 
@@ -79,12 +83,28 @@ class HPACKDecodeBuffer {
    */
   HPACK::DecodeError decodeLiteral(folly::fbstring& literal);
 
+  /**
+   * decode a literal starting from the current position without giving it
+   * its own string. A plain literal that is contiguous in a managed ingress
+   * IOBuf is cloned into ingress and referenced in place, anything else is
+   * decoded into the arena. buf is set to the IOBuf that literal points
+   * into.
+   */
+  HPACK::DecodeError decodeLiteral(folly::StringPiece& literal,
+                                   HPACKDecodeArena& arena,
+                                   folly::IOBuf& ingress,
+                                   const folly::IOBuf*& buf);
+
 private:
+  HPACK::DecodeError decodeLiteralSize(bool& huffman, uint32_t& size);
+
   const huffman::HuffTree& huffmanTree_;
   folly::io::Cursor& cursor_;
   uint32_t totalBytes_;
   uint32_t remainingBytes_;
   uint32_t maxLiteralSize_{std::numeric_limits<uint32_t>::max()};
+  huffman::DecodeMode huffmanDecodeMode_{huffman::kDefaultDecodeMode};
+  folly::fbstring huffmanLiteral_;
 };
 
 }
@@ -80,7 +80,7 @@ uint32_t HPACKDecoder::decode(Cursor& cursor,
                               headers_t& headers) {
   uint32_t emittedSize = 0;
   HPACKDecodeBuffer dbuf(getHuffmanTree(), cursor, totalBytes,
-                         maxUncompressed_);
+                         maxUncompressed_, huffmanDecodeMode_);
   handleBaseIndex(dbuf);
   while (!hasError() && !dbuf.empty()) {
     emittedSize += decodeHeader(dbuf, &headers);
@@ -101,8 +101,12 @@ uint32_t HPACKDecoder::decodeStreaming(
 
   uint32_t emittedSize = 0;
   streamingCb_ = streamingCb;
+  if (zeroCopyEnabled()) {
+    // huffman coding shrinks a literal to about 5/8 of its size
+    arena_.reset(totalBytes * 8 / 5);
+  }
   HPACKDecodeBuffer dbuf(getHuffmanTree(), cursor, totalBytes,
-                         maxUncompressed_);
+                         maxUncompressed_, huffmanDecodeMode_);
   handleBaseIndex(dbuf);
   while (!hasError() && !dbuf.empty()) {
     emittedSize += decodeHeader(dbuf, nullptr);
@@ -111,9 +115,12 @@ uint32_t HPACKDecoder::decodeStreaming(
       LOG(ERROR) << "exceeded uncompressed size limit of "
                  << maxUncompressed_ << " bytes";
       err_ = HPACK::DecodeError::HEADERS_TOO_LARGE;
-      return dbuf.consumedBytes();
+      break;
     }
   }
+  // don't hold on to the ingress once the block is decoded
+  nameIngress_ = IOBuf();
+  valueIngress_ = IOBuf();
 
   return dbuf.consumedBytes();
 }
@@ -132,9 +139,22 @@ void HPACKDecoder::handleTableSizeUpdate(HPACKDecodeBuffer& dbuf) {
     err_ = HPACK::DecodeError::INVALID_TABLE_SIZE;
     return;
   }
+  if (arg == 0) {
+    // the table emptied itself
+    tableResetPending_ = false;
+  }
   table_.setCapacity(arg);
 }
 
+void HPACKDecoder::completeTableReset() {
+  if (tableResetPending_) {
+    table_.setCapacity(0);
+    tableResetPending_ = false;
+  }
+  table_.compact();
+  arena_.release();
+}
+
 uint32_t HPACKDecoder::decodeLiteralHeader(HPACKDecodeBuffer& dbuf,
                                            headers_t* emitted) {
   uint8_t byte = dbuf.peek();
@@ -168,6 +188,8 @@ uint32_t HPACKDecoder::decodeLiteralHeader(HPACKDecodeBuffer& dbuf,
       return 0;
     }
     header.name = getHeader(index).name;
+  } else if (zeroCopyEnabled()) {
+    return decodeLiteralHeaderView(dbuf, indexing);
   } else {
     // skip current byte
     dbuf.next();
@@ -179,13 +201,18 @@ uint32_t HPACKDecoder::decodeLiteralHeader(HPACKDecodeBuffer& dbuf,
       return 0;
     }
   }
+  if (zeroCopyEnabled()) {
+    return decodeLiteralHeaderView(dbuf, indexing, &header.name);
+  }
   // value
-  err_ = dbuf.decodeLiteral(header.value);
+  folly::fbstring value;
+  err_ = dbuf.decodeLiteral(value);
   if (err_ != HPACK::DecodeError::NONE) {
     LOG(ERROR) << "Error decoding header value name=" << header.name
                << " err_=" << err_;
     return 0;
   }
+  header.value = std::move(value);
 
   uint32_t emittedSize = emit(header, emitted);
 
@@ -197,6 +224,42 @@ uint32_t HPACKDecoder::decodeLiteralHeader(HPACKDecodeBuffer& dbuf,
   return emittedSize;
 }
 
+uint32_t HPACKDecoder::decodeLiteralHeaderView(
+    HPACKDecodeBuffer& dbuf,
+    bool indexing,
+    const HPACKHeaderName* indexedName) {
+  folly::StringPiece name;
+  if (indexedName) {
+    name = indexedName->get();
+  } else {
+    // skip current byte
+    dbuf.next();
+    const IOBuf* nameBuf = nullptr;
+    err_ = dbuf.decodeLiteral(name, arena_, nameIngress_, nameBuf);
+    if (err_ != HPACK::DecodeError::NONE) {
+      LOG(ERROR) << "Error decoding header name err_=" << err_;
+      return 0;
+    }
+  }
+  folly::StringPiece value;
+  const IOBuf* valueBuf = nullptr;
+  err_ = dbuf.decodeLiteral(value, arena_, valueIngress_, valueBuf);
+  if (err_ != HPACK::DecodeError::NONE) {
+    LOG(ERROR) << "Error decoding header value name=" << name
+               << " err_=" << err_;
+    return 0;
+  }
+
+  uint32_t emittedSize = emitView(name, value, *valueBuf);
+
+  if (indexing) {
+    // the table keeps its own copy
+    table_.add(HPACKHeader(name, value));
+  }
+
+  return emittedSize;
+}
+
 uint32_t HPACKDecoder::decodeIndexedHeader(HPACKDecodeBuffer& dbuf,
                                            headers_t* emitted) {
   uint32_t index;
@@ -241,13 +304,27 @@ uint32_t HPACKDecoder::decodeHeader(HPACKDecodeBuffer& dbuf,
 }
 
 uint32_t HPACKDecoder::emit(const HPACKHeader& header, headers_t* emitted) {
-  if (streamingCb_) {
-    streamingCb_->onHeader(header.name.get(), header.value);
+  if (zeroCopyEnabled()) {
+    // indexed values are copied to the arena, as the entry may be evicted
+    // before the consumer is done with the view
+    const IOBuf* valueBuf = nullptr;
+    auto value = arena_.copy(header.value.get(), valueBuf);
+    return emitView(header.name.get(), value, *valueBuf);
+  } else if (streamingCb_) {
+    streamingCb_->onHeader(header.name.get(), header.value.get());
   } else if (emitted) {
     // copying HPACKHeader
-    emitted->emplace_back(header.name.get(), header.value);
+    emitted->emplace_back(header.name.get(), header.value.get());
   }
   return header.bytes();
 }
 
+uint32_t HPACKDecoder::emitView(folly::StringPiece name,
+                                folly::StringPiece value,
+                                const IOBuf& valueBuf) {
+  streamingCb_->onHeaderView(name, value, valueBuf);
+  return folly::to<uint32_t>(HPACKHeader::kMinLength + name.size() +
+                             value.size());
+}
+
 }
@@ -15,6 +15,7 @@
 #include <memory>
 #include <proxygen/lib/http/codec/compress/HeaderCodec.h>
 #include <proxygen/lib/http/codec/compress/HPACKContext.h>
+#include <proxygen/lib/http/codec/compress/HPACKDecodeArena.h>
 #include <proxygen/lib/http/codec/compress/HPACKDecodeBuffer.h>
 #include <proxygen/lib/http/codec/compress/HPACKHeader.h>
 #include <vector>
@@ -74,6 +75,19 @@ class HPACKDecoder : public HPACKContext {
     maxUncompressed_ = maxUncompressed;
   }
 
+  void setHuffmanDecodeMode(huffman::DecodeMode mode) {
+    huffmanDecodeMode_ = mode;
+  }
+
+  /**
+   * When enabled, decodeStreaming hands values to the callback through
+   * onHeaderView, pointing into the ingress buffer or into an arena shared
+   * by the whole header block, instead of one string per header.
+   */
+  void setZeroCopyDecode(bool zeroCopy) {
+    zeroCopy_ = zeroCopy;
+  }
+
   uint32_t getTableSize() const {
     return table_.capacity();
   }
@@ -86,6 +100,19 @@ class HPACKDecoder : public HPACKContext {
     return table_.size();
   }
 
+  /**
+   * To empty the table of an idle connection: call prepareTableReset()
+   * when sending a SETTINGS_HEADER_TABLE_SIZE of 0, and completeTableReset()
+   * once the peer acknowledged it. Unless a size update of 0 arrived in
+   * between, the peer has encoded nothing since, and its next header block
+   * starts with that update, so the table can be emptied right away.
+   */
+  void prepareTableReset() {
+    tableResetPending_ = true;
+  }
+
+  void completeTableReset();
+
  protected:
   bool isValid(uint32_t index);
 
@@ -93,6 +120,13 @@ class HPACKDecoder : public HPACKContext {
 
   uint32_t emit(const HPACKHeader& header, headers_t* emitted);
 
+  uint32_t emitView(folly::StringPiece name, folly::StringPiece value,
+                    const folly::IOBuf& valueBuf);
+
+  bool zeroCopyEnabled() const {
+    return zeroCopy_ && streamingCb_;
+  }
+
   void handleBaseIndex(HPACKDecodeBuffer& dbuf);
 
   virtual uint32_t decodeIndexedHeader(HPACKDecodeBuffer& dbuf,
@@ -101,6 +135,11 @@ class HPACKDecoder : public HPACKContext {
   virtual uint32_t decodeLiteralHeader(HPACKDecodeBuffer& dbuf,
                                        headers_t* emitted);
 
+  uint32_t decodeLiteralHeaderView(
+    HPACKDecodeBuffer& dbuf,
+    bool indexing,
+    const HPACKHeaderName* indexedName = nullptr);
+
   uint32_t decodeHeader(HPACKDecodeBuffer& dbuf, headers_t* emitted);
 
   void handleTableSizeUpdate(HPACKDecodeBuffer& dbuf);
@@ -108,7 +147,14 @@ class HPACKDecoder : public HPACKContext {
   HPACK::DecodeError err_{HPACK::DecodeError::NONE};
   uint32_t maxTableSize_;
   uint32_t maxUncompressed_;
+  huffman::DecodeMode huffmanDecodeMode_{huffman::kDefaultDecodeMode};
   HeaderCodec::StreamingCallback* streamingCb_{nullptr};
+  bool zeroCopy_{false};
+  bool tableResetPending_{false};
+  HPACKDecodeArena arena_;
+  // clones of the ingress the current name and value point into
+  folly::IOBuf nameIngress_;
+  folly::IOBuf valueIngress_;
 };
 
 HeaderDecodeError hpack2headerCodecError(HPACK::DecodeError err);
@@ -89,18 +89,53 @@ uint32_t HPACKEncodeBuffer::encodeInteger(uint32_t value, uint8_t prefix,
   return count;
 }
 
-uint32_t HPACKEncodeBuffer::encodeHuffman(const folly::fbstring& literal) {
-  uint32_t size = huffmanTree_.getEncodeSize(literal);
-  // add the length
-  uint32_t count = encodeInteger(size, HPACK::LiteralEncoding::HUFFMAN, 7);
-  // ensure we have enough bytes before performing the encoding
-  count += huffmanTree_.encode(literal, buf_);
+uint32_t HPACKEncodeBuffer::getIntegerSize(uint32_t value, uint8_t nbit) {
+  uint32_t mask = ~HPACK::NBIT_MASKS[nbit] & 0xFF;
+  if (value < mask) {
+    return 1;
+  }
+  uint32_t count = 2;
+  for (value -= mask; value >= 128; value = value >> 7) {
+    ++count;
+  }
   return count;
 }
 
+uint32_t HPACKEncodeBuffer::encodeHuffman(const folly::fbstring& literal,
+                                          uint32_t maxSize) {
+  // the length goes before the data, leave room for the largest prefix and
+  // move the data back in the rare case the actual one is shorter
+  uint32_t prefixSize = getIntegerSize(maxSize, 7);
+  buf_.ensure(prefixSize + maxSize + huffman::kEncodeSlack);
+  uint8_t* start = buf_.writableData();
+  uint32_t size = huffmanTree_.encode(literal, start + prefixSize, maxSize);
+  if (size > maxSize) {
+    return 0;
+  }
+  uint32_t sizeLen = getIntegerSize(size, 7);
+  if (sizeLen < prefixSize) {
+    memmove(start + sizeLen, start + prefixSize, size);
+  }
+  // we have ensured enough room, so the length lands at 'start'
+  uint32_t count = encodeInteger(size, HPACK::LiteralEncoding::HUFFMAN, 7);
+  DCHECK_EQ(buf_.writableData(), start + sizeLen);
+  buf_.append(size);
+  return count + size;
+}
+
+uint32_t HPACKEncodeBuffer::encodeHuffman(const folly::fbstring& literal) {
+  // no code is longer than 32 bits
+  return encodeHuffman(literal, literal.size() * 4);
+}
+
 uint32_t HPACKEncodeBuffer::encodeLiteral(const folly::fbstring& literal) {
   if (huffmanEnabled_) {
-    return encodeHuffman(literal);
+    // give up on huffman if it would make the literal longer, ties stay
+    // with huffman like in the RFC 7541 examples
+    uint32_t count = encodeHuffman(literal, literal.size());
+    if (count > 0) {
+      return count;
+    }
   }
   // otherwise use simple layout
   uint32_t count =
@@ -111,6 +146,11 @@ uint32_t HPACKEncodeBuffer::encodeLiteral(const folly::fbstring& literal) {
   return count;
 }
 
+uint32_t HPACKEncodeBuffer::appendEncoded(folly::StringPiece encoded) {
+  buf_.push((const uint8_t*)encoded.data(), encoded.size());
+  return encoded.size();
+}
+
 string HPACKEncodeBuffer::toBin() {
   return IOBufPrinter::printBin(bufQueue_.front());
 }
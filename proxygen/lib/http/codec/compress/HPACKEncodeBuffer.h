@@ -66,7 +66,8 @@ class HPACKEncodeBuffer {
   uint32_t encodeInteger(uint32_t value, uint8_t prefix, uint8_t nbit);
 
   /**
-   * encodes a string, either header name or header value
+   * encodes a string, either header name or header value. When huffman is
+   * enabled it is used unless it makes the string longer.
    *
    * @return bytes used for encoding
    */
@@ -77,6 +78,18 @@ class HPACKEncodeBuffer {
    */
   uint32_t encodeHuffman(const folly::fbstring& literal);
 
+  /**
+   * appends bytes produced earlier by a buffer with the same huffman setting
+   *
+   * @return bytes appended
+   */
+  uint32_t appendEncoded(folly::StringPiece encoded);
+
+  /**
+   * how many bytes encodeInteger() takes for the value with a nbit prefix
+   */
+  static uint32_t getIntegerSize(uint32_t value, uint8_t nbit);
+
   /**
    * prints the content of an IOBuf in binary format. Useful for debugging.
    */
@@ -89,6 +102,14 @@ class HPACKEncodeBuffer {
    */
   void append(uint8_t byte);
 
+  /**
+   * huffman encodes the string and its length in a single pass, unless the
+   * encoding takes more than maxSize bytes
+   *
+   * @return bytes used for encoding, 0 if nothing was written
+   */
+  uint32_t encodeHuffman(const folly::fbstring& literal, uint32_t maxSize);
+
   uint32_t growthSize_;
   folly::IOBufQueue bufQueue_;
   folly::io::QueueAppender buf_;
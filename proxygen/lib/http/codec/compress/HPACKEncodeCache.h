@@ -0,0 +1,79 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/FBString.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace proxygen {
+
+/**
+ * Bounded LRU map from a key to the bytes it was encoded to, so the encoder
+ * can copy repeated literals instead of encoding them again.
+ *
+ * The cache doesn't know what the encoding depends on, the owner has to
+ * clear() it whenever that changes.
+ */
+class HPACKEncodeCache {
+ public:
+  explicit HPACKEncodeCache(uint32_t capacity) : capacity_(capacity) {}
+
+  /**
+   * @return the encoded bytes for the key, or nullptr on a miss. A hit makes
+   * the entry the most recently used one.
+   */
+  const std::string* get(const folly::fbstring& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return &it->second->second;
+  }
+
+  /**
+   * Store the encoded bytes for a key that isn't cached yet, evicting the
+   * least recently used entry when full.
+   */
+  const std::string& put(const folly::fbstring& key, std::string encoded) {
+    if (!lru_.empty() && lru_.size() >= capacity_) {
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+    lru_.emplace_front(key, std::move(encoded));
+    index_.emplace(key, lru_.begin());
+    return lru_.front().second;
+  }
+
+  void clear() {
+    index_.clear();
+    lru_.clear();
+  }
+
+  uint32_t size() const {
+    return lru_.size();
+  }
+
+  uint32_t capacity() const {
+    return capacity_;
+  }
+
+ private:
+  using Entry = std::pair<folly::fbstring, std::string>;
+
+  uint32_t capacity_;
+  std::list<Entry> lru_;
+  std::unordered_map<folly::fbstring, std::list<Entry>::iterator> index_;
+};
+
+}
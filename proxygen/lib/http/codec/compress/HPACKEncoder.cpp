@@ -14,6 +14,7 @@
 
 using folly::IOBuf;
 using std::list;
+using std::string;
 using std::unique_ptr;
 using std::unordered_set;
 using std::vector;
@@ -21,6 +22,10 @@ using std::vector;
 namespace {
 // Some number close to typical MTU + room for "overhead"
 const uint16_t kAutoFlushThreshold = 1400;
+// Encode cache entries are copied out of a small scratch buffer
+const uint32_t kCacheBufferGrowth = 256;
+// Longer values are unlikely to repeat, don't let them bloat the caches
+const uint32_t kMaxCachedValueLength = 256;
 }
 
 namespace proxygen {
@@ -37,7 +42,8 @@ HPACKEncoder::HPACKEncoder(bool huffman,
     huffman_(huffman),
     buffer_(kBufferGrowth, huffman::huffTree(), huffman),
     emitSequenceNumbers_(emitSequenceNumbers),
-    autoCommit_(autoCommit) {
+    autoCommit_(autoCommit),
+    cacheBuffer_(kCacheBufferGrowth, huffman::huffTree(), huffman) {
   // Default the encoder indexing strategy; it can be updated later as well
   setHeaderIndexingStrategy(HeaderIndexingStrategy::getDefaultInstance());
 }
@@ -49,6 +55,8 @@ unique_ptr<IOBuf> HPACKEncoder::encode(const vector<HPACKHeader>& headers,
     packetFlushed();
   }
   eviction_ = false;
+  cacheHits_ = 0;
+  cacheMisses_ = 0;
   if (headroom) {
     buffer_.addHeadroom(headroom);
   }
@@ -61,6 +69,12 @@ unique_ptr<IOBuf> HPACKEncoder::encode(const vector<HPACKHeader>& headers,
     bytesInPacket_ += buffer_.encodeInteger(baseIndex, 0, 0);
   }
   if (pendingContextUpdate_) {
+    if (pendingMinTableSize_ < table_.capacity()) {
+      bytesInPacket_ += buffer_.encodeInteger(
+        pendingMinTableSize_,
+        HPACK::HeaderEncoding::TABLE_SIZE_UPDATE,
+        5);
+    }
     bytesInPacket_ += buffer_.encodeInteger(
       table_.capacity(),
       HPACK::HeaderEncoding::TABLE_SIZE_UPDATE,
@@ -80,23 +94,98 @@ unique_ptr<IOBuf> HPACKEncoder::encode(const vector<HPACKHeader>& headers,
   return buffer_.release();
 }
 
-void HPACKEncoder::encodeAsLiteral(const HPACKHeader& header, bool indexing) {
-  if (indexingStrat_) {
-    indexing &= indexingStrat_->indexHeader(header);
+void HPACKEncoder::setEncodeCacheSize(uint32_t maxEntries) {
+  literalCache_.reset();
+  valueCache_.reset();
+  if (maxEntries == 0) {
+    return;
+  }
+  // with sequence numbers the literals depend on the epochs as well, only
+  // the values can be cached
+  if (!emitSequenceNumbers_ && !useBaseIndex_) {
+    literalCache_ = std::make_unique<HPACKEncodeCache>(maxEntries);
+  }
+  if (huffman_) {
+    valueCache_ = std::make_unique<HPACKEncodeCache>(maxEntries);
+  }
+}
+
+void HPACKEncoder::resetTable() {
+  setHeaderTableSize(0);
+  table_.compact();
+  if (valueCache_) {
+    valueCache_->clear();
   }
-  if (header.bytes() > table_.capacity()) {
-    // May want to investigate further whether or not this is wanted.
-    // Flushing the table on a large header frees up some memory,
-    // however, there will be no compression do to an empty table, and
-    // the table will fill up again fairly quickly
-    indexing = false;
+  cacheKey_ = folly::fbstring();
+}
+
+bool HPACKEncoder::shouldIndex(const HPACKHeader& header) const {
+  if (indexingStrat_ && !indexingStrat_->indexHeader(header)) {
+    return false;
+  }
+  // May want to investigate further whether or not this is wanted.
+  // Flushing the table on a large header frees up some memory,
+  // however, there will be no compression do to an empty table, and
+  // the table will fill up again fairly quickly
+  return header.bytes() <= table_.capacity();
+}
+
+string HPACKEncoder::releaseCacheBuffer() {
+  string encoded;
+  auto buf = cacheBuffer_.release();
+  if (buf) {
+    for (auto range : *buf) {
+      encoded.append((const char*)range.data(), range.size());
+    }
   }
+  return encoded;
+}
+
+uint32_t HPACKEncoder::encodeValue(HPACKEncodeBuffer& buffer,
+                                   const folly::fbstring& value) {
+  if (!valueCache_ || value.size() > kMaxCachedValueLength) {
+    return buffer.encodeLiteral(value);
+  }
+  const string* encoded = valueCache_->get(value);
+  if (encoded) {
+    cacheHits_++;
+  } else {
+    cacheMisses_++;
+    cacheBuffer_.encodeLiteral(value);
+    encoded = &valueCache_->put(value, releaseCacheBuffer());
+  }
+  return buffer.appendEncoded(*encoded);
+}
+
+void HPACKEncoder::encodeCachedLiteral(const HPACKHeader& header,
+                                       uint32_t index) {
+  cacheBuffer_.encodeInteger(index,
+                             HPACK::HeaderEncoding::LITERAL_NO_INDEXING, 4);
+  string encoded = releaseCacheBuffer();
+  encodeValue(cacheBuffer_, header.value.get());
+  encoded += releaseCacheBuffer();
+  cacheKey_.assign(1, (char)index);
+  cacheKey_.append(header.value.get());
+  bytesInPacket_ += buffer_.appendEncoded(
+    literalCache_->put(cacheKey_, std::move(encoded)));
+}
+
+void HPACKEncoder::encodeAsLiteral(const HPACKHeader& header, bool indexing) {
+  indexing &= shouldIndex(header);
   uint8_t prefix = indexing ?
     HPACK::HeaderEncoding::LITERAL_INCR_INDEXING :
     HPACK::HeaderEncoding::LITERAL_NO_INDEXING;
   uint8_t len = indexing ? 6 : 4;
   // name
   uint32_t index = nameIndex(header.name, commitEpoch_, nextSequenceNumber_);
+  if (literalCache_ && !indexing && index && isStatic(index) &&
+      header.value.size() <= kMaxCachedValueLength) {
+    // it never gets into the dynamic table, and neither does the name
+    // reference depend on it, so the bytes can be reused as is
+    VLOG(10) << "caching literal with name index=" << index;
+    encodeCachedLiteral(header, index);
+    return;
+  }
   if (index) {
     VLOG(10) << "encoding name index=" << index;
     bytesInPacket_ += buffer_.encodeInteger(index, prefix, len);
@@ -105,7 +194,7 @@ void HPACKEncoder::encodeAsLiteral(const HPACKHeader& header, bool indexing) {
     bytesInPacket_ += buffer_.encodeLiteral(header.name.get());
   }
   // value
-  bytesInPacket_ += buffer_.encodeLiteral(header.value);
+  bytesInPacket_ += encodeValue(buffer_, header.value.get());
   // indexed ones need to get added to the header table
   if (indexing) {
     bool eviction;
@@ -123,6 +212,22 @@ void HPACKEncoder::encodeHeader(const HPACKHeader& header) {
   if (sEnableAutoFlush_ && bytesInPacket_ > kAutoFlushThreshold) {
     packetFlushed();
   }
+  if (literalCache_ && header.value.size() <= kMaxCachedValueLength &&
+      !shouldIndex(header)) {
+    uint32_t staticIndex =
+      StaticHeaderTable::lookupNameIndex(header.name.get());
+    if (staticIndex) {
+      cacheKey_.assign(1, (char)staticIndex);
+      cacheKey_.append(header.value.get());
+      const string* encoded = literalCache_->get(cacheKey_);
+      if (encoded) {
+        cacheHits_++;
+        bytesInPacket_ += buffer_.appendEncoded(*encoded);
+        return;
+      }
+      cacheMisses_++;
+    }
+  }
   uint32_t index = getIndex(header, commitEpoch_, packetEpoch_);
   bool indexable = true;
   if (index == std::numeric_limits<uint32_t>::max()) {
@@ -14,6 +14,7 @@
 #include <proxygen/lib/http/codec/compress/HPACKConstants.h>
 #include <proxygen/lib/http/codec/compress/HPACKContext.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncodeBuffer.h>
+#include <proxygen/lib/http/codec/compress/HPACKEncodeCache.h>
 #include <proxygen/lib/http/codec/compress/HeaderIndexingStrategy.h>
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
 #include <vector>
@@ -45,10 +46,23 @@ class HPACKEncoder : public HPACKContext {
     bool* eviction = nullptr);
 
   void setHeaderTableSize(uint32_t size) {
+    // the decoder must see the smallest size since the last update, to
+    // evict what the encoder evicted
+    if (!pendingContextUpdate_ || size < pendingMinTableSize_) {
+      pendingMinTableSize_ = size;
+    }
     table_.setCapacity(size);
     pendingContextUpdate_ = true;
+    clearLiteralCache();
   }
 
+  /**
+   * Empty the table and free its memory and the encode caches. The table
+   * stays at size 0 until setHeaderTableSize(), and the next header block
+   * has the decoder empty its table too.
+   */
+  void resetTable();
+
   uint32_t getTableSize() const {
     return table_.capacity();
   }
@@ -75,6 +89,7 @@ class HPACKEncoder : public HPACKContext {
 
   void setHeaderIndexingStrategy(const HeaderIndexingStrategy* indexingStrat) {
     indexingStrat_ = indexingStrat;
+    clearLiteralCache();
   }
   const HeaderIndexingStrategy* getHeaderIndexingStrategy() const {
     return indexingStrat_;
@@ -84,6 +99,32 @@ class HPACKEncoder : public HPACKContext {
     sEnableAutoFlush_ = true;
   }
 
+  /**
+   * Cache the encoded bytes of the literals that don't depend on the dynamic
+   * table (never indexed headers with a static name), and of huffman encoded
+   * values, keeping up to maxEntries of each in LRU order. The literal cache
+   * is dropped whenever the indexing decisions could change. 0 disables both.
+   */
+  void setEncodeCacheSize(uint32_t maxEntries);
+
+  /**
+   * @return encode cache hits and misses during the last encode()
+   */
+  uint32_t getEncodeCacheHits() const {
+    return cacheHits_;
+  }
+  uint32_t getEncodeCacheMisses() const {
+    return cacheMisses_;
+  }
+  bool hasEncodeCache() const {
+    return literalCache_ || valueCache_;
+  }
+
+  void seedHeaderTable(std::vector<HPACKHeader>& headers) {
+    HPACKContext::seedHeaderTable(headers);
+    clearLiteralCache();
+  }
+
  protected:
   void encodeAsIndex(uint32_t index);
 
@@ -92,6 +133,30 @@ class HPACKEncoder : public HPACKContext {
 
   virtual void encodeAsLiteral(const HPACKHeader& header, bool indexable);
 
+  bool shouldIndex(const HPACKHeader& header) const;
+
+  /**
+   * encodes a literal with an indexed name through the literal cache
+   */
+  void encodeCachedLiteral(const HPACKHeader& header, uint32_t index);
+
+  /**
+   * encodes a header value through the value cache, if enabled
+   */
+  uint32_t encodeValue(HPACKEncodeBuffer& buffer,
+                       const folly::fbstring& value);
+
+  /**
+   * @return what was encoded into cacheBuffer_, leaving it empty
+   */
+  std::string releaseCacheBuffer();
+
+  void clearLiteralCache() {
+    if (literalCache_) {
+      literalCache_->clear();
+    }
+  }
+
   bool huffman_;
 
   const HeaderIndexingStrategy* indexingStrat_;
@@ -102,10 +167,18 @@ class HPACKEncoder : public HPACKContext {
   int32_t commitEpoch_{-1};
   uint16_t bytesInPacket_{0};
   bool pendingContextUpdate_{false};
+  uint32_t pendingMinTableSize_{0};
   bool eviction_{false};
   bool emitSequenceNumbers_{false};
   bool autoCommit_{true};
 
+  std::unique_ptr<HPACKEncodeCache> literalCache_;
+  std::unique_ptr<HPACKEncodeCache> valueCache_;
+  HPACKEncodeBuffer cacheBuffer_;
+  folly::fbstring cacheKey_;
+  uint32_t cacheHits_{0};
+  uint32_t cacheMisses_{0};
+
   static bool sEnableAutoFlush_;
 };
 
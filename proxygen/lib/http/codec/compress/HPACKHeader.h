@@ -13,7 +13,7 @@
 #include <ostream>
 #include <string>
 #include <proxygen/lib/http/codec/compress/HPACKHeaderName.h>
-#include <folly/FBString.h>
+#include <proxygen/lib/http/codec/compress/HPACKHeaderValue.h>
 
 namespace proxygen {
 
@@ -25,7 +25,7 @@ class HPACKHeader {
 
   HPACKHeader(folly::StringPiece name_,
               folly::StringPiece value_):
-      name(name_), value(value_.data(), value_.size()) {}
+      name(name_), value(value_) {}
 
   HPACKHeader(HPACKHeader&& goner) noexcept
       : name(std::move(goner.name)),
@@ -75,7 +75,7 @@ class HPACKHeader {
   }
 
   HPACKHeaderName name;
-  folly::fbstring value;
+  HPACKHeaderValue value;
 };
 
 std::ostream& operator<<(std::ostream& os, const HPACKHeader& h);
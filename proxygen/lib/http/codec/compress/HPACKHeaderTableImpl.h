@@ -25,12 +25,13 @@ class HPACKHeaderTableImpl : public TableImpl {
     }
   }
   void resize(size_t sz) override { vec_.resize(sz); }
+  void release() override { std::vector<HPACKHeader>().swap(vec_); }
   void moveItems(size_t oldTail, size_t oldLength, size_t newLength) override {
     std::move_backward(vec_.begin() + oldTail, vec_.begin() + oldLength,
                        vec_.begin() + newLength);
   }
   void add(size_t head, const HPACKHeaderName& name,
-           const folly::fbstring& value, int32_t /*epoch*/) override {
+           const HPACKHeaderValue& value, int32_t /*epoch*/) override {
     vec_[head].name = name;
     vec_[head].value = value;
   }
@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/FBString.h>
+#include <folly/Range.h>
+#include <iostream>
+#include <proxygen/lib/http/codec/compress/HPACKInternPool.h>
+
+namespace proxygen {
+
+/*
+ * HPACKHeaderValue stores the value of HPACKHeaders. It owns its string,
+ * unless it was interned in an HPACKInternPool: it then references the
+ * pooled string, shared with the other values interned there.
+ */
+class HPACKHeaderValue {
+ public:
+  HPACKHeaderValue() {}
+
+  explicit HPACKHeaderValue(folly::StringPiece value)
+      : value_(value.data(), value.size()) {}
+
+  HPACKHeaderValue(HPACKInternPool& pool, folly::StringPiece value)
+      : interned_(pool.intern(value)) {}
+
+  HPACKHeaderValue(const HPACKHeaderValue& other)
+      : value_(other.value_),
+        interned_(other.interned_) {
+    if (interned_) {
+      HPACKInternPool::acquire(interned_);
+    }
+  }
+  HPACKHeaderValue(HPACKHeaderValue&& goner) noexcept
+      : value_(std::move(goner.value_)),
+        interned_(goner.interned_) {
+    goner.interned_ = nullptr;
+  }
+  HPACKHeaderValue& operator=(const HPACKHeaderValue& other) {
+    if (this != &other) {
+      reset();
+      value_ = other.value_;
+      interned_ = other.interned_;
+      if (interned_) {
+        HPACKInternPool::acquire(interned_);
+      }
+    }
+    return *this;
+  }
+  HPACKHeaderValue& operator=(HPACKHeaderValue&& goner) noexcept {
+    if (this != &goner) {
+      reset();
+      value_ = std::move(goner.value_);
+      interned_ = goner.interned_;
+      goner.interned_ = nullptr;
+    }
+    return *this;
+  }
+  HPACKHeaderValue& operator=(folly::StringPiece value) {
+    reset();
+    value_.assign(value.data(), value.size());
+    return *this;
+  }
+  HPACKHeaderValue& operator=(folly::fbstring&& value) {
+    reset();
+    value_ = std::move(value);
+    return *this;
+  }
+
+  ~HPACKHeaderValue() {
+    reset();
+  }
+
+  /*
+   * Interned values of the same pool are equal only if they are the same
+   * entry, the others compare the strings
+   */
+  bool operator==(const HPACKHeaderValue& other) const {
+    if (interned_ && other.interned_ &&
+        interned_->getPool() == other.interned_->getPool()) {
+      return interned_ == other.interned_;
+    }
+    return get() == other.get();
+  }
+  bool operator!=(const HPACKHeaderValue& other) const {
+    return !(*this == other);
+  }
+  bool operator<(const HPACKHeaderValue& other) const {
+    return get() < other.get();
+  }
+  bool operator>(const HPACKHeaderValue& other) const {
+    return get() > other.get();
+  }
+
+  /*
+   * Return the folly::fbstring stored or referenced by HPACKHeaderValue
+   */
+  const folly::fbstring& get() const {
+    return interned_ ? interned_->get() : value_;
+  }
+
+  bool isInterned() const {
+    return interned_ != nullptr;
+  }
+
+  /*
+   * Directly call folly::fbstring member functions
+   */
+  uint32_t size() const {
+    return (uint32_t)(get().size());
+  }
+  bool empty() const {
+    return get().empty();
+  }
+  const char* data() const {
+    return get().data();
+  }
+  const char* c_str() const {
+    return get().c_str();
+  }
+
+ private:
+  void reset() {
+    if (interned_) {
+      HPACKInternPool::release(interned_);
+      interned_ = nullptr;
+    }
+    value_.clear();
+  }
+
+  // empty while interned_ is set
+  folly::fbstring value_;
+  const HPACKInternPool::Entry* interned_{nullptr};
+};
+
+inline std::ostream& operator<<(std::ostream& os,
+                                const HPACKHeaderValue& value) {
+  os << value.get();
+  return os;
+}
+
+} // proxygen
@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/compress/HPACKInternPool.h>
+
+#include <folly/SingletonThreadLocal.h>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+const size_t HPACKInternPool::kMinLength;
+
+namespace { struct InternPoolTag {}; }
+static folly::SingletonThreadLocal<HPACKInternPool, InternPoolTag>
+  s_internPool{};
+
+HPACKInternPool& HPACKInternPool::get() {
+  return s_internPool.get();
+}
+
+HPACKInternPool::~HPACKInternPool() {
+  // the values still referenced outlive the pool, and are freed with their
+  // last reference
+  for (auto& it: entries_) {
+    const_cast<Entry*>(it.second)->pool_ = nullptr;
+  }
+}
+
+const HPACKInternPool::Entry* HPACKInternPool::intern(
+    folly::StringPiece value) {
+  auto it = entries_.find(value);
+  if (it != entries_.end()) {
+    stats_.hits++;
+    acquire(it->second);
+    return it->second;
+  }
+  stats_.misses++;
+  auto entry = new Entry(this, value);
+  entries_.emplace(folly::StringPiece(entry->get()), entry);
+  bytes_ += value.size();
+  return entry;
+}
+
+void HPACKInternPool::release(const Entry* entry) {
+  DCHECK_GT(entry->refs_, 0);
+  if (--entry->refs_ > 0) {
+    return;
+  }
+  if (entry->pool_) {
+    entry->pool_->erase(entry);
+  }
+  delete entry;
+}
+
+void HPACKInternPool::erase(const Entry* entry) {
+  auto erased = entries_.erase(folly::StringPiece(entry->get()));
+  DCHECK_EQ(erased, 1);
+  bytes_ -= entry->get().size();
+}
+
+}
@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/FBString.h>
+#include <folly/Range.h>
+#include <folly/hash/SpookyHashV2.h>
+
+#include <unordered_map>
+
+namespace proxygen {
+
+/**
+ * Refcounted immutable header values, shared by the header tables of a
+ * thread.
+ *
+ * Every connection's dynamic tables hold the same popular values: user
+ * agents, accept strings, common cookies. A table using the pool references
+ * the pooled copy of a value instead of owning one, so the memory taken by
+ * values grows with the number of distinct values rather than with the
+ * number of connections. A value leaves the pool with its last reference.
+ *
+ * Not thread safe: a pool and its entries must only be used from one thread,
+ * which the per-thread pool returned by get() is.
+ */
+class HPACKInternPool {
+ public:
+  // Shorter values fit in an fbstring without allocating, there is nothing
+  // to share
+  static const size_t kMinLength = 24;
+
+  class Entry {
+   public:
+    const folly::fbstring& get() const {
+      return value_;
+    }
+
+    const HPACKInternPool* getPool() const {
+      return pool_;
+    }
+
+   private:
+    friend class HPACKInternPool;
+
+    Entry(HPACKInternPool* pool, folly::StringPiece value)
+        : pool_(pool), value_(value.data(), value.size()) {}
+
+    // nullptr once the pool is gone before the entry
+    HPACKInternPool* pool_;
+    const folly::fbstring value_;
+    mutable uint32_t refs_{1};
+  };
+
+  struct Stats {
+    // Values found in the pool, and those added to it
+    uint64_t hits{0};
+    uint64_t misses{0};
+  };
+
+  /**
+   * The pool of the calling thread.
+   */
+  static HPACKInternPool& get();
+
+  HPACKInternPool() = default;
+  HPACKInternPool(const HPACKInternPool&) = delete;
+  HPACKInternPool& operator=(const HPACKInternPool&) = delete;
+  ~HPACKInternPool();
+
+  /**
+   * The entry holding value, with a new reference to it.
+   */
+  const Entry* intern(folly::StringPiece value);
+
+  static void acquire(const Entry* entry) {
+    entry->refs_++;
+  }
+
+  /**
+   * Drop a reference to entry, which is freed with the last one.
+   */
+  static void release(const Entry* entry);
+
+  // Distinct values, and their bytes
+  size_t size() const {
+    return entries_.size();
+  }
+
+  uint64_t getBytes() const {
+    return bytes_;
+  }
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  struct Hash {
+    size_t operator()(folly::StringPiece value) const {
+      return folly::hash::SpookyHashV2::Hash64(value.data(), value.size(), 0);
+    }
+  };
+
+  void erase(const Entry* entry);
+
+  // keyed by the entries' own values
+  std::unordered_map<folly::StringPiece, const Entry*, Hash> entries_;
+  uint64_t bytes_{0};
+  Stats stats_;
+};
+
+}
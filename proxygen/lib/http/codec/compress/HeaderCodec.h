@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <folly/FBString.h>
+#include <folly/Range.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/codec/compress/Header.h>
 #include <proxygen/lib/http/codec/compress/HeaderPiece.h>
@@ -73,6 +74,12 @@ class HeaderCodec {
     virtual void recordDecode(Type type, HTTPHeaderSize& size) = 0;
     virtual void recordDecodeError(Type type) = 0;
     virtual void recordDecodeTooLarge(Type type) = 0;
+    /**
+     * hits and misses of the encoder's cache of encoded literals during one
+     * encode, only reported when the cache is enabled
+     */
+    virtual void recordEncodeCache(Type /*type*/, uint32_t /*hits*/,
+                                   uint32_t /*misses*/) {}
   };
 
   class StreamingCallback {
@@ -81,6 +88,17 @@ class HeaderCodec {
 
     virtual void onHeader(const folly::fbstring& name,
                           const folly::fbstring& value) = 0;
+    /**
+     * Zero copy variant of onHeader, value points into valueBuf and stays
+     * valid only as long as valueBuf is referenced. Callbacks that don't
+     * keep views get a copy.
+     */
+    virtual void onHeaderView(folly::StringPiece name,
+                              folly::StringPiece value,
+                              const folly::IOBuf& /*valueBuf*/) {
+      onHeader(folly::fbstring(name.data(), name.size()),
+               folly::fbstring(value.data(), value.size()));
+    }
     virtual void onHeadersComplete(HTTPHeaderSize decodedSize) = 0;
     virtual void onDecodeError(HeaderDecodeError decodeError) = 0;
   };
@@ -22,10 +22,10 @@ bool HeaderIndexingStrategy::indexHeader(const HPACKHeader& header) const {
   switch(header.name.getHeaderCode()) {
     case HTTP_HEADER_OTHER:
       if (header.name.get() == ":path") {
-        if (header.value.find('=') != std::string::npos) {
+        if (header.value.get().find('=') != std::string::npos) {
           return false;
         }
-        if (header.value.find("jpg") != std::string::npos) {
+        if (header.value.get().find("jpg") != std::string::npos) {
           return false;
         }
       }
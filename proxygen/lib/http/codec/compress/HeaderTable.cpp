@@ -9,9 +9,11 @@
  */
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
 
+#include <algorithm>
+#include <folly/hash/SpookyHashV2.h>
 #include <glog/logging.h>
 
-using std::list;
+using folly::hash::SpookyHashV2;
 using std::pair;
 using std::string;
 
@@ -24,7 +26,19 @@ void HeaderTable::init(uint32_t capacityVal) {
   capacity_ = capacityVal;
   uint32_t initLength = getMaxTableLength(capacity_) / 2;
   table_->init(initLength);
-  names_.clear();
+  hashes_.assign(initLength, EntryHashes());
+  names_.init(initLength);
+  headers_.init(initLength);
+}
+
+uint32_t HeaderTable::hashName(const HPACKHeaderName& name) {
+  const auto& str = name.get();
+  return SpookyHashV2::Hash32(str.data(), str.size(), 0);
+}
+
+uint32_t HeaderTable::hashHeader(uint32_t nameHash,
+                                 const folly::fbstring& value) {
+  return SpookyHashV2::Hash32(value.data(), value.size(), nameHash);
 }
 
 bool HeaderTable::add(const HPACKHeader& header) {
@@ -51,8 +65,11 @@ bool HeaderTable::add(const HPACKHeader& header, int32_t epoch,
   }
 
   if (size_ == length()) {
-    increaseTableLengthTo(std::min( (uint32_t)(size_ * 1.5),
-                                    getMaxTableLength(capacity_)));
+    // grow by at least one slot, 1.5 * size_ truncates to size_ for tiny
+    // tables. The evictions above ensure the max length has room for it.
+    increaseTableLengthTo(std::min(std::max(size_ + 1,
+                                            (uint32_t)(size_ * 1.5)),
+                                   getMaxTableLength(capacity_)));
   }
   uint32_t localHead = head_;
   head_ = next(head_);
@@ -61,9 +78,26 @@ bool HeaderTable::add(const HPACKHeader& header, int32_t epoch,
   } else {
     localHead = head_;
   }
-  table_->add(localHead, header.name, header.value, epoch);
-  // index name
-  names_[header.name].push_back(localHead);
+  unindex(localHead);
+  if (internPool_ && !header.value.isInterned() &&
+      header.value.size() >= HPACKInternPool::kMinLength) {
+    table_->add(localHead, header.name,
+                HPACKHeaderValue(*internPool_, header.value.get()), epoch);
+  } else {
+    table_->add(localHead, header.name, header.value, epoch);
+  }
+  // index name and name/value
+  auto& hashes = hashes_[localHead];
+  hashes.indexed = true;
+  hashes.name = hashName(header.name);
+  hashes.header = hashHeader(hashes.name, header.value.get());
+  names_.insert(hashes.name, localHead, [&] (uint32_t i) {
+    return (*table_)[i].name == header.name;
+  });
+  headers_.insert(hashes.header, localHead, [&] (uint32_t i) {
+    const auto& entry = (*table_)[i];
+    return entry.value == header.value && entry.name == header.name;
+  });
   bytes_ += header.bytes();
   ++size_;
   return true;
@@ -72,36 +106,53 @@ bool HeaderTable::add(const HPACKHeader& header, int32_t epoch,
 uint32_t HeaderTable::getIndex(const HPACKHeader& header,
                                int32_t commitEpoch,
                                int32_t curEpoch) const {
-  auto it = names_.find(header.name);
-  if (it == names_.end()) {
+  uint32_t i = headers_.find(
+    hashHeader(hashName(header.name), header.value.get()),
+    [&] (uint32_t pos) {
+      const auto& entry = (*table_)[pos];
+      return entry.value == header.value && entry.name == header.name;
+    });
+  if (i == HeaderTableIndex::kNone) {
     return 0;
   }
-  bool encoderHasEntry = false;
-  for (auto i : it->second) {
-    if ((*table_)[i].value == header.value) {
-      encoderHasEntry = true;
-      if (table_->isValidEpoch(i, commitEpoch, curEpoch)) {
-        return toExternal(i);
-      }
+  // the matches are chained newest to oldest, pick the oldest valid one
+  uint32_t index = HeaderTableIndex::kNone;
+  for (; i != HeaderTableIndex::kNone; i = headers_.older(i)) {
+    if (table_->isValidEpoch(i, commitEpoch, curEpoch)) {
+      index = i;
     }
   }
-  return encoderHasEntry ? std::numeric_limits<uint32_t>::max() : 0;
+  if (index == HeaderTableIndex::kNone) {
+    // the encoder has the entry, but can't reference it yet
+    return std::numeric_limits<uint32_t>::max();
+  }
+  return toExternal(index);
+}
+
+uint32_t HeaderTable::findName(const HPACKHeaderName& headerName) const {
+  return names_.find(hashName(headerName), [&] (uint32_t pos) {
+    return (*table_)[pos].name == headerName;
+  });
 }
 
-bool HeaderTable::hasName(const HPACKHeaderName& headerName) {
-  return names_.find(headerName) != names_.end();
+bool HeaderTable::hasName(const HPACKHeaderName& headerName) const {
+  return findName(headerName) != HeaderTableIndex::kNone;
+}
+
+uint32_t HeaderTable::countName(const HPACKHeaderName& headerName) const {
+  uint32_t count = 0;
+  for (uint32_t i = findName(headerName); i != HeaderTableIndex::kNone;
+       i = names_.older(i)) {
+    ++count;
+  }
+  return count;
 }
 
 uint32_t HeaderTable::nameIndex(const HPACKHeaderName& headerName,
                                 int32_t commitEpoch,
                                 int32_t curEpoch) const {
-  auto it = names_.find(headerName);
-  if (it == names_.end()) {
-    return 0;
-  }
-  for (auto indexIt = it->second.rbegin(); indexIt != it->second.rend();
-       ++indexIt) {
-    auto i = *indexIt;
+  for (uint32_t i = findName(headerName); i != HeaderTableIndex::kNone;
+       i = names_.older(i)) {
     if (table_->isValidEpoch(i, commitEpoch, curEpoch)) {
       return toExternal(i);
     }
@@ -121,35 +172,49 @@ uint32_t HeaderTable::getMaxTableLength(uint32_t capacityVal) {
   return (capacityVal >> 5);
 }
 
+void HeaderTable::unindex(uint32_t i) {
+  auto& hashes = hashes_[i];
+  if (hashes.indexed) {
+    names_.erase(hashes.name, i);
+    headers_.erase(hashes.header, i);
+    hashes.indexed = false;
+  }
+}
+
 void HeaderTable::removeLast() {
   auto t = tail();
-  // remove the first element from the names index
-  auto names_it = names_.find((*table_)[t].name);
-  DCHECK(names_it != names_.end());
-  auto &ilist = names_it->second;
-  if (writeBaseIndex_ < 0) {
-    DCHECK_EQ(ilist.front(), t);
-  } // otherwise, we may have written out of order.
-
-  for (auto indexIt = ilist.begin(); indexIt != ilist.end(); ++indexIt) {
-    if (*indexIt == t) {
-      ilist.erase(indexIt);
-      break;
-    }
-  }
-  // remove the name if there are no indices associated with it
-  if (ilist.empty()) {
-    names_.erase(names_it);
-  }
+  // remove the first element from the indices
+  unindex(t);
   const auto& header = (*table_)[t];
   bytes_ -= header.bytes();
   VLOG(10) << "Removing local idx=" << t << " name=" << header.name <<
     " value=" << header.value;
+  if (writeBaseIndex_ < 0) {
+    releaseValue(t);
+  }
   --size_;
 }
 
+void HeaderTable::releaseValue(uint32_t i) {
+  // the slot keeps its value until reused, but a pooled one should leave the
+  // pool with the entry
+  auto& header = (*table_)[i];
+  if (header.value.isInterned()) {
+    header.value = HPACKHeaderValue();
+  }
+}
+
 void HeaderTable::reset() {
   names_.clear();
+  headers_.clear();
+  for (auto& hashes : hashes_) {
+    hashes.indexed = false;
+  }
+  if (writeBaseIndex_ < 0) {
+    for (uint32_t i = 0; i < table_->size(); i++) {
+      releaseValue(i);
+    }
+  }
 
   bytes_ = 0;
   size_ = 0;
@@ -175,30 +240,40 @@ void HeaderTable::setCapacity(uint32_t newCapacity) {
   capacity_ = newCapacity;
 }
 
+void HeaderTable::compact() {
+  if (size_ > 0 || writeBaseIndex_ >= 0) {
+    return;
+  }
+  table_->release();
+  std::vector<EntryHashes>().swap(hashes_);
+  names_.init(0);
+  headers_.init(0);
+  head_ = 0;
+}
+
 void HeaderTable::increaseTableLengthTo(uint32_t newLength) {
   DCHECK_GE(newLength, length());
-  auto oldTail = tail();
+  // the table may have no slots at all yet
+  auto oldTail = size_ > 0 ? tail() : 0;
   auto oldLength = table_->size();
   table_->resize(newLength);
+  hashes_.resize(newLength);
   // TODO: referenence to head here is incompatible with baseIndex
-  if (size_ > 0 && oldTail > head_) {
+  bool moved = size_ > 0 && oldTail > head_;
+  if (moved) {
     // the list wrapped around, need to move oldTail..oldLength to the end
     // of the now-larger table_
     table_->moveItems(oldTail, oldLength, newLength);
-    // Update the names indecies that pointed to the old range
-    for (auto& names_it: names_) {
-      for (auto& idx: names_it.second) {
-        if (idx >= oldTail) {
-          DCHECK_LT(idx + (table_->size() - oldLength), table_->size());
-          idx += (table_->size() - oldLength);
-        } else {
-          // remaining indecies in the list were smaller than oldTail, so
-          // should be indexed from 0
-          break;
-        }
-      }
-    }
+    std::move_backward(hashes_.begin() + oldTail, hashes_.begin() + oldLength,
+                       hashes_.begin() + newLength);
+    std::fill(hashes_.begin() + oldTail,
+              hashes_.begin() + std::min(oldTail + newLength - oldLength,
+                                         oldLength),
+              EntryHashes());
   }
+  // Update the indices that pointed to the old range
+  names_.grow(oldTail, oldLength, newLength, moved);
+  headers_.grow(oldTail, oldLength, newLength, moved);
 }
 
 uint32_t HeaderTable::evict(uint32_t needed, uint32_t desiredCapacity) {
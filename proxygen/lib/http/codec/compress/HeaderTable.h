@@ -9,11 +9,9 @@
  */
 #pragma once
 
-#include <list>
 #include <proxygen/lib/http/codec/compress/HPACKHeader.h>
+#include <proxygen/lib/http/codec/compress/HeaderTableIndex.h>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 namespace proxygen {
@@ -25,10 +23,11 @@ class TableImpl {
   virtual size_t size() const = 0;
   virtual HPACKHeader& operator[] (size_t i) = 0;
   virtual void resize(size_t size) = 0;
+  virtual void release() = 0;
   virtual void moveItems(size_t oldTail, size_t oldLength,
                          size_t newLength) = 0;
   virtual void add(size_t head, const HPACKHeaderName& name,
-                   const folly::fbstring& value, int32_t epoch) = 0;
+                   const HPACKHeaderValue& value, int32_t epoch) = 0;
   virtual bool isValidEpoch(uint32_t i, int32_t commitEpoch,
                             int32_t curEpoch) = 0;
 };
@@ -36,12 +35,17 @@ class TableImpl {
 /**
  * Data structure for maintaining indexed headers, based on a fixed-length ring
  * with FIFO semantics. Externally it acts as an array.
+ *
+ * Lookups by name and by name and value go through two open addressing
+ * indices over the ring positions, keyed by the name hash and by the combined
+ * name/value hash, see HeaderTableIndex.
+ *
+ * With an intern pool, entries reference their values in the pool instead of
+ * holding a copy, see HPACKInternPool.
  */
 
 class HeaderTable {
  public:
-  typedef std::unordered_map<HPACKHeaderName, std::list<uint32_t>> names_map;
-
   HeaderTable(std::unique_ptr<TableImpl> table, uint32_t capacityVal)
       : table_(std::move(table)) {
     init(capacityVal);
@@ -68,6 +72,19 @@ class HeaderTable {
     }
   }
 
+  /**
+   * Have the entries added from now on share their values through pool, or
+   * own them again if nullptr. The pool must outlive the entries, and only
+   * be used by the thread it belongs to.
+   */
+  void setInternPool(HPACKInternPool* pool) {
+    internPool_ = pool;
+  }
+
+  HPACKInternPool* getInternPool() const {
+    return internPool_;
+  }
+
   int64_t markBaseIndex() {
     readBaseIndex_ = writeBaseIndex_;
     return writeBaseIndex_;
@@ -109,14 +126,12 @@ class HeaderTable {
   /**
    * @return true if there is at least one header with the given name
    */
-  bool hasName(const HPACKHeaderName& headerName);
+  bool hasName(const HPACKHeaderName& headerName) const;
 
   /**
-   * @return the map holding the indexed names
+   * @return how many entries have the given name
    */
-  const names_map& names() const {
-    return names_;
-  }
+  uint32_t countName(const HPACKHeaderName& headerName) const;
 
   /**
    * Get any index of a header that has the given name. From all the
@@ -145,6 +160,12 @@ class HeaderTable {
    */
   void setCapacity(uint32_t capacity);
 
+  /**
+   * Free the slots of an empty table, they are allocated again as entries
+   * are added. Has no effect on a table with entries or absolute indexing.
+   */
+  void compact();
+
   /**
    * @return number of valid entries
    */
@@ -189,6 +210,17 @@ class HeaderTable {
    */
   void removeLast();
 
+  /**
+   * Removes the entry at the given internal index from the name and
+   * name/value indices, if it's there.
+   */
+  void unindex(uint32_t i);
+
+  /**
+   * Drop the pooled value of the evicted entry at the given internal index.
+   */
+  void releaseValue(uint32_t i);
+
   /**
    * Empties the underlying header table
    */
@@ -219,6 +251,21 @@ class HeaderTable {
    */
   uint32_t toInternal(uint32_t externalIndex) const;
 
+  /**
+   * Newest internal index holding the given name, or HeaderTableIndex::kNone
+   */
+  uint32_t findName(const HPACKHeaderName& headerName) const;
+
+  static uint32_t hashName(const HPACKHeaderName& name);
+  static uint32_t hashHeader(uint32_t nameHash, const folly::fbstring& value);
+
+  struct EntryHashes {
+    uint32_t name{0};
+    uint32_t header{0};
+    // with absolute indexing an entry may be overwritten before it's evicted
+    bool indexed{false};
+  };
+
   uint32_t capacity_{0};
   uint32_t bytes_{0};     // size in bytes of the current entries
   std::unique_ptr<TableImpl> table_;
@@ -226,9 +273,13 @@ class HeaderTable {
   uint32_t size_{0};    // how many entries we have in the table
   uint32_t head_{0};     // points to the first element of the ring
 
-  names_map names_;
+  // hashes of the entry at each position of the ring, used for removals
+  std::vector<EntryHashes> hashes_;
+  HeaderTableIndex names_;
+  HeaderTableIndex headers_;
   int64_t readBaseIndex_{-1};
   int64_t writeBaseIndex_{-1};
+  HPACKInternPool* internPool_{nullptr};
 };
 
 std::ostream& operator<<(std::ostream& os, const HeaderTable& table);
@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/compress/HeaderTableIndex.h>
+
+#include <algorithm>
+#include <folly/Bits.h>
+#include <glog/logging.h>
+
+namespace {
+const uint32_t kMinSlots = 16;
+}
+
+namespace proxygen {
+
+const uint32_t HeaderTableIndex::kNone;
+
+void HeaderTableIndex::init(uint32_t length) {
+  size_ = 0;
+  slots_.clear();
+  rehash(std::max(kMinSlots, (uint32_t)folly::nextPowTwo(length * 2)));
+  links_.assign(length, Link());
+}
+
+void HeaderTableIndex::clear() {
+  if (size_ > 0) {
+    std::fill(slots_.begin(), slots_.end(), Slot());
+    size_ = 0;
+  }
+}
+
+void HeaderTableIndex::grow(uint32_t oldTail, uint32_t oldLength,
+                            uint32_t newLength, bool moved) {
+  DCHECK_GE(newLength, oldLength);
+  links_.resize(newLength);
+  if (!moved) {
+    return;
+  }
+  std::move_backward(links_.begin() + oldTail, links_.begin() + oldLength,
+                     links_.begin() + newLength);
+  uint32_t delta = newLength - oldLength;
+  auto shift = [oldTail, delta] (uint32_t pos) {
+    return (pos != kNone && pos >= oldTail) ? pos + delta : pos;
+  };
+  for (auto& slot : slots_) {
+    slot.pos = shift(slot.pos);
+  }
+  for (auto& link : links_) {
+    link.newer = shift(link.newer);
+    link.older = shift(link.older);
+  }
+}
+
+void HeaderTableIndex::rehash(uint32_t numSlots) {
+  DCHECK_EQ(numSlots & (numSlots - 1), 0);
+  std::vector<Slot> old(numSlots);
+  old.swap(slots_);
+  mask_ = numSlots - 1;
+  for (const auto& slot : old) {
+    if (slot.pos != kNone) {
+      uint32_t i = slot.hash & mask_;
+      while (slots_[i].pos != kNone) {
+        i = (i + 1) & mask_;
+      }
+      slots_[i] = slot;
+    }
+  }
+}
+
+void HeaderTableIndex::insertSlot(uint32_t hash, uint32_t pos) {
+  // keep the load factor at or below 1/2, so probe sequences stay short
+  if ((size_ + 1) * 2 > slots_.size()) {
+    rehash(std::max(kMinSlots, (uint32_t)slots_.size() * 2));
+  }
+  uint32_t i = hash & mask_;
+  while (slots_[i].pos != kNone) {
+    i = (i + 1) & mask_;
+  }
+  slots_[i].hash = hash;
+  slots_[i].pos = pos;
+  ++size_;
+}
+
+void HeaderTableIndex::erase(uint32_t hash, uint32_t pos) {
+  Link link = links_[pos];
+  links_[pos] = Link();
+  if (link.older != kNone) {
+    links_[link.older].newer = link.newer;
+  }
+  if (link.newer != kNone) {
+    // not the newest entry for the key, the slot doesn't change
+    links_[link.newer].older = link.older;
+    return;
+  }
+  uint32_t i = findSlot(hash, [pos] (uint32_t p) { return p == pos; });
+  DCHECK_NE(i, kNone);
+  if (i == kNone) {
+    return;
+  }
+  if (link.older != kNone) {
+    slots_[i].pos = link.older;
+  } else {
+    eraseSlot(i);
+  }
+}
+
+void HeaderTableIndex::eraseSlot(uint32_t i) {
+  // shift back the following entries of the cluster that would not be
+  // reachable anymore through their ideal slot
+  uint32_t j = i;
+  while (true) {
+    j = (j + 1) & mask_;
+    if (slots_[j].pos == kNone) {
+      break;
+    }
+    uint32_t ideal = slots_[j].hash & mask_;
+    bool reachable = (i <= j) ? (i < ideal && ideal <= j) :
+                                (i < ideal || ideal <= j);
+    if (!reachable) {
+      slots_[i] = slots_[j];
+      i = j;
+    }
+  }
+  slots_[i] = Slot();
+  --size_;
+}
+
+}
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Open addressing index over the positions of the header table ring.
+ *
+ * Each key (a header name, or a name/value pair) has one slot in a flat array
+ * using linear probing, holding its hash and the position of the newest
+ * entry with that key. Older entries with the same key are chained through
+ * per-position links, newest to oldest, so lookups are O(1) and the newest
+ * match comes first. Removals use backward shift deletion, so the constant
+ * FIFO churn of the header table leaves no tombstones behind and doesn't
+ * allocate.
+ *
+ * Keys are compared by the caller, which knows what is stored at each
+ * position, through an equality predicate taking a position.
+ */
+class HeaderTableIndex {
+ public:
+  static const uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * Size the index for a ring of the given length, dropping all the entries.
+   */
+  void init(uint32_t length);
+
+  /**
+   * Remove all the entries, keeping the allocated memory.
+   */
+  void clear();
+
+  /**
+   * Follow the ring growing from oldLength to newLength, where the positions
+   * from oldTail to oldLength were moved to the end.
+   */
+  void grow(uint32_t oldTail, uint32_t oldLength, uint32_t newLength,
+            bool moved);
+
+  /**
+   * @return the newest position whose key has the given hash and satisfies
+   * isKey, or kNone
+   */
+  template <typename Eq>
+  uint32_t find(uint32_t hash, Eq isKey) const {
+    uint32_t i = findSlot(hash, isKey);
+    return i == kNone ? kNone : slots_[i].pos;
+  }
+
+  /**
+   * @return the next older position with the same key, or kNone
+   */
+  uint32_t older(uint32_t pos) const {
+    return links_[pos].older;
+  }
+
+  /**
+   * Index the entry at pos as the newest one for its key, isKey tells if an
+   * existing position holds the same key.
+   */
+  template <typename Eq>
+  void insert(uint32_t hash, uint32_t pos, Eq isKey) {
+    uint32_t i = findSlot(hash, isKey);
+    if (i == kNone) {
+      links_[pos] = Link();
+      insertSlot(hash, pos);
+    } else {
+      links_[pos].older = slots_[i].pos;
+      links_[pos].newer = kNone;
+      links_[slots_[i].pos].newer = pos;
+      slots_[i].pos = pos;
+    }
+  }
+
+  /**
+   * Remove the entry at the given position, indexed under the given hash.
+   */
+  void erase(uint32_t hash, uint32_t pos);
+
+  /**
+   * @return number of distinct keys
+   */
+  uint32_t size() const {
+    return size_;
+  }
+
+ private:
+  struct Slot {
+    uint32_t hash{0};
+    uint32_t pos{kNone};
+  };
+
+  struct Link {
+    uint32_t newer{kNone};
+    uint32_t older{kNone};
+  };
+
+  template <typename Eq>
+  uint32_t findSlot(uint32_t hash, Eq isKey) const {
+    if (size_ == 0) {
+      return kNone;
+    }
+    for (uint32_t i = hash & mask_; slots_[i].pos != kNone;
+         i = (i + 1) & mask_) {
+      if (slots_[i].hash == hash && isKey(slots_[i].pos)) {
+        return i;
+      }
+    }
+    return kNone;
+  }
+
+  void insertSlot(uint32_t hash, uint32_t pos);
+  void eraseSlot(uint32_t i);
+  void rehash(uint32_t numSlots);
+
+  std::vector<Slot> slots_;
+  std::vector<Link> links_;
+  uint32_t mask_{0};
+  uint32_t size_{0};
+};
+
+}
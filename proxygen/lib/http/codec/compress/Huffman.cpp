@@ -9,8 +9,9 @@
  */
 #include <proxygen/lib/http/codec/compress/Huffman.h>
 
+#include <folly/Bits.h>
 #include <folly/Indestructible.h>
-#include <folly/portability/Sockets.h>
+#include <memory>
 
 using folly::IOBuf;
 using std::pair;
@@ -29,8 +30,15 @@ HuffTree::HuffTree(const HuffTree& tree) :
 }
 
 bool HuffTree::decode(const uint8_t* buf, uint32_t size,
-                      folly::fbstring& literal)
-    const {
+                      folly::fbstring& literal, DecodeMode mode) const {
+  if (mode == DecodeMode::MULTI_SYMBOL) {
+    return decodeMultiSymbol(buf, size, literal);
+  }
+  return decodeTree(buf, size, literal);
+}
+
+bool HuffTree::decodeTree(const uint8_t* buf, uint32_t size,
+                          folly::fbstring& literal) const {
   const SuperHuffNode* snode = &table_[0];
   uint32_t w = 0;
   uint32_t wbits = 0;
@@ -71,6 +79,98 @@ bool HuffTree::decode(const uint8_t* buf, uint32_t size,
   return true;
 }
 
+bool HuffTree::decodeMultiSymbol(const uint8_t* buf, uint32_t size,
+                                 folly::fbstring& literal) const {
+  // the shortest code has 5 bits, so this is an upper bound for the output,
+  // plus one character because the fast path always stores two. Characters
+  // are written through a raw pointer and the literal is trimmed to the
+  // decoded size on the way out.
+  size_t start = literal.size();
+  literal.resize(start + (size_t(size) * 8) / 5 + 1);
+  char* out = &literal[start];
+  auto finish = [&literal, &out] (bool ok) {
+    literal.resize(out - literal.data());
+    return ok;
+  };
+  // bits are kept aligned to the MSB of the accumulator
+  uint64_t acc = 0;
+  uint32_t nbits = 0;
+  uint32_t i = 0;
+  while (true) {
+    if (i + 8 <= size) {
+      // refill with a whole word, bits past the consumed bytes are loaded
+      // again at the same position by the next refill
+      acc |= folly::Endian::big(folly::loadUnaligned<uint64_t>(buf + i)) >>
+        nbits;
+      uint32_t n = (63 - nbits) >> 3;
+      i += n;
+      nbits += n << 3;
+    } else {
+      while (nbits < 56 && i < size) {
+        acc |= uint64_t(buf[i]) << (56 - nbits);
+        nbits += 8;
+        i++;
+      }
+    }
+    uint32_t used;
+    const MultiSymbolEntry& entry = multiTable_[acc >> (64 - kMultiSymbolBits)];
+    if (nbits >= kMultiSymbolBits && entry.bits != 0) {
+      // fast path, all the bits of the key come from the stream
+      bool two = entry.bits2 != 0;
+      out[0] = entry.ch[0];
+      out[1] = entry.ch[1];
+      out += 1 + two;
+      used = two ? entry.bits2 : entry.bits;
+    } else {
+      if (nbits < 8 && i == size) {
+        if (nbits == 0 || (acc >> (64 - nbits)) == (1u << nbits) - 1) {
+          // what is left is padding with the EOS prefix
+          return finish(true);
+        }
+      }
+      // past the end of the stream the lookup key is padded with 1s
+      uint64_t w = acc | (~uint64_t(0) >> nbits);
+      const MultiSymbolEntry& tail =
+        multiTable_[w >> (64 - kMultiSymbolBits)];
+      if (tail.bits2 != 0 && tail.bits2 <= nbits) {
+        *out++ = tail.ch[0];
+        *out++ = tail.ch[1];
+        used = tail.bits2;
+      } else if (tail.bits != 0) {
+        if (tail.bits > nbits) {
+          // truncated stream or padding which is not an EOS prefix
+          return finish(false);
+        }
+        *out++ = tail.ch[0];
+        used = tail.bits;
+      } else {
+        // the code is longer than kMultiSymbolBits, use the super-node tree
+        const SuperHuffNode* snode = &table_[0];
+        used = 0;
+        while (true) {
+          const HuffNode& node = snode->index[(w << used) >> 56];
+          if (node.isLeaf()) {
+            if (node.metadata.bits == 0) {
+              // EOS in the middle of the stream
+              return finish(false);
+            }
+            used += node.metadata.bits;
+            if (used > nbits) {
+              return finish(false);
+            }
+            *out++ = node.data.ch;
+            break;
+          }
+          used += 8;
+          snode = &table_[node.data.superNodeIndex];
+        }
+      }
+    }
+    acc <<= used;
+    nbits -= used;
+  }
+}
+
 /**
  * insert a new character into the tree, identified by an unique code,
  * a number of bits to represent it. The code is aligned at LSB.
@@ -128,55 +228,109 @@ void HuffTree::buildTree() {
   for (uint32_t i = 0; i < kTableSize; i++) {
     insert(codes_[i], bits_[i], i);
   }
+  buildMultiSymbolTable();
+}
+
+/**
+ * finds the character whose code is a prefix of the 'width' bits wide key,
+ * using the super-node tree, which has to be built already
+ */
+bool HuffTree::lookupPrefix(uint32_t key, uint32_t width, uint8_t& ch,
+                            uint8_t& bits) const {
+  if (width == 0) {
+    return false;
+  }
+  // align the key to the MSB of a 32-bit word
+  uint32_t w = key << (32 - width);
+  const SuperHuffNode* snode = &table_[0];
+  uint32_t used = 0;
+  while (true) {
+    const HuffNode& node = snode->index[(w << used) >> 24];
+    if (node.isLeaf()) {
+      if (node.metadata.bits == 0 || used + node.metadata.bits > width) {
+        return false;
+      }
+      ch = node.data.ch;
+      bits = used + node.metadata.bits;
+      return true;
+    }
+    used += 8;
+    if (used >= width) {
+      return false;
+    }
+    snode = &table_[node.data.superNodeIndex];
+  }
+}
+
+/**
+ * for every possible kMultiSymbolBits key store the first character and,
+ * when it fits in the remaining bits, the second one
+ */
+void HuffTree::buildMultiSymbolTable() {
+  for (uint32_t key = 0; key < kMultiSymbolTableSize; key++) {
+    MultiSymbolEntry& entry = multiTable_[key];
+    uint8_t ch;
+    uint8_t bits;
+    if (!lookupPrefix(key, kMultiSymbolBits, ch, bits)) {
+      continue;
+    }
+    entry.ch[0] = ch;
+    entry.bits = bits;
+    uint32_t rest = kMultiSymbolBits - bits;
+    if (lookupPrefix(key & ((1 << rest) - 1), rest, ch, bits)) {
+      entry.ch[1] = ch;
+      entry.bits2 = entry.bits + bits;
+    }
+  }
 }
 
 uint32_t HuffTree::encode(const folly::fbstring& literal,
                           folly::io::QueueAppender& buf) const {
-  uint32_t code;  // the huffman code of a given character
-  uint8_t bits;   // on how many bits code is represented
-  uint32_t w = 0; // 4-byte word used for packing bits and write it to memory
-  uint8_t wbits = 0;  // how many bits we have in 'w'
-  uint32_t totalBytes = 0;
+  // no code is longer than 32 bits
+  uint32_t maxSize = literal.size() * 4;
+  uint32_t size;
+  if (buf.length() >= maxSize + kEncodeSlack) {
+    size = encode(literal, buf.writableData(), maxSize);
+  } else {
+    // not enough room for the whole-word writes in the current buffer,
+    // encode aside and copy what we actually produced
+    std::unique_ptr<uint8_t[]> tmp(new uint8_t[maxSize + kEncodeSlack]);
+    size = encode(literal, tmp.get(), maxSize);
+    buf.push(tmp.get(), size);
+    return size;
+  }
+  buf.append(size);
+  return size;
+}
+
+uint32_t HuffTree::encode(const folly::fbstring& literal, uint8_t* buf,
+                          uint32_t maxSize) const {
+  uint8_t* out = buf;
+  const uint8_t* limit = buf + maxSize;
+  // bits are kept aligned to the MSB of the accumulator, which never holds
+  // more than 7 + 30 bits
+  uint64_t w = 0;
+  uint32_t wbits = 0;
   for (size_t i = 0; i < literal.size(); i++) {
     uint8_t ch = literal[i];
-    code = codes_[ch];
-    bits = bits_[ch];
-
-    if (wbits + bits < 32) {
-      w = (w << bits) | code;
-      wbits += bits;
-    } else {
-      uint8_t xbits = wbits + bits - 32;
-      w = (w << (bits - xbits)) | (code >> xbits);
-      // write the word into the buffer by converting to network order, which
-      // takes care of the endianness problems
-      buf.writeBE<uint32_t>(w);
-      totalBytes += 4;
-      // carry for next batch
-      wbits = xbits;
-      w = code & ((1 << xbits) - 1);
+    wbits += bits_[ch];
+    w |= uint64_t(codes_[ch]) << (64 - wbits);
+    // store the whole word but only advance over the complete bytes
+    folly::storeUnaligned<uint64_t>(out, folly::Endian::big(w));
+    out += wbits >> 3;
+    w <<= wbits & ~7u;
+    wbits &= 7;
+    if (out > limit) {
+      return maxSize + 1;
     }
   }
-  // we might have some padding at the byte level
-  if (wbits & 0x7) {
-    // padding bits
-    uint8_t padbits = 8 - (wbits & 0x7);
-    w = (w << padbits) | ((1 << padbits) - 1);
-
-    wbits += padbits;
-  }
-  // we need to write the leftover bytes, from 1 to 4 bytes
   if (wbits > 0) {
-    uint8_t bytes = wbits >> 3;
-    // align the bits to the MSB
-    w = w << (32 - wbits);
-    // set the bytes in the network order and copy w[0], w[1]...
-    w = htonl(w);
-    // we need to use memcpy because we might write less than 4 bytes
-    buf.push((uint8_t*)&w, bytes);
-    totalBytes += bytes;
+    // pad the last byte with the EOS prefix
+    w |= ~uint64_t(0) >> wbits;
+    folly::storeUnaligned<uint64_t>(out, folly::Endian::big(w));
+    out++;
   }
-  return totalBytes;
+  return out - buf;
 }
 
 uint32_t HuffTree::getEncodeSize(const folly::fbstring& literal) const {
@@ -24,6 +24,37 @@ const uint32_t kTableSize = 256;
 // used only for padding of up to 7 bits
 const uint32_t kEOSHpack = 0x3fffffff;
 
+// number of bits used for indexing the multi-symbol decode table
+const uint32_t kMultiSymbolBits = 12;
+const uint32_t kMultiSymbolTableSize = 1 << kMultiSymbolBits;
+
+// the encoder stores whole 64-bit words, so it may write up to this many
+// bytes past the end of the encoded data
+const uint32_t kEncodeSlack = 8;
+
+/**
+ * Strategy used by HuffTree::decode
+ *
+ * TREE walks the 8-bit super-node tree and emits one character per lookup.
+ * MULTI_SYMBOL uses a 12-bit table that emits up to two characters per lookup
+ * and falls back to the tree for codes longer than 12 bits. It also rejects
+ * invalid padding and EOS in the bit stream, as required by RFC 7541 5.2.
+ *
+ * The default can be switched at build time with
+ * -DPROXYGEN_HUFFMAN_TREE_DECODE and at runtime through the HPACK/QPACK
+ * decoders.
+ */
+enum class DecodeMode : uint8_t {
+  TREE,
+  MULTI_SYMBOL,
+};
+
+#ifdef PROXYGEN_HUFFMAN_TREE_DECODE
+constexpr DecodeMode kDefaultDecodeMode = DecodeMode::TREE;
+#else
+constexpr DecodeMode kDefaultDecodeMode = DecodeMode::MULTI_SYMBOL;
+#endif
+
 /**
  * node from the huffman tree
  *
@@ -51,6 +82,18 @@ struct SuperHuffNode {
   HuffNode index[256];
 };
 
+/**
+ * entry of the multi-symbol decode table, indexed by the next
+ * kMultiSymbolBits bits of the stream
+ */
+struct MultiSymbolEntry {
+  uint8_t ch[2]{0, 0};
+  // code length of ch[0], 0 if the code is longer than kMultiSymbolBits
+  uint8_t bits{0};
+  // code length of ch[0] and ch[1] together, 0 if ch[1] does not fit
+  uint8_t bits2{0};
+};
+
 /**
  * Immutable Huffman tree used in the process of decoding. Traditionally the
  * huffman tree is binary, but using that approach leads to major inefficiencies
@@ -80,6 +123,12 @@ struct SuperHuffNode {
  * 3. we don't have enough bits, so we use paddding and we get a key of
  * 01011111, which points to '(' character, like any other node under the
  * subtree '010'.
+ *
+ * On top of the tree there is a 12-bit multi-symbol table (DecodeMode::
+ * MULTI_SYMBOL), whose entries hold the one or two characters whose codes
+ * fit in the key. Most header strings only use codes of 5 to 8 bits, so the
+ * common case emits two characters per lookup without any branching on the
+ * tree. Keys starting with a longer code continue through the tree.
  */
 class HuffTree {
  public:
@@ -97,11 +146,13 @@ class HuffTree {
    * @param buf start of a huffman-encoded bit stream
    * @param size size of the buffer
    * @param literal where to append decoded characters
+   * @param mode decoding strategy
    *
    * @return true if the decode process was successful
    */
   bool decode(const uint8_t* buf, uint32_t size,
-              folly::fbstring& literal) const;
+              folly::fbstring& literal,
+              DecodeMode mode = kDefaultDecodeMode) const;
 
   /**
    * encode string literal into huffman encoded bit stream
@@ -112,6 +163,19 @@ class HuffTree {
   uint32_t encode(const folly::fbstring& literal,
                   folly::io::QueueAppender& buf) const;
 
+  /**
+   * encode string literal into a contiguous buffer in a single pass, using a
+   * 64-bit accumulator and writing whole words. The encoding stops as soon as
+   * it takes more than maxSize bytes.
+   *
+   * @param literal string to encode
+   * @param buf destination, with room for maxSize + kEncodeSlack bytes
+   * @param maxSize largest encoded size the caller is interested in
+   * @return encoded size, or a value larger than maxSize if it didn't fit
+   */
+  uint32_t encode(const folly::fbstring& literal, uint8_t* buf,
+                  uint32_t maxSize) const;
+
   /**
    * get the encode size for a string literal, works as a dry-run for the encode
    * useful to allocate enough buffer space before doing the actual encode
@@ -142,6 +206,13 @@ class HuffTree {
      uint8_t level);
   void buildTree();
   void insert(uint32_t code, uint8_t bits, uint8_t ch);
+  void buildMultiSymbolTable();
+  bool lookupPrefix(uint32_t key, uint32_t width, uint8_t& ch,
+                    uint8_t& bits) const;
+  bool decodeTree(const uint8_t* buf, uint32_t size,
+                  folly::fbstring& literal) const;
+  bool decodeMultiSymbol(const uint8_t* buf, uint32_t size,
+                         folly::fbstring& literal) const;
 
   uint32_t nodes_{0};
   const uint32_t* codes_;
@@ -150,6 +221,7 @@ class HuffTree {
  protected:
   explicit HuffTree(const HuffTree& tree);
   SuperHuffNode table_[46];
+  MultiSymbolEntry multiTable_[kMultiSymbolTableSize];
 };
 
 const HuffTree& huffTree();
@@ -53,12 +53,13 @@ class QCRAMTableImpl : public TableImpl {
     }
   }
   void resize(size_t size) override { vec_.resize(size); }
+  void release() override { std::vector<QCRAMHeader>().swap(vec_); }
   void moveItems(size_t oldTail, size_t oldLength, size_t newLength) override {
     std::move_backward(vec_.begin() + oldTail, vec_.begin() + oldLength,
                        vec_.begin() + newLength);
   }
   void add(size_t head, const HPACKHeaderName& name,
-           const folly::fbstring& value, int32_t epoch) override {
+           const HPACKHeaderValue& value, int32_t epoch) override {
     vec_[head].name = name;
     vec_[head].value = value;
     vec_[head].epoch = epoch;
@@ -12,7 +12,9 @@
 
 #include <folly/Indestructible.h>
 
+#include <cstring>
 #include <glog/logging.h>
+#include <limits>
 #include <list>
 
 using std::list;
@@ -22,7 +24,7 @@ using std::vector;
 namespace proxygen {
 
 // array of static header table entires pair
-const char* s_tableEntries[][2] = {
+constexpr const char* s_tableEntries[][2] = {
       {":authority", ""},
       {":method", "GET"},
       {":method", "POST"},
@@ -86,10 +88,130 @@ const char* s_tableEntries[][2] = {
       {"www-authenticate", ""}
     };
 
-const int kEntriesSize = sizeof(s_tableEntries) / (2 * sizeof(const char*));
+constexpr int kEntriesSize =
+  sizeof(s_tableEntries) / (2 * sizeof(const char*));
+
+namespace {
+
+// The name hash only mixes the length and three characters of the name; the
+// seed was searched offline so that the 52 distinct static names land in
+// distinct slots, which is checked below at compile time.
+constexpr uint32_t kNameHashSeed = 49;
+constexpr uint32_t kNameHashBits = 8;
+constexpr uint32_t kNameSlots = 1 << kNameHashBits;
+
+constexpr uint32_t hashName(const char* name, uint32_t length) {
+  uint32_t hash = kNameHashSeed ^ length;
+  hash = (hash ^ (uint8_t)name[0]) * 0x9E3779B1;
+  hash = (hash ^ (uint8_t)name[length / 2]) * 0x9E3779B1;
+  hash = (hash ^ (uint8_t)name[length - 1]) * 0x9E3779B1;
+  return hash >> (32 - kNameHashBits);
+}
+
+constexpr uint32_t constLength(const char* str) {
+  uint32_t length = 0;
+  while (str[length]) {
+    ++length;
+  }
+  return length;
+}
+
+constexpr bool constEquals(const char* a, const char* b) {
+  while (*a && *a == *b) {
+    ++a;
+    ++b;
+  }
+  return *a == *b;
+}
+
+struct StaticIndex {
+  // position of the first entry with the name hashed to each slot, plus one,
+  // and the number of entries with that name
+  uint8_t first[kNameSlots]{};
+  uint8_t count[kNameSlots]{};
+  uint8_t nameLength[kEntriesSize]{};
+  uint8_t valueLength[kEntriesSize]{};
+};
+
+constexpr StaticIndex buildStaticIndex() {
+  StaticIndex index{};
+  for (int i = 0; i < kEntriesSize; ++i) {
+    uint32_t length = constLength(s_tableEntries[i][0]);
+    uint32_t slot = hashName(s_tableEntries[i][0], length);
+    if (index.first[slot] == 0) {
+      index.first[slot] = i + 1;
+    }
+    ++index.count[slot];
+    index.nameLength[i] = length;
+    index.valueLength[i] = constLength(s_tableEntries[i][1]);
+  }
+  return index;
+}
+
+constexpr StaticIndex kStaticIndex = buildStaticIndex();
+
+// every entry must be found in its slot, among contiguous entries that all
+// share its name
+constexpr bool isPerfectHash() {
+  for (int i = 0; i < kEntriesSize; ++i) {
+    uint32_t slot = hashName(s_tableEntries[i][0], kStaticIndex.nameLength[i]);
+    int first = kStaticIndex.first[slot] - 1;
+    int last = first + kStaticIndex.count[slot];
+    if (i < first || i >= last) {
+      return false;
+    }
+    for (int j = first; j < last; ++j) {
+      if (!constEquals(s_tableEntries[i][0], s_tableEntries[j][0])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(isPerfectHash(), "static table names collide, change the seed");
+
+/**
+ * @return slot of the given name, or kNameSlots if it isn't a static name
+ */
+uint32_t findNameSlot(folly::StringPiece name) {
+  if (name.empty() || name.size() > std::numeric_limits<uint8_t>::max()) {
+    return kNameSlots;
+  }
+  uint32_t slot = hashName(name.data(), name.size());
+  uint32_t first = kStaticIndex.first[slot];
+  if (first == 0 || kStaticIndex.nameLength[first - 1] != name.size() ||
+      memcmp(s_tableEntries[first - 1][0], name.data(), name.size()) != 0) {
+    return kNameSlots;
+  }
+  return slot;
+}
+
+}
+
+uint32_t StaticHeaderTable::lookupIndex(folly::StringPiece name,
+                                        folly::StringPiece value) {
+  uint32_t slot = findNameSlot(name);
+  if (slot == kNameSlots) {
+    return 0;
+  }
+  uint32_t first = kStaticIndex.first[slot];
+  for (uint32_t i = first - 1; i < first - 1 + kStaticIndex.count[slot]; ++i) {
+    if (kStaticIndex.valueLength[i] == value.size() &&
+        memcmp(s_tableEntries[i][1], value.data(), value.size()) == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+uint32_t StaticHeaderTable::lookupNameIndex(folly::StringPiece name) {
+  uint32_t slot = findNameSlot(name);
+  return slot == kNameSlots ? 0 : kStaticIndex.first[slot];
+}
 
 StaticHeaderTable::StaticHeaderTable(
-    const char* entries[][2],
+    const char* const entries[][2],
     int size)
     : HeaderTable(std::make_unique<HPACKHeaderTableImpl>(), 0) {
   // calculate the size
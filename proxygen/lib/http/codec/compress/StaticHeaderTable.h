@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <folly/Range.h>
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
 #include <string>
 #include <vector>
@@ -19,10 +20,25 @@ class StaticHeaderTable : public HeaderTable {
 
  public:
   explicit StaticHeaderTable(
-    const char* entries[][2],
+    const char* const entries[][2],
     int size);
 
   static const HeaderTable& get();
+
+  /**
+   * Lookups in a perfect hash over the names of the static entries, generated
+   * at compile time. They don't touch the heap or the HeaderTable indices, so
+   * the encoder can match the static table before probing the dynamic one.
+   *
+   * @return index of the static entry matching both name and value, or 0
+   */
+  static uint32_t lookupIndex(folly::StringPiece name,
+                              folly::StringPiece value);
+
+  /**
+   * @return index of the first static entry with the given name, or 0
+   */
+  static uint32_t lookupNameIndex(folly::StringPiece name);
 };
 
 }
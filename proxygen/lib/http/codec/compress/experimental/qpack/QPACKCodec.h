@@ -66,6 +66,10 @@ class QPACKCodec : public HeaderCodec, public QPACKDecoder::Callback {
     decoder_.setMaxUncompressed(maxUncompressed);
   }
 
+  void setHuffmanDecodeMode(huffman::DecodeMode mode) {
+    decoder_.setHuffmanDecodeMode(mode);
+  }
+
   std::unique_ptr<folly::IOBuf> moveAcks() {
     return std::move(acks_);
   }
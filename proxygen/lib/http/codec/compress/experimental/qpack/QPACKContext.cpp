@@ -20,7 +20,8 @@ QPACKContext::QPACKContext(uint32_t tableSize) :
 }
 
 uint32_t QPACKContext::getIndex(const HPACKHeader& header) {
-  uint32_t index = getStaticTable().getIndex(header);
+  uint32_t index = StaticHeaderTable::lookupIndex(header.name.get(),
+                                                  header.value.get());
   if (index) {
     return staticToGlobalIndex(index);
   }
@@ -32,7 +33,7 @@ uint32_t QPACKContext::getIndex(const HPACKHeader& header) {
 }
 
 uint32_t QPACKContext::nameIndex(const HPACKHeaderName& name) {
-  uint32_t index = getStaticTable().nameIndex(name);
+  uint32_t index = StaticHeaderTable::lookupNameIndex(name.get());
   if (index) {
     return staticToGlobalIndex(index);
   }
@@ -49,7 +49,7 @@ void QPACKDecoder::decodeControlStream(folly::io::Cursor& cursor,
   decodeRequests_.emplace_front(nullptr, totalBytes);
   auto dreq = decodeRequests_.begin();
   HPACKDecodeBuffer dbuf(getHuffmanTree(), cursor, totalBytes,
-                         maxUncompressed_);
+                         maxUncompressed_, huffmanDecodeMode_);
   while (!dreq->hasError() && !dbuf.empty()) {
     dreq->pending++;
     decodeHeaderControl(dbuf, dreq);
@@ -68,7 +68,7 @@ bool QPACKDecoder::decodeStreaming(
   decodeRequests_.emplace_front(streamingCb, totalBytes);
   auto dreq = decodeRequests_.begin();
   HPACKDecodeBuffer dbuf(getHuffmanTree(), cursor, totalBytes,
-                         maxUncompressed_);
+                         maxUncompressed_, huffmanDecodeMode_);
   while (!dreq->hasError() && !dbuf.empty()) {
     dreq->pending++;
     decodeHeader(dbuf, dreq);
@@ -151,7 +151,7 @@ bool QPACKDecoder::isValid(uint32_t index) {
 void QPACKDecoder::emit(DecodeRequestHandle dreq, const HPACKHeader& header) {
   // would be nice to std::move here
   CHECK(dreq->cb);
-  dreq->cb->onHeader(header.name.get(), header.value);
+  dreq->cb->onHeader(header.name.get(), header.value.get());
   dreq->decodedSize.uncompressed += header.bytes();
   dreq->pending--;
   checkComplete(dreq);
@@ -52,6 +52,10 @@ class QPACKDecoder : public QPACKContext {
     maxUncompressed_ = maxUncompressed;
   }
 
+  void setHuffmanDecodeMode(huffman::DecodeMode mode) {
+    huffmanDecodeMode_ = mode;
+  }
+
   uint32_t getQueuedBytes() const {
     return queuedBytes_;
   }
@@ -104,6 +108,7 @@ class QPACKDecoder : public QPACKContext {
 
   Callback& callback_;
   uint32_t maxUncompressed_;
+  huffman::DecodeMode huffmanDecodeMode_{huffman::kDefaultDecodeMode};
   HeaderCodec::StreamingCallback* streamingCb_{nullptr};
   std::list<DecodeRequest> decodeRequests_;
   uint32_t queuedBytes_{0};
@@ -138,7 +138,7 @@ void QPACKEncoder::encodeLiteral(HPACKEncodeBuffer& buffer,
     buffer.encodeLiteral(header.name.get());
   }
   // value
-  buffer.encodeLiteral(header.value);
+  buffer.encodeLiteral(header.value.get());
 }
 
 void QPACKEncoder::encodeDelete(uint32_t delIndex, uint32_t refcount) {
@@ -51,7 +51,7 @@ bool QPACKHeaderTable::add(const HPACKHeader& header, uint32_t index) {
   std::tie(it, inserted) = table_.emplace(
     std::piecewise_construct,
     std::forward_as_tuple(index),
-    std::forward_as_tuple(header.name.get(), header.value));
+    std::forward_as_tuple(header.name.get(), header.value.get()));
   folly::Bits<uint64_t>::clear(availIndexes_.begin(), index - 1);
   // index name
   it->second.refCount = 1;
@@ -66,11 +66,11 @@ bool QPACKHeaderTable::add(const HPACKHeader& header, uint32_t index) {
 uint32_t QPACKHeaderTable::getIndex(const HPACKHeader& header) const {
   // cast away const-ness
   return ((QPACKHeaderTable*)this)->getIndexImpl(
-    header.name, header.value, true, false);
+    header.name, header.value.get(), true, false);
 }
 
 uint32_t QPACKHeaderTable::getIndexRef(const HPACKHeader& header) {
-  return getIndexImpl(header.name, header.value, true, true);
+  return getIndexImpl(header.name, header.value.get(), true, true);
 }
 
 uint32_t QPACKHeaderTable::nameIndexRef(const HPACKHeaderName& name) {
@@ -88,7 +88,7 @@ uint32_t QPACKHeaderTable::getIndexImpl(const HPACKHeaderName& name,
   for (auto idx: nameIt->second) {
     auto it = table_.find(idx);
     CHECK(it != table_.end());
-    if (it->second.valid && (!checkValue || it->second.value == value)) {
+    if (it->second.valid && (!checkValue || it->second.value.get() == value)) {
       if (takeRef) {
         it->second.refCount++;
         // encoder side operation, getIndex should never delete
@@ -10,6 +10,7 @@
 #include <proxygen/lib/http/codec/compress/test/TestUtil.h>
 #include <folly/Benchmark.h>
 #include <folly/Range.h>
+#include <folly/io/IOBufQueue.h>
 
 #include <algorithm>
 
@@ -98,8 +99,119 @@ BENCHMARK(EncodeDecode2, iters) {
   encodeDecodeBench(2, iters);
 }
 
+namespace {
+// response headers which don't get indexed by the default strategy
+vector<HPACKHeader> getResponseHeaders() {
+  vector<HPACKHeader> headers;
+  headers.emplace_back(":status", "200");
+  headers.emplace_back("content-type", "text/html; charset=utf-8");
+  headers.emplace_back("content-length", "48213");
+  headers.emplace_back("last-modified", "Mon, 09 Oct 2017 20:55:04 GMT");
+  headers.emplace_back("if-modified-since", "Mon, 09 Oct 2017 20:55:04 GMT");
+  headers.emplace_back(
+    "cache-control", "private, no-cache, no-store, must-revalidate");
+  return headers;
+}
+
+static vector<HPACKHeader> responseHeaders = getResponseHeaders();
+}
+
+void encodeResponseBench(uint32_t cacheSize, int iters) {
+  HPACKEncoder encoder(true);
+  encoder.setEncodeCacheSize(cacheSize);
+  for (int i = 0; i < iters; i++) {
+    encode(responseHeaders, encoder);
+  }
+}
+
+BENCHMARK(EncodeResponse, iters) {
+  encodeResponseBench(0, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeResponseCached, iters) {
+  encodeResponseBench(64, iters);
+}
+
+namespace {
+// huffman encoded names and values of the test headers
+vector<string> getHuffmanLiterals() {
+  vector<string> literals;
+  const huffman::HuffTree& tree = huffman::huffTree();
+  for (const auto& header : headers) {
+    for (const auto& str : { folly::fbstring(header.name.get()),
+                             header.value.get() }) {
+      IOBufQueue queue;
+      io::QueueAppender appender(&queue, 512);
+      tree.encode(str, appender);
+      literals.push_back(queue.move()->moveToFbString().toStdString());
+    }
+  }
+  return literals;
+}
+
+static vector<string> huffmanLiterals = getHuffmanLiterals();
+
+void huffmanDecodeBench(huffman::DecodeMode mode, int iters) {
+  const huffman::HuffTree& tree = huffman::huffTree();
+  folly::fbstring literal;
+  for (int i = 0; i < iters; i++) {
+    for (const auto& encoded : huffmanLiterals) {
+      literal.clear();
+      tree.decode((const uint8_t*)encoded.data(), encoded.size(), literal,
+                  mode);
+    }
+  }
+}
+
+void decodeBench(huffman::DecodeMode mode, int iters) {
+  unique_ptr<IOBuf> encoded;
+  BENCHMARK_SUSPEND {
+    // a first header block, all the literals are on the wire
+    HPACKEncoder encoder(true);
+    encoded = encode(headers, encoder);
+  }
+  for (int i = 0; i < iters; i++) {
+    HPACKDecoder decoder;
+    decoder.setHuffmanDecodeMode(mode);
+    auto decodedHeaders = decoder.decode(encoded.get());
+    CHECK(!decoder.hasError());
+  }
+}
+}
+
+BENCHMARK(HuffmanDecodeTree, iters) {
+  huffmanDecodeBench(huffman::DecodeMode::TREE, iters);
+}
+
+BENCHMARK_RELATIVE(HuffmanDecodeMultiSymbol, iters) {
+  huffmanDecodeBench(huffman::DecodeMode::MULTI_SYMBOL, iters);
+}
+
+BENCHMARK(DecodeTree, iters) {
+  decodeBench(huffman::DecodeMode::TREE, iters);
+}
+
+BENCHMARK_RELATIVE(DecodeMultiSymbol, iters) {
+  decodeBench(huffman::DecodeMode::MULTI_SYMBOL, iters);
+}
+
+// both decoders have to produce the same output before we time them
+void checkHuffmanDecoders() {
+  const huffman::HuffTree& tree = huffman::huffTree();
+  for (const auto& encoded : huffmanLiterals) {
+    folly::fbstring treeLiteral;
+    folly::fbstring multiLiteral;
+    CHECK(tree.decode((const uint8_t*)encoded.data(), encoded.size(),
+                      treeLiteral, huffman::DecodeMode::TREE));
+    CHECK(tree.decode((const uint8_t*)encoded.data(), encoded.size(),
+                      multiLiteral, huffman::DecodeMode::MULTI_SYMBOL));
+    CHECK_EQ(treeLiteral, multiLiteral);
+  }
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
+  checkHuffmanDecoders();
   folly::runBenchmarks();
   return 0;
 }
@@ -118,6 +118,45 @@ TEST_F(HPACKBufferTests, encode_huffman_literal) {
   EXPECT_EQ(data_[11], 0x7f);
 }
 
+TEST_F(HPACKBufferTests, encode_huffman_literal_no_gain) {
+  // binary characters have long codes, the plain layout is shorter
+  string binary("\x01\x02\x03");
+  HPACKEncodeBuffer encoder(512, huffman::huffTree(), true);
+  EXPECT_EQ(encoder.encodeLiteral(binary), 4);
+  releaseData(encoder);
+  EXPECT_EQ(buf_->length(), 4);
+  EXPECT_EQ(data_[0], 3);
+  EXPECT_EQ(data_[1], 1);
+
+  // huffman is still available explicitly
+  EXPECT_GT(encoder.encodeHuffman(binary), 4);
+}
+
+TEST_F(HPACKBufferTests, encode_huffman_literal_short_length) {
+  // the length reserved for the plain literal takes 2 bytes while the
+  // huffman one fits in 1, so the encoded data is moved next to the prefix
+  string literal(200, 'a');
+  HPACKEncodeBuffer encoder(512, huffman::huffTree(), true);
+  EXPECT_EQ(encoder.encodeLiteral(literal), 126);
+  releaseData(encoder);
+  EXPECT_EQ(buf_->length(), 126);
+  EXPECT_EQ(data_[0], 128 + 125);
+  resetDecoder();
+  folly::fbstring decoded;
+  EXPECT_EQ(decoder_.decodeLiteral(decoded), DecodeError::NONE);
+  EXPECT_EQ(decoded, literal);
+}
+
+TEST_F(HPACKBufferTests, integer_size) {
+  for (uint32_t value : {0u, 30u, 31u, 127u, 128u, 1337u, 1u << 20}) {
+    for (uint8_t nbit : {4, 5, 7, 8}) {
+      HPACKEncodeBuffer encoder(512);
+      EXPECT_EQ(HPACKEncodeBuffer::getIntegerSize(value, nbit),
+                encoder.encodeInteger(value, 0, nbit));
+    }
+  }
+}
+
 TEST_F(HPACKBufferTests, decode_single_byte) {
   buf_ = IOBuf::create(512);
   uint8_t* wdata = buf_->writableData();
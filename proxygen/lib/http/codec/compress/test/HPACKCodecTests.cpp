@@ -62,6 +62,13 @@ class TestHeaderCodecStats : public HeaderCodec::Stats {
     errors++; //?
   }
 
+  void recordEncodeCache(HeaderCodec::Type type, uint32_t hits,
+                         uint32_t misses) override {
+    EXPECT_EQ(type, HeaderCodec::Type::HPACK);
+    cacheHits += hits;
+    cacheMisses += misses;
+  }
+
   void reset() {
     encodes = 0;
     decodes = 0;
@@ -70,6 +77,8 @@ class TestHeaderCodecStats : public HeaderCodec::Stats {
     decodedBytesCompr = 0;
     decodedBytesUncompr = 0;
     errors = 0;
+    cacheHits = 0;
+    cacheMisses = 0;
   }
 
   uint32_t encodes{0};
@@ -79,6 +88,8 @@ class TestHeaderCodecStats : public HeaderCodec::Stats {
   uint32_t decodedBytesCompr{0};
   uint32_t decodedBytesUncompr{0};
   uint32_t errors{0};
+  uint32_t cacheHits{0};
+  uint32_t cacheMisses{0};
 };
 
 namespace {
@@ -310,6 +321,103 @@ TEST_F(HPACKCodecTests, default_header_indexing_strategy) {
 }
 
 
+TEST_F(HPACKCodecTests, encode_cache) {
+  vector<vector<string>> headersStrings = {
+    {":status", "200"},
+    {"content-type", "text/html; charset=utf-8"},
+    {"cache-control", "private, no-cache, no-store, must-revalidate"},
+    {"content-length", "12345"},
+    {"last-modified", "Mon, 09 Oct 2017 20:55:04 GMT"},
+    {"x-custom", "some_value"}
+  };
+  vector<Header> headers = headersFromArray(headersStrings);
+  HPACKCodec cached{TransportDirection::DOWNSTREAM};
+  cached.setEncodeCacheSize(16);
+  TestHeaderCodecStats stats;
+  cached.setStats(&stats);
+  HPACKCodec decoder{TransportDirection::UPSTREAM};
+
+  // the cache must not change the encoding, also across a table size update
+  // which changes which headers fit in the table
+  for (auto i = 0; i < 6; i++) {
+    if (i == 3) {
+      server.setEncoderHeaderTableSize(60);
+      cached.setEncoderHeaderTableSize(60);
+    }
+    auto expected = server.encode(headers);
+    auto encoded = cached.encode(headers);
+    EXPECT_TRUE(IOBufEqual()(expected, encoded));
+    Cursor cursor(encoded.get());
+    auto result = decoder.decode(cursor, cursor.totalLength());
+    EXPECT_TRUE(result.isOk());
+    EXPECT_EQ(result.ok().headers.size(), 2 * headers.size());
+  }
+  // both never indexed headers are reused once their literal is cached
+  EXPECT_GE(stats.cacheHits, 4);
+  EXPECT_GT(stats.cacheMisses, 0);
+}
+
+namespace {
+class ViewStreamingCallback : public TestStreamingCallback {
+ public:
+  void onHeaderView(StringPiece name, StringPiece value,
+                    const IOBuf& valueBuf) override {
+    EXPECT_TRUE(valueBuf.isManagedOne());
+    EXPECT_GE(value.begin(), (const char*)valueBuf.data());
+    EXPECT_LE(value.end(), (const char*)valueBuf.tail());
+    views++;
+    onHeader(fbstring(name.data(), name.size()),
+             fbstring(value.data(), value.size()));
+  }
+
+  uint32_t views{0};
+};
+}
+
+TEST_F(HPACKCodecTests, zero_copy_decode) {
+  vector<vector<string>> headersStrings = {
+    {":path", "/index.php?q=search"},
+    {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101"},
+    // huffman would make these longer, so they are sent as plain literals
+    {"x-plain", "{}|~^`{}|~^`{}|~^`"},
+    {"{}|~^`", "x"},
+    {"cookie", "datr=1234567890abcdefghijklmnopqrstuvwxyz"}
+  };
+  vector<Header> headers = headersFromArray(headersStrings);
+  HPACKCodec zeroCopy{TransportDirection::DOWNSTREAM};
+  zeroCopy.setZeroCopyDecode(true);
+
+  // the second round decodes the same headers from the dynamic table
+  for (auto i = 0; i < 2; i++) {
+    auto encoded = client.encode(headers);
+    // split the block so some literals span two buffers
+    auto tail = encoded->clone();
+    auto split = encoded->length() / 2;
+    encoded->trimEnd(encoded->length() - split);
+    tail->trimStart(split);
+    encoded->prependChain(std::move(tail));
+
+    TestStreamingCallback expected;
+    Cursor cursor(encoded.get());
+    server.decodeStreaming(cursor, cursor.totalLength(), &expected);
+    ViewStreamingCallback views;
+    Cursor zeroCopyCursor(encoded.get());
+    zeroCopy.decodeStreaming(zeroCopyCursor, zeroCopyCursor.totalLength(),
+                             &views);
+
+    EXPECT_EQ(views.error, HeaderDecodeError::NONE);
+    EXPECT_EQ(views.views, headers.size());
+    ASSERT_EQ(views.headers.size(), expected.headers.size());
+    for (size_t j = 0; j < expected.headers.size(); j++) {
+      EXPECT_EQ(views.headers[j].str, expected.headers[j].str);
+    }
+    EXPECT_EQ(zeroCopy.getDecodedSize().uncompressed,
+              server.getDecodedSize().uncompressed);
+    EXPECT_EQ(zeroCopy.getHPACKTableInfo().ingressBytesStored_,
+              server.getHPACKTableInfo().ingressBytesStored_);
+  }
+}
+
 class HPACKQueueTests : public testing::TestWithParam<int> {
  public:
   HPACKQueueTests()
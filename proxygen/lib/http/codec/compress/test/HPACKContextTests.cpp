@@ -74,6 +74,24 @@ TEST_F(HPACKContextTests, static_table) {
   CHECK_EQ(table[table.size()].name.get(), "www-authenticate");
 }
 
+TEST_F(HPACKContextTests, static_table_lookup) {
+  auto& table = StaticHeaderTable::get();
+  for (uint32_t i = 1; i <= table.size(); i++) {
+    const HPACKHeader& header = table[i];
+    EXPECT_EQ(StaticHeaderTable::lookupIndex(header.name.get(),
+                                             header.value.get()), i);
+    EXPECT_EQ(StaticHeaderTable::lookupNameIndex(header.name.get()),
+              table.nameIndex(header.name));
+  }
+  EXPECT_EQ(StaticHeaderTable::lookupNameIndex(":status"), 8);
+  EXPECT_EQ(StaticHeaderTable::lookupIndex(":status", "404"), 13);
+  EXPECT_EQ(StaticHeaderTable::lookupIndex(":status", "401"), 0);
+  EXPECT_EQ(StaticHeaderTable::lookupIndex("accept", "text/html"), 0);
+  EXPECT_EQ(StaticHeaderTable::lookupNameIndex("x-fb-debug"), 0);
+  EXPECT_EQ(StaticHeaderTable::lookupNameIndex("accep"), 0);
+  EXPECT_EQ(StaticHeaderTable::lookupNameIndex(""), 0);
+}
+
 TEST_F(HPACKContextTests, static_index) {
   TestContext context(HPACK::kTableSize);
   HPACKHeader authority(":authority", "");
@@ -264,6 +282,65 @@ TEST_P(HPACKContextTests, contextUpdate) {
   }
 }
 
+TEST_F(HPACKContextTests, resetEncoderTable) {
+  HPACKEncoder encoder(true);
+  HPACKDecoder decoder;
+  vector<HPACKHeader> headers{HPACKHeader("x-fb-random", "bla"),
+                              HPACKHeader(":path", "/index.html")};
+  auto decoded = decoder.decode(encoder.encode(headers).get());
+  EXPECT_EQ(*decoded, headers);
+  EXPECT_EQ(decoder.getHeadersStored(), 2);
+
+  encoder.resetTable();
+  EXPECT_EQ(encoder.getTableSize(), 0);
+  EXPECT_EQ(encoder.getHeadersStored(), 0);
+  encoder.setHeaderTableSize(HPACK::kTableSize);
+  auto encoded = encoder.encode(headers);
+  // size update to 0, then back to the table size
+  EXPECT_EQ(encoded->data()[0], HPACK::HeaderEncoding::TABLE_SIZE_UPDATE);
+  decoded = decoder.decode(encoded.get());
+  EXPECT_FALSE(decoder.hasError());
+  EXPECT_EQ(*decoded, headers);
+  // the decoder dropped the old entries as well
+  EXPECT_EQ(decoder.getHeadersStored(), 2);
+  EXPECT_EQ(decoder.getBytesStored(), encoder.getBytesStored());
+}
+
+TEST_F(HPACKContextTests, resetDecoderTable) {
+  HPACKEncoder encoder(true);
+  HPACKDecoder decoder;
+  vector<HPACKHeader> headers{HPACKHeader("x-fb-random", "bla"),
+                              HPACKHeader(":path", "/index.html")};
+  decoder.decode(encoder.encode(headers).get());
+  EXPECT_EQ(decoder.getHeadersStored(), 2);
+
+  // SETTINGS_HEADER_TABLE_SIZE 0 acknowledged with no header block between
+  decoder.prepareTableReset();
+  decoder.completeTableReset();
+  EXPECT_EQ(decoder.getTableSize(), 0);
+  EXPECT_EQ(decoder.getHeadersStored(), 0);
+  // the peer's next block signals the reset
+  encoder.setHeaderTableSize(0);
+  encoder.setHeaderTableSize(HPACK::kTableSize);
+  auto decoded = decoder.decode(encoder.encode(headers).get());
+  EXPECT_FALSE(decoder.hasError());
+  EXPECT_EQ(*decoded, headers);
+  EXPECT_EQ(decoder.getHeadersStored(), 2);
+
+  // a header block signaling the reset arrived before the acknowledgement,
+  // what it added stays
+  decoder.prepareTableReset();
+  encoder.setHeaderTableSize(0);
+  encoder.setHeaderTableSize(HPACK::kTableSize);
+  decoder.decode(encoder.encode(headers).get());
+  decoder.completeTableReset();
+  EXPECT_EQ(decoder.getTableSize(), HPACK::kTableSize);
+  EXPECT_EQ(decoder.getHeadersStored(), 2);
+  decoded = decoder.decode(encoder.encode(headers).get());
+  EXPECT_FALSE(decoder.hasError());
+  EXPECT_EQ(*decoded, headers);
+}
+
 INSTANTIATE_TEST_CASE_P(Context,
                         HPACKContextTests,
                         ::testing::Values(true, false));
@@ -7,6 +7,7 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <folly/Conv.h>
 #include <folly/portability/GTest.h>
 #include <memory>
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
@@ -72,11 +73,10 @@ TEST_F(HeaderTableTests, add) {
   table.add(header);
   table.add(header);
   table.add(header);
-  EXPECT_EQ(table.names().size(), 1);
   EXPECT_EQ(table.hasName(header.name), true);
-  auto it = table.names().find(header.name);
-  EXPECT_EQ(it->second.size(), 3);
+  EXPECT_EQ(table.countName(header.name), 3);
   EXPECT_EQ(table.nameIndex(header.name), 1);
+  EXPECT_EQ(table.getIndex(header), 3);
 }
 
 TEST_F(HeaderTableTests, evict) {
@@ -95,15 +95,15 @@ TEST_F(HeaderTableTests, evict) {
   EXPECT_EQ(table.add(accept2), true);
   // evict the first one
   EXPECT_EQ(table[1], accept2);
-  auto ilist = table.names().find(name)->second;
-  EXPECT_EQ(ilist.size(), max);
+  EXPECT_EQ(table.countName(name), max);
   // evict all the 'accept' headers
   for (size_t i = 0; i < max - 1; i++) {
     EXPECT_EQ(table.add(accept2), true);
   }
   EXPECT_EQ(table.size(), max);
   EXPECT_EQ(table[max], accept2);
-  EXPECT_EQ(table.names().size(), 1);
+  EXPECT_EQ(table.countName(name), max);
+  EXPECT_EQ(table.getIndex(accept), 0);
   // add an entry that will cause 2 evictions
   EXPECT_EQ(table.add(accept3), true);
   EXPECT_EQ(table[1], accept3);
@@ -115,7 +115,7 @@ TEST_F(HeaderTableTests, evict) {
   HPACKHeader bigheader("user-agent", bigvalue);
   EXPECT_EQ(table.add(bigheader), false);
   EXPECT_EQ(table.size(), 0);
-  EXPECT_EQ(table.names().size(), 0);
+  EXPECT_EQ(table.hasName(name), false);
 }
 
 TEST_F(HeaderTableTests, reduceCapacity) {
@@ -272,22 +272,24 @@ TEST_F(HeaderTableTests, addLargerThanTable) {
   table.add(HPACKHeader("accept-encoding", "gzip"));  // internal index = 0
   table.add(HPACKHeader("accept-encoding", "gzip"));  // internal index = 1
   table.add(HPACKHeader("test-encoding", "gzip"));    // internal index = 2
-  EXPECT_EQ(table.names().size(), 2);
+  HPACKHeaderName testName("test-encoding");
+  EXPECT_EQ(table.hasName(name), true);
+  EXPECT_EQ(table.hasName(testName), true);
 
   // Attempt to add a header that is larger than our specified table capacity
   // bytes.  This should result in a table flush.
   table.add(HPACKHeader(std::string(capacityBytes, 'a'), "gzip"));
-  EXPECT_EQ(table.names().size(), 0);
+  EXPECT_EQ(table.hasName(name), false);
+  EXPECT_EQ(table.hasName(testName), false);
 
   // Add the previous headers to the table again
   table.add(HPACKHeader("accept-encoding", "gzip"));  // internal index = 3
   table.add(HPACKHeader("accept-encoding", "gzip"));  // internal index = 4
   table.add(HPACKHeader("test-encoding", "gzip"));    // internal index = 5
-  EXPECT_EQ(table.names().size(), 2);
+  EXPECT_EQ(table.countName(testName), 1);
 
   EXPECT_EQ(table.hasName(name), true);
-  auto it = table.names().find(name);
-  EXPECT_EQ(it->second.size(), 2);
+  EXPECT_EQ(table.countName(name), 2);
   // As nameIndex takes the last index added, we have head = 5, index = 4
   // and so yields a difference of one and as external indexing is 1 based,
   // we expect 2 here
@@ -323,4 +325,104 @@ TEST_F(HeaderTableTests, increaseLengthOfFullTable) {
   CHECK_EQ(table[8], smallHeader);
 }
 
+TEST_F(HeaderTableTests, indexAfterResize) {
+  // distinct values, so every entry has its own name/value key
+  HeaderTable table(std::make_unique<HPACKHeaderTableImpl>(), 4096);
+  std::vector<HPACKHeader> headers;
+  for (uint32_t i = 0; i < 200; i++) {
+    headers.emplace_back(folly::to<string>("name", i % 7),
+                         folly::to<string>("value", i));
+    table.add(headers.back());
+    // the ring wraps and grows along the way, every live entry has to be
+    // found at its current external index
+    for (uint32_t j = 1; j <= table.size(); j++) {
+      const auto& header = headers[headers.size() - j];
+      EXPECT_EQ(table.getIndex(header), j);
+      EXPECT_EQ(table[j], header);
+    }
+    if (headers.size() > table.size()) {
+      EXPECT_EQ(table.getIndex(headers[headers.size() - table.size() - 1]),
+                0);
+    }
+    // the newest entry with a name is the one nameIndex returns
+    EXPECT_EQ(table.nameIndex(headers.back().name), 1);
+  }
+}
+
+TEST_F(HeaderTableTests, tinyTable) {
+  // room for a single entry, the table starts without any slot
+  HPACKHeader header("a", "b");
+  HeaderTable table(std::make_unique<HPACKHeaderTableImpl>(), header.bytes());
+  EXPECT_EQ(table.length(), 0);
+  EXPECT_EQ(table.add(header), true);
+  EXPECT_EQ(table.length(), 1);
+  EXPECT_EQ(table.getIndex(header), 1);
+  HPACKHeader header2("a", "c");
+  EXPECT_EQ(table.add(header2), true);
+  EXPECT_EQ(table.size(), 1);
+  EXPECT_EQ(table.getIndex(header), 0);
+  EXPECT_EQ(table.getIndex(header2), 1);
+  EXPECT_EQ(table.countName(header.name), 1);
+}
+
+TEST_F(HeaderTableTests, compact) {
+  HPACKHeader header("abcd", "efgh");
+  HeaderTable table(std::make_unique<HPACKHeaderTableImpl>(), 4096);
+  EXPECT_GT(table.length(), 0);
+  for (int i = 0; i < 10; i++) {
+    table.add(HPACKHeader("abcd", folly::to<string>(i)));
+  }
+  // only empty tables are compacted
+  table.compact();
+  EXPECT_EQ(table.size(), 10);
+  EXPECT_EQ(table.getIndex(HPACKHeader("abcd", "9")), 1);
+
+  table.setCapacity(0);
+  table.compact();
+  EXPECT_EQ(table.length(), 0);
+  EXPECT_EQ(table.nameIndex(header.name), 0);
+
+  // grows back as entries are added
+  table.setCapacity(4096);
+  for (int i = 0; i < 200; i++) {
+    EXPECT_EQ(table.add(HPACKHeader("abcd", folly::to<string>(i))), true);
+  }
+  EXPECT_LE(table.bytes(), 4096);
+  EXPECT_EQ(table.getIndex(HPACKHeader("abcd", "199")), 1);
+  EXPECT_EQ(table.getIndex(HPACKHeader("abcd", "9")), 0);
+  EXPECT_EQ(table.countName(header.name), table.size());
+}
+
+TEST_F(HeaderTableTests, internPool) {
+  HPACKInternPool pool;
+  HeaderTable table1(std::make_unique<HPACKHeaderTableImpl>(), 4096);
+  HeaderTable table2(std::make_unique<HPACKHeaderTableImpl>(), 4096);
+  table1.setInternPool(&pool);
+  table2.setInternPool(&pool);
+  HPACKHeader agent("user-agent", string(100, 'a'));
+  HPACKHeader small("accept", "*/*");
+  for (auto table: { &table1, &table2 }) {
+    EXPECT_EQ(table->add(agent), true);
+    EXPECT_EQ(table->add(small), true);
+    EXPECT_EQ(table->getIndex(agent), 2);
+    EXPECT_EQ(table->getIndex(small), 1);
+    EXPECT_EQ((*table)[2], agent);
+  }
+  // one copy of the long value, short ones are kept inline
+  EXPECT_TRUE(table1[2].value.isInterned());
+  EXPECT_FALSE(table1[1].value.isInterned());
+  EXPECT_EQ(table1[2].value.data(), table2[2].value.data());
+  EXPECT_EQ(pool.size(), 1);
+  EXPECT_EQ(pool.getBytes(), 100);
+  EXPECT_EQ(pool.getStats().misses, 1);
+  EXPECT_EQ(pool.getStats().hits, 1);
+
+  // the value leaves the pool with its last table entry
+  table1.setCapacity(0);
+  EXPECT_EQ(pool.size(), 1);
+  table2.setCapacity(0);
+  EXPECT_EQ(pool.size(), 0);
+  EXPECT_EQ(pool.getBytes(), 0);
+}
+
 }
@@ -7,6 +7,7 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <folly/Random.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/portability/GTest.h>
@@ -283,3 +284,66 @@ TEST_F(HuffmanTests, sanity_checks) {
   uint32_t totalReqChars = treeDfs(allSnodesReq, 0, 0, 0, 0x3fffffff, 30);
   EXPECT_EQ(totalReqChars, 256);
 }
+
+TEST_F(HuffmanTests, multi_symbol_matches_tree) {
+  folly::Random::DefaultGenerator rng(static_cast<uint32_t>(42));
+  for (uint32_t i = 0; i < 10000; i++) {
+    folly::fbstring str;
+    uint32_t len = folly::Random::rand32(64, rng);
+    for (uint32_t j = 0; j < len; j++) {
+      // mix printable strings with the long codes of the binary range
+      str.push_back(i % 2 ? folly::Random::rand32(256, rng) :
+                    32 + folly::Random::rand32(95, rng));
+    }
+    IOBufQueue bufQueue;
+    QueueAppender appender(&bufQueue, 512);
+    tree_.encode(str, appender);
+    auto encoded = bufQueue.move();
+    encoded->coalesce();
+    folly::fbstring treeLiteral;
+    folly::fbstring multiLiteral;
+    EXPECT_TRUE(tree_.decode(encoded->data(), encoded->length(), treeLiteral,
+                             DecodeMode::TREE));
+    EXPECT_TRUE(tree_.decode(encoded->data(), encoded->length(),
+                             multiLiteral, DecodeMode::MULTI_SYMBOL));
+    EXPECT_EQ(treeLiteral, str);
+    EXPECT_EQ(multiLiteral, str);
+  }
+}
+
+TEST_F(HuffmanTests, multi_symbol_invalid) {
+  folly::fbstring literal;
+  // "/e" with padding which is not an EOS prefix
+  uint8_t badPadding[2] = {0x60, 0xb0};
+  EXPECT_FALSE(tree_.decode(badPadding, 2, literal,
+                            DecodeMode::MULTI_SYMBOL));
+  // "/e" with more than 7 bits of padding
+  uint8_t longPadding[3] = {0x60, 0xbf, 0xff};
+  literal.clear();
+  EXPECT_FALSE(tree_.decode(longPadding, 3, literal,
+                            DecodeMode::MULTI_SYMBOL));
+  // EOS
+  uint8_t eos[4] = {0xff, 0xff, 0xff, 0xff};
+  literal.clear();
+  EXPECT_FALSE(tree_.decode(eos, 4, literal, DecodeMode::MULTI_SYMBOL));
+  // the valid version still decodes
+  uint8_t valid[2] = {0x60, 0xbf};
+  literal.clear();
+  EXPECT_TRUE(tree_.decode(valid, 2, literal, DecodeMode::MULTI_SYMBOL));
+  EXPECT_EQ(literal, "/e");
+}
+
+TEST_F(HuffmanTests, bounded_encode) {
+  folly::fbstring accept("accept-encoding");
+  uint32_t size = tree_.getEncodeSize(accept);
+  uint8_t buf[64];
+  // fits exactly
+  EXPECT_EQ(tree_.encode(accept, buf, size), size);
+  folly::fbstring decoded;
+  tree_.decode(buf, size, decoded);
+  EXPECT_EQ(decoded, accept);
+  // one byte short
+  EXPECT_GT(tree_.encode(accept, buf, size - 1), size - 1);
+  // empty string
+  EXPECT_EQ(tree_.encode(folly::fbstring(), buf, 0), 0);
+}
@@ -169,7 +169,7 @@ TEST_P(RFCResponseTest, rfc_example_response) {
   EXPECT_EQ(encoder.getTable().bytes(), 222);
   EXPECT_EQ(encoder.getTable().size(), 4);
   EXPECT_EQ(encoder.getHeader(64).name.get(), "cache-control");
-  EXPECT_EQ(encoder.getHeader(64).value, "private");
+  EXPECT_EQ(encoder.getHeader(64).value.get(), "private");
 
   // second
   encoded = hpack::encodeDecode(resp2, encoder, decoder);
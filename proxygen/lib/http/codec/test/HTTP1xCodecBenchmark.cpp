@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2017-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/IOBuf.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/codec/test/TestUtils.h>
+
+#include <cstring>
+
+using namespace std;
+using namespace folly;
+using namespace proxygen;
+
+namespace {
+
+// A browser-like request with the kind of long values that dominate header
+// parsing time at the edge
+const string kRequest =
+  "GET /graphql/query?doc_id=1234567890&variables=%7B%22id%22%3A%2242%22%7D "
+  "HTTP/1.1\r\n"
+  "Host: www.facebook.com\r\n"
+  "Connection: keep-alive\r\n"
+  "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_12_6) "
+  "AppleWebKit/537.36 (KHTML, like Gecko) Chrome/60.0.3100.0 "
+  "Safari/537.36\r\n"
+  "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+  "image/webp,image/apng,*/*;q=0.8\r\n"
+  "Accept-Encoding: gzip, deflate, br\r\n"
+  "Accept-Language: en-US,en;q=0.8\r\n"
+  "Cookie: datr=AbCdEfGhIjKlMnOpQrStUvWx; sb=YzAbCdEfGhIjKlMnOpQrStUv; "
+  "c_user=100000000000000; xs=12%3AabcdefghijklmN%3A2%3A1500000000%3A12345; "
+  "fr=0AbCdEfGhIjKlMnOp.AWXyZ0123456789.Bz.AAA.0.0.Bz.AWXyZ012\r\n"
+  "Referer: https://www.facebook.com/some/page/that/linked/here\r\n"
+  "Upgrade-Insecure-Requests: 1\r\n"
+  "\r\n";
+
+int noopCB(http_parser* /*parser*/) {
+  return 0;
+}
+
+int noopDataCB(http_parser* /*parser*/, const char* /*buf*/, size_t /*len*/) {
+  return 0;
+}
+
+// Drives the bare http_parser over a buffer of pipelined requests, so the
+// numbers reflect scanning speed rather than HTTPMessage construction
+void parserBench(http_parser_scan_mode mode, int iters) {
+  BenchmarkSuspender suspender;
+  http_parser_set_scan_mode(mode);
+  string data;
+  for (size_t i = 0; i < 100; i++) {
+    data += kRequest;
+  }
+  http_parser_settings settings;
+  memset(&settings, 0, sizeof(settings));
+  settings.on_message_begin = noopCB;
+  settings.on_url = noopDataCB;
+  settings.on_header_field = noopDataCB;
+  settings.on_header_value = noopDataCB;
+  settings.on_headers_complete = noopDataCB;
+  settings.on_body = noopDataCB;
+  settings.on_message_complete = noopCB;
+  settings.on_reason = noopDataCB;
+  settings.on_chunk_header = noopCB;
+  settings.on_chunk_complete = noopCB;
+  suspender.dismiss();
+
+  for (int i = 0; i < iters; i++) {
+    http_parser parser;
+    http_parser_init(&parser, HTTP_REQUEST);
+    auto parsed = http_parser_execute(&parser, &settings, data.data(),
+                                      data.size());
+    CHECK_EQ(parsed, data.size());
+  }
+
+  suspender.rehire();
+  http_parser_set_scan_mode(HTTP_PARSER_SCAN_AUTO);
+}
+
+// Full HTTP1xCodec ingress path for a single request
+void codecBench(http_parser_scan_mode mode, int iters) {
+  BenchmarkSuspender suspender;
+  http_parser_set_scan_mode(mode);
+  auto buf = IOBuf::copyBuffer(kRequest);
+  suspender.dismiss();
+
+  for (int i = 0; i < iters; i++) {
+    HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+    FakeHTTPCodecCallback callbacks;
+    codec.setCallback(&callbacks);
+    codec.onIngress(*buf);
+    CHECK_EQ(callbacks.headersComplete, 1);
+  }
+
+  suspender.rehire();
+  http_parser_set_scan_mode(HTTP_PARSER_SCAN_AUTO);
+}
+
+}
+
+BENCHMARK(ParserScalar, iters) {
+  parserBench(HTTP_PARSER_SCAN_SCALAR, iters);
+}
+
+BENCHMARK_RELATIVE(ParserSSE42, iters) {
+  parserBench(HTTP_PARSER_SCAN_SSE42, iters);
+}
+
+BENCHMARK_RELATIVE(ParserAVX2, iters) {
+  parserBench(HTTP_PARSER_SCAN_AVX2, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(CodecScalar, iters) {
+  codecBench(HTTP_PARSER_SCAN_SCALAR, iters);
+}
+
+BENCHMARK_RELATIVE(CodecSSE42, iters) {
+  codecBench(HTTP_PARSER_SCAN_SSE42, iters);
+}
+
+BENCHMARK_RELATIVE(CodecAVX2, iters) {
+  codecBench(HTTP_PARSER_SCAN_AVX2, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -523,3 +523,115 @@ INSTANTIATE_TEST_CASE_P(
     ConnectionHeaderTest::ParamType(
       { "foo", "upgrade, boo", "baz" }, "foo, upgrade, boo, baz, keep-alive")
   ));
+
+class ScanModeTest : public testing::TestWithParam<http_parser_scan_mode> {
+ public:
+  void SetUp() override {
+    http_parser_set_scan_mode(GetParam());
+  }
+  void TearDown() override {
+    http_parser_set_scan_mode(HTTP_PARSER_SCAN_AUTO);
+  }
+};
+
+TEST_P(ScanModeTest, TestLongFields) {
+  // Long enough that every field goes through the fast-forward path
+  string path("/a/rather/long/path/to/some/resource.html");
+  string query("first=value&second=another%20value&third=3");
+  string agent("Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+               "(KHTML, like Gecko) Chrome/60.0.3112.113 Safari/537.36");
+  string quoted("\"a quoted \\\"string\\\" that goes on for a while\"");
+  string req = "GET " + path + "?" + query + "#frag HTTP/1.1\r\n"
+    "Host: www.facebook.com\r\n"
+    "User-Agent: " + agent + "\r\n"
+    "X-Some-Unusually-Long-Header-Name: " + quoted + "\r\n"
+    "X-High-Bytes: caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9\t tab\r\n"
+    "\r\n";
+
+  // Parse it in one shot and split at every offset
+  for (size_t split = 0; split < req.size(); split++) {
+    HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+    HTTP1xCodecCallback callbacks;
+    codec.setCallback(&callbacks);
+    auto first = folly::IOBuf::copyBuffer(req.data(), split);
+    auto second = folly::IOBuf::copyBuffer(req.data() + split,
+                                           req.size() - split);
+    codec.onIngress(*first);
+    codec.onIngress(*second);
+    ASSERT_EQ(callbacks.headersComplete, 1);
+    ASSERT_EQ(callbacks.messageComplete, 1);
+    auto& msg = callbacks.msg_;
+    EXPECT_EQ(msg->getPath(), path);
+    EXPECT_EQ(msg->getQueryString(), query);
+    auto& headers = msg->getHeaders();
+    EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_USER_AGENT), agent);
+    EXPECT_EQ(headers.getSingleOrEmpty("X-Some-Unusually-Long-Header-Name"),
+              quoted);
+    EXPECT_EQ(headers.getSingleOrEmpty("X-High-Bytes"),
+              "caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9\t tab");
+  }
+}
+
+TEST_P(ScanModeTest, TestInvalidBytes) {
+  // A control character in a long value, and a separator in a long name
+  for (auto& req : {
+        string("GET / HTTP/1.1\r\nX-Value: 0123456789abcdef012345\x01"
+               "6789abcdef\r\n\r\n"),
+        string("GET / HTTP/1.1\r\nX-Header-Name-Goes-On-For-A-Bit(: "
+               "x\r\n\r\n")}) {
+    HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+    FakeHTTPCodecCallback callbacks;
+    codec.setCallback(&callbacks);
+    auto buf = folly::IOBuf::copyBuffer(req);
+    codec.onIngress(*buf);
+    EXPECT_EQ(callbacks.streamErrors, 1);
+    EXPECT_EQ(callbacks.headersComplete, 0);
+    EXPECT_EQ(callbacks.lastParseError->getHttpStatusCode(), 400);
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(
+  HTTP1xCodec,
+  ScanModeTest,
+  ::testing::Values(HTTP_PARSER_SCAN_SCALAR,
+                    HTTP_PARSER_SCAN_SSE42,
+                    HTTP_PARSER_SCAN_AVX2));
+
+TEST(HTTP1xCodecTest, TestZeroCopyHeaders) {
+  HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+  codec.setZeroCopyIngressHeaders(true);
+  HTTP1xCodecCallback callbacks;
+  codec.setCallback(&callbacks);
+  // X-Folded is unfolded by the parser, X-Split spans two onIngress() calls;
+  // both have to be copied
+  auto first = folly::IOBuf::copyBuffer(
+    "GET / HTTP/1.1\r\n"
+    "Host: www.facebook.com\r\n"
+    "X-Custom-Header: some value\r\n"
+    "X-Folded: folded\r\n value\r\n"
+    "X-Split: spl");
+  auto second = folly::IOBuf::copyBuffer(
+    "it value\r\n"
+    "Accept: */*\r\n"
+    "\r\n");
+  codec.onIngress(*first);
+  codec.onIngress(*second);
+  first.reset();
+  second.reset();
+  ASSERT_EQ(callbacks.headersComplete, 1);
+
+  auto& headers = callbacks.msg_->getHeaders();
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_HOST), "www.facebook.com");
+  EXPECT_EQ(headers.getSingleOrEmpty("X-Custom-Header"), "some value");
+  EXPECT_EQ(headers.getSingleOrEmpty("X-Folded"), "folded value");
+  EXPECT_EQ(headers.getSingleOrEmpty("X-Split"), "split value");
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_ACCEPT), "*/*");
+
+  // Forwarding the request writes the views out unchanged
+  HTTP1xCodec upstream(TransportDirection::UPSTREAM);
+  folly::IOBufQueue writeBuf(folly::IOBufQueue::cacheChainLength());
+  upstream.generateHeader(writeBuf, upstream.createStream(), *callbacks.msg_);
+  auto out = writeBuf.move()->moveToFbString();
+  EXPECT_NE(out.find("X-Custom-Header: some value\r\n"), std::string::npos);
+  EXPECT_NE(out.find("X-Split: split value\r\n"), std::string::npos);
+}
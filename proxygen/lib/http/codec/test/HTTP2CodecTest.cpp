@@ -62,6 +62,29 @@ TEST_F(HTTP2CodecTest, BasicHeader) {
   EXPECT_EQ("www.foo.com", headers.getSingleOrEmpty(HTTP_HEADER_HOST));
 }
 
+TEST_F(HTTP2CodecTest, ZeroCopyHeaders) {
+  downstreamCodec_.setZeroCopyIngressHeaders(true);
+  HTTPMessage req = getGetRequest("/guacamole");
+  req.getHeaders().add(HTTP_HEADER_USER_AGENT, "coolio");
+  // huffman would make this value longer, so it stays a plain literal
+  req.getHeaders().add("x-plain", "{}|~^`{}|~^`");
+  req.getHeaders().add(HTTP_HEADER_COOKIE, "a=1234567890; b=abcdefghij");
+  // the second request gets the values from the dynamic table
+  for (auto stream = 1; stream <= 3; stream += 2) {
+    callbacks_.reset();
+    upstreamCodec_.generateHeader(output_, stream, req, 0, true /* eom */);
+    // the ingress is released once parsed, the headers keep what they need
+    parse();
+    callbacks_.expectMessage(true, 4, "/guacamole");
+    const auto& headers = callbacks_.msg->getHeaders();
+    EXPECT_EQ("coolio", headers.getSingleOrEmpty(HTTP_HEADER_USER_AGENT));
+    EXPECT_EQ("{}|~^`{}|~^`", headers.getSingleOrEmpty("x-plain"));
+    EXPECT_EQ("a=1234567890; b=abcdefghij",
+              headers.getSingleOrEmpty(HTTP_HEADER_COOKIE));
+    EXPECT_EQ("www.foo.com", headers.getSingleOrEmpty(HTTP_HEADER_HOST));
+  }
+}
+
 TEST_F(HTTP2CodecTest, BadHeaders) {
   static const std::string v1("GET");
   static const std::string v2("/");
@@ -996,6 +1019,71 @@ TEST_F(HTTP2CodecTest, SettingsAck) {
   EXPECT_EQ(callbacks_.sessionErrors, 0);
 }
 
+TEST_F(HTTP2CodecTest, Hibernate) {
+  HTTPMessage req = getGetRequest("/guacamole");
+  req.getHeaders().add(HTTP_HEADER_USER_AGENT, "coolio");
+  upstreamCodec_.generateHeader(output_, 1, req, 0, true /* eom */);
+  parse();
+  callbacks_.expectMessage(true, 2, "/guacamole");
+
+  callbacks_.reset();
+  SetUpUpstreamTest();
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  resp.getHeaders().add(HTTP_HEADER_CONTENT_TYPE, "x-coolio");
+  downstreamCodec_.generateHeader(output_, 1, resp, 0, true /* eom */);
+  parseUpstream();
+  callbacks_.expectMessage(true, 2, 200);
+  upstreamCodec_.generateSettingsAck(output_);
+  parse();
+  auto info = downstreamCodec_.getHPACKTableInfo();
+  EXPECT_GT(info.egressHeadersStored_, 0);
+  EXPECT_GT(info.ingressHeadersStored_, 0);
+
+  // our encoder table is emptied right away, the decoder one once the peer
+  // acknowledges the new table size
+  callbacks_.reset();
+  EXPECT_GT(downstreamCodec_.hibernate(output_), 0);
+  EXPECT_EQ(downstreamCodec_.hibernate(output_), 0);
+  info = downstreamCodec_.getHPACKTableInfo();
+  EXPECT_EQ(info.egressHeadersStored_, 0);
+  EXPECT_GT(info.ingressHeadersStored_, 0);
+  parseUpstream();
+  EXPECT_EQ(callbacks_.settings, 1);
+  EXPECT_EQ(upstreamCodec_.getHPACKTableInfo().egressHeaderTableSize_, 0);
+  upstreamCodec_.generateSettingsAck(output_);
+  parse();
+  EXPECT_EQ(callbacks_.settingsAcks, 1);
+  info = downstreamCodec_.getHPACKTableInfo();
+  EXPECT_EQ(info.ingressHeaderTableSize_, 0);
+  EXPECT_EQ(info.ingressHeadersStored_, 0);
+
+  callbacks_.reset();
+  upstreamCodec_.generateHeader(output_, 3, req, 0, true /* eom */);
+  parse();
+  callbacks_.expectMessage(true, 2, "/guacamole");
+
+  // waking up restores the table sizes
+  EXPECT_GT(downstreamCodec_.wake(output_), 0);
+  EXPECT_EQ(downstreamCodec_.wake(output_), 0);
+  callbacks_.reset();
+  downstreamCodec_.generateHeader(output_, 3, resp, 0, true /* eom */);
+  parseUpstream();
+  callbacks_.expectMessage(true, 2, 200);
+  EXPECT_EQ(callbacks_.settings, 1);
+  EXPECT_EQ(upstreamCodec_.getHPACKTableInfo().egressHeaderTableSize_, 4096);
+  EXPECT_GT(downstreamCodec_.getHPACKTableInfo().egressHeadersStored_, 0);
+
+  callbacks_.reset();
+  upstreamCodec_.generateSettingsAck(output_);
+  upstreamCodec_.generateHeader(output_, 5, req, 0, true /* eom */);
+  parse();
+  callbacks_.expectMessage(true, 2, "/guacamole");
+  info = downstreamCodec_.getHPACKTableInfo();
+  EXPECT_EQ(info.ingressHeaderTableSize_, 4096);
+  EXPECT_GT(info.ingressHeadersStored_, 0);
+}
+
 TEST_F(HTTP2CodecTest, BadSettings) {
   auto settings = upstreamCodec_.getEgressSettings();
   settings->setSetting(SettingsId::INITIAL_WINDOW_SIZE, 0xffffffff);
@@ -1126,6 +1214,40 @@ TEST_F(HTTP2CodecTest, BadPriority) {
   EXPECT_EQ(callbacks_.sessionErrors, 0);
 }
 
+TEST_F(HTTP2CodecTest, PriorityUpdate) {
+  http2::writePriorityUpdate(output_, 5, "u=1, i");
+
+  EXPECT_TRUE(parse());
+  EXPECT_EQ(callbacks_.extensiblePriorityStream, 5);
+  EXPECT_EQ(callbacks_.extensiblePriority, RFC9218::Priority(1, true));
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+}
+
+TEST_F(HTTP2CodecTest, BadPriorityUpdate) {
+  http2::writePriorityUpdate(output_, 1, "u=1");
+
+  // hack ingress with a non zero stream ID
+  parse([&] (IOBuf* ingress) {
+      folly::io::RWPrivateCursor c(ingress);
+      c.skip(http2::kConnectionPreface.length() + 5);
+      c.writeBE<uint32_t>(1);
+    });
+
+  EXPECT_EQ(callbacks_.extensiblePriorityStream, 0);
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 1);
+}
+
+TEST_F(HTTP2CodecTest, PriorityUpdateToClient) {
+  SetUpUpstreamTest();
+  http2::writePriorityUpdate(output_, 1, "u=1");
+
+  parseUpstream();
+  EXPECT_EQ(callbacks_.extensiblePriorityStream, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 1);
+}
+
 class DummyQueue: public HTTPCodec::PriorityQueue {
  public:
   DummyQueue() {}
@@ -289,6 +289,21 @@ TEST_F(HTTP2FramerTest, Priority) {
   ASSERT_EQ(30, priority.weight);
 }
 
+TEST_F(HTTP2FramerTest, PriorityUpdate) {
+  writePriorityUpdate(queue_, 7, "u=2, i");
+
+  FrameHeader header;
+  uint32_t prioritizedStream = 0;
+  std::string priorityField;
+  parse(&parsePriorityUpdate, header, prioritizedStream, priorityField);
+
+  ASSERT_EQ(FrameType::PRIORITY_UPDATE, header.type);
+  ASSERT_EQ(0, header.stream);
+  ASSERT_EQ(0, header.flags);
+  ASSERT_EQ(7, prioritizedStream);
+  ASSERT_EQ("u=2, i", priorityField);
+}
+
 TEST_F(HTTP2FramerTest, HeadersWithPaddingAndPriority) {
   auto body = makeBuf(500);
   writeHeaders(queue_, body->clone(), 1, {{0, true, 12}}, 200,
@@ -142,6 +142,12 @@ class FakeHTTPCodecCallback : public HTTPCodec::Callback {
     priority = pri;
   }
 
+  void onExtensiblePriority(HTTPCodec::StreamID streamID,
+                            const RFC9218::Priority& pri) override {
+    extensiblePriorityStream = streamID;
+    extensiblePriority = pri;
+  }
+
   void onWindowUpdate(HTTPCodec::StreamID stream, uint32_t amount) override {
     windowUpdateCalls++;
     windowUpdates[stream].push_back(amount);
@@ -240,6 +246,8 @@ class FakeHTTPCodecCallback : public HTTPCodec::Callback {
     windowSize = 0;
     maxStreams = 0;
     priority = HTTPMessage::HTTPPriority(0, false, 0);
+    extensiblePriorityStream = 0;
+    extensiblePriority = RFC9218::Priority();
     windowUpdates.clear();
     data.move();
     msg.reset();
@@ -295,6 +303,8 @@ class FakeHTTPCodecCallback : public HTTPCodec::Callback {
   uint32_t windowSize{0};
   uint32_t maxStreams{0};
   HTTPMessage::HTTPPriority priority{0, false, 0};
+  HTTPCodec::StreamID extensiblePriorityStream{0};
+  RFC9218::Priority extensiblePriority;
   std::map<uint32_t, std::vector<uint32_t> > windowUpdates;
   folly::IOBufQueue data;
 
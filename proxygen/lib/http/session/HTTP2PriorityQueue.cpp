@@ -9,8 +9,14 @@
  */
 #include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
 
-using std::list;
-using std::unique_ptr;
+#include <algorithm>
+
+namespace {
+// Nodes in the first chunk of a pool, each further chunk doubles up to the
+// max
+const uint32_t kMinPoolChunk = 8;
+const uint32_t kMaxPoolChunk = 512;
+}
 
 namespace proxygen {
 
@@ -18,6 +24,31 @@ uint32_t HTTP2PriorityQueue::kMaxRebuilds_ = 3;
 std::chrono::milliseconds HTTP2PriorityQueue::kNodeLifetime_ =
   std::chrono::seconds(30);
 
+namespace {
+struct WeightCmp {
+  bool operator()(const HTTP2PriorityQueue::NextEgressResult::value_type& t1,
+                  const HTTP2PriorityQueue::NextEgressResult::value_type& t2) {
+    return t1.second > t2.second;
+  }
+};
+}
+
+void* HTTP2PriorityQueue::NodePool::allocate() {
+  if (!free_) {
+    uint32_t chunkSize = std::min(kMinPoolChunk << chunks_.size(),
+                                  kMaxPoolChunk);
+    chunks_.emplace_back(new Slot[chunkSize]);
+    Slot* chunk = chunks_.back().get();
+    for (uint32_t i = 0; i < chunkSize; i++) {
+      chunk[i].next = free_;
+      free_ = &chunk[i];
+    }
+  }
+  Slot* slot = free_;
+  free_ = slot->next;
+  return slot;
+}
+
 HTTP2PriorityQueue::Node::Node(HTTP2PriorityQueue& queue,
                                HTTP2PriorityQueue::Node* inParent,
                                HTTPCodec::StreamID id,
@@ -36,18 +67,21 @@ HTTP2PriorityQueue::Node::~Node() {
   if (!txn_) {
     queue_.numVirtualNodes_--;
   }
+  children_.clear_and_dispose([] (Node* child) {
+      child->queue_.destroyNode(child);
+    });
 }
 
 // Add a new node as a child of this node
-HTTP2PriorityQueue::Handle
-HTTP2PriorityQueue::Node::emplaceNode(
-  unique_ptr<HTTP2PriorityQueue::Node> node, bool exclusive) {
+HTTP2PriorityQueue::Node*
+HTTP2PriorityQueue::Node::emplaceNode(HTTP2PriorityQueue::Node* node,
+                                      bool exclusive) {
   CHECK(!node->isEnqueued());
-  list<unique_ptr<Node>> children;
+  ChildList children;
   CHECK_NE(id_, node->id_) << "Tried to create a loop in the tree";
   if (exclusive) {
     // this->children become new node's children
-    std::swap(children, children_);
+    children.swap(children_);
     totalChildWeight_ = 0;
     bool wasInEgressTree = inEgressTree();
     totalEnqueuedWeight_ = 0;
@@ -58,27 +92,27 @@ HTTP2PriorityQueue::Node::emplaceNode(
       propagatePendingEgressClear(this);
     }
   }
-  auto res = addChild(std::move(node));
-  res->addChildren(std::move(children));
+  auto res = addChild(node);
+  res->addChildren(children);
   return res;
 }
 
 void
-HTTP2PriorityQueue::Node::addChildren(list<unique_ptr<Node>>&& children) {
-  list<unique_ptr<Node>> emptyChilden;
+HTTP2PriorityQueue::Node::addChildren(ChildList& children) {
   uint64_t totalEnqueuedWeight = 0;
-  for (auto& child: children) {
+  while (!children.empty()) {
+    Node* child = &children.front();
+    children.pop_front();
     if (child->inEgressTree()) {
       totalEnqueuedWeight += child->weight_;
-      child->parent_->removeEnqueuedChild(child.get());
+      child->parent_->removeEnqueuedChild(child);
       CHECK(!child->enqueuedHook_.is_linked());
-      addEnqueuedChild(child.get());
+      addEnqueuedChild(child);
     } else {
       CHECK(!child->enqueuedHook_.is_linked());
     }
-    addChild(std::move(child));
+    addChild(child);
   }
-  std::swap(children, emptyChilden);
   if (totalEnqueuedWeight > 0) {
     if (!inEgressTree()) {
       propagatePendingEgressSignal(this);
@@ -87,33 +121,28 @@ HTTP2PriorityQueue::Node::addChildren(list<unique_ptr<Node>>&& children) {
   }
 }
 
-HTTP2PriorityQueue::Handle
-HTTP2PriorityQueue::Node::addChild(
-  unique_ptr<HTTP2PriorityQueue::Node> child) {
+HTTP2PriorityQueue::Node*
+HTTP2PriorityQueue::Node::addChild(HTTP2PriorityQueue::Node* child) {
   CHECK_NE(id_, child->id_) << "Tried to create a loop in the tree";
   child->parent_ = this;
   totalChildWeight_ += child->weight_;
-  Node* raw = child.get();
-  raw->self_ = children_.insert(children_.end(), std::move(child));
+  children_.push_back(*child);
   cancelTimeout();
-  return raw;
+  return child;
 }
 
-unique_ptr<HTTP2PriorityQueue::Node>
+void
 HTTP2PriorityQueue::Node::detachChild(Node* node) {
   CHECK(!node->isEnqueued());
   totalChildWeight_ -= node->weight_;
-  auto it = node->self_;
-  auto res = std::move(*node->self_);
-  children_.erase(it);
+  children_.erase(children_.iterator_to(*node));
   node->parent_ = nullptr;
   if (children_.empty() && !txn_ && !isPermanent_) {
     queue_.scheduleNodeExpiration(this);
   }
-  return res;
 }
 
-HTTP2PriorityQueue::Handle
+HTTP2PriorityQueue::Node*
 HTTP2PriorityQueue::Node::reparent(HTTP2PriorityQueue::Node* newParent,
                                    bool exclusive) {
   // Save enqueued_ and totalEnqueuedWeight_, clear them and restore
@@ -127,8 +156,8 @@ HTTP2PriorityQueue::Node::reparent(HTTP2PriorityQueue::Node* newParent,
     propagatePendingEgressClear(this);
   }
 
-  auto self = parent_->detachChild(this);
-  (void)newParent->emplaceNode(std::move(self), exclusive);
+  parent_->detachChild(this);
+  (void)newParent->emplaceNode(this, exclusive);
 
   // Restore state
   enqueued_ = enqueued;
@@ -235,9 +264,9 @@ HTTP2PriorityQueue::Node::removeFromTree() {
     // update child weights so they sum to (approximately) this node's weight.
     double r = double(weight_) / totalChildWeight_;
     for (auto& child: children_) {
-      uint64_t newWeight = std::max(uint64_t(child->weight_ * r), uint64_t(1));
+      uint64_t newWeight = std::max(uint64_t(child.weight_ * r), uint64_t(1));
       CHECK_LE(newWeight, 256);
-      child->updateWeight(uint8_t(newWeight) - 1);
+      child.updateWeight(uint8_t(newWeight) - 1);
     }
   }
 
@@ -253,8 +282,9 @@ HTTP2PriorityQueue::Node::removeFromTree() {
   }
 
   // move my children to my parent
-  parent_->addChildren(std::move(children_));
-  (void)parent_->detachChild(this);
+  parent_->addChildren(children_);
+  parent_->detachChild(this);
+  queue_.destroyNode(this);
 }
 
 bool
@@ -276,7 +306,7 @@ HTTP2PriorityQueue::Node::iterate(
     if (stop || stopFn()) {
       return true;
     }
-    stop = child->iterate(fn, stopFn, all);
+    stop = child.iterate(fn, stopFn, all);
   }
   return stop;
 }
@@ -306,7 +336,7 @@ HTTP2PriorityQueue::Node::visitBFS(
       }
     } else {
       for (auto& child: children_) {
-        pendingNodes.emplace_back(child->id_, child.get(), newRelWeight);
+        pendingNodes.emplace_back(child.id_, &child, newRelWeight);
       }
     }
   }
@@ -325,7 +355,7 @@ void
 HTTP2PriorityQueue::Node::updateEnqueuedWeight(bool activeNodes) {
   totalEnqueuedWeightCheck_ = totalChildWeight_;
   for (auto& child: children_) {
-    child->updateEnqueuedWeight(activeNodes);
+    child.updateEnqueuedWeight(activeNodes);
   }
   if (activeNodes) {
     if (totalEnqueuedWeightCheck_ == 0 && !isEnqueued()) {
@@ -344,7 +374,7 @@ void
 HTTP2PriorityQueue::Node::dropPriorityNodes() {
   for (auto it = children_.begin(); it != children_.end(); ) {
     auto& child = *it++;
-    child->dropPriorityNodes();
+    child.dropPriorityNodes();
   }
   if (!txn_ && !isPermanent_) {
     removeFromTree();
@@ -376,13 +406,15 @@ HTTP2PriorityQueue::Node::calculateDepth(bool includeVirtual) const {
 
 void
 HTTP2PriorityQueue::Node::flattenSubtree() {
-  std::list<std::unique_ptr<Node>> oldChildren_;
+  ChildList oldChildren;
   // Move the old children to a temporary list
-  std::swap(oldChildren_, children_);
+  oldChildren.swap(children_);
   // Reparent the children
-  for (auto& child : oldChildren_) {
+  while (!oldChildren.empty()) {
+    Node* child = &oldChildren.front();
+    oldChildren.pop_front();
     child->flattenSubtreeDFS(this);
-    addChildToNewSubtreeRoot(std::move(child), this);
+    addChildToNewSubtreeRoot(child, this);
   }
   // Update the weights
   totalEnqueuedWeight_ = 0;
@@ -390,33 +422,32 @@ HTTP2PriorityQueue::Node::flattenSubtree() {
   totalEnqueuedWeightCheck_ = 0;
 #endif
   totalChildWeight_ = 0;
-  std::for_each(
-    children_.begin(),
-    children_.end(),
-    [this](const std::unique_ptr<Node>& child) {
-      totalChildWeight_ += child->weight_;
-      if (child->enqueued_) {
-        totalEnqueuedWeight_ += child->weight_;
+  for (auto& child: children_) {
+    totalChildWeight_ += child.weight_;
+    if (child.enqueued_) {
+      totalEnqueuedWeight_ += child.weight_;
 #ifndef NDEBUG
-        totalEnqueuedWeightCheck_ += child->weight_;
+      totalEnqueuedWeightCheck_ += child.weight_;
 #endif
-      }
+      addEnqueuedChild(&child);
     }
-  );
+  }
 }
 
 void
 HTTP2PriorityQueue::Node::flattenSubtreeDFS(Node* subtreeRoot) {
-  for (auto& child : children_) {
+  while (!children_.empty()) {
+    Node* child = &children_.front();
+    children_.pop_front();
     child->flattenSubtreeDFS(subtreeRoot);
-    addChildToNewSubtreeRoot(std::move(child), subtreeRoot);
+    addChildToNewSubtreeRoot(child, subtreeRoot);
   }
 }
 
 void
-HTTP2PriorityQueue::Node::addChildToNewSubtreeRoot(std::unique_ptr<Node> child,
+HTTP2PriorityQueue::Node::addChildToNewSubtreeRoot(Node* child,
                                                    Node* subtreeRoot) {
-  child->children_.clear();
+  DCHECK(child->children_.empty());
   child->parent_ = subtreeRoot;
   child->weight_ = 16;
   child->totalChildWeight_ = 0;
@@ -424,9 +455,9 @@ HTTP2PriorityQueue::Node::addChildToNewSubtreeRoot(std::unique_ptr<Node> child,
 #ifndef NDEBUG
   child->totalEnqueuedWeightCheck_ = 0;
 #endif
-  Node* raw = child.get();
-  raw->self_ = subtreeRoot->children_.insert(subtreeRoot->children_.end(),
-                                             std::move(child));
+  // flattenSubtree links the enqueued ones again
+  child->enqueuedHook_.unlink();
+  subtreeRoot->children_.push_back(*child);
 }
 
 /// class HTTP2PriorityQueue
@@ -440,6 +471,17 @@ void HTTP2PriorityQueue::detachThreadLocals() {
   timeout_ = WheelTimerInstance();
 }
 
+HTTP2PriorityQueue::Node*
+HTTP2PriorityQueue::createNode(Node* parent, HTTPCodec::StreamID id,
+                               uint8_t weight, HTTPTransaction* txn) {
+  return new (nodePool_.allocate()) Node(*this, parent, id, weight, txn);
+}
+
+void HTTP2PriorityQueue::destroyNode(Node* node) {
+  node->~Node();
+  nodePool_.deallocate(node);
+}
+
 void
 HTTP2PriorityQueue::addOrUpdatePriorityNode(HTTPCodec::StreamID id,
                                             http2::PriorityUpdate pri) {
@@ -463,6 +505,7 @@ HTTP2PriorityQueue::addTransaction(HTTPCodec::StreamID id,
   CHECK_NE(id, 0);
   CHECK_NE(id, pri.streamDependency) << "Tried to create a loop in the tree";
   CHECK(!txn || !permanent);
+  egressCacheValid_ = false;
   Node *existingNode = find(id, depth);
   if (existingNode) {
     CHECK(!permanent);
@@ -495,13 +538,13 @@ HTTP2PriorityQueue::addTransaction(HTTPCodec::StreamID id,
   }
   VLOG(4) << "Adding id=" << id << " with parent=" << parent->getID() <<
     " and weight=" << ((uint16_t)pri.weight + 1);
-  auto node = std::make_unique<Node>(*this, parent, id, pri.weight, txn);
+  Node* node = createNode(parent, id, pri.weight, txn);
   if (permanent) {
     node->setPermanent();
   } else if (!txn) {
-    scheduleNodeExpiration(node.get());
+    scheduleNodeExpiration(node);
   }
-  auto result = parent->emplaceNode(std::move(node), pri.exclusive);
+  auto result = parent->emplaceNode(node, pri.exclusive);
   pendingWeightChange_ = true;
   return result;
 }
@@ -510,8 +553,9 @@ HTTP2PriorityQueue::Handle
 HTTP2PriorityQueue::updatePriority(HTTP2PriorityQueue::Handle handle,
                                    http2::PriorityUpdate pri,
                                    uint64_t* depth) {
-  Node* node = handle;
+  Node* node = static_cast<Node*>(handle);
   pendingWeightChange_ = true;
+  egressCacheValid_ = false;
   VLOG(4) << "Updating id=" << node->getID() << " with parent=" <<
     pri.streamDependency << " and weight=" << ((uint16_t)pri.weight + 1);
   node->updateWeight(pri.weight);
@@ -544,8 +588,9 @@ HTTP2PriorityQueue::updatePriority(HTTP2PriorityQueue::Handle handle,
 
 void
 HTTP2PriorityQueue::removeTransaction(HTTP2PriorityQueue::Handle handle) {
-  Node* node = handle;
+  Node* node = static_cast<Node*>(handle);
   pendingWeightChange_ = true;
+  egressCacheValid_ = false;
   // TODO: or require the node to do it?
   if (node->isEnqueued()) {
     clearPendingEgress(handle);
@@ -555,7 +600,7 @@ HTTP2PriorityQueue::removeTransaction(HTTP2PriorityQueue::Handle handle) {
     numVirtualNodes_++;
     scheduleNodeExpiration(node);
   } else {
-    VLOG(5) << "Deleting dangling node over max id=" << handle->getID();
+    VLOG(5) << "Deleting dangling node over max id=" << node->getID();
     node->removeFromTree();
   }
 }
@@ -563,9 +608,10 @@ HTTP2PriorityQueue::removeTransaction(HTTP2PriorityQueue::Handle handle) {
 void
 HTTP2PriorityQueue::signalPendingEgress(Handle h) {
   if (!h->isEnqueued()) {
-    h->signalPendingEgress();
+    static_cast<Node*>(h)->signalPendingEgress();
     activeCount_++;
     pendingWeightChange_ = true;
+    egressCacheValid_ = false;
   }
 }
 
@@ -573,9 +619,10 @@ void
 HTTP2PriorityQueue::clearPendingEgress(Handle h) {
   CHECK_GT(activeCount_, 0);
   // clear does a CHECK on h->isEnqueued()
-  h->clearPendingEgress();
+  static_cast<Node*>(h)->clearPendingEgress();
   activeCount_--;
   pendingWeightChange_ = true;
+  egressCacheValid_ = false;
 }
 
 void
@@ -590,18 +637,28 @@ HTTP2PriorityQueue::iterateBFS(
   updateEnqueuedWeight();
   while (!stop && !stopFn() && !pendingNodes.empty()) {
     CHECK(newPendingNodes.empty());
-    while (!stop && !pendingNodes.empty()) {
-      Node* node = findInternal(pendingNodes.front().id);
+    for (size_t i = 0; !stop && i < pendingNodes.size(); i++) {
+      Node* node = findInternal(pendingNodes[i].id);
       if (node) {
-        stop = node->visitBFS(pendingNodes.front().ratio, fn, all,
+        stop = node->visitBFS(pendingNodes[i].ratio, fn, all,
                               newPendingNodes, false /* all children */);
       }
-      pendingNodes.pop_front();
     }
+    pendingNodes.clear();
     std::swap(pendingNodes, newPendingNodes);
   }
 }
 
+void
+HTTP2PriorityQueue::iterateByPriority(
+  const std::function<bool(HTTPCodec::StreamID, HTTPTransaction*)>& fn,
+  const std::function<bool()>& stopFn) {
+  iterateBFS([&fn] (HTTP2PriorityQueue&, HTTPCodec::StreamID id,
+                    HTTPTransaction* txn, double) {
+               return fn(id, txn);
+             }, stopFn, true /* all */);
+}
+
 bool
 HTTP2PriorityQueue::nextEgressResult(HTTP2PriorityQueue& queue,
                                      HTTPCodec::StreamID,
@@ -613,48 +670,53 @@ HTTP2PriorityQueue::nextEgressResult(HTTP2PriorityQueue& queue,
 void
 HTTP2PriorityQueue::nextEgress(HTTP2PriorityQueue::NextEgressResult& result,
                                bool spdyMode) {
-  struct WeightCmp {
-    bool operator()(const std::pair<HTTPTransaction*, double>& t1,
-                    const std::pair<HTTPTransaction*, double>& t2) {
-      return t1.second > t2.second;
-    }
-  };
+  if (!egressCacheValid_ || egressCacheSpdy_ != spdyMode) {
+    computeNextEgress(spdyMode);
+  }
+  bool sort = !result.empty();
+  result.insert(result.end(), egressCache_.begin(), egressCache_.end());
+  if (sort) {
+    std::sort(result.begin(), result.end(), WeightCmp());
+  }
+}
 
-  result.reserve(activeCount_);
-  nextEgressResults_ = &result;
+void
+HTTP2PriorityQueue::computeNextEgress(bool spdyMode) {
+  egressCache_.clear();
+  egressCache_.reserve(activeCount_);
+  nextEgressResults_ = &egressCache_;
 
   updateEnqueuedWeight();
-  Node::PendingList pendingNodes;
-  Node::PendingList pendingNodesTmp;
-  pendingNodes.emplace_back(0, &root_, 1.0);
+  egressLevel_.clear();
+  egressNextLevel_.clear();
+  egressLevel_.emplace_back(0, &root_, 1.0);
   bool stop = false;
   do {
-    while (!stop && !pendingNodes.empty()) {
-      Node* node = pendingNodes.front().node;
-      if (node) {
-        stop = node->visitBFS(pendingNodes.front().ratio, nextEgressResult,
-                              false, pendingNodesTmp,
-                              true /* enqueued children */);
-      }
-      pendingNodes.pop_front();
+    for (size_t i = 0; !stop && i < egressLevel_.size(); i++) {
+      stop = egressLevel_[i].node->visitBFS(
+        egressLevel_[i].ratio, nextEgressResult, false, egressNextLevel_,
+        true /* enqueued children */);
     }
+    egressLevel_.clear();
     // In SPDY mode, we stop as soon one level of the tree produces results,
     // then normalize the ratios.
-    if (spdyMode && !result.empty() && !pendingNodesTmp.empty()) {
+    if (spdyMode && !egressCache_.empty() && !egressNextLevel_.empty()) {
       double totalRatio = 0;
-      for (auto &txnPair: result) {
+      for (auto &txnPair: egressCache_) {
         totalRatio += txnPair.second;
       }
       CHECK_GT(totalRatio, 0);
-      for (auto &txnPair: result) {
+      for (auto &txnPair: egressCache_) {
         txnPair.second = txnPair.second / totalRatio;
       }
       break;
     }
-    std::swap(pendingNodes, pendingNodesTmp);
-  } while (!stop && !pendingNodes.empty());
-  std::sort(result.begin(), result.end(), WeightCmp());
+    std::swap(egressLevel_, egressNextLevel_);
+  } while (!stop && !egressLevel_.empty());
+  std::sort(egressCache_.begin(), egressCache_.end(), WeightCmp());
   nextEgressResults_ = nullptr;
+  egressCacheValid_ = true;
+  egressCacheSpdy_ = spdyMode;
 }
 
 HTTP2PriorityQueue::Node*
@@ -687,6 +749,7 @@ HTTP2PriorityQueue::updateEnqueuedWeight() {
 void
 HTTP2PriorityQueue::rebuildTree() {
   CHECK_LE(rebuildCount_ + 1, kMaxRebuilds_);
+  egressCacheValid_ = false;
   root_.flattenSubtree();
   rebuildCount_++;
 }
@@ -13,17 +13,19 @@
 #include <folly/io/async/HHWheelTimer.h>
 #include <proxygen/lib/http/codec/HTTP2Framer.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
+#include <proxygen/lib/http/session/HTTPEgressQueue.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
 
-#include <list>
-#include <deque>
+#include <new>
+#include <type_traits>
+#include <vector>
 #include <boost/intrusive/unordered_set.hpp>
 
 namespace proxygen {
 
 class HTTPTransaction;
 
-class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
+class HTTP2PriorityQueue : public HTTPEgressQueue {
 
  private:
   class Node;
@@ -34,8 +36,6 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
 
  public:
 
-  typedef Node* Handle;
-
   HTTP2PriorityQueue()
       : nodes_(NodeMap::bucket_traits(nodeBuckets_, kNumBuckets)) {
     root_.setPermanent();
@@ -47,19 +47,19 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
     root_.setPermanent();
   }
 
-  void attachThreadLocals(const WheelTimerInstance& timeout);
+  void attachThreadLocals(const WheelTimerInstance& timeout) override;
 
-  void detachThreadLocals();
+  void detachThreadLocals() override;
 
   void setMaxVirtualNodes(uint32_t maxVirtualNodes) {
     maxVirtualNodes_ = maxVirtualNodes;
   }
 
   // Notify the queue when a transaction has egress
-  void signalPendingEgress(Handle h);
+  void signalPendingEgress(Handle h) override;
 
   // Notify the queue when a transaction no longer has egress
-  void clearPendingEgress(Handle h);
+  void clearPendingEgress(Handle h) override;
 
   void addPriorityNode(HTTPCodec::StreamID id,
                        HTTPCodec::StreamID parent) override{
@@ -67,33 +67,35 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
   }
 
   void addOrUpdatePriorityNode(HTTPCodec::StreamID id,
-                               http2::PriorityUpdate pri);
+                               http2::PriorityUpdate pri) override;
 
-  void dropPriorityNodes() {
+  void dropPriorityNodes() override {
+    pendingWeightChange_ = true;
+    egressCacheValid_ = false;
     root_.dropPriorityNodes();
   }
 
   // adds new transaction (possibly nullptr) to the priority tree
   Handle addTransaction(HTTPCodec::StreamID id, http2::PriorityUpdate pri,
                         HTTPTransaction *txn, bool permanent = false,
-                        uint64_t* depth = nullptr);
+                        uint64_t* depth = nullptr) override;
 
   // update the priority of an existing node
   Handle updatePriority(
       Handle handle,
       http2::PriorityUpdate pri,
-      uint64_t* depth = nullptr);
+      uint64_t* depth = nullptr) override;
 
   // Remove the transaction from the priority tree
-  void removeTransaction(Handle handle);
+  void removeTransaction(Handle handle) override;
 
   // Returns true if there are no transaction with pending egress
-  bool empty() const {
+  bool empty() const override {
     return activeCount_ == 0;
   }
 
   // The number with pending egress
-  uint64_t numPendingEgress() const {
+  uint64_t numPendingEgress() const override {
     return activeCount_;
   }
 
@@ -114,9 +116,18 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
                                            HTTPTransaction *, double)>& fn,
                   const std::function<bool()>& stopFn, bool all);
 
-  typedef std::vector<std::pair<HTTPTransaction*, double>> NextEgressResult;
+  // Visits the tree breadth first
+  void iterateByPriority(
+    const std::function<bool(HTTPCodec::StreamID, HTTPTransaction*)>& fn,
+    const std::function<bool()>& stopFn) override;
 
-  void nextEgress(NextEgressResult& result, bool spdyMode = false);
+  /**
+   * Append the transactions to egress next and their share of the egress,
+   * highest first. The answer is kept until the tree or the set of
+   * transactions with pending egress changes, so calling this again while
+   * writing out the same streams doesn't walk the tree.
+   */
+  void nextEgress(NextEgressResult& result, bool spdyMode = false) override;
 
   static void setNodeLifetime(std::chrono::milliseconds lifetime) {
     kNodeLifetime_ = lifetime;
@@ -132,9 +143,9 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
 
  private:
   // Find the node in priority tree
-  Handle find(HTTPCodec::StreamID id, uint64_t* depth = nullptr);
+  Node* find(HTTPCodec::StreamID id, uint64_t* depth = nullptr);
 
-  Handle findInternal(HTTPCodec::StreamID id) {
+  Node* findInternal(HTTPCodec::StreamID id) {
     if (id == 0) {
       return &root_;
     }
@@ -157,13 +168,25 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
                                HTTPCodec::StreamID id, HTTPTransaction* txn,
                                double r);
 
+  void computeNextEgress(bool spdyMode);
+
   void updateEnqueuedWeight();
 
+  Node* createNode(Node* parent, HTTPCodec::StreamID id, uint8_t weight,
+                   HTTPTransaction* txn);
+
+  void destroyNode(Node* node);
+
  private:
   typedef boost::intrusive::link_mode<boost::intrusive::auto_unlink> link_mode;
 
   class Node : public folly::HHWheelTimer::Callback,
+               public HTTPEgressQueue::Entry,
                public boost::intrusive::unordered_set_base_hook<link_mode> {
+    // A node owns its children, they live in the node pool of the queue
+    folly::IntrusiveListHook childHook_;
+    using ChildList = folly::IntrusiveList<Node, &Node::childHook_>;
+
    public:
     Node(HTTP2PriorityQueue& queue, Node* inParent, HTTPCodec::StreamID id,
          uint8_t weight, HTTPTransaction *txn);
@@ -223,7 +246,7 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
     }
 
     // Add a new node as a child of this node
-    Handle emplaceNode(std::unique_ptr<Node> node, bool exclusive);
+    Node* emplaceNode(Node* node, bool exclusive);
 
     // Removes the node from the tree
     void removeFromTree();
@@ -239,13 +262,13 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
     // Set a new weight for this node
     void updateWeight(uint8_t weight);
 
-    Handle reparent(Node* newParent, bool exclusive);
+    Node* reparent(Node* newParent, bool exclusive);
 
     // Returns true if this is a descendant of node
     bool isDescendantOf(Node *node) const;
 
     // True if this Node is in the egress queue
-    bool isEnqueued() const {
+    bool isEnqueued() const override {
       return (txn_ != nullptr && enqueued_);
     }
 
@@ -298,7 +321,7 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
           id(i), node(n), ratio(r) {}
     };
 
-    typedef std::deque<PendingNode> PendingList;
+    typedef std::vector<PendingNode> PendingList;
     bool visitBFS(double relativeParentWeight,
                   const std::function<bool(HTTP2PriorityQueue& queue,
                                            HTTPCodec::StreamID,
@@ -312,20 +335,20 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
 
     void convertVirtualNode(HTTPTransaction* txn);
 
-    uint64_t calculateDepth(bool includeVirtual = true) const;
+    uint64_t calculateDepth(bool includeVirtual = true) const override;
 
     // Internal error recovery
     void flattenSubtree();
     void flattenSubtreeDFS(Node* subtreeRoot);
-    static void addChildToNewSubtreeRoot(std::unique_ptr<Node> child,
-                                         Node* subtreeRoot);
+    static void addChildToNewSubtreeRoot(Node* child, Node* subtreeRoot);
 
    private:
-    Handle addChild(std::unique_ptr<Node> child);
+    Node* addChild(Node* child);
 
-    void addChildren(std::list<std::unique_ptr<Node>>&& children);
+    // Moves all the nodes of children under this node
+    void addChildren(ChildList& children);
 
-    std::unique_ptr<Node> detachChild(Node* node);
+    void detachChild(Node* node);
 
     void addEnqueuedChild(HTTP2PriorityQueue::Node* node);
 
@@ -338,6 +361,8 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
     void timeoutExpired() noexcept override {
       VLOG(5) << "Node=" << id_ << " expired";
       CHECK(txn_ == nullptr);
+      queue_.pendingWeightChange_ = true;
+      queue_.egressCacheValid_ = false;
       removeFromTree();
     }
 
@@ -359,8 +384,7 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
 #endif
     uint64_t totalEnqueuedWeight_{0};
     uint64_t totalChildWeight_{0};
-    std::list<std::unique_ptr<Node>> children_;
-    std::list<std::unique_ptr<Node>>::iterator self_;
+    ChildList children_;
     // enqueuedChildren_ includes all children that are themselves enqueued_
     // or have enqueued descendants. Therefore, enqueuedChildren_ may contain
     // direct children that have enqueued_ == false
@@ -368,8 +392,35 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
     folly::IntrusiveList<Node, &Node::enqueuedHook_> enqueuedChildren_;
   };
 
+  /**
+   * Fixed size slots for the nodes, handed out from a free list and grown a
+   * chunk at a time, so a connection stops allocating for its priority tree
+   * once it reached its largest size.
+   */
+  class NodePool {
+   public:
+    void* allocate();
+
+    void deallocate(void* node) {
+      auto slot = static_cast<Slot*>(node);
+      slot->next = free_;
+      free_ = slot;
+    }
+
+   private:
+    union Slot {
+      Slot* next;
+      typename std::aligned_storage<sizeof(Node), alignof(Node)>::type node;
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> chunks_;
+    Slot* free_{nullptr};
+  };
+
   typename NodeMap::bucket_type nodeBuckets_[kNumBuckets];
   NodeMap nodes_;
+  // declared ahead of root_, which returns its subtree to the pool
+  NodePool nodePool_;
   Node root_{*this, nullptr, 0, 1, nullptr};
   uint32_t rebuildCount_{0};
   static uint32_t kMaxRebuilds_;
@@ -380,6 +431,13 @@ class HTTP2PriorityQueue : public HTTPCodec::PriorityQueue {
   WheelTimerInstance timeout_;
 
   NextEgressResult* nextEgressResults_{nullptr};
+  // result of the last nextEgress, valid until the next change to the tree
+  NextEgressResult egressCache_;
+  bool egressCacheValid_{false};
+  bool egressCacheSpdy_{false};
+  // levels of the egress tree, reused across calls
+  Node::PendingList egressLevel_;
+  Node::PendingList egressNextLevel_;
   static std::chrono::milliseconds kNodeLifetime_;
 };
 
@@ -36,10 +36,16 @@ std::unique_ptr<HTTPCodec> HTTPDefaultSessionCodecFactory::getCodec(
                                          alwaysUseSPDYVersion_.value(),
                                          accConfig_.spdyCompressionLevel);
   } else if (!isSSL_ && alwaysUseHTTP2_) {
-    return std::make_unique<HTTP2Codec>(direction);
+    auto codec = std::make_unique<HTTP2Codec>(direction);
+    codec->setZeroCopyIngressHeaders(accConfig_.zeroCopyIngressHeaders);
+    if (accConfig_.internHeaderValues) {
+      codec->setHeaderInternPool(&HPACKInternPool::get());
+    }
+    return std::move(codec);
   } else if (nextProtocol.empty() ||
              HTTP1xCodec::supportsNextProtocol(nextProtocol)) {
     auto codec = std::make_unique<HTTP1xCodec>(direction);
+    codec->setZeroCopyIngressHeaders(accConfig_.zeroCopyIngressHeaders);
     if (!isSSL_) {
       codec->setAllowedUpgradeProtocols(
         accConfig_.allowedPlaintextUpgradeProtocols);
@@ -51,7 +57,12 @@ std::unique_ptr<HTTPCodec> HTTPDefaultSessionCodecFactory::getCodec(
   } else if (nextProtocol == http2::kProtocolString ||
              nextProtocol == http2::kProtocolDraftString ||
              nextProtocol == http2::kProtocolExperimentalString) {
-    return std::make_unique<HTTP2Codec>(direction);
+    auto codec = std::make_unique<HTTP2Codec>(direction);
+    codec->setZeroCopyIngressHeaders(accConfig_.zeroCopyIngressHeaders);
+    if (accConfig_.internHeaderValues) {
+      codec->setHeaderInternPool(&HPACKInternPool::get());
+    }
+    return std::move(codec);
   } else {
     VLOG(2) << "Client requested unrecognized next protocol " << nextProtocol;
   }
@@ -23,7 +23,7 @@ HTTPDownstreamSession::startNow() {
   // Create virtual nodes should happen before startNow since ingress may come
   // before we can finish startNow. Since maxLevel = 0, this is a no-op unless
   // SPDY is used. And no frame will be sent to peer, so ignore returned value.
-  codec_->addPriorityNodes(txnEgressQueue_, writeBuf_, 0);
+  codec_->addPriorityNodes(*txnEgressQueue_, writeBuf_, 0);
   HTTPSession::startNow();
 }
 
@@ -91,7 +91,7 @@ HTTPDownstreamSession::onHeadersSent(const HTTPMessage& headers,
 
 bool HTTPDownstreamSession::allTransactionsStarted() const {
   for (const auto& txn: transactions_) {
-    if (txn.second.isPushed() && !txn.second.isEgressStarted()) {
+    if (txn.second->isPushed() && !txn.second->isEgressStarted()) {
       return false;
     }
   }
@@ -134,7 +134,7 @@ HTTPDownstreamSession::onNativeProtocolUpgrade(
     bool ret = HTTPSession::onNativeProtocolUpgradeImpl(
       streamID, std::move(codec), protocolString);
     if (ret) {
-      codec_->addPriorityNodes(txnEgressQueue_, writeBuf_, 0);
+      codec_->addPriorityNodes(*txnEgressQueue_, writeBuf_, 0);
     }
     return ret;
   } else {
@@ -0,0 +1,111 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/http/RFC9218.h>
+#include <proxygen/lib/http/codec/HTTP2Framer.h>
+#include <proxygen/lib/http/codec/HTTPCodec.h>
+#include <proxygen/lib/utils/WheelTimerInstance.h>
+
+#include <functional>
+#include <vector>
+
+namespace proxygen {
+
+class HTTPTransaction;
+
+/**
+ * Decides in which order, and in which proportions, the transactions of a
+ * session with pending egress get to write. A session picks one
+ * implementation for the whole connection:
+ *
+ * HTTP2PriorityQueue follows the dependency tree of RFC 7540.
+ * HTTPExtensiblePriorityQueue follows the urgency and incremental
+ * parameters of RFC 9218, and ignores the dependency tree.
+ */
+class HTTPEgressQueue : public HTTPCodec::PriorityQueue {
+ public:
+  /**
+   * The queue entry of a transaction.
+   */
+  class Entry {
+   public:
+    virtual ~Entry() {}
+
+    // True if the transaction is waiting to egress
+    virtual bool isEnqueued() const = 0;
+
+    // Depth of the entry in the priority tree, the root being 0
+    virtual uint64_t calculateDepth(bool includeVirtual = true) const = 0;
+  };
+
+  typedef Entry* Handle;
+
+  typedef std::vector<std::pair<HTTPTransaction*, double>> NextEgressResult;
+
+  ~HTTPEgressQueue() override {}
+
+  virtual void attachThreadLocals(const WheelTimerInstance& timeout) = 0;
+
+  virtual void detachThreadLocals() = 0;
+
+  // Notify the queue when a transaction has egress
+  virtual void signalPendingEgress(Handle h) = 0;
+
+  // Notify the queue when a transaction no longer has egress
+  virtual void clearPendingEgress(Handle h) = 0;
+
+  virtual void addOrUpdatePriorityNode(HTTPCodec::StreamID id,
+                                       http2::PriorityUpdate pri) = 0;
+
+  virtual void dropPriorityNodes() = 0;
+
+  // adds new transaction (possibly nullptr) to the queue
+  virtual Handle addTransaction(HTTPCodec::StreamID id,
+                                http2::PriorityUpdate pri,
+                                HTTPTransaction *txn,
+                                bool permanent = false,
+                                uint64_t* depth = nullptr) = 0;
+
+  // update the RFC 7540 priority of an existing transaction
+  virtual Handle updatePriority(Handle handle,
+                                http2::PriorityUpdate pri,
+                                uint64_t* depth = nullptr) = 0;
+
+  // update the RFC 9218 priority of an existing transaction
+  virtual void updateExtensiblePriority(Handle /* handle */,
+                                        const RFC9218::Priority& /* pri */) {}
+
+  // Remove the transaction from the queue
+  virtual void removeTransaction(Handle handle) = 0;
+
+  // Returns true if there are no transaction with pending egress
+  virtual bool empty() const = 0;
+
+  // The number with pending egress
+  virtual uint64_t numPendingEgress() const = 0;
+
+  /**
+   * Append the transactions to egress next and their share of the egress,
+   * highest first.
+   */
+  virtual void nextEgress(NextEgressResult& result, bool spdyMode = false) = 0;
+
+  /**
+   * Visit every transaction, the ones to egress first first, until fn
+   * returns true. stopFn is evaluated between groups of transactions of
+   * equal priority.
+   */
+  virtual void iterateByPriority(
+    const std::function<bool(HTTPCodec::StreamID, HTTPTransaction*)>& fn,
+    const std::function<bool()>& stopFn) = 0;
+};
+
+}
@@ -0,0 +1,155 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/HTTPExtensiblePriorityQueue.h>
+
+#include <algorithm>
+#include <glog/logging.h>
+#include <tuple>
+
+namespace proxygen {
+
+const size_t HTTPExtensiblePriorityQueue::kNumUrgencies;
+
+HTTPEgressQueue::Handle
+HTTPExtensiblePriorityQueue::addTransaction(HTTPCodec::StreamID id,
+                                            http2::PriorityUpdate,
+                                            HTTPTransaction *txn,
+                                            bool permanent,
+                                            uint64_t* depth) {
+  CHECK_NE(id, 0);
+  CHECK(txn && !permanent);
+  auto res = entries_.emplace(std::piecewise_construct,
+                              std::forward_as_tuple(id),
+                              std::forward_as_tuple(id, txn));
+  CHECK(res.second) << "Duplicate txn=" << id;
+  if (depth) {
+    *depth = 1;
+  }
+  return &res.first->second;
+}
+
+HTTPEgressQueue::Handle
+HTTPExtensiblePriorityQueue::updatePriority(Handle handle,
+                                            http2::PriorityUpdate,
+                                            uint64_t* depth) {
+  if (depth) {
+    *depth = 1;
+  }
+  return handle;
+}
+
+void
+HTTPExtensiblePriorityQueue::updateExtensiblePriority(
+    Handle handle, const RFC9218::Priority& pri) {
+  Entry* entry = static_cast<Entry*>(handle);
+  VLOG(4) << "Updating id=" << entry->id << " with urgency="
+          << (uint16_t)pri.urgency << " incremental=" << pri.incremental;
+  CHECK_LE(pri.urgency, RFC9218::Priority::kMaxUrgency);
+  if (entry->enqueued) {
+    dequeue(entry);
+    entry->priority = pri;
+    enqueue(entry);
+  } else {
+    entry->priority = pri;
+  }
+}
+
+void
+HTTPExtensiblePriorityQueue::removeTransaction(Handle handle) {
+  Entry* entry = static_cast<Entry*>(handle);
+  if (entry->enqueued) {
+    clearPendingEgress(handle);
+  }
+  entries_.erase(entry->id);
+}
+
+void
+HTTPExtensiblePriorityQueue::signalPendingEgress(Handle h) {
+  Entry* entry = static_cast<Entry*>(h);
+  if (!entry->enqueued) {
+    enqueue(entry);
+    activeCount_++;
+  }
+}
+
+void
+HTTPExtensiblePriorityQueue::clearPendingEgress(Handle h) {
+  Entry* entry = static_cast<Entry*>(h);
+  CHECK(entry->enqueued);
+  CHECK_GT(activeCount_, 0);
+  dequeue(entry);
+  activeCount_--;
+}
+
+void
+HTTPExtensiblePriorityQueue::enqueue(Entry* entry) {
+  auto& bucket = buckets_[entry->priority.urgency];
+  if (entry->priority.incremental) {
+    // joins the end of the round
+    bucket.incremental.push_back(*entry);
+  } else {
+    bucket.sequential.insert(*entry);
+  }
+  entry->enqueued = true;
+}
+
+void
+HTTPExtensiblePriorityQueue::dequeue(Entry* entry) {
+  auto& bucket = buckets_[entry->priority.urgency];
+  if (entry->priority.incremental) {
+    bucket.incremental.erase(bucket.incremental.iterator_to(*entry));
+  } else {
+    bucket.sequential.erase(bucket.sequential.iterator_to(*entry));
+  }
+  entry->enqueued = false;
+}
+
+void
+HTTPExtensiblePriorityQueue::nextEgress(NextEgressResult& result, bool) {
+  for (auto& bucket: buckets_) {
+    if (!bucket.sequential.empty()) {
+      result.emplace_back(bucket.sequential.begin()->txn, 1.0);
+      return;
+    }
+    if (!bucket.incremental.empty()) {
+      // rotate, so the next call picks the following transaction
+      Entry& entry = bucket.incremental.front();
+      bucket.incremental.pop_front();
+      bucket.incremental.push_back(entry);
+      result.emplace_back(entry.txn, 1.0);
+      return;
+    }
+  }
+}
+
+void
+HTTPExtensiblePriorityQueue::iterateByPriority(
+  const std::function<bool(HTTPCodec::StreamID, HTTPTransaction*)>& fn,
+  const std::function<bool()>& stopFn) {
+  // fn may add or remove transactions, visit a snapshot by ID
+  std::vector<std::pair<uint8_t, HTTPCodec::StreamID>> order;
+  order.reserve(entries_.size());
+  for (const auto& it: entries_) {
+    order.emplace_back(it.second.priority.urgency, it.first);
+  }
+  std::sort(order.begin(), order.end());
+
+  for (size_t i = 0; i < order.size(); i++) {
+    if ((i == 0 || order[i].first != order[i - 1].first) && stopFn()) {
+      return;
+    }
+    auto it = entries_.find(order[i].second);
+    if (it != entries_.end() && fn(it->first, it->second.txn)) {
+      return;
+    }
+  }
+}
+
+}
@@ -0,0 +1,136 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/IntrusiveList.h>
+#include <proxygen/lib/http/RFC9218.h>
+#include <proxygen/lib/http/session/HTTPEgressQueue.h>
+
+#include <array>
+#include <boost/intrusive/set.hpp>
+#include <unordered_map>
+
+namespace proxygen {
+
+/**
+ * Egress queue scheduling transactions by their RFC 9218 priority: one
+ * bucket per urgency, the most urgent non empty bucket gets the whole
+ * connection. Dependencies and weights of RFC 7540 are ignored.
+ */
+class HTTPExtensiblePriorityQueue : public HTTPEgressQueue {
+ public:
+  static const size_t kNumUrgencies = RFC9218::Priority::kMaxUrgency + 1;
+
+  // Nothing expires, no timer is needed
+  void attachThreadLocals(const WheelTimerInstance&) override {}
+
+  void detachThreadLocals() override {}
+
+  void signalPendingEgress(Handle h) override;
+
+  void clearPendingEgress(Handle h) override;
+
+  // RFC 7540 priority nodes have no place in the queue
+  void addPriorityNode(HTTPCodec::StreamID,
+                       HTTPCodec::StreamID) override {}
+
+  void addOrUpdatePriorityNode(HTTPCodec::StreamID,
+                               http2::PriorityUpdate) override {}
+
+  void dropPriorityNodes() override {}
+
+  // new transactions start with the default priority of RFC 9218
+  Handle addTransaction(HTTPCodec::StreamID id, http2::PriorityUpdate pri,
+                        HTTPTransaction *txn, bool permanent = false,
+                        uint64_t* depth = nullptr) override;
+
+  // leaves the transaction where it is
+  Handle updatePriority(Handle handle,
+                        http2::PriorityUpdate pri,
+                        uint64_t* depth = nullptr) override;
+
+  void updateExtensiblePriority(Handle handle,
+                                const RFC9218::Priority& pri) override;
+
+  void removeTransaction(Handle handle) override;
+
+  bool empty() const override {
+    return activeCount_ == 0;
+  }
+
+  uint64_t numPendingEgress() const override {
+    return activeCount_;
+  }
+
+  /**
+   * Append the one transaction to egress next. Within the most urgent
+   * bucket, the non incremental transaction with the lowest stream ID is
+   * sent first and alone, as a client can only use those responses once
+   * complete. Otherwise the incremental transactions take turns, a
+   * different one on each call.
+   */
+  void nextEgress(NextEgressResult& result, bool spdyMode = false) override;
+
+  void iterateByPriority(
+    const std::function<bool(HTTPCodec::StreamID, HTTPTransaction*)>& fn,
+    const std::function<bool()>& stopFn) override;
+
+ private:
+  class Entry : public HTTPEgressQueue::Entry {
+   public:
+    Entry(HTTPCodec::StreamID inId, HTTPTransaction* inTxn)
+        : id(inId), txn(inTxn) {}
+
+    bool isEnqueued() const override {
+      return enqueued;
+    }
+
+    // every transaction depends on the connection
+    uint64_t calculateDepth(bool /* includeVirtual */) const override {
+      return 1;
+    }
+
+    struct IdLess {
+      bool operator()(const Entry& lhs, const Entry& rhs) const {
+        return lhs.id < rhs.id;
+      }
+    };
+
+    HTTPCodec::StreamID id;
+    HTTPTransaction* txn;
+    RFC9218::Priority priority;
+    bool enqueued{false};
+    // links the entry into its bucket while enqueued
+    boost::intrusive::set_member_hook<> sequentialHook;
+    folly::IntrusiveListHook incrementalHook;
+  };
+
+  using SequentialSet = boost::intrusive::set<
+    Entry,
+    boost::intrusive::member_hook<Entry, boost::intrusive::set_member_hook<>,
+                                  &Entry::sequentialHook>,
+    boost::intrusive::compare<Entry::IdLess>>;
+
+  struct Bucket {
+    SequentialSet sequential;
+    folly::IntrusiveList<Entry, &Entry::incrementalHook> incremental;
+  };
+
+  void enqueue(Entry* entry);
+
+  void dequeue(Entry* entry);
+
+  std::unordered_map<HTTPCodec::StreamID, Entry> entries_;
+  // declared after entries_, so they are unlinked before being destroyed
+  std::array<Bucket, kNumUrgencies> buckets_;
+  uint64_t activeCount_{0};
+};
+
+}
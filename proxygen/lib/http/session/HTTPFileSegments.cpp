@@ -0,0 +1,186 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/HTTPFileSegments.h>
+
+#include <folly/FileUtil.h>
+#include <folly/io/IOBufQueue.h>
+#include <glog/logging.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+using folly::IOBuf;
+using std::unique_ptr;
+
+namespace proxygen {
+
+const size_t HTTPFileSegments::kMaxPlaceholderSize;
+const size_t HTTPFileSegments::kReadChunkSize;
+
+namespace {
+
+// Never written nor read, it stays on the zero page
+uint8_t s_placeholder[HTTPFileSegments::kMaxPlaceholderSize];
+
+}
+
+unique_ptr<IOBuf> HTTPFileSegments::makePlaceholder(size_t length) {
+  folly::IOBufQueue queue;
+  while (length > 0) {
+    size_t len = std::min(length, kMaxPlaceholderSize);
+    queue.append(IOBuf::wrapBuffer(s_placeholder, len));
+    length -= len;
+  }
+  return queue.move();
+}
+
+bool HTTPFileSegments::isPlaceholder(const IOBuf& buf) {
+  return buf.data() >= s_placeholder &&
+    buf.data() < s_placeholder + kMaxPlaceholderSize;
+}
+
+size_t HTTPFileSegments::countPlaceholderBytes(const IOBuf& chain) {
+  size_t count = 0;
+  const IOBuf* cur = &chain;
+  do {
+    if (isPlaceholder(*cur)) {
+      count += cur->length();
+    }
+    cur = cur->next();
+  } while (cur != &chain);
+  return count;
+}
+
+size_t HTTPFileSegments::getRunLength(const IOBuf& chain,
+                                      bool* placeholders) {
+  *placeholders = isPlaceholder(chain);
+  size_t length = 0;
+  const IOBuf* cur = &chain;
+  do {
+    length += cur->length();
+    cur = cur->next();
+  } while (cur != &chain &&
+           (cur->length() == 0 || isPlaceholder(*cur) == *placeholders));
+  return length;
+}
+
+unique_ptr<IOBuf> HTTPFileSegments::read(int fd, off_t offset,
+                                         size_t length) {
+  auto buf = IOBuf::create(length);
+  auto rc = folly::preadFull(fd, buf->writableData(), length, offset);
+  if (rc < 0 || size_t(rc) != length) {
+    VLOG(4) << "short read of file body fd=" << fd << " rc=" << rc
+            << " errno=" << errno;
+    return nullptr;
+  }
+  buf->append(length);
+  return buf;
+}
+
+void HTTPFileSegments::append(std::shared_ptr<folly::File> file,
+                              off_t offset, size_t length) {
+  if (length == 0) {
+    return;
+  }
+  segments_.push_back({std::move(file), offset, length});
+  length_ += length;
+}
+
+void HTTPFileSegments::clear() {
+  segments_.clear();
+  length_ = 0;
+}
+
+void HTTPFileSegments::moveTo(HTTPFileSegments& other, size_t length) {
+  CHECK_LE(length, length_);
+  while (length > 0) {
+    Segment& seg = segments_.front();
+    size_t len = std::min(length, seg.length);
+    other.append(seg.file, seg.offset, len);
+    skip(len);
+    length -= len;
+  }
+}
+
+unique_ptr<IOBuf> HTTPFileSegments::fill(unique_ptr<IOBuf> chain) {
+  folly::IOBufQueue queue;
+  while (chain) {
+    auto next = chain->pop();
+    if (isPlaceholder(*chain) && chain->length() > 0) {
+      size_t length = chain->length();
+      CHECK_LE(length, length_);
+      while (length > 0) {
+        const Segment& seg = segments_.front();
+        size_t len = std::min(length, seg.length);
+        auto data = read(seg.file->fd(), seg.offset, len);
+        if (!data) {
+          return nullptr;
+        }
+        queue.append(std::move(data));
+        skip(len);
+        length -= len;
+      }
+    } else {
+      queue.append(std::move(chain));
+    }
+    chain = std::move(next);
+  }
+  return queue.move();
+}
+
+ssize_t HTTPFileSegments::sendTo(int fd, size_t length) {
+  CHECK_LE(length, length_);
+  ssize_t sent = 0;
+#ifdef __linux__
+  while (length > 0) {
+    const Segment& seg = segments_.front();
+    size_t len = std::min(length, seg.length);
+    off_t offset = seg.offset;
+    ssize_t rc = ::sendfile(fd, seg.file->fd(), &offset, len);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    if (rc <= 0) {
+      // an error, or a file shorter than announced
+      VLOG(4) << "sendfile failed fd=" << fd << " rc=" << rc
+              << " errno=" << errno;
+      return sent > 0 ? sent : -1;
+    }
+    skip(rc);
+    sent += rc;
+    length -= rc;
+    if (size_t(rc) < len) {
+      break;
+    }
+  }
+#endif
+  return sent;
+}
+
+void HTTPFileSegments::skip(size_t length) {
+  CHECK_LE(length, length_);
+  length_ -= length;
+  while (length > 0) {
+    Segment& seg = segments_.front();
+    if (length < seg.length) {
+      seg.offset += length;
+      seg.length -= length;
+      return;
+    }
+    length -= seg.length;
+    segments_.pop_front();
+  }
+}
+
+}
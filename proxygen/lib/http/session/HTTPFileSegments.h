@@ -0,0 +1,113 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/File.h>
+#include <folly/io/IOBuf.h>
+#include <sys/types.h>
+
+#include <deque>
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * Body bytes that stay in a file until they are sent.
+ *
+ * A file body travels the egress path as placeholder IOBufs of the same
+ * length, so flow control, egress buffering and byte events count it like
+ * any other body. Placeholders point into a block of memory only they use,
+ * which tells them apart from real data. Whoever ends up sending them
+ * takes the bytes they stand for from the file segments, in order: the
+ * session writes them to the socket with sendfile(2), anything else reads
+ * them into regular buffers with fill().
+ */
+class HTTPFileSegments {
+ public:
+  // Longest placeholder IOBuf, longer bodies are chains of them
+  static const size_t kMaxPlaceholderSize = 1024 * 1024;
+
+  // Most read() is asked for at once by those turning file bodies into
+  // regular bodies, a piece at a time
+  static const size_t kReadChunkSize = 64 * 1024;
+
+  /**
+   * Placeholder chain for length bytes of file, nullptr if length is 0.
+   */
+  static std::unique_ptr<folly::IOBuf> makePlaceholder(size_t length);
+
+  static bool isPlaceholder(const folly::IOBuf& buf);
+
+  /**
+   * Placeholder bytes in chain.
+   */
+  static size_t countPlaceholderBytes(const folly::IOBuf& chain);
+
+  /**
+   * Length of the leading run of chain that is either all placeholders or
+   * all data, which placeholders tells.
+   */
+  static size_t getRunLength(const folly::IOBuf& chain, bool* placeholders);
+
+  /**
+   * Read length bytes of fd from offset. Returns nullptr if the file could
+   * not be read or is too short.
+   */
+  static std::unique_ptr<folly::IOBuf> read(int fd, off_t offset,
+                                            size_t length);
+
+  /**
+   * Queue length bytes of file from offset, to match the next placeholders.
+   */
+  void append(std::shared_ptr<folly::File> file, off_t offset, size_t length);
+
+  bool empty() const {
+    return segments_.empty();
+  }
+
+  // Bytes left in the segments
+  size_t length() const {
+    return length_;
+  }
+
+  void clear();
+
+  /**
+   * Move the next length bytes to the back of other.
+   */
+  void moveTo(HTTPFileSegments& other, size_t length);
+
+  /**
+   * Replace the placeholders of chain with the bytes they stand for.
+   * Returns nullptr if a file could not be read.
+   */
+  std::unique_ptr<folly::IOBuf> fill(std::unique_ptr<folly::IOBuf> chain);
+
+  /**
+   * Send up to length of the next bytes to fd, a non blocking socket, with
+   * sendfile(2). Returns how many were sent, fewer once the socket is full
+   * and 0 where sendfile is not available, or -1 on error.
+   */
+  ssize_t sendTo(int fd, size_t length);
+
+ private:
+  struct Segment {
+    std::shared_ptr<folly::File> file;
+    off_t offset;
+    size_t length;
+  };
+
+  void skip(size_t length);
+
+  std::deque<Segment> segments_;
+  size_t length_{0};
+};
+
+}
@@ -0,0 +1,247 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/HTTPMemoryBudget.h>
+
+#include <folly/SingletonThreadLocal.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace proxygen {
+
+const uint64_t HTTPMemoryBudget::kRebalanceBytes;
+const std::chrono::milliseconds HTTPMemoryBudget::kRecheckInterval{20};
+
+std::atomic<uint64_t> HTTPMemoryBudget::processBytes_{0};
+std::atomic<uint64_t> HTTPMemoryBudget::processHighWater_{0};
+std::atomic<uint64_t> HTTPMemoryBudget::processLowWater_{0};
+
+namespace { struct BudgetTag {}; }
+static folly::SingletonThreadLocal<HTTPMemoryBudget, BudgetTag> s_budget{};
+
+HTTPMemoryBudget& HTTPMemoryBudget::get() {
+  return s_budget.get();
+}
+
+void HTTPMemoryBudget::setProcessLimits(uint64_t highWater,
+                                        uint64_t lowWater) {
+  processHighWater_.store(highWater, std::memory_order_relaxed);
+  processLowWater_.store(std::min(lowWater, highWater),
+                         std::memory_order_relaxed);
+}
+
+HTTPMemoryBudget::~HTTPMemoryBudget() {
+  // the thread is going away, so are the consumers
+  processBytes_.fetch_sub(bytes_, std::memory_order_relaxed);
+  pending_.clear();
+  consumers_.clear();
+  recheckTimeout_.reset();
+}
+
+void HTTPMemoryBudget::attachEventBase(folly::EventBase* evb) {
+  if (evb_ == evb) {
+    return;
+  }
+  DCHECK(!evb_) << "a budget belongs to a single thread";
+  evb_ = evb;
+  recheckTimeout_ = std::make_unique<RecheckTimeout>(*this, evb);
+  evb->runOnDestruction(&detachCallback_);
+  if (numPaused_ > 0) {
+    recheckTimeout_->scheduleTimeout(kRecheckInterval);
+  }
+  schedulePending();
+}
+
+void HTTPMemoryBudget::detachEventBase() {
+  notifyCallback_.cancelLoopCallback();
+  recheckTimeout_.reset();
+  evb_ = nullptr;
+}
+
+void HTTPMemoryBudget::setLimits(uint64_t highWater, uint64_t lowWater) {
+  highWater_ = highWater;
+  lowWater_ = std::min(lowWater, highWater);
+}
+
+void HTTPMemoryBudget::add(Consumer& consumer) {
+  DCHECK(!consumer.budgetListHook_.is_linked());
+  consumers_.push_back(consumer);
+  bytes_ += consumer.budgetedBytes_;
+  processBytes_.fetch_add(consumer.budgetedBytes_, std::memory_order_relaxed);
+}
+
+void HTTPMemoryBudget::remove(Consumer& consumer) {
+  DCHECK(consumer.budgetListHook_.is_linked());
+  consumer.budgetListHook_.unlink();
+  if (consumer.pendingListHook_.is_linked()) {
+    consumer.pendingListHook_.unlink();
+  }
+  if (consumer.budgetPaused_) {
+    consumer.budgetPaused_ = false;
+    numPaused_--;
+  }
+  consumer.notifiedPaused_ = false;
+  bytes_ -= consumer.budgetedBytes_;
+  processBytes_.fetch_sub(consumer.budgetedBytes_, std::memory_order_relaxed);
+  consumer.budgetedBytes_ = 0;
+  if (numPaused_ > 0 && isBelowLowWater()) {
+    resumeAll();
+  } else if (numPaused_ == 0 && recheckTimeout_) {
+    recheckTimeout_->cancelTimeout();
+  }
+}
+
+void HTTPMemoryBudget::update(Consumer& consumer, int64_t delta) {
+  DCHECK(delta >= 0 || uint64_t(-delta) <= consumer.budgetedBytes_);
+  consumer.budgetedBytes_ += delta;
+  bytes_ += delta;
+  processBytes_.fetch_add(delta, std::memory_order_relaxed);
+  if (delta > 0) {
+    auto excess = getExcess();
+    if (excess > 0 && (numPaused_ == 0 ||
+                       bytes_ >= pausedAt_ + kRebalanceBytes)) {
+      pauseLargest(excess);
+    }
+  } else if (delta < 0 && numPaused_ > 0 && isBelowLowWater()) {
+    resumeAll();
+  }
+}
+
+uint64_t HTTPMemoryBudget::getExcess() const {
+  uint64_t excess = 0;
+  if (highWater_ > 0 && bytes_ > highWater_) {
+    excess = bytes_ - lowWater_;
+  }
+  auto processHighWater = processHighWater_.load(std::memory_order_relaxed);
+  auto processBytes = getProcessBytes();
+  if (processHighWater > 0 && processBytes > processHighWater) {
+    // only this thread's share can be paused from here
+    excess = std::max(excess, std::min(
+      bytes_,
+      processBytes - processLowWater_.load(std::memory_order_relaxed)));
+  }
+  return excess;
+}
+
+bool HTTPMemoryBudget::isBelowLowWater() const {
+  auto processHighWater = processHighWater_.load(std::memory_order_relaxed);
+  return (highWater_ == 0 || bytes_ <= lowWater_) &&
+    (processHighWater == 0 ||
+     getProcessBytes() <= processLowWater_.load(std::memory_order_relaxed));
+}
+
+void HTTPMemoryBudget::pauseLargest(uint64_t excess) {
+  pausedAt_ = bytes_;
+  uint64_t paused = 0;
+  std::vector<Consumer*> candidates;
+  for (auto& consumer: consumers_) {
+    if (consumer.budgetPaused_) {
+      paused += consumer.budgetedBytes_;
+    } else if (consumer.budgetedBytes_ > 0) {
+      candidates.push_back(&consumer);
+    }
+  }
+  if (paused >= excess) {
+    return;
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [] (const Consumer* a, const Consumer* b) {
+              return a->budgetedBytes_ > b->budgetedBytes_;
+            });
+  for (auto consumer: candidates) {
+    if (paused >= excess) {
+      break;
+    }
+    VLOG(3) << "Memory budget of " << bytes_ << " bytes pauses a consumer of "
+            << consumer->budgetedBytes_;
+    paused += consumer->budgetedBytes_;
+    setPaused(*consumer, true);
+    numPaused_++;
+  }
+  if (recheckTimeout_ && !recheckTimeout_->isScheduled()) {
+    recheckTimeout_->scheduleTimeout(kRecheckInterval);
+  }
+  schedulePending();
+}
+
+void HTTPMemoryBudget::resumeAll() {
+  VLOG(3) << "Memory budget down to " << bytes_ << " bytes, resuming "
+          << numPaused_ << " consumers";
+  for (auto& consumer: consumers_) {
+    if (consumer.budgetPaused_) {
+      setPaused(consumer, false);
+    }
+  }
+  numPaused_ = 0;
+  if (recheckTimeout_) {
+    recheckTimeout_->cancelTimeout();
+  }
+  schedulePending();
+}
+
+void HTTPMemoryBudget::setPaused(Consumer& consumer, bool paused) {
+  consumer.budgetPaused_ = paused;
+  if (paused) {
+    stats_.pauses++;
+  } else {
+    stats_.resumes++;
+  }
+  if (!consumer.pendingListHook_.is_linked()) {
+    pending_.push_back(consumer);
+  }
+}
+
+void HTTPMemoryBudget::schedulePending() {
+  if (pending_.empty()) {
+    return;
+  }
+  if (evb_) {
+    if (!notifyCallback_.isLoopCallbackScheduled()) {
+      evb_->runInLoop(&notifyCallback_);
+    }
+  } else if (!notifying_) {
+    notifyPending();
+  }
+}
+
+void HTTPMemoryBudget::notifyPending() {
+  // One at a time: a consumer told may add, update or remove any other
+  notifying_ = true;
+  while (!pending_.empty()) {
+    auto& consumer = pending_.front();
+    pending_.pop_front();
+    if (consumer.notifiedPaused_ == consumer.budgetPaused_) {
+      // paused and resumed again before it was told
+      continue;
+    }
+    consumer.notifiedPaused_ = consumer.budgetPaused_;
+    if (consumer.notifiedPaused_) {
+      consumer.onMemoryBudgetPaused();
+    } else {
+      consumer.onMemoryBudgetResumed();
+    }
+  }
+  notifying_ = false;
+}
+
+void HTTPMemoryBudget::recheck() {
+  if (numPaused_ == 0) {
+    return;
+  }
+  if (isBelowLowWater()) {
+    // The other threads released their share of the process excess
+    resumeAll();
+  } else {
+    recheckTimeout_->scheduleTimeout(kRecheckInterval);
+  }
+}
+
+}
@@ -0,0 +1,225 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/IntrusiveList.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * Bytes buffered by the sessions of a thread, ingress and egress alike.
+ *
+ * Each session's limits bound what one connection buffers, not what
+ * thousands of slow ones do together. Past the high water mark, the
+ * budget pauses the largest consumers until the bytes they hold would
+ * bring the total back to the low water mark; all of them resume once it
+ * is reached. An optional process wide limit applies on top of the
+ * per-thread one, each thread pausing its own consumers.
+ *
+ * Consumers are told they are paused or resumed from a loop callback of
+ * the thread's event base, never from within another consumer's update.
+ * While some are paused, a timer also checks whether the other threads
+ * brought the process back under its low water mark.
+ */
+class HTTPMemoryBudget {
+ public:
+  /**
+   * Whatever buffers bytes, such as a session.
+   */
+  class Consumer {
+   public:
+    virtual ~Consumer() {}
+
+    /**
+     * Stop adding to the budget: stop reading and producing egress.
+     */
+    virtual void onMemoryBudgetPaused() noexcept = 0;
+
+    virtual void onMemoryBudgetResumed() noexcept = 0;
+
+    uint64_t getBudgetedBytes() const {
+      return budgetedBytes_;
+    }
+
+    /**
+     * As of the last onMemoryBudgetPaused() or onMemoryBudgetResumed().
+     */
+    bool isMemoryBudgetPaused() const {
+      return notifiedPaused_;
+    }
+
+   private:
+    friend class HTTPMemoryBudget;
+
+    folly::IntrusiveListHook budgetListHook_;
+    // Linked while it has yet to be told of a change of budgetPaused_
+    folly::IntrusiveListHook pendingListHook_;
+    uint64_t budgetedBytes_{0};
+    bool budgetPaused_{false};
+    bool notifiedPaused_{false};
+  };
+
+  struct Stats {
+    // Times a consumer was paused, and resumed
+    uint64_t pauses{0};
+    uint64_t resumes{0};
+  };
+
+  /**
+   * The budget of the calling thread.
+   */
+  static HTTPMemoryBudget& get();
+
+  /**
+   * Limit the bytes of all threads together, 0 for no limit.
+   */
+  static void setProcessLimits(uint64_t highWater, uint64_t lowWater);
+
+  static uint64_t getProcessBytes() {
+    return processBytes_.load(std::memory_order_relaxed);
+  }
+
+  // How often paused consumers check the process is back under low water
+  static const std::chrono::milliseconds kRecheckInterval;
+
+  HTTPMemoryBudget() = default;
+  HTTPMemoryBudget(uint64_t highWater, uint64_t lowWater) {
+    setLimits(highWater, lowWater);
+  }
+  ~HTTPMemoryBudget();
+
+  /**
+   * The event base of the thread, which tells the consumers they are
+   * paused or resumed. Without one they are told at the end of each call
+   * which pauses or resumes them.
+   */
+  void attachEventBase(folly::EventBase* evb);
+
+  /**
+   * Limit the bytes of this thread, 0 for no limit. lowWater is capped at
+   * highWater.
+   */
+  void setLimits(uint64_t highWater, uint64_t lowWater);
+
+  uint64_t getHighWater() const {
+    return highWater_;
+  }
+
+  uint64_t getLowWater() const {
+    return lowWater_;
+  }
+
+  void add(Consumer& consumer);
+
+  /**
+   * Stop accounting for consumer, and release its bytes.
+   */
+  void remove(Consumer& consumer);
+
+  /**
+   * consumer now buffers delta more bytes, or fewer if negative. May pause
+   * or resume consumers, consumer included.
+   */
+  void update(Consumer& consumer, int64_t delta);
+
+  // Bytes buffered by the consumers of this budget
+  uint64_t getBytes() const {
+    return bytes_;
+  }
+
+  size_t getNumConsumers() const {
+    return consumers_.size();
+  }
+
+  size_t getNumPaused() const {
+    return numPaused_;
+  }
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  // Growth past the high water mark before looking for more to pause
+  static const uint64_t kRebalanceBytes = 64 * 1024;
+
+  class NotifyCallback : public folly::EventBase::LoopCallback {
+   public:
+    explicit NotifyCallback(HTTPMemoryBudget& budget) : budget_(budget) {}
+    void runLoopCallback() noexcept override {
+      budget_.notifyPending();
+    }
+   private:
+    HTTPMemoryBudget& budget_;
+  };
+
+  class RecheckTimeout : public folly::AsyncTimeout {
+   public:
+    RecheckTimeout(HTTPMemoryBudget& budget, folly::EventBase* evb)
+        : folly::AsyncTimeout(evb), budget_(budget) {}
+    void timeoutExpired() noexcept override {
+      budget_.recheck();
+    }
+   private:
+    HTTPMemoryBudget& budget_;
+  };
+
+  // Forgets the event base when it goes away before the budget
+  class DetachCallback : public folly::EventBase::LoopCallback {
+   public:
+    explicit DetachCallback(HTTPMemoryBudget& budget) : budget_(budget) {}
+    void runLoopCallback() noexcept override {
+      budget_.detachEventBase();
+    }
+   private:
+    HTTPMemoryBudget& budget_;
+  };
+
+  // Bytes above the low water marks, if past a high water mark
+  uint64_t getExcess() const;
+  bool isBelowLowWater() const;
+  void pauseLargest(uint64_t excess);
+  void resumeAll();
+
+  // Queue consumer to be told of its new state
+  void setPaused(Consumer& consumer, bool paused);
+  void schedulePending();
+  void notifyPending();
+  void recheck();
+  void detachEventBase();
+
+  static std::atomic<uint64_t> processBytes_;
+  static std::atomic<uint64_t> processHighWater_;
+  static std::atomic<uint64_t> processLowWater_;
+
+  folly::IntrusiveList<Consumer, &Consumer::budgetListHook_> consumers_;
+  folly::IntrusiveList<Consumer, &Consumer::pendingListHook_> pending_;
+  folly::EventBase* evb_{nullptr};
+  NotifyCallback notifyCallback_{*this};
+  DetachCallback detachCallback_{*this};
+  std::unique_ptr<RecheckTimeout> recheckTimeout_;
+  bool notifying_{false};
+  uint64_t highWater_{0};
+  uint64_t lowWater_{0};
+  uint64_t bytes_{0};
+  // Bytes when consumers were last paused
+  uint64_t pausedAt_{0};
+  size_t numPaused_{0};
+  Stats stats_;
+};
+
+}
@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/HTTPPacingBucket.h>
+
+#include <algorithm>
+#include <glog/logging.h>
+
+using namespace std::chrono;
+
+namespace proxygen {
+
+const uint64_t HTTPPacingBucket::kMinBurst;
+
+namespace {
+const uint64_t kMicrosPerSecond = 1000000;
+}
+
+HTTPPacingBucket::HTTPPacingBucket(uint64_t rate, uint64_t burst,
+                                   TimePoint now)
+    : rate_(rate),
+      burst_(std::max(burst, kMinBurst)),
+      tokens_(burst_),
+      lastRefill_(now) {
+  CHECK_GT(rate_, 0);
+}
+
+void HTTPPacingBucket::refill(TimePoint now) {
+  if (now <= lastRefill_) {
+    return;
+  }
+  auto elapsed = duration_cast<microseconds>(now - lastRefill_).count();
+  lastRefill_ = now;
+  if (tokens_ >= burst_) {
+    remainder_ = 0;
+    return;
+  }
+  // a full bucket is reached within burst / rate seconds, cap elapsed to
+  // keep the product from overflowing
+  uint64_t maxElapsed = (burst_ * kMicrosPerSecond) / rate_ + 1;
+  uint64_t accrued = std::min<uint64_t>(elapsed, maxElapsed) * rate_ +
+    remainder_;
+  tokens_ = std::min(burst_, tokens_ + accrued / kMicrosPerSecond);
+  remainder_ = tokens_ < burst_ ? accrued % kMicrosPerSecond : 0;
+}
+
+uint64_t HTTPPacingBucket::getAvailable(TimePoint now) {
+  refill(now);
+  return tokens_;
+}
+
+void HTTPPacingBucket::consume(uint64_t bytes) {
+  DCHECK_LE(bytes, tokens_);
+  tokens_ -= std::min(bytes, tokens_);
+}
+
+milliseconds HTTPPacingBucket::getDelay(uint64_t bytes, TimePoint now) {
+  refill(now);
+  bytes = std::min(bytes, burst_);
+  if (bytes <= tokens_) {
+    return milliseconds(0);
+  }
+  uint64_t needed = (bytes - tokens_) * kMicrosPerSecond - remainder_;
+  // round up, the tokens must be there once the delay is over
+  return milliseconds((needed + rate_ * 1000 - 1) / (rate_ * 1000));
+}
+
+}
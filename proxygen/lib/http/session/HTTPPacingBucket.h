@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * Token bucket pacing egress: tokens accrue at rate bytes per second, up to
+ * burst bytes, and every byte written takes one. A bucket can be shared by
+ * the sessions of one thread to pace them as a group; it is not thread
+ * safe.
+ */
+class HTTPPacingBucket {
+ public:
+  // Smallest burst, so a paced write is never smaller than this
+  static const uint64_t kMinBurst = 8192;
+
+  /**
+   * A bucket that starts full. A burst below kMinBurst is raised to it.
+   */
+  HTTPPacingBucket(uint64_t rate, uint64_t burst,
+                   TimePoint now = getCurrentTime());
+
+  uint64_t getRate() const {
+    return rate_;
+  }
+
+  uint64_t getBurst() const {
+    return burst_;
+  }
+
+  /**
+   * Bytes that can be written at now.
+   */
+  uint64_t getAvailable(TimePoint now);
+
+  /**
+   * Take bytes out of the bucket, no more than getAvailable() returned.
+   */
+  void consume(uint64_t bytes);
+
+  /**
+   * How long until bytes can be written, 0 if they can now.
+   */
+  std::chrono::milliseconds getDelay(uint64_t bytes, TimePoint now);
+
+ private:
+  void refill(TimePoint now);
+
+  uint64_t rate_;
+  uint64_t burst_;
+  uint64_t tokens_;
+  // fractions of a token, in bytes * microseconds per second
+  uint64_t remainder_{0};
+  TimePoint lastRefill_;
+};
+
+}
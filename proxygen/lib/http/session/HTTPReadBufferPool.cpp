@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/HTTPReadBufferPool.h>
+
+#include <folly/SingletonThreadLocal.h>
+#include <glog/logging.h>
+
+using folly::IOBuf;
+using std::unique_ptr;
+
+namespace proxygen {
+
+const size_t HTTPReadBufferPool::kMinBufferSize;
+const size_t HTTPReadBufferPool::kMaxBufferSize;
+const size_t HTTPReadBufferPool::kMaxIdleBuffers;
+const size_t HTTPReadBufferPool::kNumSizes;
+
+namespace { struct PoolTag {}; }
+static folly::SingletonThreadLocal<HTTPReadBufferPool, PoolTag> s_pool{};
+
+HTTPReadBufferPool& HTTPReadBufferPool::get() {
+  return s_pool.get();
+}
+
+size_t HTTPReadBufferPool::getSizeIndex(size_t size) {
+  size_t index = 0;
+  while (index + 1 < kNumSizes && (kMinBufferSize << index) < size) {
+    index++;
+  }
+  return index;
+}
+
+unique_ptr<IOBuf> HTTPReadBufferPool::acquire(size_t size) {
+  auto index = getSizeIndex(size);
+  auto& idle = idle_[index];
+  unique_ptr<IOBuf> buf;
+  stats_.borrows++;
+  stats_.lentBuffers++;
+  if (idle.empty()) {
+    stats_.allocations++;
+    buf = IOBuf::create(kMinBufferSize << index);
+  } else {
+    buf = std::move(idle.back());
+    idle.pop_back();
+    stats_.idleBuffers--;
+    stats_.idleBytes -= buf->capacity();
+  }
+  return buf;
+}
+
+void HTTPReadBufferPool::release(unique_ptr<IOBuf> buf) {
+  DCHECK(buf);
+  DCHECK(!buf->isChained());
+  stats_.lentBuffers--;
+  if (buf->isShared()) {
+    // parsed data still points into it, the last reference frees it
+    stats_.pinned++;
+    return;
+  }
+  if (buf->capacity() < kMinBufferSize) {
+    return;
+  }
+  // the size it was acquired for, even if malloc rounded the capacity up
+  size_t index = kNumSizes - 1;
+  while (index > 0 && (kMinBufferSize << index) > buf->capacity()) {
+    index--;
+  }
+  auto& idle = idle_[index];
+  if (idle.size() >= kMaxIdleBuffers) {
+    return;
+  }
+  buf->clear();
+  stats_.idleBuffers++;
+  stats_.idleBytes += buf->capacity();
+  idle.push_back(std::move(buf));
+}
+
+}
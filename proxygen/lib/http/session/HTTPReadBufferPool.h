@@ -0,0 +1,82 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBuf.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Read buffers shared by the sessions of a thread.
+ *
+ * A session borrows a buffer for the duration of a read, parses it in
+ * place and returns it, only copying out the bytes the codec could not
+ * parse yet. Idle connections then hold no read buffer at all.
+ *
+ * Buffers come in power of two sizes. A buffer still referenced by parsed
+ * data, such as a body chunk or zero copy header values, is left to those
+ * references instead of going back to the pool.
+ */
+class HTTPReadBufferPool {
+ public:
+  static const size_t kMinBufferSize = 2048;
+  static const size_t kMaxBufferSize = 64 * 1024;
+  // Idle buffers kept per size
+  static const size_t kMaxIdleBuffers = 4;
+
+  struct Stats {
+    // Buffers waiting in the pool, and their capacity
+    uint64_t idleBuffers{0};
+    uint64_t idleBytes{0};
+    // Buffers currently borrowed from this thread. A session moving to
+    // another thread returns its buffer there.
+    int64_t lentBuffers{0};
+    // Buffers handed out, and those that had to be allocated
+    uint64_t borrows{0};
+    uint64_t allocations{0};
+    // Buffers returned while still referenced by parsed data
+    uint64_t pinned{0};
+  };
+
+  /**
+   * The pool of the calling thread.
+   */
+  static HTTPReadBufferPool& get();
+
+  /**
+   * An empty buffer with room for at least size bytes, size being capped
+   * to kMaxBufferSize.
+   */
+  std::unique_ptr<folly::IOBuf> acquire(size_t size);
+
+  /**
+   * Return a buffer obtained from acquire(). The pool takes it back unless
+   * it is still shared or the pool is full.
+   */
+  void release(std::unique_ptr<folly::IOBuf> buf);
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  static const size_t kNumSizes = 6;
+
+  static size_t getSizeIndex(size_t size);
+
+  std::array<std::vector<std::unique_ptr<folly::IOBuf>>, kNumSizes> idle_;
+  Stats stats_;
+};
+
+}
@@ -11,6 +11,7 @@
 
 #include <chrono>
 #include <folly/Conv.h>
+#include <folly/io/Cursor.h>
 #include <wangle/acceptor/ConnectionManager.h>
 #include <wangle/acceptor/SocketOptions.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
@@ -20,6 +21,7 @@
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/tracing/ScopedTraceSection.h>
+#include <netinet/tcp.h>
 
 using folly::AsyncSSLSocket;
 using folly::AsyncSocket;
@@ -125,9 +127,13 @@ HTTPSession::HTTPSession(
     HTTPSessionBase(localAddr, peerAddr, controller, tinfo, infoCallback,
                     std::move(codec)),
     writeTimeout_(this),
-    txnEgressQueue_(isHTTP2CodecProtocol(codec_->getProtocol()) ?
-                    WheelTimerInstance(timeout) :
-                    WheelTimerInstance()),
+    readSizeHint_(std::max(kMinReadSize,
+                           HTTPSessionBase::maxReadBufferSize_)),
+    readBufferReleaser_(this),
+    txnEgressQueue_(std::make_unique<HTTP2PriorityQueue>(
+                      isHTTP2CodecProtocol(codec_->getProtocol()) ?
+                      WheelTimerInstance(timeout) :
+                      WheelTimerInstance())),
     sock_(std::move(sock)),
     timeout_(timeout),
     draining_(false),
@@ -137,13 +143,18 @@ HTTPSession::HTTPSession(
     ingressError_(false),
     flowControlTimeout_(this),
     drainTimeout_(this),
+    hibernateTimeout_(this),
+    pacingTimeout_(this),
+    writableHandler_(this),
     reads_(SocketState::PAUSED),
     writes_(SocketState::UNPAUSED),
     ingressUpgraded_(false),
     resetSocketOnShutdown_(false),
     inLoopCallback_(false),
     inResume_(false),
-    pendingPause_(false) {
+    pendingPause_(false),
+    extensiblePrioritiesEnabled_(false),
+    hibernating_(false) {
   byteEventTracker_ = std::make_shared<ByteEventTracker>(this);
   initialReceiveWindow_ = receiveStreamWindowSize_ =
     receiveSessionWindowSize_ = codec_->getDefaultWindowSize();
@@ -198,9 +209,10 @@ HTTPSession::~HTTPSession() {
   VLOG(4) << *this << " closing";
 
   CHECK(transactions_.empty());
-  txnEgressQueue_.dropPriorityNodes();
-  CHECK(txnEgressQueue_.empty());
+  txnEgressQueue_->dropPriorityNodes();
+  CHECK(txnEgressQueue_->empty());
   DCHECK(!sock_->getReadCallback());
+  releaseReadBuffer();
 
   if (writeTimeout_.isScheduled()) {
     writeTimeout_.cancelTimeout();
@@ -210,6 +222,8 @@ HTTPSession::~HTTPSession() {
     flowControlTimeout_.cancelTimeout();
   }
 
+  cancelHibernateTimeout();
+
   runDestroyCallbacks();
 }
 
@@ -223,6 +237,7 @@ void HTTPSession::startNow() {
   }
   scheduleWrite();
   resumeReads();
+  scheduleHibernateTimeout();
 }
 
 void HTTPSession::setFlowControl(size_t initialReceiveWindow,
@@ -250,6 +265,88 @@ void HTTPSession::setEgressSettings(const SettingsList& inSettings) {
   }
 }
 
+void HTTPSession::setExtensiblePrioritiesEnabled(bool enabled) {
+  CHECK(!started_);
+  CHECK(transactions_.empty());
+  if (enabled == extensiblePrioritiesEnabled_ ||
+      !isHTTP2CodecProtocol(codec_->getProtocol())) {
+    return;
+  }
+  extensiblePrioritiesEnabled_ = enabled;
+  if (enabled) {
+    txnEgressQueue_ = std::make_unique<HTTPExtensiblePriorityQueue>();
+  } else {
+    txnEgressQueue_ = std::make_unique<HTTP2PriorityQueue>(timeout_);
+  }
+  HTTPSettings* settings = codec_->getEgressSettings();
+  if (settings) {
+    settings->setSetting(SettingsId::NO_RFC7540_PRIORITIES, enabled ? 1 : 0);
+  }
+}
+
+void HTTPSession::setZeroCopyThreshold(size_t threshold) {
+  zeroCopyThreshold_ = 0;
+  if (threshold == 0) {
+    return;
+  }
+  // TLS encrypts into its own buffers, there is nothing to save
+  auto sock = sock_->getUnderlyingTransport<AsyncSocket>();
+  if (!sock || sock_->getUnderlyingTransport<AsyncSSLSocket>()) {
+    VLOG(4) << *this << " zero copy needs a plaintext socket";
+    return;
+  }
+  if (!sock->setZeroCopy(true)) {
+    VLOG(4) << *this << " SO_ZEROCOPY not supported";
+    return;
+  }
+  zeroCopyThreshold_ = threshold;
+}
+
+void HTTPSession::setEgressPacingRate(uint64_t rate, uint64_t burst,
+                                      bool useSocketPacing) {
+  pacingBucket_.reset();
+  if (rate == 0) {
+    return;
+  }
+#ifdef SO_MAX_PACING_RATE
+  auto sock = sock_->getUnderlyingTransport<AsyncSocket>();
+  if (useSocketPacing && sock) {
+    // older kernels only take 32 bits
+    uint32_t sockRate = std::min<uint64_t>(
+      rate, std::numeric_limits<uint32_t>::max() - 1);
+    if (sock->setSockOpt(SOL_SOCKET, SO_MAX_PACING_RATE, &sockRate) == 0) {
+      VLOG(4) << *this << " kernel paces egress at " << sockRate;
+      return;
+    }
+    VLOG(4) << *this << " SO_MAX_PACING_RATE failed, errno=" << errno;
+  }
+#else
+  (void)useSocketPacing;
+#endif
+  pacingBucket_ = std::make_unique<HTTPPacingBucket>(rate, burst);
+}
+
+void HTTPSession::setNotSentLowat(uint32_t lowat) {
+  writableHandler_.unregisterHandler();
+  notSentLowat_ = 0;
+  if (lowat == 0) {
+    return;
+  }
+#ifdef TCP_NOTSENT_LOWAT
+  auto sock = sock_->getUnderlyingTransport<AsyncSocket>();
+  if (!sock) {
+    VLOG(4) << *this << " TCP_NOTSENT_LOWAT needs a socket";
+    return;
+  }
+  if (sock->setSockOpt(IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat) != 0) {
+    VLOG(4) << *this << " TCP_NOTSENT_LOWAT failed, errno=" << errno;
+    return;
+  }
+  writableHandler_.initHandler(sock->getEventBase(), sock->getFd());
+  notSentLowat_ = lowat;
+#endif
+}
+
 void HTTPSession::setMaxConcurrentIncomingStreams(uint32_t num) {
   CHECK(!started_);
   if (codec_->supportsParallelRequests()) {
@@ -313,6 +410,104 @@ HTTPSession::writeTimeoutExpired() noexcept {
   shutdownTransportWithReset(kErrorWriteTimeout);
 }
 
+void
+HTTPSession::hibernateTimeoutExpired() noexcept {
+  if (!transactions_.empty() || draining_ || writesShutdown() ||
+      readsShutdown()) {
+    return;
+  }
+  VLOG(4) << "Hibernating " << *this;
+  hibernating_ = true;
+  if (codec_->hibernate(writeBuf_) > 0) {
+    scheduleWrite();
+  }
+  HTTPEgressQueue::NextEgressResult().swap(nextEgressResults_);
+}
+
+void
+HTTPSession::pacingTimeoutExpired() noexcept {
+  VLOG(4) << *this << " pacing timeout expired";
+  scheduleWrite();
+}
+
+void
+HTTPSession::socketWritable() noexcept {
+  VLOG(4) << *this << " socket writable";
+  if (egressBlockedSince_ != TimePoint()) {
+    auto blocked = millisecondsSince(egressBlockedSince_);
+    egressBlockedSince_ = TimePoint();
+    egressBlockedTime_ += blocked;
+    if (sessionStats_) {
+      sessionStats_->recordEgressBlockedTime(blocked);
+    }
+  }
+  scheduleWrite();
+}
+
+void
+HTTPSession::onMemoryBudgetPaused() noexcept {
+  VLOG(3) << *this << " paused by the memory budget, buffering "
+          << getBudgetedBytes() << " bytes";
+  if (readsUnpaused()) {
+    // the loop callback leaves it out while paused
+    sock_->setReadCB(nullptr);
+  }
+  if (egressLimitExceeded()) {
+    // already paused
+    return;
+  }
+  if (inResume_) {
+    pendingPause_ = true;
+  } else {
+    invokeOnAllTransactions(&HTTPTransaction::pauseEgress);
+  }
+}
+
+void
+HTTPSession::onMemoryBudgetResumed() noexcept {
+  VLOG(3) << *this << " resumed by the memory budget";
+  DestructorGuard dg(this);
+  if (!egressLimitExceeded()) {
+    if (inResume_) {
+      pendingPause_ = false;
+    } else {
+      resumeTransactions();
+    }
+  }
+  if (readsUnpaused() && !isLoopCallbackScheduled()) {
+    sock_->getEventBase()->runInLoop(this);
+  }
+}
+
+void
+HTTPSession::scheduleHibernateTimeout() {
+  auto duration = hibernateTimeout_.getTimeoutDuration();
+  if (duration.count() > 0 && !hibernating_) {
+    timeout_.scheduleTimeout(&hibernateTimeout_, duration);
+  }
+}
+
+void
+HTTPSession::cancelHibernateTimeout() {
+  if (hibernateTimeout_.isScheduled()) {
+    hibernateTimeout_.cancelTimeout();
+  }
+}
+
+void
+HTTPSession::wakeFromHibernation() {
+  cancelHibernateTimeout();
+  if (!hibernating_) {
+    return;
+  }
+  VLOG(4) << "Waking up " << *this;
+  hibernating_ = false;
+  if (codec_->wake(writeBuf_) > 0) {
+    scheduleWrite();
+  }
+  nextEgressResults_.reserve(maxConcurrentIncomingStreams_);
+}
+
 void
 HTTPSession::flowControlTimeoutExpired() noexcept {
   VLOG(4) << "Flow control timeout for " << *this;
@@ -404,7 +599,14 @@ HTTPSession::dropConnection() {
   shutdownTransportWithReset(kErrorDropped);
 }
 
-void HTTPSession::dumpConnectionState(uint8_t /*loglevel*/) {}
+void HTTPSession::dumpConnectionState(uint8_t loglevel) {
+  VLOG(loglevel) << *this << " transactions=" << transactions_.size()
+                 << " ingressBuffered=" << getPendingReadSize()
+                 << " egressBuffered=" << getPendingWriteSize()
+                 << " writeBuf=" << writeBuf_.chainLength()
+                 << " budgetedBytes=" << getBudgetedBytes()
+                 << (isMemoryBudgetPaused() ? " paused by memory budget" : "");
+}
 
 bool HTTPSession::isUpstream() const {
   return codec_->getTransportDirection() == TransportDirection::UPSTREAM;
@@ -417,10 +619,23 @@ bool HTTPSession::isDownstream() const {
 void
 HTTPSession::getReadBuffer(void** buf, size_t* bufSize) {
   FOLLY_SCOPED_TRACE_SECTION("HTTPSession - getReadBuffer");
-  pair<void*,uint32_t> readSpace =
-    readBuf_.preallocate(kMinReadSize, HTTPSessionBase::maxReadBufferSize_);
-  *buf = readSpace.first;
-  *bufSize = readSpace.second;
+  if (readBuf_.chainLength() >= readSizeHint_) {
+    // In the middle of a large frame or header block, that would be copied
+    // out of every borrowed buffer. Grow a buffer of our own instead.
+    pair<void*,uint32_t> readSpace =
+      readBuf_.preallocate(kMinReadSize, readSizeHint_);
+    *buf = readSpace.first;
+    *bufSize = readSpace.second;
+    return;
+  }
+  if (!borrowedReadBuf_) {
+    borrowedReadBuf_ = HTTPReadBufferPool::get().acquire(readSizeHint_);
+    // in case nothing is read into it
+    sock_->getEventBase()->runInLoop(&readBufferReleaser_, true);
+  }
+  *buf = borrowedReadBuf_->writableTail();
+  // the pool rounds the size up
+  *bufSize = std::min<size_t>(borrowedReadBuf_->tailroom(), readSizeHint_);
 }
 
 void
@@ -430,13 +645,50 @@ HTTPSession::readDataAvailable(size_t readSize) noexcept {
 
   DestructorGuard dg(this);
   resetTimeout();
-  readBuf_.postallocate(readSize);
+  if (borrowedReadBuf_) {
+    // adapt to the traffic: grow when the read filled the buffer, up to
+    // maxReadBufferSize, shrink when it used little of it
+    size_t offered = std::min<size_t>(borrowedReadBuf_->tailroom(),
+                                      readSizeHint_);
+    uint32_t maxReadSize = std::min<uint32_t>(
+      HTTPReadBufferPool::kMaxBufferSize,
+      std::max(kMinReadSize, HTTPSessionBase::maxReadBufferSize_));
+    if (readSize == offered) {
+      readSizeHint_ = std::min(readSizeHint_ * 2, maxReadSize);
+    } else if (readSize < offered / 4) {
+      readSizeHint_ = std::max(readSizeHint_ / 2, kMinReadSize);
+    }
+    borrowedReadBuf_->append(readSize);
+    readBuf_.append(borrowedReadBuf_->cloneOne());
+  } else {
+    readBuf_.postallocate(readSize);
+  }
 
   if (infoCallback_) {
     infoCallback_->onRead(*this, readSize);
   }
 
   processReadData();
+  releaseReadBuffer();
+}
+
+void
+HTTPSession::releaseReadBuffer() {
+  if (!borrowedReadBuf_) {
+    return;
+  }
+  // retain only the unparsed tail
+  auto unparsed = readBuf_.move();
+  if (unparsed && !unparsed->empty()) {
+    size_t length = unparsed->computeChainDataLength();
+    auto tail = IOBuf::create(length);
+    folly::io::Cursor cursor(unparsed.get());
+    cursor.pull(tail->writableData(), length);
+    tail->append(length);
+    readBuf_.append(std::move(tail));
+  }
+  unparsed.reset();
+  HTTPReadBufferPool::get().release(std::move(borrowedReadBuf_));
 }
 
 bool
@@ -472,6 +724,12 @@ HTTPSession::processReadData() {
   // Pass the ingress data through the codec to parse it. The codec
   // will invoke various methods of the HTTPSession as callbacks.
   const IOBuf* currentReadBuf;
+  readsYielded_ = false;
+  size_t totalParsed = 0;
+  TimePoint deadline;
+  if (readTimeBudget_.count() > 0) {
+    deadline = getCurrentTime() + readTimeBudget_;
+  }
   // It's possible for the last buffer in a chain to be empty here.
   // AsyncTransport saw fd activity so asked for a read buffer, but it was
   // SSL traffic and not enough to decrypt a whole record.  Later we invoke
@@ -480,15 +738,50 @@ HTTPSession::processReadData() {
          readsUnpaused() &&
          ((currentReadBuf = readBuf_.front()) != nullptr &&
           currentReadBuf->length() != 0)) {
+    if (totalParsed > 0 &&
+        ((readByteBudget_ > 0 && totalParsed >= readByteBudget_) ||
+         (readTimeBudget_.count() > 0 && getCurrentTime() >= deadline))) {
+      yieldReads();
+      break;
+    }
     // We're about to parse, make sure the parser is not paused
     codec_->setParserPaused(false);
-    size_t bytesParsed = codec_->onIngress(*currentReadBuf);
+    size_t bytesParsed = 0;
+    if (readByteBudget_ > 0 &&
+        readBuf_.chainLength() > readByteBudget_ - totalParsed) {
+      // only show the codec what the budget allows
+      unique_ptr<IOBuf> budgeted;
+      folly::io::Cursor(currentReadBuf).clone(
+        budgeted, readByteBudget_ - totalParsed);
+      bytesParsed = codec_->onIngress(*budgeted);
+    }
+    if (bytesParsed == 0) {
+      // no budget, or a frame larger than what is left of it
+      bytesParsed = codec_->onIngress(*currentReadBuf);
+    }
     if (bytesParsed == 0) {
       // If the codec didn't make any progress with current input, we
       // better get more.
       break;
     }
     readBuf_.trimStart(bytesParsed);
+    totalParsed += bytesParsed;
+  }
+}
+
+void
+HTTPSession::yieldReads() {
+  VLOG(4) << *this << " read budget exhausted, " << readBuf_.chainLength()
+          << " bytes left to parse";
+  readsYielded_ = true;
+  readBudgetExhaustions_++;
+  if (sessionStats_) {
+    sessionStats_->recordReadBudgetExhausted();
+  }
+  // the loop callback puts the read callback back once it is caught up
+  sock_->setReadCB(nullptr);
+  if (!isLoopCallbackScheduled()) {
+    sock_->getEventBase()->runInLoop(this);
   }
 }
 
@@ -577,7 +870,7 @@ size_t HTTPSession::getCodecSendWindowSize() const {
 
 void
 HTTPSession::setNewTransactionPauseState(HTTPCodec::StreamID streamID) {
-  if (!egressLimitExceeded()) {
+  if (!egressLimitExceeded() && !isMemoryBudgetPaused()) {
     return;
   }
 
@@ -681,9 +974,7 @@ HTTPSession::onMessageBeginImpl(HTTPCodec::StreamID streamID,
     // There must be at least two transactions (we just checked).  Grab the
     // second to last one
     DCHECK_GE(transactions_.size(), 2);
-    auto prevIt = transactions_.rbegin();
-    prevIt++;
-    auto prevTxn = &prevIt->second;
+    auto prevTxn = transactions_.last(1);
     if (!prevTxn->isIngressPaused()) {
       DCHECK(prevTxn->isIngressComplete());
       prevTxn->pauseIngress();
@@ -721,6 +1012,10 @@ HTTPSession::onHeadersComplete(HTTPCodec::StreamID streamID,
   msg->setSecureInfo(transportInfo_.sslVersion, sslCipher);
   msg->setSecure(transportInfo_.secure);
 
+  if (extensiblePrioritiesEnabled_ && isDownstream()) {
+    applyExtensiblePriority(txn, msg.get());
+  }
+
   setupOnHeadersComplete(txn, msg.get());
 
   // The txn may have already been aborted by the handler.
@@ -740,6 +1035,23 @@ HTTPSession::onHeadersComplete(HTTPCodec::StreamID streamID,
   txn->onIngressHeadersComplete(std::move(msg));
 }
 
+void
+HTTPSession::applyExtensiblePriority(HTTPTransaction* txn,
+                                     const HTTPMessage* msg) {
+  // A PRIORITY_UPDATE received first takes precedence over the header
+  auto it = pendingPriorityUpdates_.find(txn->getID());
+  if (it != pendingPriorityUpdates_.end()) {
+    txn->onExtensiblePriorityUpdate(it->second);
+  } else {
+    txn->onExtensiblePriorityUpdate(RFC9218::parsePriority(
+      msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_PRIORITY)));
+  }
+  // streams up to this one can no longer be opened
+  pendingPriorityUpdates_.erase(pendingPriorityUpdates_.begin(),
+                                pendingPriorityUpdates_.upper_bound(
+                                  txn->getID()));
+}
+
 void
 HTTPSession::onBody(HTTPCodec::StreamID streamID,
                     unique_ptr<IOBuf> chain, uint16_t padding) {
@@ -987,7 +1299,7 @@ void HTTPSession::onGoaway(uint64_t lastGoodStreamID,
     if (((bool)(streamID & 0x01) == isUpstream()) &&
         (streamID > lastGoodStreamID)) {
       if (firstStream == HTTPCodec::NoStream) {
-        // transactions_ is a set so it should be sorted by stream id.
+        // transactions_ iterates in stream id order.
         // We will defer adding the firstStream to the id list until
         // we can determine whether we have a codec error code.
         firstStream = streamID;
@@ -1100,7 +1412,27 @@ void HTTPSession::onPriority(HTTPCodec::StreamID streamID,
     txn->onPriorityUpdate(h2Pri);
   } else {
     // virtual node
-    txnEgressQueue_.addOrUpdatePriorityNode(streamID, h2Pri);
+    txnEgressQueue_->addOrUpdatePriorityNode(streamID, h2Pri);
+  }
+}
+
+void HTTPSession::onExtensiblePriority(HTTPCodec::StreamID streamID,
+                                       const RFC9218::Priority& pri) {
+  if (!extensiblePrioritiesEnabled_) {
+    return;
+  }
+  HTTPTransaction* txn = findTransaction(streamID);
+  if (txn) {
+    txn->onExtensiblePriorityUpdate(pri);
+  } else if (streamID > codec_->getLastIncomingStreamID() &&
+             (pendingPriorityUpdates_.count(streamID) ||
+              pendingPriorityUpdates_.size() <
+              maxConcurrentIncomingStreams_)) {
+    // the update may arrive before the HEADERS of its stream, keep it for
+    // onHeadersComplete
+    pendingPriorityUpdates_[streamID] = pri;
+  } else {
+    VLOG(4) << *this << " ignoring priority update for stream=" << streamID;
   }
 }
 
@@ -1270,6 +1602,9 @@ void HTTPSession::sendHeaders(HTTPTransaction* txn,
     if (getHTTP2PrioritiesEnabled()) {
       auto pri = getMessagePriority(&headers);
       txn->onPriorityUpdate(pri);
+    } else if (extensiblePrioritiesEnabled_ && headers.isRequest()) {
+      txn->onExtensiblePriorityUpdate(RFC9218::parsePriority(
+        headers.getHeaders().getSingleOrEmpty(HTTP_HEADER_PRIORITY)));
     }
   }
 
@@ -1515,7 +1850,7 @@ HTTPSession::maybeResumePausedPipelinedTransaction(
   if (!codec_->supportsParallelRequests() && !transactions_.empty() &&
       getPipelineStreamCount() < oldStreamCount &&
       getPipelineStreamCount() == 1) {
-    auto& nextTxn = transactions_.rbegin()->second;
+    auto& nextTxn = *transactions_.last();
     DCHECK_EQ(nextTxn.getSequenceNumber(), txnSeqn + 1);
     DCHECK(!nextTxn.isIngressComplete());
     DCHECK(nextTxn.isIngressPaused());
@@ -1531,8 +1866,7 @@ HTTPSession::detach(HTTPTransaction* txn) noexcept {
   DestructorGuard guard(this);
   HTTPCodec::StreamID streamID = txn->getID();
   auto txnSeqn = txn->getSequenceNumber();
-  auto it = transactions_.find(txn->getID());
-  DCHECK(it != transactions_.end());
+  DCHECK(transactions_.contains(streamID));
 
   if (txn->isIngressPaused()) {
     // Someone detached a transaction that was paused.  Make the resumeIngress
@@ -1554,7 +1888,7 @@ HTTPSession::detach(HTTPTransaction* txn) noexcept {
   }
   auto oldStreamCount = getPipelineStreamCount();
   decrementTransactionCount(txn, true, true);
-  transactions_.erase(it);
+  transactions_.erase(streamID);
 
   if (transactions_.empty()) {
     HTTPSessionBase::setLatestActive();
@@ -1564,6 +1898,7 @@ HTTPSession::detach(HTTPTransaction* txn) noexcept {
     if (getConnectionManager()) {
       getConnectionManager()->onDeactivated(*this);
     }
+    scheduleHibernateTimeout();
   } else {
     if (infoCallback_) {
       infoCallback_->onTransactionDetached(*this);
@@ -1633,6 +1968,21 @@ HTTPSession::notifyEgressBodyBuffered(int64_t bytes) noexcept {
   }
 }
 
+bool
+HTTPSession::canSendFileBody() const noexcept {
+  // HTTP/1.x frames the body without looking at it, the file bytes can go
+  // to the socket as they are between the framing bytes
+  return codec_->getProtocol() == CodecProtocol::HTTP_1_1 &&
+    sock_->getUnderlyingTransport<AsyncSocket>() &&
+    !sock_->getUnderlyingTransport<AsyncSSLSocket>();
+}
+
+void
+HTTPSession::takeEgressFileSegments(HTTPFileSegments& segments,
+                                    size_t length) noexcept {
+  segments.moveTo(egressFileSegments_, length);
+}
+
 bool HTTPSession::getCurrentTransportInfoWithoutUpdate(
     TransportInfo* tinfo) const {
   auto sock = sock_->getUnderlyingTransport<AsyncSocket>();
@@ -1678,8 +2028,15 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork, bool* eom) {
 
   // We always tack on at least one body packet to the current write buf
   // This ensures that a short HTTPS response will go out in a single SSL record
-  while (!txnEgressQueue_.empty()) {
+  // Paced sessions first send what pacing held back.
+  while (!txnEgressQueue_->empty() &&
+         (!isEgressPaced() ||
+          writeBuf_.chainLength() < HTTPPacingBucket::kMinBurst)) {
     uint32_t toSend = kWriteReadyMax;
+    if (notSentLowat_ > 0) {
+      // no more than the socket sends soon
+      toSend = std::min(toSend, notSentLowat_);
+    }
     if (connFlowControl_) {
       if (connFlowControl_->getAvailableSend() == 0) {
         VLOG(4) << "Session-level send window is full, skipping remaining "
@@ -1688,8 +2045,8 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork, bool* eom) {
       }
       toSend = std::min(toSend, connFlowControl_->getAvailableSend());
     }
-    txnEgressQueue_.nextEgress(nextEgressResults_,
-                               isSpdyCodecProtocol(codec_->getProtocol()));
+    txnEgressQueue_->nextEgress(nextEgressResults_,
+                                isSpdyCodecProtocol(codec_->getProtocol()));
     CHECK(!nextEgressResults_.empty()); // Queue was non empty, so this must be
     // The maximum we will send for any transaction in this loop
     uint32_t txnMaxToSend = toSend * nextEgressResults_.front().second;
@@ -1738,7 +2095,7 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork, bool* eom) {
     if (needed > 0) {
       VLOG(5) << *this << " writeBuf_.chainLength(): "
               << writeBuf_.chainLength() << " txnEgressQueue_.empty(): "
-              << txnEgressQueue_.empty();
+              << txnEgressQueue_->empty();
 
       if (needed < writeBuf_.chainLength()) {
         // split the next EOM chunk
@@ -1756,10 +2113,81 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork, bool* eom) {
   }
 
   // cork if there are txns with pending egress and room to send them
-  *cork = !txnEgressQueue_.empty() && !isConnWindowFull();
+  *cork = !txnEgressQueue_->empty() && !isConnWindowFull();
   return writeBuf_.move();
 }
 
+void
+HTTPSession::writeFileBytes(WriteSegment* segment,
+                            unique_ptr<IOBuf> placeholders,
+                            size_t len) {
+  // no write is pending, nothing else can come in between
+  auto sock = sock_->getUnderlyingTransport<AsyncSocket>();
+  DCHECK(sock);
+  ssize_t sent = egressFileSegments_.sendTo(sock->getFd(), len);
+  if (sent == folly::to<ssize_t>(len)) {
+    segment->writeSuccess();
+    return;
+  }
+  unique_ptr<IOBuf> data;
+  if (sent >= 0) {
+    VLOG(4) << *this << " sendfile wrote " << sent << " of " << len
+            << " bytes, buffering the rest";
+    folly::IOBufQueue queue(folly::IOBufQueue::cacheChainLength());
+    queue.append(std::move(placeholders));
+    queue.trimStart(sent);
+    data = egressFileSegments_.fill(queue.move());
+  }
+  if (!data) {
+    segment->writeErr(std::max<ssize_t>(sent, 0), AsyncSocketException(
+                        AsyncSocketException::INTERNAL_ERROR,
+                        "failed to send file body", errno));
+    return;
+  }
+  sock_->writeChain(segment, std::move(data), segment->getFlags());
+}
+
+size_t
+HTTPSession::getPacedLength(size_t len) {
+  auto now = getCurrentTime();
+  uint64_t allowed = len;
+  for (auto bucket: {pacingBucket_.get(), pacingGroup_.get()}) {
+    if (bucket) {
+      allowed = std::min(allowed, bucket->getAvailable(now));
+    }
+  }
+  // wait for a burst rather than dribble out tiny writes
+  uint64_t wanted = std::min<uint64_t>(len, HTTPPacingBucket::kMinBurst);
+  if (allowed < wanted) {
+    std::chrono::milliseconds delay(1);
+    for (auto bucket: {pacingBucket_.get(), pacingGroup_.get()}) {
+      if (bucket) {
+        delay = std::max(delay, bucket->getDelay(wanted, now));
+      }
+    }
+    VLOG(4) << *this << " pacing egress for " << delay.count() << "ms";
+    timeout_.scheduleTimeout(&pacingTimeout_, delay);
+    if (sessionStats_) {
+      sessionStats_->recordEgressPacingDelay(delay);
+    }
+    return 0;
+  }
+  for (auto bucket: {pacingBucket_.get(), pacingGroup_.get()}) {
+    if (bucket) {
+      bucket->consume(allowed);
+    }
+  }
+  return allowed;
+}
+
+void
+HTTPSession::requeueEgress(unique_ptr<IOBuf> buf) {
+  folly::IOBufQueue queue(folly::IOBufQueue::cacheChainLength());
+  queue.append(std::move(buf));
+  queue.append(writeBuf_.move());
+  writeBuf_.append(queue.move());
+}
+
 void
 HTTPSession::runLoopCallback() noexcept {
   // We schedule this callback to run at the end of an event
@@ -1779,11 +2207,21 @@ HTTPSession::runLoopCallback() noexcept {
   VLOG(5) << *this << " in loop callback";
 
   for (uint32_t i = 0; i < kMaxWritesPerLoop; ++i) {
+    if (pacingTimeout_.isScheduled()) {
+      break;
+    }
+    if (writableHandler_.isHandlerRegistered()) {
+      // wait for the socket to send most of what it has
+      if (egressBlockedSince_ == TimePoint() && hasMoreWrites()) {
+        egressBlockedSince_ = getCurrentTime();
+      }
+      break;
+    }
     bodyBytesPerWriteBuf_ = 0;
     if (isPrioritySampled()) {
       invokeOnAllTransactions(
         &HTTPTransaction::updateContentionsCount,
-        txnEgressQueue_.numPendingEgress());
+        txnEgressQueue_->numPendingEgress());
     }
 
     bool cork = true;
@@ -1802,6 +2240,39 @@ HTTPSession::runLoopCallback() noexcept {
       return;
     }
 
+    bool fileBytes = false;
+    if (!egressFileSegments_.empty()) {
+      // file bytes and buffers are written separately, put back what
+      // follows the first run of either
+      size_t runLen = HTTPFileSegments::getRunLength(*writeBuf, &fileBytes);
+      if (runLen < len) {
+        folly::IOBufQueue queue(folly::IOBufQueue::cacheChainLength());
+        queue.append(std::move(writeBuf));
+        writeBuf = queue.split(runLen);
+        requeueEgress(queue.move());
+        len = runLen;
+        cork = true;
+        eom = false;
+      }
+    }
+
+    if (isEgressPaced()) {
+      size_t pacedLen = getPacedLength(len);
+      if (pacedLen == 0) {
+        requeueEgress(std::move(writeBuf));
+        break;
+      }
+      if (pacedLen < len) {
+        folly::IOBufQueue queue(folly::IOBufQueue::cacheChainLength());
+        queue.append(std::move(writeBuf));
+        writeBuf = queue.split(pacedLen);
+        requeueEgress(queue.move());
+        len = pacedLen;
+        cork = true;
+        eom = false;
+      }
+    }
+
     if (isPrioritySampled()) {
       invokeOnAllTransactions(
         &HTTPTransaction::updateSessionBytesSheduled,
@@ -1811,6 +2282,13 @@ HTTPSession::runLoopCallback() noexcept {
     WriteSegment* segment = new WriteSegment(this, len);
     segment->setCork(cork);
     segment->setEOR(eom);
+    if (zeroCopyThreshold_ > 0 && len >= zeroCopyThreshold_ && !fileBytes) {
+      // the socket holds on to writeBuf until the kernel is done with it
+      segment->setZeroCopy(true);
+      if (sessionStats_) {
+        sessionStats_->recordZeroCopyWrite(len);
+      }
+    }
 
     pendingWrites_.push_back(*segment);
     if (!writeTimeout_.isScheduled()) {
@@ -1821,7 +2299,11 @@ HTTPSession::runLoopCallback() noexcept {
     VLOG(4) << *this << " writing " << len << ", activeWrites="
              << numActiveWrites_ << " cork=" << cork << " eom=" << eom;
     bytesScheduled_ += len;
-    sock_->writeChain(segment, std::move(writeBuf), segment->getFlags());
+    if (fileBytes) {
+      writeFileBytes(segment, std::move(writeBuf), len);
+    } else {
+      sock_->writeChain(segment, std::move(writeBuf), segment->getFlags());
+    }
     if (numActiveWrites_ > 0) {
       updateWriteCount();
       pendingWriteSizeDelta_ += len;
@@ -1829,9 +2311,14 @@ HTTPSession::runLoopCallback() noexcept {
       break;
     }
     // writeChain can result in a writeError and trigger the shutdown code path
+    if (notSentLowat_ > 0 && !writesShutdown()) {
+      writableHandler_.registerHandler(folly::EventHandler::WRITE);
+    }
   }
   if (numActiveWrites_ == 0 && !writesShutdown() && hasMoreWrites() &&
-      (!connFlowControl_ || connFlowControl_->getAvailableSend())) {
+      (!connFlowControl_ || connFlowControl_->getAvailableSend()) &&
+      !pacingTimeout_.isScheduled() &&
+      !writableHandler_.isHandlerRegistered()) {
     scheduleWrite();
   }
 
@@ -1839,7 +2326,8 @@ HTTPSession::runLoopCallback() noexcept {
     processReadData();
 
     // Install the read callback if necessary
-    if (readsUnpaused() && !sock_->getReadCallback()) {
+    if (readsUnpaused() && !readsYielded_ && !isMemoryBudgetPaused() &&
+        !sock_->getReadCallback()) {
       sock_->setReadCB(this);
     }
   }
@@ -1853,7 +2341,7 @@ HTTPSession::scheduleWrite() {
   // batch helps us packetize the network traffic more efficiently,
   // as well as saving a few system calls.
   if (!isLoopCallbackScheduled() &&
-      (writeBuf_.front() || !txnEgressQueue_.empty())) {
+      (writeBuf_.front() || !txnEgressQueue_->empty())) {
     VLOG(5) << *this << " scheduling write callback";
     sock_->getEventBase()->runInLoop(this);
   }
@@ -1899,7 +2387,7 @@ HTTPSession::updateWriteBufSize(int64_t delta) {
       } else {
         VLOG(3) << "Ignoring redundant resume for " << *this;
       }
-    } else {
+    } else if (!isMemoryBudgetPaused()) {
       VLOG(3) << "Resuming txn egress for " << *this;
       resumeTransactions();
     }
@@ -1958,6 +2446,7 @@ HTTPSession::shutdownTransport(bool shutdownReads,
     if (!hasMoreWrites() &&
         (transactions_.empty() || codec_->closeOnEgressComplete())) {
       writes_ = SocketState::SHUTDOWN;
+      writableHandler_.unregisterHandler();
       if (byteEventTracker_) {
         byteEventTracker_->drainByteEvents();
       }
@@ -2028,7 +2517,9 @@ void HTTPSession::shutdownTransportWithReset(
 
   if (!writesShutdown()) {
     writes_ = SocketState::SHUTDOWN;
+    writableHandler_.unregisterHandler();
     IOBuf::destroy(writeBuf_.move());
+    egressFileSegments_.clear();
     while (!pendingWrites_.empty()) {
       pendingWrites_.front().detach();
       numActiveWrites_--;
@@ -2145,7 +2636,7 @@ HTTPCodec::StreamID HTTPSession::sendPriority(http2::PriorityUpdate pri) {
 size_t HTTPSession::sendPriority(HTTPCodec::StreamID id,
                                  http2::PriorityUpdate pri) {
   auto res = sendPriorityImpl(id, pri);
-  txnEgressQueue_.addOrUpdatePriorityNode(id, pri);
+  txnEgressQueue_->addOrUpdatePriorityNode(id, pri);
   return res;
 }
 
@@ -2165,25 +2656,21 @@ size_t HTTPSession::sendPriorityImpl(HTTPCodec::StreamID id,
 
 HTTPTransaction*
 HTTPSession::findTransaction(HTTPCodec::StreamID streamID) {
-  auto it = transactions_.find(streamID);
-  if (it == transactions_.end()) {
-    return nullptr;
-  } else {
-    return &it->second;
-  }
+  return transactions_.find(streamID);
 }
 
 HTTPTransaction*
 HTTPSession::createTransaction(HTTPCodec::StreamID streamID,
                                HTTPCodec::StreamID assocStreamID,
                                http2::PriorityUpdate priority) {
-  if (!sock_->good() || transactions_.count(streamID)) {
+  if (!sock_->good() || transactions_.contains(streamID)) {
     // Refuse to add a transaction on a closing session or if a
     // transaction of that ID already exists.
     return nullptr;
   }
 
   if (transactions_.empty()) {
+    wakeFromHibernation();
     if (infoCallback_) {
       infoCallback_->onActivateConnection(*this);
     }
@@ -2193,21 +2680,16 @@ HTTPSession::createTransaction(HTTPCodec::StreamID streamID,
     HTTPSessionBase::onCreateTransaction();
   }
 
-  auto matchPair = transactions_.emplace(
-    std::piecewise_construct,
-    std::forward_as_tuple(streamID),
-    std::forward_as_tuple(
-      codec_->getTransportDirection(), streamID, getNumTxnServed(), *this,
-      txnEgressQueue_, timeout_, sessionStats_,
-      codec_->supportsStreamFlowControl(),
-      initialReceiveWindow_,
-      getCodecSendWindowSize(),
-      priority, assocStreamID));
-
-  CHECK(matchPair.second) << "Emplacement failed, despite earlier "
-    "existence check.";
+  HTTPTransaction* txn = transactions_.emplace(
+    streamID,
+    codec_->getTransportDirection(), streamID, getNumTxnServed(), *this,
+    *txnEgressQueue_, timeout_, sessionStats_,
+    codec_->supportsStreamFlowControl(),
+    initialReceiveWindow_,
+    getCodecSendWindowSize(),
+    priority, assocStreamID);
 
-  HTTPTransaction* txn = &matchPair.first->second;
+  CHECK(txn) << "Emplacement failed, despite earlier existence check.";
 
   if (isPrioritySampled()) {
     txn->setPrioritySampled(true /* sampled */);
@@ -2436,11 +2918,11 @@ HTTPSession::hasMoreWrites() const {
     << " numActiveWrites_: " << numActiveWrites_
     << " pendingWrites_.empty(): " << pendingWrites_.empty()
     << " pendingWrites_.size(): " << pendingWrites_.size()
-    << " txnEgressQueue_.empty(): " << txnEgressQueue_.empty();
+    << " txnEgressQueue_.empty(): " << txnEgressQueue_->empty();
 
   return (numActiveWrites_ != 0) ||
     !pendingWrites_.empty() || writeBuf_.front() ||
-    !txnEgressQueue_.empty();
+    !txnEgressQueue_->empty();
 }
 
 void HTTPSession::errorOnAllTransactions(
@@ -2485,18 +2967,18 @@ void HTTPSession::resumeTransactions() {
   CHECK(!inResume_);
   inResume_ = true;
   DestructorGuard g(this);
-  auto resumeFn = [] (HTTP2PriorityQueue&, HTTPCodec::StreamID,
-                      HTTPTransaction *txn, double) {
+  auto resumeFn = [] (HTTPCodec::StreamID, HTTPTransaction *txn) {
     if (txn) {
       txn->resumeEgress();
     }
     return false;
   };
   auto stopFn = [this] {
-    return (transactions_.empty() || egressLimitExceeded());
+    return (transactions_.empty() || egressLimitExceeded() ||
+            isMemoryBudgetPaused());
   };
 
-  txnEgressQueue_.iterateBFS(resumeFn, stopFn, true /* all */);
+  txnEgressQueue_->iterateByPriority(resumeFn, stopFn);
   inResume_ = false;
   if (pendingPause_) {
     VLOG(3) << "Pausing txn egress for " << *this;
@@ -2512,7 +2994,7 @@ void HTTPSession::onConnectionSendWindowOpen() {
 }
 
 void HTTPSession::onConnectionSendWindowClosed() {
-  if(!txnEgressQueue_.empty()) {
+  if(!txnEgressQueue_->empty()) {
     VLOG(4) << *this << " session stalled by flow control";
     if (sessionStats_) {
       sessionStats_->recordSessionStalled();
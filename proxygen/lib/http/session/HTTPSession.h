@@ -12,15 +12,21 @@
 #include <folly/IntrusiveList.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
 #include <folly/io/async/HHWheelTimer.h>
 #include <proxygen/lib/http/HTTPConstants.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/codec/FlowControlFilter.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
 #include <proxygen/lib/http/session/HTTPEvent.h>
+#include <proxygen/lib/http/session/HTTPExtensiblePriorityQueue.h>
+#include <proxygen/lib/http/session/HTTPReadBufferPool.h>
+#include <proxygen/lib/http/session/HTTPPacingBucket.h>
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/http/session/HTTPTransactionTable.h>
 #include <queue>
 #include <set>
 #include <folly/io/async/AsyncSocket.h>
@@ -103,13 +109,121 @@ class HTTPSession:
   void setEgressSettings(const SettingsList& inSettings) override;
 
   bool getHTTP2PrioritiesEnabled() const override {
-    return HTTPSessionBase::getHTTP2PrioritiesEnabled();
+    // RFC 7540 priorities give way to extensible priorities
+    return HTTPSessionBase::getHTTP2PrioritiesEnabled() &&
+      !extensiblePrioritiesEnabled_;
   }
 
   void setHTTP2PrioritiesEnabled(bool enabled) override {
     HTTPSessionBase::setHTTP2PrioritiesEnabled(enabled);
   }
 
+  /**
+   * Schedule egress by the extensible priorities of RFC 9218 instead of the
+   * RFC 7540 dependency tree. Only HTTP/2 sessions support them, and this
+   * must be called before the session starts. The session announces
+   * SETTINGS_NO_RFC7540_PRIORITIES, and takes the priority of each stream
+   * from its priority header or PRIORITY_UPDATE frames.
+   */
+  void setExtensiblePrioritiesEnabled(bool enabled);
+
+  bool getExtensiblePrioritiesEnabled() const {
+    return extensiblePrioritiesEnabled_;
+  }
+
+  /**
+   * Hibernate once the session has had no transactions for the given time:
+   * free what can be rebuilt, such as the header compression tables, until
+   * the next transaction. 0, the default, disables hibernation.
+   */
+  void setHibernateTimeout(std::chrono::milliseconds timeout) {
+    hibernateTimeout_.setTimeoutDuration(timeout);
+  }
+
+  std::chrono::milliseconds getHibernateTimeout() const {
+    return hibernateTimeout_.getTimeoutDuration();
+  }
+
+  bool isHibernating() const {
+    return hibernating_;
+  }
+
+  /**
+   * Send writes of at least threshold bytes with MSG_ZEROCOPY, so the
+   * kernel reads large bodies straight from their IOBufs. The socket keeps
+   * the IOBufs of such a write until the kernel reports it is done with
+   * them, so body buffers must not be modified once sent. Only plaintext
+   * AsyncSocket transports on kernels with SO_ZEROCOPY support it; 0, the
+   * default, disables it.
+   */
+  void setZeroCopyThreshold(size_t threshold);
+
+  size_t getZeroCopyThreshold() const {
+    return zeroCopyThreshold_;
+  }
+
+  /**
+   * Pace egress to rate bytes per second, in bursts of up to burst bytes.
+   * With useSocketPacing the kernel paces the socket through
+   * SO_MAX_PACING_RATE when it supports it, the session paces it otherwise.
+   * A rate of 0, the default, disables pacing.
+   */
+  void setEgressPacingRate(uint64_t rate, uint64_t burst,
+                           bool useSocketPacing = false);
+
+  /**
+   * Also pace egress with a bucket shared by other sessions of this thread,
+   * such as those of a class of clients. nullptr removes it.
+   */
+  void setEgressPacingGroup(std::shared_ptr<HTTPPacingBucket> group) {
+    pacingGroup_ = std::move(group);
+  }
+
+  bool isEgressPaced() const {
+    return pacingBucket_ || pacingGroup_;
+  }
+
+  /**
+   * Set TCP_NOTSENT_LOWAT on the socket and keep no more than about lowat
+   * bytes queued in it: after each write the session waits for the socket
+   * to be writable again, that is until the kernel has less than lowat
+   * bytes left unsent, before it picks the next egress. Responses that
+   * come later then do not queue behind a full send buffer, which keeps
+   * priorities effective. Needs an AsyncSocket on Linux 3.12 or later, 0,
+   * the default, disables it.
+   */
+  void setNotSentLowat(uint32_t lowat);
+
+  uint32_t getNotSentLowat() const {
+    return notSentLowat_;
+  }
+
+  /**
+   * Total time egress was pending while the session waited for the socket
+   * to become writable under TCP_NOTSENT_LOWAT.
+   */
+  std::chrono::milliseconds getEgressBlockedTime() const {
+    return egressBlockedTime_;
+  }
+
+  /**
+   * Parse at most bytes of ingress, or for at most time, before giving the
+   * event loop back to other connections; parsing resumes from a loop
+   * callback. The budget is checked between codec calls, so it may be
+   * overrun by a frame. 0 leaves either unbounded, the default.
+   */
+  void setReadBudget(size_t bytes, std::chrono::microseconds time) {
+    readByteBudget_ = bytes;
+    readTimeBudget_ = time;
+  }
+
+  /**
+   * Number of times the session ran out of read budget and yielded.
+   */
+  uint64_t getReadBudgetExhaustions() const {
+    return readBudgetExhaustions_;
+  }
+
   const folly::SocketAddress& getLocalAddress() const noexcept override {
     return HTTPSessionBase::getLocalAddress();
   }
@@ -322,6 +436,26 @@ class HTTPSession:
   void readTimeoutExpired() noexcept;
   void writeTimeoutExpired() noexcept;
   void flowControlTimeoutExpired() noexcept;
+  void hibernateTimeoutExpired() noexcept;
+  void pacingTimeoutExpired() noexcept;
+  void socketWritable() noexcept;
+
+  // HTTPMemoryBudget::Consumer methods
+  void onMemoryBudgetPaused() noexcept override;
+  void onMemoryBudgetResumed() noexcept override;
+
+  /**
+   * Start the hibernate timer, if enabled. The session must be idle.
+   */
+  void scheduleHibernateTimeout();
+
+  void cancelHibernateTimeout();
+
+  /**
+   * Leave hibernation, or stop the hibernate timer, as a transaction
+   * starts.
+   */
+  void wakeFromHibernation();
 
   // AsyncTransportWrapper::ReadCallback methods
   void getReadBuffer(void** buf, size_t* bufSize) override;
@@ -329,6 +463,11 @@ class HTTPSession:
   bool isBufferMovable() noexcept override;
   void readBufferAvailable(std::unique_ptr<folly::IOBuf>) noexcept override;
   void processReadData();
+
+  /**
+   * Stop reading until the loop callback, which parses what is left.
+   */
+  void yieldReads();
   void readEOF() noexcept override;
   void readErr(
       const folly::AsyncSocketException&) noexcept override;
@@ -365,6 +504,8 @@ class HTTPSession:
   void onSettingsAck()  override;
   void onPriority(HTTPCodec::StreamID stream,
                   const HTTPMessage::HTTPPriority&) override;
+  void onExtensiblePriority(HTTPCodec::StreamID stream,
+                            const RFC9218::Priority& pri) override;
   uint32_t numOutgoingStreams() const override { return outgoingStreams_; }
   uint32_t numIncomingStreams() const override { return incomingStreams_; }
 
@@ -394,6 +535,9 @@ class HTTPSession:
   void notifyPendingEgress() noexcept override;
   void notifyIngressBodyProcessed(uint32_t bytes) noexcept override;
   void notifyEgressBodyBuffered(int64_t bytes) noexcept override;
+  bool canSendFileBody() const noexcept override;
+  void takeEgressFileSegments(HTTPFileSegments& segments,
+                              size_t length) noexcept override;
   HTTPTransaction* newPushedTransaction(
     HTTPCodec::StreamID assocStreamId,
     HTTPTransaction::PushHandler* handler) noexcept override;
@@ -554,7 +698,7 @@ class HTTPSession:
 
   /**
    * This function invokes a callback on all transactions. It is safe,
-   * but runs in O(n*log n) and if the callback *adds* transactions,
+   * but runs in O(n) and if the callback *adds* transactions,
    * they will not get the callback.
    */
   template<typename... Args1, typename... Args2>
@@ -578,7 +722,7 @@ class HTTPSession:
 
   /**
    * This function invokes a callback on all transactions. It is safe,
-   * but runs in O(n*log n) and if the callback *adds* transactions,
+   * but runs in O(n) and if the callback *adds* transactions,
    * they will not get the callback.
    */
   void errorOnAllTransactions(ProxygenError err, const std::string& errorMsg);
@@ -625,6 +769,9 @@ class HTTPSession:
   }
 
   void rescheduleLoopCallbacks() {
+    if (notSentLowat_ > 0) {
+      writableHandler_.attachEventBase(sock_->getEventBase());
+    }
     if (!isLoopCallbackScheduled()) {
       sock_->getEventBase()->runInLoop(this);
     }
@@ -642,6 +789,12 @@ class HTTPSession:
     if (shutdownTransportCb_) {
       shutdownTransportCb_->cancelLoopCallback();
     }
+    readBufferReleaser_.cancelLoopCallback();
+    releaseReadBuffer();
+    if (notSentLowat_ > 0) {
+      writableHandler_.unregisterHandler();
+      writableHandler_.detachEventBase();
+    }
   }
 
   // protected members
@@ -663,10 +816,47 @@ class HTTPSession:
   /** Chain of ingress IOBufs */
   folly::IOBufQueue readBuf_{folly::IOBufQueue::cacheChainLength()};
 
-  /** Priority tree of transactions */
-  HTTP2PriorityQueue txnEgressQueue_;
+  /**
+   * Buffer borrowed from the HTTPReadBufferPool of the thread for the
+   * current read, returned once the read is parsed.
+   */
+  std::unique_ptr<folly::IOBuf> borrowedReadBuf_;
+
+  /**
+   * Size of the buffer to borrow for the next read, following the size of
+   * the recent reads, never more than maxReadBufferSize.
+   */
+  uint32_t readSizeHint_;
+
+  /**
+   * Returns the borrowed buffer at the end of the loop when the transport
+   * asked for a buffer but did not read anything into it.
+   */
+  class ReadBufferReleaser : public folly::EventBase::LoopCallback {
+   public:
+    explicit ReadBufferReleaser(HTTPSession* session) : session_(session) {}
+
+    void runLoopCallback() noexcept override {
+      session_->releaseReadBuffer();
+    }
+   private:
+    HTTPSession* session_;
+  };
+  ReadBufferReleaser readBufferReleaser_;
+
+  /**
+   * Transactions with pending egress, scheduled by RFC 7540 priorities
+   * (HTTP2PriorityQueue) or RFC 9218 ones (HTTPExtensiblePriorityQueue)
+   */
+  std::unique_ptr<HTTPEgressQueue> txnEgressQueue_;
 
-  std::map<HTTPCodec::StreamID, HTTPTransaction> transactions_;
+  /**
+   * RFC 9218 priorities received in PRIORITY_UPDATE frames for streams
+   * not opened yet, bounded by the number of concurrent streams
+   */
+  std::map<HTTPCodec::StreamID, RFC9218::Priority> pendingPriorityUpdates_;
+
+  HTTPTransactionTable<HTTPTransaction> transactions_;
 
   /** Count of transactions awaiting input */
   uint32_t liveTransactions_{0};
@@ -735,6 +925,18 @@ class HTTPSession:
 
   http2::PriorityUpdate getMessagePriority(const HTTPMessage* msg);
 
+  /**
+   * Copy the unparsed bytes of the borrowed read buffer out, and return it
+   * to the pool.
+   */
+  void releaseReadBuffer();
+
+  /**
+   * Set the RFC 9218 priority of a new ingress transaction from a pending
+   * PRIORITY_UPDATE or the priority header of msg.
+   */
+  void applyExtensiblePriority(HTTPTransaction* txn, const HTTPMessage* msg);
+
   bool isConnWindowFull() const {
     return connFlowControl_ && connFlowControl_->getAvailableSend() == 0;
   }
@@ -844,6 +1046,14 @@ class HTTPSession:
       }
     }
 
+    void setZeroCopy(bool zeroCopy) {
+      if (zeroCopy) {
+        flags_ = flags_ | folly::WriteFlags::WRITE_MSG_ZEROCOPY;
+      } else {
+        unSet(flags_, folly::WriteFlags::WRITE_MSG_ZEROCOPY);
+      }
+    }
+
     /**
      * Clear the session. This is used if the session
      * does not want to receive future notification about this segment.
@@ -881,6 +1091,31 @@ class HTTPSession:
     folly::IntrusiveList<WriteSegment, &WriteSegment::listHook>;
   WriteSegmentList pendingWrites_;
 
+  /**
+   * Write the file bytes standing behind placeholders, the next len bytes
+   * of egress, with sendfile. What the socket has no room for is read into
+   * buffers and written the regular way.
+   */
+  void writeFileBytes(WriteSegment* segment,
+                      std::unique_ptr<folly::IOBuf> placeholders,
+                      size_t len);
+
+  /**
+   * The files behind the placeholders of writeBuf_.
+   */
+  HTTPFileSegments egressFileSegments_;
+
+  /**
+   * How much of the next len bytes of egress pacing lets out now. If it is
+   * 0, the pacing timeout fires once enough can go.
+   */
+  size_t getPacedLength(size_t len);
+
+  /**
+   * Put buf back at the front of writeBuf_, to be sent next.
+   */
+  void requeueEgress(std::unique_ptr<folly::IOBuf> buf);
+
   /**
    * Connection level flow control for SPDY >= 3.1 and HTTP/2
    */
@@ -921,6 +1156,34 @@ class HTTPSession:
    */
   uint64_t bytesScheduled_{0};
 
+  /**
+   * Smallest write sent with MSG_ZEROCOPY, 0 if disabled.
+   */
+  size_t zeroCopyThreshold_{0};
+
+  /**
+   * The pacing buckets of this session, and of its group of sessions.
+   */
+  std::unique_ptr<HTTPPacingBucket> pacingBucket_;
+  std::shared_ptr<HTTPPacingBucket> pacingGroup_;
+
+  /**
+   * TCP_NOTSENT_LOWAT of the socket, 0 if not set. Since when egress has
+   * been waiting for the socket, and for how long in total.
+   */
+  uint32_t notSentLowat_{0};
+  TimePoint egressBlockedSince_{};
+  std::chrono::milliseconds egressBlockedTime_{0};
+
+  /**
+   * Ingress parsed per event loop iteration, 0 if unbounded. readsYielded_
+   * is set while the session waits for its loop callback to parse more.
+   */
+  size_t readByteBudget_{0};
+  std::chrono::microseconds readTimeBudget_{0};
+  uint64_t readBudgetExhaustions_{0};
+  bool readsYielded_{false};
+
   /**
    * The net change this event loop in the amount of buffered bytes
    * for all this session's txns and socket write buffer.
@@ -933,9 +1196,9 @@ class HTTPSession:
   uint64_t bodyBytesPerWriteBuf_{0};
 
   /**
-   * Container to hold the results of HTTP2PriorityQueue::nextEgress
+   * Container to hold the results of HTTPEgressQueue::nextEgress
    */
-  HTTP2PriorityQueue::NextEgressResult nextEgressResults_;
+  HTTPEgressQueue::NextEgressResult nextEgressResults_;
 
   /**
    * Max number of bytes to egress per session
@@ -1004,6 +1267,54 @@ class HTTPSession:
   };
   DrainTimeout drainTimeout_;
 
+  class HibernateTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit HibernateTimeout(HTTPSession* session) : session_(session) {}
+    ~HibernateTimeout() override {}
+
+    void timeoutExpired() noexcept override {
+      session_->hibernateTimeoutExpired();
+    }
+
+    std::chrono::milliseconds getTimeoutDuration() const {
+      return duration_;
+    }
+
+    void setTimeoutDuration(std::chrono::milliseconds duration) {
+      duration_ = duration;
+    }
+   private:
+    HTTPSession* session_;
+    std::chrono::milliseconds duration_{std::chrono::milliseconds(0)};
+  };
+  HibernateTimeout hibernateTimeout_;
+
+  class PacingTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit PacingTimeout(HTTPSession* session) : session_(session) {}
+    ~PacingTimeout() override {}
+
+    void timeoutExpired() noexcept override {
+      session_->pacingTimeoutExpired();
+    }
+   private:
+    HTTPSession* session_;
+  };
+  PacingTimeout pacingTimeout_;
+
+  class WritableHandler : public folly::EventHandler {
+   public:
+    explicit WritableHandler(HTTPSession* session) : session_(session) {}
+    ~WritableHandler() override {}
+
+    void handlerReady(uint16_t /*events*/) noexcept override {
+      session_->socketWritable();
+    }
+   private:
+    HTTPSession* session_;
+  };
+  WritableHandler writableHandler_;
+
   enum SocketState {
     UNPAUSED = 0,
     PAUSED = 1,
@@ -1022,6 +1333,8 @@ class HTTPSession:
   bool inLoopCallback_:1;
   bool inResume_:1;
   bool pendingPause_:1;
+  bool extensiblePrioritiesEnabled_:1;
+  bool hibernating_:1;
 };
 
 
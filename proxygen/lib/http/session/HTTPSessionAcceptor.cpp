@@ -12,6 +12,7 @@
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/HTTPDefaultSessionCodecFactory.h>
 #include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
+#include <proxygen/lib/http/session/HTTPSessionStats.h>
 
 using folly::AsyncSocket;
 using folly::SocketAddress;
@@ -31,7 +32,8 @@ HTTPSessionAcceptor::HTTPSessionAcceptor(
   std::shared_ptr<HTTPCodecFactory> codecFactory):
     HTTPAcceptor(accConfig),
     codecFactory_(codecFactory),
-    simpleController_(this) {
+    simpleController_(this),
+    overloadController_(this) {
   if (!codecFactory_) {
     codecFactory_ =
         std::make_shared<HTTPDefaultSessionCodecFactory>(accConfig_);
@@ -41,6 +43,61 @@ HTTPSessionAcceptor::HTTPSessionAcceptor(
 HTTPSessionAcceptor::~HTTPSessionAcceptor() {
 }
 
+void HTTPSessionAcceptor::init(folly::AsyncServerSocket* serverSocket,
+                               folly::EventBase* eventBase,
+                               wangle::SSLStats* stat) {
+  HTTPAcceptor::init(serverSocket, eventBase, stat);
+  if (accConfig_.maxEventLoopLag.count() > 0 ||
+      accConfig_.maxEventLoopQueueDepth > 0) {
+    eventLoopMonitor_ = std::make_unique<EventLoopMonitor>(
+      eventBase, accConfig_.eventLoopCheckInterval, this);
+    eventLoopMonitor_->start();
+  }
+}
+
+void HTTPSessionAcceptor::onEventLoopSample(std::chrono::microseconds lag,
+                                            size_t queueDepth) noexcept {
+  if (downstreamSessionStats_) {
+    downstreamSessionStats_->recordEventLoopLag(lag);
+    downstreamSessionStats_->recordEventLoopQueueDepth(queueDepth);
+  }
+  bool overloaded =
+    (accConfig_.maxEventLoopLag.count() > 0 &&
+     lag >= accConfig_.maxEventLoopLag) ||
+    (accConfig_.maxEventLoopQueueDepth > 0 &&
+     queueDepth >= accConfig_.maxEventLoopQueueDepth);
+  if (overloaded != overloaded_) {
+    VLOG(2) << (overloaded ? "Overloaded" : "No longer overloaded")
+            << ", event loop lag=" << lag.count()
+            << "us queue depth=" << queueDepth;
+    overloaded_ = overloaded;
+  }
+  if (overloaded_ && accConfig_.overloadIdleConnectionsToDrop > 0) {
+    auto dropped = dropIdleConnections(
+      accConfig_.overloadIdleConnectionsToDrop);
+    if (dropped > 0 && downstreamSessionStats_) {
+      downstreamSessionStats_->recordOverloadDroppedIdleConnections(dropped);
+    }
+  }
+}
+
+bool HTTPSessionAcceptor::canAccept(const SocketAddress& address) {
+  if (overloaded_ && !accConfig_.overloadRespondWith503) {
+    if (downstreamSessionStats_) {
+      downstreamSessionStats_->recordOverloadRejectedConnection();
+    }
+    return false;
+  }
+  return HTTPAcceptor::canAccept(address);
+}
+
+HTTPTransactionHandler*
+HTTPSessionAcceptor::OverloadController::getRequestHandler(
+    HTTPTransaction& txn, HTTPMessage* /*msg*/) {
+  auto errorPage = acceptor_->getErrorPage(txn.getLocalAddress());
+  return createErrorHandler(503, "Service Unavailable", errorPage);
+}
+
 const HTTPErrorPage* HTTPSessionAcceptor::getErrorPage(
     const SocketAddress& addr) const {
   const HTTPErrorPage* errorPage = nullptr;
@@ -71,7 +128,15 @@ void HTTPSessionAcceptor::onNewConnection(
     return;
   }
 
-  auto controller = getController();
+  // Told to go away after a 503, its session is drained once started
+  bool shed = overloaded_ && accConfig_.overloadRespondWith503;
+  HTTPSessionController* controller = getController();
+  if (shed) {
+    controller = &overloadController_;
+    if (downstreamSessionStats_) {
+      downstreamSessionStats_->recordOverloadRejectedConnection();
+    }
+  }
   SocketAddress localAddress;
   try {
     sock->getLocalAddress(&localAddress);
@@ -105,6 +170,24 @@ void HTTPSessionAcceptor::onNewConnection(
 
   // set HTTP2 priorities flag on session object
   session->setHTTP2PrioritiesEnabled(accConfig_.HTTP2PrioritiesEnabled);
+  session->setExtensiblePrioritiesEnabled(
+    accConfig_.extensiblePrioritiesEnabled);
+  session->setHibernateTimeout(accConfig_.hibernateTimeout);
+  session->setZeroCopyThreshold(accConfig_.zeroCopyThreshold);
+  session->setEgressPacingRate(accConfig_.egressPacingRate,
+                               accConfig_.egressPacingBurst,
+                               accConfig_.useSocketPacing);
+  session->setEgressPacingGroup(getEgressPacingGroup(*peerAddress));
+  session->setNotSentLowat(accConfig_.notSentLowat);
+  session->setReadBudget(accConfig_.readByteBudget,
+                         accConfig_.readTimeBudget);
+  if (accConfig_.memoryBudgetHighWater > 0) {
+    auto& budget = HTTPMemoryBudget::get();
+    budget.setLimits(accConfig_.memoryBudgetHighWater,
+                     accConfig_.memoryBudgetLowWater);
+    budget.attachEventBase(getEventBase());
+    session->setMemoryBudget(&budget);
+  }
 
   // set flow control parameters
   session->setFlowControl(accConfig_.initialReceiveWindow,
@@ -116,6 +199,34 @@ void HTTPSessionAcceptor::onNewConnection(
   session->setSessionStats(downstreamSessionStats_);
   Acceptor::addConnection(session);
   session->startNow();
+  if (shed) {
+    session->drain();
+  }
+}
+
+std::shared_ptr<HTTPPacingBucket> HTTPSessionAcceptor::getEgressPacingGroup(
+    const SocketAddress& peerAddress) {
+  const auto& classes = accConfig_.egressPacingClasses;
+  if (classes.empty() || !peerAddress.isFamilyInet()) {
+    return nullptr;
+  }
+  egressPacingGroups_.resize(classes.size());
+  auto addr = peerAddress.getIPAddress();
+  for (size_t i = 0; i < classes.size(); i++) {
+    const auto& pacingClass = classes[i];
+    if (pacingClass.rate == 0 ||
+        addr.family() != pacingClass.network.first.family() ||
+        !addr.inSubnet(pacingClass.network.first,
+                       pacingClass.network.second)) {
+      continue;
+    }
+    if (!egressPacingGroups_[i]) {
+      egressPacingGroups_[i] = std::make_shared<HTTPPacingBucket>(
+        pacingClass.rate, pacingClass.burst);
+    }
+    return egressPacingGroups_[i];
+  }
+  return nullptr;
 }
 
 size_t HTTPSessionAcceptor::dropIdleConnections(size_t num) {
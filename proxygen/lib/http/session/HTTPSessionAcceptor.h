@@ -15,6 +15,7 @@
 #include <proxygen/lib/http/session/HTTPErrorPage.h>
 #include <proxygen/lib/http/session/SimpleController.h>
 #include <proxygen/lib/services/HTTPAcceptor.h>
+#include <proxygen/lib/utils/EventLoopMonitor.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 
 namespace proxygen {
@@ -27,7 +28,8 @@ class HTTPSessionStats;
  */
 class HTTPSessionAcceptor:
   public HTTPAcceptor,
-  private HTTPSessionBase::InfoCallback {
+  private HTTPSessionBase::InfoCallback,
+  private EventLoopMonitor::Callback {
 public:
   explicit HTTPSessionAcceptor(const AcceptorConfiguration& accConfig);
   explicit HTTPSessionAcceptor(const AcceptorConfiguration& accConfig,
@@ -105,6 +107,25 @@ public:
     sessionInfoCb_ = cb;
   }
 
+  void init(folly::AsyncServerSocket* serverSocket,
+            folly::EventBase* eventBase,
+            wangle::SSLStats* stat = nullptr) override;
+
+  /**
+   * Whether the event loop of this acceptor is past maxEventLoopLag or
+   * maxEventLoopQueueDepth as of the last sample.
+   */
+  bool isOverloaded() const {
+    return overloaded_;
+  }
+
+  /**
+   * The monitor of the event loop, nullptr if no overload check is enabled.
+   */
+  const EventLoopMonitor* getEventLoopMonitor() const {
+    return eventLoopMonitor_.get();
+  }
+
 protected:
   /**
    * This function is invoked when a new session is created to get the
@@ -134,12 +155,41 @@ protected:
 
   virtual size_t dropIdleConnections(size_t num);
 
+  /**
+   * Refuses connections while overloaded, unless they get a 503.
+   */
+  bool canAccept(const folly::SocketAddress& address) override;
+
   virtual void onSessionCreationError(ProxygenError /*error*/) {}
 
+  /**
+   * The pacing bucket shared by the sessions of the egress pacing class of
+   * peerAddress, nullptr if it has none.
+   */
+  std::shared_ptr<HTTPPacingBucket> getEgressPacingGroup(
+    const folly::SocketAddress& peerAddress);
+
  private:
   HTTPSessionAcceptor(const HTTPSessionAcceptor&) = delete;
   HTTPSessionAcceptor& operator=(const HTTPSessionAcceptor&) = delete;
 
+  /**
+   * Answers every request with a 503, for the sessions accepted while
+   * overloaded.
+   */
+  class OverloadController : public SimpleController {
+   public:
+    explicit OverloadController(HTTPSessionAcceptor* acceptor)
+        : SimpleController(acceptor) {}
+
+    HTTPTransactionHandler* getRequestHandler(HTTPTransaction& txn,
+                                              HTTPMessage* msg) override;
+  };
+
+  // EventLoopMonitor::Callback
+  void onEventLoopSample(std::chrono::microseconds lag,
+                         size_t queueDepth) noexcept override;
+
   /** General-case error page generator */
   std::unique_ptr<HTTPErrorPage> defaultErrorPage_;
 
@@ -150,8 +200,16 @@ protected:
 
   SimpleController simpleController_;
 
+  OverloadController overloadController_;
+
   HTTPSession::InfoCallback* sessionInfoCb_{nullptr};
 
+  /** Pacing buckets of the egress pacing classes, created on first use */
+  std::vector<std::shared_ptr<HTTPPacingBucket>> egressPacingGroups_;
+
+  std::unique_ptr<EventLoopMonitor> eventLoopMonitor_;
+  bool overloaded_{false};
+
   /**
    * 0.0.0.0:0, a valid address to use if getsockname() or getpeername() fails
    */
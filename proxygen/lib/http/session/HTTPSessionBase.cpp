@@ -45,6 +45,28 @@ HTTPSessionBase::HTTPSessionBase(
   setController(controller);
 }
 
+HTTPSessionBase::~HTTPSessionBase() {
+  if (memoryBudget_) {
+    memoryBudget_->remove(*this);
+  }
+}
+
+void HTTPSessionBase::setMemoryBudget(HTTPMemoryBudget* budget) {
+  if (memoryBudget_) {
+    bool wasPaused = isMemoryBudgetPaused();
+    memoryBudget_->remove(*this);
+    memoryBudget_ = nullptr;
+    if (wasPaused) {
+      onMemoryBudgetResumed();
+    }
+  }
+  memoryBudget_ = budget;
+  if (memoryBudget_) {
+    memoryBudget_->add(*this);
+    memoryBudget_->update(*this, pendingReadSize_ + pendingWriteSize_);
+  }
+}
+
 void HTTPSessionBase::runDestroyCallbacks() {
   if (infoCallback_) {
     infoCallback_->onDestroy(*this);
@@ -79,6 +101,9 @@ bool HTTPSessionBase::onBody(std::unique_ptr<folly::IOBuf> chain, size_t length,
   DestructorGuard dg(this);
   auto oldSize = pendingReadSize_;
   pendingReadSize_ += length + padding;
+  if (memoryBudget_) {
+    memoryBudget_->update(*this, length + padding);
+  }
   txn->onIngressBody(std::move(chain), padding);
   if (oldSize < pendingReadSize_) {
     // Transaction must have buffered something and not called
@@ -101,6 +126,9 @@ bool HTTPSessionBase::notifyBodyProcessed(uint32_t bytes) {
   CHECK_GE(pendingReadSize_, bytes);
   auto oldSize = pendingReadSize_;
   pendingReadSize_ -= bytes;
+  if (memoryBudget_) {
+    memoryBudget_->update(*this, -int64_t(bytes));
+  }
   VLOG(4) << *this << " Dequeued " << bytes << " bytes of ingress. "
     << "Ingress buffer uses " << pendingReadSize_  << " of "
     << readBufLimit_ << " bytes.";
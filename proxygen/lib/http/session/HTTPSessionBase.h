@@ -13,6 +13,7 @@
 #include <wangle/acceptor/ManagedConnection.h>
 #include <wangle/acceptor/TransportInfo.h>
 #include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/http/session/HTTPMemoryBudget.h>
 #include <proxygen/lib/utils/Time.h>
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
 
@@ -27,7 +28,8 @@ public:
   virtual HTTPCodec::StreamID sendPriority(http2::PriorityUpdate pri) = 0;
 };
 
-class HTTPSessionBase : public wangle::ManagedConnection {
+class HTTPSessionBase : public wangle::ManagedConnection,
+                        public HTTPMemoryBudget::Consumer {
  public:
   /**
    * Optional callback interface that the HTTPSessionBase
@@ -74,7 +76,7 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     InfoCallback* infoCallback,
     std::unique_ptr<HTTPCodec> codec);
 
-  virtual ~HTTPSessionBase() {}
+  virtual ~HTTPSessionBase();
 
   /**
    * Set the read buffer limit to be used for all new HTTPSessionBase objects.
@@ -232,6 +234,17 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     readBufLimit_ = limit;
   }
 
+  /**
+   * Account the bytes this session buffers, ingress and egress, to budget,
+   * which may pause the session when its threads' sessions together buffer
+   * too much. nullptr, the default, leaves the session unaccounted.
+   */
+  void setMemoryBudget(HTTPMemoryBudget* budget);
+
+  HTTPMemoryBudget* getMemoryBudget() const {
+    return memoryBudget_;
+  }
+
   /**
    * Start reading from the transport and send any introductory messages
    * to the remote side. This function must be called once per session to
@@ -430,9 +443,21 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     return pendingWriteSize_ > writeBufLimit_;
   }
 
+  // Ingress and egress bytes buffered by the session
+  uint32_t getPendingReadSize() const {
+    return pendingReadSize_;
+  }
+
+  uint64_t getPendingWriteSize() const {
+    return pendingWriteSize_;
+  }
+
   void updatePendingWriteSize(int64_t delta) {
     DCHECK(delta >= 0 || uint64_t(-delta) <= pendingWriteSize_);
     pendingWriteSize_ += delta;
+    if (memoryBudget_) {
+      memoryBudget_->update(*this, delta);
+    }
   }
 
   void onCreateTransaction() {
@@ -586,6 +611,9 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   uint32_t pendingReadSize_{0};
 
+  // Budget pendingReadSize_ and pendingWriteSize_ are accounted to
+  HTTPMemoryBudget* memoryBudget_{nullptr};
+
   bool prioritySample_:1;
   bool h2PrioritiesEnabled_:1;
 };
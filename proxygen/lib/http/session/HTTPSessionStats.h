@@ -27,6 +27,14 @@ class HTTPSessionStats : public TTLBAStats {
   virtual void recordSessionIdleTime(std::chrono::seconds) noexcept {}
   virtual void recordTransactionStalled() noexcept = 0;
   virtual void recordSessionStalled() noexcept = 0;
+  virtual void recordZeroCopyWrite(uint64_t /*bytes*/) noexcept {}
+  virtual void recordEgressPacingDelay(std::chrono::milliseconds) noexcept {}
+  virtual void recordEgressBlockedTime(std::chrono::milliseconds) noexcept {}
+  virtual void recordReadBudgetExhausted() noexcept {}
+  virtual void recordEventLoopLag(std::chrono::microseconds) noexcept {}
+  virtual void recordEventLoopQueueDepth(size_t) noexcept {}
+  virtual void recordOverloadRejectedConnection() noexcept {}
+  virtual void recordOverloadDroppedIdleConnections(size_t) noexcept {}
 };
 
 }
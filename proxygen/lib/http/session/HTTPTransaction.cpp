@@ -32,7 +32,7 @@ HTTPTransaction::HTTPTransaction(TransportDirection direction,
                                  HTTPCodec::StreamID id,
                                  uint32_t seqNo,
                                  Transport& transport,
-                                 HTTP2PriorityQueue& egressQueue,
+                                 HTTPEgressQueue& egressQueue,
                                  const WheelTimerInstance& timeout,
                                  HTTPSessionStats* stats,
                                  bool useFlowControl,
@@ -488,6 +488,7 @@ void HTTPTransaction::markEgressComplete() {
     transport_.notifyEgressBodyBuffered(-deferredEgressBodyBytes);
   }
   deferredEgressBody_.move();
+  egressFileSegments_.clear();
   if (isEnqueued()) {
     dequeue();
   }
@@ -778,6 +779,13 @@ void HTTPTransaction::sendBody(std::unique_ptr<folly::IOBuf> body) {
   notifyTransportPendingEgress();
 }
 
+void HTTPTransaction::sendFileBody(std::shared_ptr<folly::File> file,
+                                   off_t offset,
+                                   size_t length) {
+  egressFileSegments_.append(std::move(file), offset, length);
+  sendBody(HTTPFileSegments::makePlaceholder(length));
+}
+
 bool HTTPTransaction::onWriteReady(const uint32_t maxEgress, double ratio) {
   DestructorGuard g(this);
   DCHECK(isEnqueued());
@@ -919,6 +927,20 @@ void HTTPTransaction::rateLimitTimeoutExpired() {
   notifyTransportPendingEgress();
 }
 
+std::unique_ptr<folly::IOBuf> HTTPTransaction::takeFileBody(
+    std::unique_ptr<folly::IOBuf> body) {
+  size_t fileBytes = HTTPFileSegments::countPlaceholderBytes(*body);
+  if (fileBytes == 0) {
+    return body;
+  }
+  if (transport_.canSendFileBody()) {
+    // the session sends them straight from the file
+    transport_.takeEgressFileSegments(egressFileSegments_, fileBytes);
+    return body;
+  }
+  return egressFileSegments_.fill(std::move(body));
+}
+
 size_t HTTPTransaction::sendEOMNow() {
   size_t nbytes = 0;
   VLOG(4) << "egress EOM on " << *this;
@@ -941,6 +963,18 @@ size_t HTTPTransaction::sendBodyNow(std::unique_ptr<folly::IOBuf> body,
   DCHECK(body);
   DCHECK_GT(bodyLen, 0);
   size_t nbytes = 0;
+  if (!egressFileSegments_.empty()) {
+    body = takeFileBody(std::move(body));
+    if (!body) {
+      HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS,
+                       folly::to<std::string>("failed to read file body,"
+                                              " streamID=", id_));
+      ex.setProxygenError(kErrorWrite);
+      ex.setCodecStatusCode(ErrorCode::INTERNAL_ERROR);
+      onError(ex);
+      return 0;
+    }
+  }
   if (useFlowControl_) {
     CHECK(sendWindow_.reserve(bodyLen));
   }
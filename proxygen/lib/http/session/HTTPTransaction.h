@@ -24,8 +24,9 @@
 #include <proxygen/lib/http/ProxygenErrorEnum.h>
 #include <proxygen/lib/http/Window.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
-#include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
+#include <proxygen/lib/http/session/HTTPEgressQueue.h>
 #include <proxygen/lib/http/session/HTTPEvent.h>
+#include <proxygen/lib/http/session/HTTPFileSegments.h>
 #include <proxygen/lib/http/session/HTTPTransactionEgressSM.h>
 #include <proxygen/lib/http/session/HTTPTransactionIngressSM.h>
 #include <proxygen/lib/utils/Time.h>
@@ -369,6 +370,17 @@ class HTTPTransaction :
 
     virtual void notifyEgressBodyBuffered(int64_t bytes) noexcept = 0;
 
+    /**
+     * Whether sendBody takes file body placeholders, once their file
+     * segments are handed over with takeEgressFileSegments.
+     */
+    virtual bool canSendFileBody() const noexcept {
+      return false;
+    }
+
+    virtual void takeEgressFileSegments(HTTPFileSegments& /*segments*/,
+                                        size_t /*length*/) noexcept {}
+
     virtual const folly::SocketAddress& getLocalAddress()
       const noexcept = 0;
 
@@ -431,7 +443,7 @@ class HTTPTransaction :
                   HTTPCodec::StreamID id,
                   uint32_t seqNo,
                   Transport& transport,
-                  HTTP2PriorityQueue& egressQueue,
+                  HTTPEgressQueue& egressQueue,
                   const WheelTimerInstance& timeout,
                   HTTPSessionStats* stats = nullptr,
                   bool useFlowControl = false,
@@ -788,6 +800,18 @@ class HTTPTransaction :
    */
   virtual void sendBody(std::unique_ptr<folly::IOBuf> body);
 
+  /**
+   * Send length bytes of file, starting at offset, as part of the body.
+   * Flow control, egress pause and byte events treat them as if they had
+   * been passed to sendBody, but they are not read until sent: plaintext
+   * HTTP/1.x sessions send them to the socket with sendfile(2), others
+   * read them into buffers as they go out. The file must keep at least
+   * offset + length bytes until then.
+   */
+  virtual void sendFileBody(std::shared_ptr<folly::File> file,
+                            off_t offset,
+                            size_t length);
+
   /**
    * Write any protocol framing required for the subsequent call(s)
    * to sendBody(). This method does not actually write the message out on
@@ -1078,6 +1102,14 @@ class HTTPTransaction :
    */
   void onPriorityUpdate(const http2::PriorityUpdate& priority);
 
+  /**
+   * Notify of a change of the RFC 9218 priority, which only matters to
+   * sessions scheduling egress by it
+   */
+  void onExtensiblePriorityUpdate(const RFC9218::Priority& priority) {
+    egressQueue_.updateExtensiblePriority(queueHandle_, priority);
+  }
+
   /**
    * Add a callback waiting for this transaction to have a transport with
    * replay protection.
@@ -1180,6 +1212,8 @@ class HTTPTransaction :
   size_t sendBodyNow(std::unique_ptr<folly::IOBuf> body, size_t bodyLen,
                      bool eom);
   size_t sendEOMNow();
+  std::unique_ptr<folly::IOBuf> takeFileBody(
+    std::unique_ptr<folly::IOBuf> body);
   void onDeltaSendWindowSize(int32_t windowDelta);
 
   void notifyTransportPendingEgress();
@@ -1264,6 +1298,11 @@ class HTTPTransaction :
    */
   folly::IOBufQueue deferredEgressBody_{folly::IOBufQueue::cacheChainLength()};
 
+  /**
+   * The files behind the placeholders of deferredEgressBody_.
+   */
+  HTTPFileSegments egressFileSegments_;
+
   const TransportDirection direction_;
   HTTPCodec::StreamID id_;
   uint32_t seqNo_;
@@ -1307,12 +1346,12 @@ class HTTPTransaction :
   /**
    * Reference to our priority queue
    */
-  HTTP2PriorityQueue& egressQueue_;
+  HTTPEgressQueue& egressQueue_;
 
   /**
    * Handle to our position in the priority queue.
    */
-  HTTP2PriorityQueue::Handle queueHandle_;
+  HTTPEgressQueue::Handle queueHandle_;
 
   /**
    * bytes we need to acknowledge to the remote end using a window update
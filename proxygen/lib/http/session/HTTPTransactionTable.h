@@ -0,0 +1,342 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ThreadLocal.h>
+#include <glog/logging.h>
+#include <proxygen/lib/http/codec/HTTPCodec.h>
+
+#include <deque>
+#include <iterator>
+#include <map>
+#include <type_traits>
+#include <utility>
+
+namespace proxygen {
+
+/**
+ * The transactions of a session, by stream ID.
+ *
+ * Stream IDs are handed out in increasing order, by each side for HTTP/2
+ * and SPDY and one after the other for HTTP/1.x, so the live streams of a
+ * session mostly fall in a narrow window of IDs. That window is kept as an
+ * array of slots indexed by the distance to its lowest ID. Streams too far
+ * behind the window, such as a long running push while the client keeps
+ * opening streams, move to a map.
+ *
+ * The transactions themselves are constructed in blocks recycled through a
+ * per thread free list, which all the sessions of an event base share.
+ *
+ * Txn is HTTPTransaction, or a stand in for tests.
+ */
+template <typename Txn>
+class HTTPTransactionTable {
+ public:
+  typedef HTTPCodec::StreamID StreamID;
+
+  // Widest window of IDs kept in the array
+  static const size_t kMaxDenseSpan = 1024;
+
+  // Blocks kept in the free list of a thread
+  static const size_t kMaxPooled = 1024;
+
+  /**
+   * Visits the transactions in increasing stream ID order.
+   */
+  class const_iterator :
+      public std::iterator<std::forward_iterator_tag,
+                           const std::pair<StreamID, Txn*>> {
+   public:
+    const std::pair<StreamID, Txn*>& operator*() const {
+      return cur_;
+    }
+
+    const std::pair<StreamID, Txn*>* operator->() const {
+      return &cur_;
+    }
+
+    const_iterator& operator++() {
+      if (fromDense_) {
+        denseIdx_++;
+      } else {
+        ++sparseIt_;
+      }
+      settle();
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return denseIdx_ == other.denseIdx_ && sparseIt_ == other.sparseIt_;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class HTTPTransactionTable;
+
+    const_iterator(const HTTPTransactionTable& table, size_t denseIdx,
+                   typename std::map<StreamID, Txn*>::const_iterator sparseIt)
+        : table_(&table), denseIdx_(denseIdx), sparseIt_(sparseIt) {
+      settle();
+    }
+
+    // skip the empty slots and pick the lower ID of both containers
+    void settle() {
+      const auto& slots = table_->slots_;
+      while (denseIdx_ < slots.size() && !slots[denseIdx_]) {
+        denseIdx_++;
+      }
+      bool denseEnd = denseIdx_ == slots.size();
+      bool sparseEnd = sparseIt_ == table_->sparse_.end();
+      if (denseEnd && sparseEnd) {
+        return;
+      }
+      StreamID denseId = table_->base_ + denseIdx_;
+      fromDense_ = sparseEnd || (!denseEnd && denseId < sparseIt_->first);
+      if (fromDense_) {
+        cur_ = std::make_pair(denseId, slots[denseIdx_]);
+      } else {
+        cur_ = *sparseIt_;
+      }
+    }
+
+    const HTTPTransactionTable* table_;
+    size_t denseIdx_;
+    typename std::map<StreamID, Txn*>::const_iterator sparseIt_;
+    bool fromDense_{false};
+    std::pair<StreamID, Txn*> cur_;
+  };
+
+  HTTPTransactionTable() {}
+
+  HTTPTransactionTable(const HTTPTransactionTable&) = delete;
+  HTTPTransactionTable& operator=(const HTTPTransactionTable&) = delete;
+
+  ~HTTPTransactionTable() {
+    for (auto txn: slots_) {
+      if (txn) {
+        destroy(txn);
+      }
+    }
+    for (auto& it: sparse_) {
+      destroy(it.second);
+    }
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  // Number of transactions outside of the window
+  size_t sparseSize() const {
+    return sparse_.size();
+  }
+
+  Txn* find(StreamID id) const {
+    if (id >= base_ && id - base_ < slots_.size() && slots_[id - base_]) {
+      return slots_[id - base_];
+    }
+    // the map may also hold IDs within the window, if it grew down to them
+    if (sparse_.empty()) {
+      return nullptr;
+    }
+    auto it = sparse_.find(id);
+    return it == sparse_.end() ? nullptr : it->second;
+  }
+
+  bool contains(StreamID id) const {
+    return find(id) != nullptr;
+  }
+
+  /**
+   * Construct the transaction of stream id from args. Returns nullptr if
+   * the stream already has one.
+   */
+  template <typename... Args>
+  Txn* emplace(StreamID id, Args&&... args) {
+    if (contains(id)) {
+      return nullptr;
+    }
+    void* block = getPool().allocate();
+    Txn* txn;
+    try {
+      txn = new (block) Txn(std::forward<Args>(args)...);
+    } catch (...) {
+      getPool().deallocate(block);
+      throw;
+    }
+    insert(id, txn);
+    return txn;
+  }
+
+  /**
+   * Destroy the transaction of stream id, if any.
+   */
+  void erase(StreamID id) {
+    Txn* txn = nullptr;
+    if (id >= base_ && id - base_ < slots_.size() && slots_[id - base_]) {
+      std::swap(txn, slots_[id - base_]);
+      trim();
+    } else {
+      auto it = sparse_.find(id);
+      if (it != sparse_.end()) {
+        txn = it->second;
+        sparse_.erase(it);
+      }
+    }
+    if (txn) {
+      size_--;
+      destroy(txn);
+    }
+  }
+
+  const_iterator begin() const {
+    return const_iterator(*this, 0, sparse_.begin());
+  }
+
+  const_iterator end() const {
+    return const_iterator(*this, slots_.size(), sparse_.end());
+  }
+
+  /**
+   * The transaction with the n+1-th highest stream ID, nullptr if there
+   * are not that many. Linear, meant for the few streams of an HTTP/1.x
+   * pipeline.
+   */
+  Txn* last(size_t n = 0) const {
+    if (n >= size_) {
+      return nullptr;
+    }
+    auto it = begin();
+    std::advance(it, size_ - n - 1);
+    return it->second;
+  }
+
+ private:
+  union Block {
+    Block* next;
+    typename std::aligned_storage<sizeof(Txn), alignof(Txn)>::type txn;
+  };
+
+  /**
+   * Blocks released by the transactions of a thread, for its next ones. A
+   * block is allocated on its own, so it can outlive the thread that made
+   * it when a session moves to another event base.
+   */
+  class Pool {
+   public:
+    ~Pool() {
+      while (free_) {
+        Block* block = free_;
+        free_ = block->next;
+        delete block;
+      }
+    }
+
+    void* allocate() {
+      if (!free_) {
+        return new Block;
+      }
+      Block* block = free_;
+      free_ = block->next;
+      freeCount_--;
+      return block;
+    }
+
+    void deallocate(void* ptr) {
+      Block* block = static_cast<Block*>(ptr);
+      if (freeCount_ >= kMaxPooled) {
+        delete block;
+        return;
+      }
+      block->next = free_;
+      free_ = block;
+      freeCount_++;
+    }
+
+   private:
+    Block* free_{nullptr};
+    size_t freeCount_{0};
+  };
+
+  static Pool& getPool() {
+    static folly::ThreadLocal<Pool> pool;
+    return *pool;
+  }
+
+  static void destroy(Txn* txn) {
+    txn->~Txn();
+    getPool().deallocate(txn);
+  }
+
+  void insert(StreamID id, Txn* txn) {
+    size_++;
+    if (slots_.empty()) {
+      base_ = id;
+      slots_.push_back(txn);
+      return;
+    }
+    if (id < base_) {
+      if (base_ - id + slots_.size() > kMaxDenseSpan) {
+        sparse_.emplace(id, txn);
+        return;
+      }
+      slots_.insert(slots_.begin(), base_ - id, nullptr);
+      base_ = id;
+    } else if (id - base_ >= kMaxDenseSpan) {
+      // make room at the front, the oldest streams move to the map
+      while (!slots_.empty() && id - base_ >= kMaxDenseSpan) {
+        if (slots_.front()) {
+          sparse_.emplace(base_, slots_.front());
+        }
+        slots_.pop_front();
+        base_++;
+        trim();
+      }
+      if (slots_.empty()) {
+        base_ = id;
+      }
+    }
+    if (id - base_ >= slots_.size()) {
+      slots_.resize(id - base_ + 1, nullptr);
+    }
+    slots_[id - base_] = txn;
+  }
+
+  // drop the empty slots at both ends
+  void trim() {
+    while (!slots_.empty() && !slots_.back()) {
+      slots_.pop_back();
+    }
+    while (!slots_.empty() && !slots_.front()) {
+      slots_.pop_front();
+      base_++;
+    }
+  }
+
+  std::deque<Txn*> slots_;
+  StreamID base_{0};
+  std::map<StreamID, Txn*> sparse_;
+  size_t size_{0};
+};
+
+template <typename Txn>
+const size_t HTTPTransactionTable<Txn>::kMaxDenseSpan;
+
+template <typename Txn>
+const size_t HTTPTransactionTable<Txn>::kMaxPooled;
+
+}
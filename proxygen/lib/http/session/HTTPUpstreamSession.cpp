@@ -67,14 +67,16 @@ void HTTPUpstreamSession::startNow() {
   HTTPSession::startNow();
   // Upstream specific:
   // create virtual priority nodes and send Priority frames to peer if necessary
-  if (priorityMapFactory_) {
+  if (getExtensiblePrioritiesEnabled()) {
+    // no RFC 7540 priority tree to build
+  } else if (priorityMapFactory_) {
     priorityAdapter_ = priorityMapFactory_->createVirtualStreams(this);
     scheduleWrite();
   } else {
     // TODO/T17420249 Move this to the PriorityAdapter and remove it from the
     // codec.
     auto bytes = codec_->addPriorityNodes(
-        txnEgressQueue_,
+        *txnEgressQueue_,
         writeBuf_,
         maxVirtualPriorityLevel_);
     if (bytes) {
@@ -119,7 +121,7 @@ HTTPTransaction::Handler* HTTPUpstreamSession::getTransactionTimeoutHandler(
 
 bool HTTPUpstreamSession::allTransactionsStarted() const {
   for (const auto& txn: transactions_) {
-    if (!txn.second.isPushed() && !txn.second.isEgressStarted()) {
+    if (!txn.second->isPushed() && !txn.second->isEgressStarted()) {
       return false;
     }
   }
@@ -146,7 +148,7 @@ bool HTTPUpstreamSession::onNativeProtocolUpgrade(
                                          protocolString);
   if (ret) {
     auto bytes = codec_->addPriorityNodes(
-      txnEgressQueue_,
+      *txnEgressQueue_,
       writeBuf_,
       maxVirtualPriorityLevel_);
     if (bytes) {
@@ -159,7 +161,7 @@ bool HTTPUpstreamSession::onNativeProtocolUpgrade(
 void HTTPUpstreamSession::detachTransactions() {
   while (!transactions_.empty()) {
     auto txn = transactions_.begin();
-    detach(&txn->second);
+    detach(txn->second);
   }
 }
 
@@ -179,7 +181,7 @@ HTTPUpstreamSession::attachThreadLocals(
   HTTPSessionStats* stats, FilterIteratorFn fn,
   HeaderCodec::Stats* headerCodecStats,
   HTTPSessionController* controller) {
-  txnEgressQueue_.attachThreadLocals(timeout);
+  txnEgressQueue_->attachThreadLocals(timeout);
   timeout_ = timeout;
   setController(controller);
   setSessionStats(stats);
@@ -194,12 +196,14 @@ HTTPUpstreamSession::attachThreadLocals(
   codec_->setHeaderCodecStats(headerCodecStats);
   resumeReadsImpl();
   rescheduleLoopCallbacks();
+  scheduleHibernateTimeout();
 }
 
 void
 HTTPUpstreamSession::detachThreadLocals(bool detachSSLContext) {
   CHECK(transactions_.empty());
   cancelLoopCallbacks();
+  cancelHibernateTimeout();
   pauseReadsImpl();
   if (sock_) {
     auto sslSocket = sock_->getUnderlyingTransport<folly::AsyncSSLSocket>();
@@ -208,7 +212,7 @@ HTTPUpstreamSession::detachThreadLocals(bool detachSSLContext) {
     }
     sock_->detachEventBase();
   }
-  txnEgressQueue_.detachThreadLocals();
+  txnEgressQueue_->detachThreadLocals();
   setController(nullptr);
   setSessionStats(nullptr);
   // The codec filters *shouldn't* be accessible while the socket is detached,
@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) 2017-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
+
+#include <random>
+#include <vector>
+
+using namespace folly;
+using namespace proxygen;
+
+namespace {
+
+// The queue never dereferences transactions
+HTTPTransaction* makeFakeTxn(HTTPCodec::StreamID id) {
+  static char* fakeTxn = (char*)0xface0000;
+  return (HTTPTransaction*)(fakeTxn + id);
+}
+
+// Builds a tree of streams depending on random earlier streams, some of them
+// exclusively, like browsers loading a page with many resources do
+std::vector<HTTP2PriorityQueue::Handle> buildTree(HTTP2PriorityQueue& queue,
+                                                  size_t streams,
+                                                  std::mt19937& rng) {
+  std::vector<HTTP2PriorityQueue::Handle> handles;
+  handles.reserve(streams);
+  for (size_t i = 0; i < streams; i++) {
+    HTTPCodec::StreamID id = 2 * i + 1;
+    HTTPCodec::StreamID parent = (i == 0 || rng() % 4 == 0) ?
+      0 : 2 * (rng() % i) + 1;
+    bool exclusive = rng() % 8 == 0;
+    uint8_t weight = rng() % 256;
+    handles.push_back(queue.addTransaction(id, {parent, exclusive, weight},
+                                           makeFakeTxn(id)));
+  }
+  return handles;
+}
+
+// Adds and removes all the streams of a connection
+void buildTearBench(int iters, size_t streams) {
+  for (int i = 0; i < iters; i++) {
+    std::mt19937 rng(i);
+    HTTP2PriorityQueue queue;
+    auto handles = buildTree(queue, streams, rng);
+    for (auto handle: handles) {
+      queue.removeTransaction(handle);
+    }
+  }
+}
+
+// Every stream has egress and keeps it across writes, like many large
+// responses being sent at the same time
+void nextEgressStableBench(int iters, size_t streams) {
+  BenchmarkSuspender suspender;
+  std::mt19937 rng(streams);
+  HTTP2PriorityQueue queue;
+  auto handles = buildTree(queue, streams, rng);
+  for (auto handle: handles) {
+    queue.signalPendingEgress(handle);
+  }
+  HTTP2PriorityQueue::NextEgressResult result;
+  suspender.dismiss();
+
+  for (int i = 0; i < iters; i++) {
+    queue.nextEgress(result);
+    CHECK(!result.empty());
+    result.clear();
+  }
+}
+
+// A stream runs out of egress and another one gets some before every
+// write, so the next streams have to be found again each time
+void nextEgressChurnBench(int iters, size_t streams) {
+  BenchmarkSuspender suspender;
+  std::mt19937 rng(streams);
+  HTTP2PriorityQueue queue;
+  auto handles = buildTree(queue, streams, rng);
+  std::vector<bool> enqueued(streams);
+  for (size_t i = 0; i < streams; i += 2) {
+    queue.signalPendingEgress(handles[i]);
+    enqueued[i] = true;
+  }
+  HTTP2PriorityQueue::NextEgressResult result;
+  suspender.dismiss();
+
+  for (int i = 0; i < iters; i++) {
+    auto idx = rng() % streams;
+    if (enqueued[idx]) {
+      queue.clearPendingEgress(handles[idx]);
+    } else {
+      queue.signalPendingEgress(handles[idx]);
+    }
+    enqueued[idx] = !enqueued[idx];
+    if (!queue.empty()) {
+      queue.nextEgress(result);
+      result.clear();
+    }
+  }
+}
+
+}
+
+BENCHMARK_PARAM(buildTearBench, 1000);
+BENCHMARK_PARAM(buildTearBench, 10000);
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(nextEgressStableBench, 1000);
+BENCHMARK_PARAM(nextEgressStableBench, 10000);
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(nextEgressChurnBench, 1000);
+BENCHMARK_PARAM(nextEgressChurnBench, 10000);
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -818,4 +818,22 @@ TEST_F(QueueTest, Rebuild) {
   EXPECT_EQ(nodes_, IDList({{3, 20}, {9, 20}, {5, 20}, {7, 20}, {1, 20}}));
 }
 
+TEST_F(QueueTest, RebuildEnqueued) {
+  buildSimpleTree();
+  q_.rebuildTree();
+  nextEgress();
+  EXPECT_EQ(nodes_.size(), 5u);
+  for (auto& node: nodes_) {
+    EXPECT_EQ(node.second, 20);
+  }
+
+  removeTransaction(3);
+  signalEgress(5, false);
+  nextEgress();
+  EXPECT_EQ(nodes_.size(), 3u);
+  for (auto& node: nodes_) {
+    EXPECT_EQ(node.second, 33);
+  }
+}
+
 }
@@ -11,7 +11,9 @@
 #include <vector>
 
 #include <folly/Conv.h>
+#include <folly/FileUtil.h>
 #include <folly/Range.h>
+#include <folly/experimental/TestUtil.h>
 #include <folly/futures/Promise.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/async/EventBase.h>
@@ -44,7 +46,8 @@ template <typename C>
 class HTTPDownstreamTest : public testing::Test {
  public:
   explicit HTTPDownstreamTest(
-    std::vector<int64_t> flowControl = { -1, -1, -1 })
+    std::vector<int64_t> flowControl = { -1, -1, -1 },
+    bool startImmediately = true)
     : eventBase_(),
       transport_(new TestAsyncTransport(&eventBase_)),
       transactionTimeouts_(makeTimeoutSet(&eventBase_)),
@@ -94,7 +97,9 @@ class HTTPDownstreamTest : public testing::Test {
     httpSession_->setEgressSettings({{ SettingsId::MAX_CONCURRENT_STREAMS, 80 },
                                      { SettingsId::HEADER_TABLE_SIZE, 5555 },
                                      { SettingsId::ENABLE_PUSH, 1 }});
-    httpSession_->startNow();
+    if (startImmediately) {
+      httpSession_->startNow();
+    }
     clientCodec_ = makeClientCodec<typename C::Codec>(C::version);
     clientCodec_->generateConnectionPreface(requests_);
     clientCodec_->setCallback(&callbacks_);
@@ -437,6 +442,10 @@ class HTTP2DownstreamSessionTest : public HTTPDownstreamTest<HTTP2CodecPair> {
   HTTP2DownstreamSessionTest()
       : HTTPDownstreamTest<HTTP2CodecPair>() {}
 
+  HTTP2DownstreamSessionTest(std::vector<int64_t> flowControl,
+                             bool startImmediately)
+      : HTTPDownstreamTest<HTTP2CodecPair>(flowControl, startImmediately) {}
+
   void SetUp() override {
     HTTPDownstreamTest<HTTP2CodecPair>::SetUp();
     HTTP2Codec::setHeaderSplitSize(http2::kMaxFramePayloadLengthMin);
@@ -1067,6 +1076,91 @@ void HTTPDownstreamTest<C>::testChunks(bool trailers) {
   expectDetachSession();
 }
 
+TEST_F(HTTPDownstreamSessionTest, file_body) {
+  folly::test::TemporaryFile tmp;
+  std::string contents("0123456789abcdefghijklmnopqrstuvwxyz");
+  ASSERT_EQ(static_cast<ssize_t>(contents.size()),
+            folly::writeFull(tmp.fd(), contents.data(), contents.size()));
+  auto file = std::make_shared<folly::File>(tmp.path().string());
+
+  InSequence enforceOrder;
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&] {
+      handler->sendHeaders(200, 21);
+      // the test transport is no socket, the file is read as it goes out
+      handler->txn_->sendFileBody(file, 10, 10);
+      handler->txn_->sendBody(folly::IOBuf::copyBuffer("-"));
+      handler->txn_->sendFileBody(file, 0, 10);
+      handler->txn_->sendEOM();
+    });
+  handler->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  std::string body;
+  EXPECT_CALL(callbacks_, onMessageBegin(1, _));
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _));
+  EXPECT_CALL(callbacks_, onBody(1, _, _))
+    .WillRepeatedly(Invoke([&] (HTTPCodec::StreamID,
+                                std::shared_ptr<folly::IOBuf> chain,
+                                uint8_t) {
+                             body += chain->moveToFbString().toStdString();
+                           }));
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+  parseOutput(*clientCodec_);
+  EXPECT_EQ(body, "abcdefghij-0123456789");
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTest, egress_pacing) {
+  // 8KB bursts at 200KB/s, the rest of the 48KB body takes about 200ms
+  httpSession_->setEgressPacingRate(200000, 0);
+  EXPECT_TRUE(httpSession_->isEgressPaced());
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] {
+      handler->sendReplyWithBody(200, 48000);
+    });
+  handler->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  auto writeEvents = transport_->getWriteEvents();
+  ASSERT_GT(writeEvents->size(), 1);
+  size_t maxWrite = 0;
+  for (auto& event: *writeEvents) {
+    size_t length = 0;
+    for (size_t i = 0; i < event->getCount(); i++) {
+      length += event->getIoVec()[i].iov_len;
+    }
+    maxWrite = std::max(maxWrite, length);
+  }
+  EXPECT_LE(maxWrite, HTTPPacingBucket::kMinBurst);
+  auto elapsed = writeEvents->back()->getTime() -
+    writeEvents->front()->getTime();
+  EXPECT_GE(elapsed, milliseconds(150));
+
+  EXPECT_CALL(callbacks_, onMessageBegin(1, _));
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _));
+  size_t bodyLength = 0;
+  EXPECT_CALL(callbacks_, onBody(1, _, _))
+    .WillRepeatedly(Invoke([&] (HTTPCodec::StreamID,
+                                std::shared_ptr<folly::IOBuf> chain,
+                                uint8_t) {
+                             bodyLength += chain->computeChainDataLength();
+                           }));
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+  parseOutput(*clientCodec_);
+  EXPECT_EQ(bodyLength, 48000);
+  expectDetachSession();
+}
+
 TEST_F(HTTPDownstreamSessionTest, http_drain) {
   InSequence enforceOrder;
 
@@ -2825,6 +2919,200 @@ TEST_F(HTTP2DownstreamSessionTest, test_disable_priorities) {
   eventBase_.loop();
 }
 
+class HTTP2DownstreamSessionExtensiblePriorityTest :
+      public HTTP2DownstreamSessionTest {
+ public:
+  HTTP2DownstreamSessionExtensiblePriorityTest()
+      : HTTP2DownstreamSessionTest({ -1, -1, -1 }, false) {}
+
+  void SetUp() override {
+    HTTP2DownstreamSessionTest::SetUp();
+    httpSession_->setExtensiblePrioritiesEnabled(true);
+    httpSession_->startNow();
+  }
+};
+
+TEST_F(HTTP2DownstreamSessionExtensiblePriorityTest, test_urgency) {
+  EXPECT_TRUE(httpSession_->getExtensiblePrioritiesEnabled());
+  EXPECT_FALSE(httpSession_->getHTTP2PrioritiesEnabled());
+  EXPECT_EQ(rawCodec_->getEgressSettings()->getSetting(
+              SettingsId::NO_RFC7540_PRIORITIES, 0), 1);
+
+  InSequence enforceOrder;
+  HTTPMessage req1 = getGetRequest();
+  req1.getHeaders().set(HTTP_HEADER_PRIORITY, "u=5");
+  sendRequest(req1);
+
+  HTTPMessage req2 = getGetRequest();
+  req2.getHeaders().set(HTTP_HEADER_PRIORITY, "u=1");
+  sendRequest(req2);
+
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM([&] {
+      handler1->sendReplyWithBody(200, 4 * 1024);
+    });
+
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM([&] {
+      handler2->sendReplyWithBody(200, 4 * 1024);
+    });
+
+  // the more urgent response is sent in full first
+  handler2->expectDetachTransaction();
+  handler1->expectDetachTransaction();
+
+  flushRequestsAndLoop();
+  httpSession_->closeWhenIdle();
+  expectDetachSession();
+  eventBase_.loop();
+}
+
+TEST_F(HTTP2DownstreamSessionExtensiblePriorityTest, test_priority_update) {
+  InSequence enforceOrder;
+  auto id1 = sendRequest();
+  // PRIORITY_UPDATE ahead of the request it is about
+  auto id2 = id1 + 2;
+  http2::writePriorityUpdate(requests_, id2, "u=0");
+  HTTPMessage req2 = getGetRequest();
+  req2.getHeaders().set(HTTP_HEADER_PRIORITY, "u=7");
+  EXPECT_EQ(sendRequest(req2), id2);
+
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM([&] {
+      handler1->sendReplyWithBody(200, 4 * 1024);
+    });
+
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM([&] {
+      handler2->sendReplyWithBody(200, 4 * 1024);
+    });
+
+  handler2->expectDetachTransaction();
+  handler1->expectDetachTransaction();
+
+  flushRequestsAndLoop();
+  httpSession_->closeWhenIdle();
+  expectDetachSession();
+  eventBase_.loop();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, test_hibernate) {
+  httpSession_->setHibernateTimeout(milliseconds(10));
+  sendRequest();
+
+  InSequence enforceOrder;
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM([&] {
+      handler1->sendReplyWithBody(200, 100);
+    });
+  handler1->expectDetachTransaction();
+
+  eventBase_.runAfterDelay([&] {
+      // the idle session dropped its header tables
+      EXPECT_TRUE(httpSession_->isHibernating());
+      EXPECT_EQ(rawCodec_->getHPACKTableInfo().egressHeadersStored_, 0);
+      sendRequest();
+      transport_->addReadEvent(requests_, milliseconds(0));
+    }, 50);
+
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders([&] {
+      EXPECT_FALSE(httpSession_->isHibernating());
+    });
+  handler2->expectEOM([&] {
+      handler2->sendReplyWithBody(200, 100);
+    });
+  handler2->expectDetachTransaction();
+
+  flushRequestsAndLoop();
+  httpSession_->closeWhenIdle();
+  expectDetachSession();
+  eventBase_.loop();
+
+  // the table size is lowered to 0, then restored for the new request
+  std::vector<uint32_t> tableSizes;
+  EXPECT_CALL(callbacks_, onSettings(_))
+    .WillRepeatedly(Invoke([&] (const SettingsList& settings) {
+          for (const auto& setting: settings) {
+            if (setting.id == SettingsId::HEADER_TABLE_SIZE) {
+              tableSizes.push_back(setting.value);
+            }
+          }
+        }));
+  EXPECT_CALL(callbacks_, onSettingsAck()).Times(AtLeast(0));
+  EXPECT_CALL(callbacks_, onMessageBegin(_, _)).Times(2);
+  EXPECT_CALL(callbacks_, onHeadersComplete(_, _)).Times(2);
+  EXPECT_CALL(callbacks_, onBody(_, _, _)).Times(AtLeast(2));
+  EXPECT_CALL(callbacks_, onMessageComplete(_, _)).Times(2);
+  EXPECT_CALL(callbacks_, onGoaway(_, _, _)).Times(AtLeast(0));
+  parseOutput(*clientCodec_);
+  EXPECT_EQ(tableSizes, std::vector<uint32_t>({5555, 0, 5555}));
+}
+
+TEST_F(HTTP2DownstreamSessionTest, read_budget) {
+  // a few requests per loop iteration
+  httpSession_->setReadBudget(100, microseconds(0));
+  std::list<unique_ptr<StrictMock<MockHTTPHandler>>> handlers;
+  {
+    InSequence enforceOrder;
+    for (auto i = 0; i < 10; i++) {
+      sendRequest();
+      auto handler = addSimpleStrictHandler();
+      handler->expectHeaders();
+      handler->expectEOM();
+      handlers.push_back(std::move(handler));
+    }
+    flushRequestsAndLoop();
+  }
+  // all of them were parsed, in several slices
+  EXPECT_GE(httpSession_->getReadBudgetExhaustions(), 2);
+
+  for (auto& handler: handlers) {
+    handler->sendReplyWithBody(200, 100);
+    handler->expectDetachTransaction();
+  }
+  httpSession_->closeWhenIdle();
+  expectDetachSession();
+  eventBase_.loop();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, memory_budget) {
+  // well below the session's own write buffer limit
+  HTTPMemoryBudget budget(500, 100);
+  budget.attachEventBase(&eventBase_);
+  httpSession_->setMemoryBudget(&budget);
+  sendRequest();
+
+  InSequence handlerSequence;
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([this] { transport_->pauseWrites(); });
+  handler->expectEOM([&handler] {
+      handler->sendHeaders(200, 1000);
+      handler->sendBody(1000);
+    });
+  handler->expectEgressPaused([&] {
+      EXPECT_TRUE(httpSession_->isMemoryBudgetPaused());
+      EXPECT_GT(budget.getBytes(), 500);
+      httpSession_->dumpConnectionState(3);
+      resumeWritesInLoop();
+    });
+  handler->expectEgressResumed([&handler] { handler->txn_->sendEOM(); });
+  handler->expectDetachTransaction();
+
+  flushRequestsAndLoop();
+  EXPECT_FALSE(httpSession_->isMemoryBudgetPaused());
+  EXPECT_EQ(budget.getStats().pauses, 1);
+  EXPECT_EQ(budget.getStats().resumes, 1);
+  httpSession_->setMemoryBudget(nullptr);
+  EXPECT_EQ(budget.getNumConsumers(), 0);
+  cleanup();
+}
+
 TEST_F(HTTP2DownstreamSessionTest, continuation_timeout) {
   // Split the headers at 15 bytes to force a CONTINUATION frame
   HTTP2Codec::setHeaderSplitSize(15);
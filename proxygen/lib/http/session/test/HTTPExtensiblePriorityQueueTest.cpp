@@ -0,0 +1,202 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <map>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/HTTPExtensiblePriorityQueue.h>
+
+namespace {
+static char* fakeTxn = (char*)0xface0000;
+
+proxygen::HTTPTransaction* makeFakeTxn(proxygen::HTTPCodec::StreamID id) {
+  return (proxygen::HTTPTransaction*)(fakeTxn + id);
+}
+
+proxygen::HTTPCodec::StreamID getTxnID(proxygen::HTTPTransaction* txn) {
+  return (proxygen::HTTPCodec::StreamID)((char*)txn - fakeTxn);
+}
+
+}
+
+namespace proxygen {
+
+typedef std::vector<HTTPCodec::StreamID> IDList;
+
+class ExtensiblePriorityQueueTest : public testing::Test {
+ protected:
+  void addTransaction(HTTPCodec::StreamID id, RFC9218::Priority pri,
+                      bool enqueue = true) {
+    uint64_t depth = 0;
+    auto handle = q_.addTransaction(id, http2::DefaultPriority,
+                                    makeFakeTxn(id), false, &depth);
+    EXPECT_EQ(depth, 1);
+    q_.updateExtensiblePriority(handle, pri);
+    handles_[id] = handle;
+    if (enqueue) {
+      q_.signalPendingEgress(handle);
+    }
+  }
+
+  void removeTransaction(HTTPCodec::StreamID id) {
+    q_.removeTransaction(handles_[id]);
+    handles_.erase(id);
+  }
+
+  void signalEgress(HTTPCodec::StreamID id, bool mark) {
+    if (mark) {
+      q_.signalPendingEgress(handles_[id]);
+    } else {
+      q_.clearPendingEgress(handles_[id]);
+    }
+  }
+
+  // The transactions returned by n calls of nextEgress
+  IDList nextEgress(size_t n = 1) {
+    IDList ids;
+    for (size_t i = 0; i < n; i++) {
+      HTTPEgressQueue::NextEgressResult result;
+      q_.nextEgress(result);
+      EXPECT_EQ(result.size(), 1);
+      for (auto& p: result) {
+        EXPECT_EQ(p.second, 1.0);
+        ids.push_back(getTxnID(p.first));
+      }
+    }
+    return ids;
+  }
+
+  HTTPExtensiblePriorityQueue q_;
+  std::map<HTTPCodec::StreamID, HTTPEgressQueue::Handle> handles_;
+};
+
+TEST_F(ExtensiblePriorityQueueTest, Basic) {
+  EXPECT_TRUE(q_.empty());
+  addTransaction(1, RFC9218::Priority());
+  EXPECT_FALSE(q_.empty());
+  EXPECT_EQ(q_.numPendingEgress(), 1);
+  EXPECT_TRUE(handles_[1]->isEnqueued());
+  EXPECT_EQ(nextEgress(), IDList({1}));
+
+  signalEgress(1, false);
+  EXPECT_TRUE(q_.empty());
+  EXPECT_FALSE(handles_[1]->isEnqueued());
+  removeTransaction(1);
+  EXPECT_TRUE(q_.empty());
+}
+
+TEST_F(ExtensiblePriorityQueueTest, Urgency) {
+  addTransaction(1, {5, false});
+  addTransaction(3, {1, true});
+  addTransaction(5, {3, false});
+  EXPECT_EQ(nextEgress(2), IDList({3, 3}));
+
+  signalEgress(3, false);
+  EXPECT_EQ(nextEgress(), IDList({5}));
+  signalEgress(5, false);
+  EXPECT_EQ(nextEgress(), IDList({1}));
+
+  // a more urgent transaction takes over
+  signalEgress(5, true);
+  EXPECT_EQ(nextEgress(), IDList({5}));
+}
+
+TEST_F(ExtensiblePriorityQueueTest, SequentialByStreamID) {
+  addTransaction(7, {3, false});
+  addTransaction(3, {3, false});
+  addTransaction(5, {3, false});
+  EXPECT_EQ(nextEgress(2), IDList({3, 3}));
+  signalEgress(3, false);
+  EXPECT_EQ(nextEgress(), IDList({5}));
+  // re-enqueued in stream ID order, not at the end
+  signalEgress(3, true);
+  EXPECT_EQ(nextEgress(), IDList({3}));
+  removeTransaction(3);
+  removeTransaction(5);
+  EXPECT_EQ(nextEgress(), IDList({7}));
+}
+
+TEST_F(ExtensiblePriorityQueueTest, IncrementalRoundRobin) {
+  addTransaction(1, {3, true});
+  addTransaction(3, {3, true});
+  addTransaction(5, {3, true});
+  EXPECT_EQ(nextEgress(4), IDList({1, 3, 5, 1}));
+
+  signalEgress(5, false);
+  EXPECT_EQ(nextEgress(3), IDList({3, 1, 3}));
+  // joins at the end of the round
+  signalEgress(5, true);
+  EXPECT_EQ(nextEgress(3), IDList({1, 3, 5}));
+
+  // sequential transactions of the same urgency go first
+  addTransaction(7, {3, false});
+  EXPECT_EQ(nextEgress(2), IDList({7, 7}));
+  removeTransaction(7);
+  EXPECT_EQ(nextEgress(), IDList({1}));
+}
+
+TEST_F(ExtensiblePriorityQueueTest, UpdatePriority) {
+  addTransaction(1, {3, false});
+  addTransaction(3, {4, false});
+  addTransaction(5, {2, false}, false);
+  EXPECT_EQ(nextEgress(), IDList({1}));
+
+  q_.updateExtensiblePriority(handles_[3], {0, true});
+  EXPECT_EQ(nextEgress(), IDList({3}));
+
+  // not enqueued, moves when it gets egress
+  q_.updateExtensiblePriority(handles_[5], {0, false});
+  EXPECT_EQ(nextEgress(), IDList({3}));
+  signalEgress(5, true);
+  EXPECT_EQ(nextEgress(), IDList({5}));
+  EXPECT_EQ(q_.numPendingEgress(), 3);
+
+  // RFC 7540 priorities are ignored
+  uint64_t depth = 0;
+  EXPECT_EQ(q_.updatePriority(handles_[1], {5, true, 255}, &depth),
+            handles_[1]);
+  EXPECT_EQ(depth, 1);
+  EXPECT_EQ(nextEgress(), IDList({5}));
+}
+
+TEST_F(ExtensiblePriorityQueueTest, IterateByPriority) {
+  addTransaction(1, {5, false});
+  addTransaction(3, {1, true}, false);
+  addTransaction(5, {5, true});
+  addTransaction(7, {3, false}, false);
+
+  IDList ids;
+  auto fn = [&ids] (HTTPCodec::StreamID id, HTTPTransaction* txn) {
+    EXPECT_EQ(getTxnID(txn), id);
+    ids.push_back(id);
+    return false;
+  };
+  q_.iterateByPriority(fn, [] { return false; });
+  EXPECT_EQ(ids, IDList({3, 7, 1, 5}));
+
+  // stopFn is checked before each urgency
+  ids.clear();
+  q_.iterateByPriority(fn, [&ids] { return ids.size() >= 2; });
+  EXPECT_EQ(ids, IDList({3, 7}));
+
+  // removing transactions while iterating
+  ids.clear();
+  q_.iterateByPriority([this, &ids] (HTTPCodec::StreamID id,
+                                     HTTPTransaction*) {
+      ids.push_back(id);
+      if (id == 1) {
+        removeTransaction(5);
+      }
+      return false;
+    }, [] { return false; });
+  EXPECT_EQ(ids, IDList({3, 7, 1}));
+}
+
+}
@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <fcntl.h>
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/HTTPFileSegments.h>
+#include <sys/socket.h>
+
+using namespace proxygen;
+using folly::IOBuf;
+
+class HTTPFileSegmentsTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_EQ(static_cast<ssize_t>(contents_.size()),
+              folly::writeFull(tmp_.fd(), contents_.data(), contents_.size()));
+    file_ = std::make_shared<folly::File>(tmp_.path().string());
+  }
+
+ protected:
+  const std::string contents_{"0123456789abcdefghijklmnopqrstuvwxyz"};
+  folly::test::TemporaryFile tmp_;
+  std::shared_ptr<folly::File> file_;
+};
+
+TEST_F(HTTPFileSegmentsTest, Placeholder) {
+  EXPECT_EQ(HTTPFileSegments::makePlaceholder(0), nullptr);
+  size_t length = 2 * HTTPFileSegments::kMaxPlaceholderSize + 10;
+  auto placeholder = HTTPFileSegments::makePlaceholder(length);
+  EXPECT_EQ(placeholder->computeChainDataLength(), length);
+  EXPECT_TRUE(HTTPFileSegments::isPlaceholder(*placeholder));
+
+  folly::IOBufQueue queue;
+  queue.append(IOBuf::copyBuffer("header"));
+  queue.append(std::move(placeholder));
+  queue.append(IOBuf::copyBuffer("trailer"));
+  auto chain = queue.move();
+  EXPECT_FALSE(HTTPFileSegments::isPlaceholder(*chain));
+  EXPECT_EQ(HTTPFileSegments::countPlaceholderBytes(*chain), length);
+
+  bool placeholders = true;
+  EXPECT_EQ(HTTPFileSegments::getRunLength(*chain, &placeholders), 6);
+  EXPECT_FALSE(placeholders);
+  queue.append(std::move(chain));
+  // a split placeholder is still one
+  queue.split(10);
+  EXPECT_EQ(HTTPFileSegments::getRunLength(*queue.front(), &placeholders),
+            length - 4);
+  EXPECT_TRUE(placeholders);
+}
+
+TEST_F(HTTPFileSegmentsTest, Fill) {
+  HTTPFileSegments segments;
+  segments.append(file_, 10, 5);
+  segments.append(file_, 0, 3);
+  segments.append(file_, 0, 0);
+  EXPECT_EQ(segments.length(), 8);
+
+  folly::IOBufQueue queue;
+  queue.append(IOBuf::copyBuffer("<"));
+  queue.append(HTTPFileSegments::makePlaceholder(4));
+  queue.append(IOBuf::copyBuffer("|"));
+  queue.append(HTTPFileSegments::makePlaceholder(4));
+  queue.append(IOBuf::copyBuffer(">"));
+  auto chain = segments.fill(queue.move());
+  ASSERT_NE(chain, nullptr);
+  EXPECT_EQ(chain->moveToFbString().toStdString(), "<abcd|e012>");
+  EXPECT_EQ(HTTPFileSegments::countPlaceholderBytes(*chain), 0);
+  EXPECT_TRUE(segments.empty());
+}
+
+TEST_F(HTTPFileSegmentsTest, ShortFile) {
+  HTTPFileSegments segments;
+  segments.append(file_, contents_.size() - 2, 4);
+  EXPECT_EQ(segments.fill(HTTPFileSegments::makePlaceholder(4)), nullptr);
+  EXPECT_EQ(HTTPFileSegments::read(file_->fd(), 0, contents_.size() + 1),
+            nullptr);
+}
+
+TEST_F(HTTPFileSegmentsTest, MoveTo) {
+  HTTPFileSegments segments;
+  segments.append(file_, 0, 10);
+  segments.append(file_, 20, 10);
+  HTTPFileSegments other;
+  segments.moveTo(other, 15);
+  EXPECT_EQ(segments.length(), 5);
+  EXPECT_EQ(other.length(), 15);
+
+  auto chain = other.fill(HTTPFileSegments::makePlaceholder(15));
+  EXPECT_EQ(chain->moveToFbString().toStdString(), "0123456789klmno");
+  chain = segments.fill(HTTPFileSegments::makePlaceholder(5));
+  EXPECT_EQ(chain->moveToFbString().toStdString(), "pqrst");
+}
+
+#ifdef __linux__
+TEST_F(HTTPFileSegmentsTest, SendTo) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT_EQ(0, fcntl(fds[0], F_SETFL, O_NONBLOCK));
+  HTTPFileSegments segments;
+  segments.append(file_, 30, 6);
+  segments.append(file_, 0, 4);
+  EXPECT_EQ(segments.sendTo(fds[0], 8), 8);
+  EXPECT_EQ(segments.length(), 2);
+  char buf[8];
+  ASSERT_EQ(8, folly::readFull(fds[1], buf, sizeof(buf)));
+  EXPECT_EQ(std::string(buf, sizeof(buf)), "uvwxyz01");
+
+  // past the end of the file
+  segments.append(file_, contents_.size(), 1);
+  EXPECT_EQ(segments.sendTo(fds[0], 3), 2);
+  EXPECT_EQ(segments.sendTo(fds[0], 1), -1);
+  close(fds[0]);
+  close(fds[1]);
+}
+#endif
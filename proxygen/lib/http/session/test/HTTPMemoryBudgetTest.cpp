@@ -0,0 +1,199 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/HTTPMemoryBudget.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+using namespace proxygen;
+
+namespace {
+
+class TestConsumer : public HTTPMemoryBudget::Consumer {
+ public:
+  void onMemoryBudgetPaused() noexcept override {
+    pauses++;
+  }
+
+  void onMemoryBudgetResumed() noexcept override {
+    resumes++;
+    if (onResume) {
+      onResume();
+    }
+  }
+
+  std::atomic<int> pauses{0};
+  std::atomic<int> resumes{0};
+  std::function<void()> onResume;
+};
+
+}
+
+TEST(HTTPMemoryBudgetTest, LargestFirst) {
+  HTTPMemoryBudget budget(1000, 400);
+  TestConsumer small, medium, large;
+  budget.add(small);
+  budget.add(medium);
+  budget.add(large);
+  budget.update(small, 100);
+  budget.update(medium, 300);
+  budget.update(large, 500);
+  EXPECT_EQ(budget.getBytes(), 900);
+  EXPECT_EQ(budget.getNumPaused(), 0);
+
+  // 1050 bytes, 650 over the low water mark: large and medium hold 800
+  budget.update(small, 150);
+  EXPECT_EQ(large.pauses, 1);
+  EXPECT_EQ(medium.pauses, 1);
+  EXPECT_EQ(small.pauses, 0);
+  EXPECT_TRUE(large.isMemoryBudgetPaused());
+  EXPECT_EQ(budget.getNumPaused(), 2);
+
+  // draining to the low water mark resumes them
+  budget.update(large, -500);
+  EXPECT_EQ(large.resumes, 0);
+  budget.update(medium, -200);
+  EXPECT_EQ(budget.getBytes(), 350);
+  EXPECT_EQ(large.resumes, 1);
+  EXPECT_EQ(medium.resumes, 1);
+  EXPECT_EQ(small.resumes, 0);
+  EXPECT_EQ(budget.getNumPaused(), 0);
+  EXPECT_EQ(budget.getStats().pauses, 2);
+  EXPECT_EQ(budget.getStats().resumes, 2);
+
+  budget.remove(small);
+  budget.remove(medium);
+  budget.remove(large);
+  EXPECT_EQ(budget.getBytes(), 0);
+}
+
+TEST(HTTPMemoryBudgetTest, Remove) {
+  HTTPMemoryBudget budget(1000, 500);
+  TestConsumer a, b;
+  budget.add(a);
+  budget.add(b);
+  budget.update(a, 900);
+  budget.update(b, 200);
+  EXPECT_EQ(a.pauses, 1);
+  EXPECT_EQ(b.pauses, 0);
+
+  // a goes away with its bytes, the others resume without it
+  budget.remove(a);
+  EXPECT_EQ(a.resumes, 0);
+  EXPECT_EQ(budget.getBytes(), 200);
+  EXPECT_EQ(budget.getNumPaused(), 0);
+  EXPECT_EQ(budget.getNumConsumers(), 1);
+  budget.remove(b);
+}
+
+TEST(HTTPMemoryBudgetTest, ProcessLimits) {
+  auto processBytes = HTTPMemoryBudget::getProcessBytes();
+  HTTPMemoryBudget::setProcessLimits(processBytes + 1000,
+                                     processBytes + 500);
+  HTTPMemoryBudget budget1;
+  HTTPMemoryBudget budget2;
+  TestConsumer a, b;
+  budget1.add(a);
+  budget2.add(b);
+  budget1.update(a, 600);
+  budget2.update(b, 600);
+  EXPECT_EQ(HTTPMemoryBudget::getProcessBytes(), processBytes + 1200);
+  // the budget that went over only pauses its own
+  EXPECT_EQ(a.pauses, 0);
+  EXPECT_EQ(b.pauses, 1);
+
+  budget1.update(a, -100);
+  EXPECT_EQ(b.resumes, 0);
+  budget2.update(b, -600);
+  EXPECT_EQ(b.resumes, 1);
+  budget1.remove(a);
+  budget2.remove(b);
+  EXPECT_EQ(HTTPMemoryBudget::getProcessBytes(), processBytes);
+  HTTPMemoryBudget::setProcessLimits(0, 0);
+}
+
+TEST(HTTPMemoryBudgetTest, NotifiedFromLoop) {
+  folly::EventBase evb;
+  HTTPMemoryBudget budget(1000, 500);
+  budget.attachEventBase(&evb);
+  TestConsumer a, b;
+  budget.add(a);
+  budget.add(b);
+  budget.update(a, 900);
+  budget.update(b, 200);
+  // paused, but only told once the loop comes around
+  EXPECT_EQ(budget.getNumPaused(), 1);
+  EXPECT_EQ(a.pauses, 0);
+  EXPECT_FALSE(a.isMemoryBudgetPaused());
+  evb.loopOnce();
+  EXPECT_EQ(a.pauses, 1);
+  EXPECT_TRUE(a.isMemoryBudgetPaused());
+
+  // paused and resumed before the loop, told neither
+  budget.update(a, -900);
+  budget.update(a, 900);
+  evb.loopOnce();
+  EXPECT_EQ(a.resumes, 0);
+  EXPECT_TRUE(a.isMemoryBudgetPaused());
+
+  // resuming a removes b, which is not told anything
+  budget.update(a, -900);
+  a.onResume = [&] { budget.remove(b); };
+  evb.loopOnce();
+  EXPECT_EQ(a.resumes, 1);
+  EXPECT_EQ(b.pauses, 0);
+  EXPECT_EQ(budget.getNumConsumers(), 1);
+  budget.remove(a);
+}
+
+TEST(HTTPMemoryBudgetTest, ProcessExcessReleasedByOtherThread) {
+  auto processBytes = HTTPMemoryBudget::getProcessBytes();
+  HTTPMemoryBudget::setProcessLimits(processBytes + 1000,
+                                     processBytes + 500);
+  folly::ScopedEventBaseThread threadA;
+  auto evbA = threadA.getEventBase();
+  std::unique_ptr<HTTPMemoryBudget> budgetA;
+  TestConsumer a, b;
+  HTTPMemoryBudget budgetB;
+  budgetB.add(b);
+  budgetB.update(b, 900);
+
+  // a is paused for the excess, mostly held by the other thread
+  evbA->runInEventBaseThreadAndWait([&] {
+      budgetA = std::make_unique<HTTPMemoryBudget>();
+      budgetA->attachEventBase(evbA);
+      budgetA->add(a);
+      budgetA->update(a, 200);
+    });
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (a.pauses == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(a.pauses, 1);
+
+  // a changes nothing, the other thread releasing its bytes resumes it
+  budgetB.update(b, -900);
+  while (a.resumes == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(a.resumes, 1);
+
+  evbA->runInEventBaseThreadAndWait([&] {
+      budgetA->remove(a);
+      budgetA.reset();
+    });
+  budgetB.remove(b);
+  EXPECT_EQ(HTTPMemoryBudget::getProcessBytes(), processBytes);
+  HTTPMemoryBudget::setProcessLimits(0, 0);
+}
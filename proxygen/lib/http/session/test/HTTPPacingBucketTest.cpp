@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/HTTPPacingBucket.h>
+
+using namespace proxygen;
+using namespace std::chrono;
+
+TEST(HTTPPacingBucketTest, Refill) {
+  auto now = getCurrentTime();
+  // 1MB/s, a byte per microsecond
+  HTTPPacingBucket bucket(1000000, 20000, now);
+  EXPECT_EQ(bucket.getAvailable(now), 20000);
+  bucket.consume(20000);
+  EXPECT_EQ(bucket.getAvailable(now), 0);
+  EXPECT_EQ(bucket.getAvailable(now + microseconds(1500)), 1500);
+  EXPECT_EQ(bucket.getDelay(1500, now + microseconds(1500)), milliseconds(0));
+  EXPECT_EQ(bucket.getDelay(2501, now + microseconds(1500)), milliseconds(2));
+
+  // never more than the burst
+  EXPECT_EQ(bucket.getAvailable(now + seconds(10)), 20000);
+  EXPECT_EQ(bucket.getDelay(50000, now + seconds(10)), milliseconds(0));
+}
+
+TEST(HTTPPacingBucketTest, Fractions) {
+  auto now = getCurrentTime();
+  // 3 bytes per millisecond
+  HTTPPacingBucket bucket(3000, 0, now);
+  EXPECT_EQ(bucket.getBurst(), HTTPPacingBucket::kMinBurst);
+  bucket.consume(HTTPPacingBucket::kMinBurst);
+  for (int i = 1; i <= 1000; i++) {
+    // a third of a byte at a time adds up
+    bucket.getAvailable(now + microseconds(111 * i));
+  }
+  EXPECT_EQ(bucket.getAvailable(now + microseconds(111000)), 333);
+  EXPECT_EQ(bucket.getDelay(336, now + microseconds(111000)),
+            milliseconds(1));
+}
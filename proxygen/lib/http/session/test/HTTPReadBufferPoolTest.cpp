@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/HTTPReadBufferPool.h>
+
+#include <vector>
+
+using namespace proxygen;
+using folly::IOBuf;
+
+TEST(HTTPReadBufferPoolTest, Reuse) {
+  HTTPReadBufferPool pool;
+  auto buf = pool.acquire(4000);
+  ASSERT_GE(buf->tailroom(), 4000);
+  EXPECT_EQ(pool.getStats().lentBuffers, 1);
+  EXPECT_EQ(pool.getStats().allocations, 1);
+  const uint8_t* data = buf->data();
+  buf->append(100);
+  pool.release(std::move(buf));
+  EXPECT_EQ(pool.getStats().lentBuffers, 0);
+  EXPECT_EQ(pool.getStats().idleBuffers, 1);
+  EXPECT_GE(pool.getStats().idleBytes, 4000);
+
+  // the same buffer comes back, emptied
+  buf = pool.acquire(3000);
+  EXPECT_EQ(buf->data(), data);
+  EXPECT_EQ(buf->length(), 0);
+  EXPECT_EQ(pool.getStats().borrows, 2);
+  EXPECT_EQ(pool.getStats().allocations, 1);
+  EXPECT_EQ(pool.getStats().idleBuffers, 0);
+  EXPECT_EQ(pool.getStats().idleBytes, 0);
+
+  // a smaller size gets its own buffer
+  auto small = pool.acquire(100);
+  EXPECT_GE(small->tailroom(), HTTPReadBufferPool::kMinBufferSize);
+  EXPECT_LT(small->tailroom(), 4000);
+  EXPECT_EQ(pool.getStats().allocations, 2);
+  pool.release(std::move(small));
+  pool.release(std::move(buf));
+  EXPECT_EQ(pool.getStats().idleBuffers, 2);
+}
+
+TEST(HTTPReadBufferPoolTest, MaxSize) {
+  HTTPReadBufferPool pool;
+  auto buf = pool.acquire(1024 * 1024);
+  EXPECT_GE(buf->tailroom(), HTTPReadBufferPool::kMaxBufferSize);
+  EXPECT_LT(buf->tailroom(), 2 * HTTPReadBufferPool::kMaxBufferSize);
+  pool.release(std::move(buf));
+  buf = pool.acquire(HTTPReadBufferPool::kMaxBufferSize);
+  EXPECT_EQ(pool.getStats().allocations, 1);
+}
+
+TEST(HTTPReadBufferPoolTest, Pinned) {
+  HTTPReadBufferPool pool;
+  auto buf = pool.acquire(4000);
+  buf->append(10);
+  // parsed data keeps a reference
+  auto body = buf->cloneOne();
+  pool.release(std::move(buf));
+  EXPECT_EQ(pool.getStats().lentBuffers, 0);
+  EXPECT_EQ(pool.getStats().pinned, 1);
+  EXPECT_EQ(pool.getStats().idleBuffers, 0);
+  EXPECT_EQ(body->length(), 10);
+
+  buf = pool.acquire(4000);
+  EXPECT_EQ(pool.getStats().allocations, 2);
+}
+
+TEST(HTTPReadBufferPoolTest, MaxIdle) {
+  HTTPReadBufferPool pool;
+  std::vector<std::unique_ptr<IOBuf>> bufs;
+  for (size_t i = 0; i < HTTPReadBufferPool::kMaxIdleBuffers + 2; i++) {
+    bufs.push_back(pool.acquire(4000));
+  }
+  EXPECT_EQ(pool.getStats().lentBuffers, bufs.size());
+  for (auto& buf: bufs) {
+    pool.release(std::move(buf));
+  }
+  EXPECT_EQ(pool.getStats().lentBuffers, 0);
+  EXPECT_EQ(pool.getStats().idleBuffers, HTTPReadBufferPool::kMaxIdleBuffers);
+}
+
+TEST(HTTPReadBufferPoolTest, ThreadPool) {
+  auto& pool = HTTPReadBufferPool::get();
+  EXPECT_EQ(&pool, &HTTPReadBufferPool::get());
+  auto lent = pool.getStats().lentBuffers;
+  auto buf = pool.acquire(4000);
+  EXPECT_EQ(pool.getStats().lentBuffers, lent + 1);
+  pool.release(std::move(buf));
+  EXPECT_EQ(pool.getStats().lentBuffers, lent);
+}
@@ -12,6 +12,10 @@
 #include <proxygen/lib/utils/TestUtils.h>
 #include <folly/io/async/test/MockAsyncServerSocket.h>
 #include <folly/io/async/test/MockAsyncSocket.h>
+#include <folly/FileUtil.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <thread>
 
 using namespace proxygen;
 using namespace testing;
@@ -60,6 +64,12 @@ class HTTPTargetSessionAcceptor : public HTTPSessionAcceptor {
     sessionCreationErrors_++;
   }
 
+  void setSessionStats(HTTPSessionStats* stats) {
+    downstreamSessionStats_ = stats;
+  }
+
+  using HTTPSessionAcceptor::canAccept;
+
   uint32_t sessionsCreated_{0};
   uint32_t sessionCreationErrors_{0};
   std::string expectedProto_;
@@ -197,3 +207,160 @@ TEST_F(HTTPSessionAcceptorTestNPN, AcceptorConfigCapture) {
   acceptor_->connectionReady(
       std::move(sock), clientAddress, "", SecureTransportType::TLS, tinfo);
 }
+
+namespace {
+
+class OverloadStats : public DummyHTTPSessionStats {
+ public:
+  void recordEventLoopLag(std::chrono::microseconds) noexcept override {
+    samples++;
+  }
+  void recordOverloadRejectedConnection() noexcept override {
+    rejected++;
+  }
+  void recordOverloadDroppedIdleConnections(size_t num) noexcept override {
+    droppedIdle += num;
+  }
+
+  size_t samples{0};
+  size_t rejected{0};
+  size_t droppedIdle{0};
+};
+
+}
+
+class HTTPSessionAcceptorTestOverload :
+    public HTTPSessionAcceptorTestNPNPlaintext {
+ public:
+  void SetUp() override {
+    HTTPSessionAcceptorTestNPNPlaintext::SetUp();
+    config_->maxEventLoopLag = std::chrono::milliseconds(10);
+    config_->eventLoopCheckInterval = std::chrono::milliseconds(10);
+  }
+
+  void newOverloadedAcceptor() {
+    newAcceptor();
+    acceptor_->setSessionStats(&stats_);
+    makeOverloaded();
+  }
+
+  void makeOverloaded() {
+    // The loop is stuck past the deadline of the first sample
+    eventBase_.runAfterDelay([] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }, 1);
+    while (!acceptor_->isOverloaded() && stats_.samples < 20) {
+      eventBase_.loopOnce();
+    }
+    ASSERT_TRUE(acceptor_->isOverloaded());
+  }
+
+  // Hands the acceptor a connection, returns the client's end
+  int connect() {
+    int fds[2];
+    EXPECT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    EXPECT_EQ(0, ::fcntl(fds[1], F_SETFL, O_NONBLOCK));
+    acceptor_->expectedProto_ = "http/1.1";
+    AsyncSocket::UniquePtr sock(new AsyncSocket(&eventBase_, fds[0]));
+    wangle::TransportInfo tinfo;
+    acceptor_->connectionReady(
+      std::move(sock), clientAddress_, "", SecureTransportType::NONE, tinfo);
+    return fds[1];
+  }
+
+  // What the server sends on the client's end until it closes it, if it does
+  // within timeout
+  std::string readUntilClosed(int fd, std::chrono::milliseconds timeout,
+                              bool* closed) {
+    std::string data;
+    char buf[4096];
+    *closed = false;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+      eventBase_.loopOnce(EVLOOP_NONBLOCK);
+      auto n = folly::readNoInt(fd, buf, sizeof(buf));
+      if (n > 0) {
+        data.append(buf, n);
+      } else if (n == 0) {
+        *closed = true;
+        break;
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    return data;
+  }
+
+ protected:
+  OverloadStats stats_;
+  SocketAddress clientAddress_{"127.0.0.1", 1234};
+};
+
+TEST_F(HTTPSessionAcceptorTestOverload, RejectWhileLagging) {
+  newOverloadedAcceptor();
+  EXPECT_FALSE(acceptor_->canAccept(clientAddress_));
+  EXPECT_EQ(1, stats_.rejected);
+
+  // Accepts again once the loop caught up
+  eventBase_.runAfterDelay([this] { eventBase_.terminateLoopSoon(); }, 200);
+  eventBase_.loopForever();
+  EXPECT_FALSE(acceptor_->isOverloaded());
+  EXPECT_LT(acceptor_->getEventLoopMonitor()->getLag(),
+            std::chrono::milliseconds(10));
+  EXPECT_TRUE(acceptor_->canAccept(clientAddress_));
+  EXPECT_EQ(1, stats_.rejected);
+}
+
+TEST_F(HTTPSessionAcceptorTestOverload, RespondWith503WhileLagging) {
+  config_->overloadRespondWith503 = true;
+  newOverloadedAcceptor();
+  EXPECT_TRUE(acceptor_->canAccept(clientAddress_));
+
+  // The session is created, to answer its first request with a 503
+  int fd = connect();
+  EXPECT_EQ(acceptor_->sessionsCreated_, 1);
+  EXPECT_EQ(1, stats_.rejected);
+  EXPECT_EQ(1, acceptor_->getNumConnections());
+
+  // Then it closes the connection
+  std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  ASSERT_EQ(ssize_t(request.size()),
+            folly::writeFull(fd, request.data(), request.size()));
+  bool closed;
+  auto response = readUntilClosed(fd, std::chrono::seconds(5), &closed);
+  ::close(fd);
+  EXPECT_TRUE(closed);
+  EXPECT_EQ(0, response.find("HTTP/1.1 503 Service Unavailable\r\n"))
+    << response;
+  EXPECT_NE(std::string::npos, response.find("Connection: close\r\n"))
+    << response;
+  EXPECT_EQ(0, acceptor_->getNumConnections());
+}
+
+TEST_F(HTTPSessionAcceptorTestOverload, DropIdleConnectionsWhileLagging) {
+  config_->overloadIdleConnectionsToDrop = 1;
+  newAcceptor();
+  acceptor_->setSessionStats(&stats_);
+  std::vector<int> fds{connect(), connect(), connect()};
+  EXPECT_EQ(3, acceptor_->getNumConnections());
+
+  // The sample finding the loop overloaded drops one idle connection
+  makeOverloaded();
+  EXPECT_EQ(1, stats_.droppedIdle);
+  EXPECT_EQ(2, acceptor_->getNumConnections());
+
+  // Whose client end sees it closed, the others staying open
+  size_t closed = 0;
+  for (auto fd : fds) {
+    bool fdClosed;
+    readUntilClosed(fd, std::chrono::milliseconds(10), &fdClosed);
+    closed += fdClosed;
+    ::close(fd);
+  }
+  EXPECT_EQ(1, closed);
+}
+
+TEST_F(HTTPSessionAcceptorTestNPNPlaintext, NoMonitorByDefault) {
+  EXPECT_EQ(nullptr, acceptor_->getEventLoopMonitor());
+  EXPECT_FALSE(acceptor_->isOverloaded());
+}
@@ -11,6 +11,7 @@
 
 #include <folly/portability/GMock.h>
 #include <proxygen/lib/http/codec/test/MockHTTPCodec.h>
+#include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 
 namespace proxygen {
@@ -0,0 +1,167 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/HTTPTransactionTable.h>
+
+#include <map>
+#include <vector>
+
+using namespace proxygen;
+
+namespace {
+
+struct FakeTxn {
+  FakeTxn(HTTPCodec::StreamID inId, int& inLive): id(inId), live(inLive) {
+    live++;
+  }
+
+  ~FakeTxn() {
+    live--;
+  }
+
+  HTTPCodec::StreamID id;
+  int& live;
+};
+
+typedef HTTPTransactionTable<FakeTxn> Table;
+typedef std::vector<HTTPCodec::StreamID> IDList;
+
+IDList getIDs(const Table& table) {
+  IDList ids;
+  for (const auto& it: table) {
+    EXPECT_EQ(it.first, it.second->id);
+    ids.push_back(it.first);
+  }
+  return ids;
+}
+
+}
+
+TEST(HTTPTransactionTableTest, Basic) {
+  int live = 0;
+  {
+    Table table;
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(table.find(1), nullptr);
+    auto txn = table.emplace(1, 1, live);
+    ASSERT_NE(txn, nullptr);
+    EXPECT_EQ(table.emplace(1, 1, live), nullptr);
+    EXPECT_EQ(table.find(1), txn);
+    EXPECT_EQ(table.size(), 1);
+    EXPECT_EQ(live, 1);
+
+    table.emplace(5, 5, live);
+    table.emplace(3, 3, live);
+    EXPECT_EQ(getIDs(table), IDList({1, 3, 5}));
+    EXPECT_EQ(table.last()->id, 5);
+    EXPECT_EQ(table.last(2)->id, 1);
+    EXPECT_EQ(table.last(3), nullptr);
+
+    table.erase(3);
+    table.erase(3);
+    EXPECT_EQ(table.find(3), nullptr);
+    EXPECT_EQ(table.size(), 2);
+    EXPECT_EQ(live, 2);
+    EXPECT_EQ(getIDs(table), IDList({1, 5}));
+    EXPECT_EQ(table.sparseSize(), 0);
+  }
+  // the table destroys what is left
+  EXPECT_EQ(live, 0);
+}
+
+TEST(HTTPTransactionTableTest, LongLivedStream) {
+  int live = 0;
+  Table table;
+  // a push stream outlives many client streams
+  table.emplace(2, 2, live);
+  HTTPCodec::StreamID last = 1;
+  for (HTTPCodec::StreamID id = 1; id < 3 * Table::kMaxDenseSpan; id += 2) {
+    table.emplace(id, id, live);
+    if (id > 1) {
+      table.erase(id - 2);
+    }
+    last = id;
+  }
+  EXPECT_EQ(table.size(), 2);
+  EXPECT_EQ(table.sparseSize(), 1);
+  EXPECT_EQ(table.find(2)->id, 2);
+  EXPECT_EQ(table.find(last)->id, last);
+  EXPECT_EQ(getIDs(table), IDList({2, last}));
+
+  table.erase(2);
+  EXPECT_EQ(table.sparseSize(), 0);
+  EXPECT_EQ(getIDs(table), IDList({last}));
+}
+
+TEST(HTTPTransactionTableTest, OutOfOrder) {
+  int live = 0;
+  Table table;
+  table.emplace(4 * Table::kMaxDenseSpan, 4 * Table::kMaxDenseSpan, live);
+  table.emplace(11, 11, live);
+  table.emplace(3 * Table::kMaxDenseSpan + 1, 3 * Table::kMaxDenseSpan + 1,
+                live);
+  EXPECT_EQ(table.sparseSize(), 1);
+  EXPECT_EQ(getIDs(table),
+            IDList({11, 3 * Table::kMaxDenseSpan + 1,
+                    4 * Table::kMaxDenseSpan}));
+
+  // the window grows down to the IDs in the map
+  table.erase(4 * Table::kMaxDenseSpan);
+  table.erase(3 * Table::kMaxDenseSpan + 1);
+  table.emplace(13, 13, live);
+  table.emplace(9, 9, live);
+  table.emplace(12, 12, live);
+  EXPECT_EQ(getIDs(table), IDList({9, 11, 12, 13}));
+  for (auto id: {9, 11, 12, 13}) {
+    EXPECT_EQ(table.find(id)->id, id);
+  }
+  EXPECT_EQ(table.emplace(11, 11, live), nullptr);
+  table.erase(11);
+  EXPECT_EQ(table.find(11), nullptr);
+  EXPECT_EQ(getIDs(table), IDList({9, 12, 13}));
+  EXPECT_EQ(live, 3);
+}
+
+TEST(HTTPTransactionTableTest, Random) {
+  int live = 0;
+  Table table;
+  std::map<HTTPCodec::StreamID, FakeTxn*> expected;
+  uint32_t seed = 1;
+  auto rand = [&seed] {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+  };
+  HTTPCodec::StreamID next = 1;
+  for (int i = 0; i < 20000; i++) {
+    if (rand() % 3 != 0 || expected.empty()) {
+      // mostly increasing, some far apart
+      auto id = (rand() % 16 == 0) ? rand() % (next + 1) : next;
+      next += 1 + rand() % 4;
+      auto txn = table.emplace(id, id, live);
+      EXPECT_EQ(txn == nullptr, expected.count(id) == 1);
+      if (txn) {
+        expected[id] = txn;
+      }
+    } else {
+      auto it = expected.begin();
+      std::advance(it, rand() % expected.size());
+      table.erase(it->first);
+      expected.erase(it);
+    }
+    ASSERT_EQ(table.size(), expected.size());
+  }
+  IDList ids;
+  for (auto& it: expected) {
+    EXPECT_EQ(table.find(it.first), it.second);
+    ids.push_back(it.first);
+  }
+  EXPECT_EQ(getIDs(table), ids);
+  EXPECT_EQ(live, static_cast<int>(expected.size()));
+}
@@ -1264,6 +1264,27 @@ TEST_F(MockCodecDownstreamTest, read_iobuf_chain_shutdown) {
   eventBase_.loop();
 }
 
+TEST_F(MockCodecDownstreamTest, read_size_capped_by_max_read_buffer_size) {
+  // Reads filling the buffer don't grow the next ones past the default
+  // maxReadBufferSize
+  EXPECT_CALL(*codec_, onIngress(_))
+    .WillRepeatedly(Invoke([] (const IOBuf& buf) {
+          return buf.computeChainDataLength();
+        }));
+  for (int i = 0; i < 5; i++) {
+    void* buf;
+    size_t bufSize;
+    transportCb_->getReadBuffer(&buf, &bufSize);
+    EXPECT_LE(bufSize, 4000);
+    transportCb_->readDataAvailable(bufSize);
+  }
+
+  EXPECT_CALL(*codec_, onIngressEOF());
+  EXPECT_CALL(mockController_, detachSession(_));
+  httpSession_->dropConnection();
+  eventBase_.loop();
+}
+
 void MockCodecDownstreamTest::testGoaway(bool doubleGoaway,
                                          bool dropConnection) {
   NiceMock<MockHTTPHandler> handler;
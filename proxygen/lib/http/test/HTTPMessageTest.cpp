@@ -402,6 +402,39 @@ TEST(HTTPHeaders, InitializerListStringPiece) {
   EXPECT_EQ("value", hdrs.getSingleOrEmpty(HTTP_HEADER_CONNECTION));
 }
 
+TEST(HTTPHeaders, AddViewFromCodec) {
+  auto buf = folly::IOBuf::copyBuffer("hostwww.facebook.comx-fooba");
+  auto data = (const char*)buf->data();
+  HTTPHeaders hdrs;
+  hdrs.addFromCodec(data, 4, folly::StringPiece(data + 4, 16), *buf);
+  hdrs.add("x-plain", "copied");
+  hdrs.addFromCodec(data + 20, 5, folly::StringPiece(data + 25, 2), *buf);
+  // The headers keep the buffer alive
+  buf.reset();
+
+  std::vector<std::string> values;
+  hdrs.forEachWithCodeView([&] (HTTPHeaderCode, const string&,
+                                folly::StringPiece value) {
+    values.push_back(value.str());
+  });
+  EXPECT_EQ(values, std::vector<std::string>(
+              {"www.facebook.com", "copied", "ba"}));
+
+  // Copies and moves carry the views along
+  HTTPHeaders copy(hdrs);
+  HTTPHeaders moved(std::move(hdrs));
+  for (auto h : {&copy, &moved}) {
+    EXPECT_EQ("www.facebook.com", h->getSingleOrEmpty(HTTP_HEADER_HOST));
+    EXPECT_EQ("ba", h->getSingleOrEmpty("X-Foo"));
+    EXPECT_EQ(3, h->size());
+  }
+  HTTPHeaders stripped;
+  copy.add(HTTP_HEADER_CONNECTION, "x-foo");
+  copy.stripPerHopHeaders(stripped);
+  EXPECT_EQ("ba", stripped.getSingleOrEmpty("X-Foo"));
+  EXPECT_FALSE(copy.exists("X-Foo"));
+}
+
 void testRemoveQueryParam(const string& url,
                           const string& queryParam,
                           const string& expectedUrl,
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/RFC9218.h>
+
+using namespace proxygen;
+
+using RFC9218::Priority;
+using RFC9218::parsePriority;
+
+TEST(PriorityTest, defaults) {
+  EXPECT_EQ(parsePriority(""), Priority(3, false));
+  EXPECT_EQ(parsePriority("  "), Priority(3, false));
+  EXPECT_EQ(RFC9218::toString(Priority()), "");
+}
+
+TEST(PriorityTest, basic) {
+  EXPECT_EQ(parsePriority("u=0"), Priority(0, false));
+  EXPECT_EQ(parsePriority("u=7"), Priority(7, false));
+  EXPECT_EQ(parsePriority("i"), Priority(3, true));
+  EXPECT_EQ(parsePriority("u=5, i"), Priority(5, true));
+  EXPECT_EQ(parsePriority("i,u=1"), Priority(1, true));
+  EXPECT_EQ(parsePriority("u=2,i=?0"), Priority(2, false));
+  EXPECT_EQ(parsePriority("i=?1"), Priority(3, true));
+  // the last value of a key wins
+  EXPECT_EQ(parsePriority("u=1, u=6"), Priority(6, false));
+}
+
+TEST(PriorityTest, invalid) {
+  EXPECT_EQ(parsePriority("u=8"), Priority(3, false));
+  EXPECT_EQ(parsePriority("u=-1, i"), Priority(3, true));
+  EXPECT_EQ(parsePriority("u, i=1"), Priority(3, false));
+  EXPECT_EQ(parsePriority("u=1.5"), Priority(3, false));
+  EXPECT_EQ(parsePriority("u=99999999999999999999"), Priority(3, false));
+  EXPECT_EQ(parsePriority(",,u=4,,"), Priority(4, false));
+}
+
+TEST(PriorityTest, unknownMembers) {
+  EXPECT_EQ(parsePriority("x=?1, u=4;p=1, y"), Priority(4, false));
+  // commas inside strings don't separate members
+  EXPECT_EQ(parsePriority("x=\"a, u=1\", i"), Priority(3, true));
+  EXPECT_EQ(parsePriority("x=\"a\\\", u=1\", u=2"), Priority(2, false));
+}
+
+TEST(PriorityTest, toString) {
+  EXPECT_EQ(RFC9218::toString(Priority(5, false)), "u=5");
+  EXPECT_EQ(RFC9218::toString(Priority(3, true)), "i");
+  EXPECT_EQ(RFC9218::toString(Priority(0, true)), "u=0, i");
+  for (uint8_t u = 0; u <= Priority::kMaxUrgency; u++) {
+    for (bool i: {false, true}) {
+      Priority priority(u, i);
+      EXPECT_EQ(parsePriority(RFC9218::toString(priority)), priority);
+    }
+  }
+}
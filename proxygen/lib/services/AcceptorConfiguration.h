@@ -11,18 +11,30 @@
 
 #include <chrono>
 #include <fcntl.h>
+#include <folly/IPAddress.h>
 #include <folly/String.h>
 #include <wangle/acceptor/ServerSocketConfig.h>
 #include <list>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <vector>
 #include <folly/io/async/AsyncSocket.h>
 #include <proxygen/lib/http/codec/HTTPSettings.h>
 #include <zlib.h>
 
 namespace proxygen {
 
+/**
+ * Clients whose address is in network, whose connections are paced
+ * together to rate bytes per second, in bursts of up to burst bytes.
+ */
+struct EgressPacingClass {
+  folly::CIDRNetwork network;
+  uint64_t rate{0};
+  uint64_t burst{0};
+};
+
 /**
  * Configuration for a single Acceptor.
  *
@@ -43,6 +55,79 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
   **/
   bool HTTP2PrioritiesEnabled{true};
 
+  /**
+   * Determines if HTTP/2 connections schedule egress by the extensible
+   * priorities of RFC 9218 instead of the HTTP2 priorities
+   **/
+  bool extensiblePrioritiesEnabled{false};
+
+  /**
+   * The number of milliseconds a session can go without transactions before
+   * it hibernates, 0 to never hibernate.
+   */
+  std::chrono::milliseconds hibernateTimeout{0};
+
+  /**
+   * Writes of at least this many bytes are sent with MSG_ZEROCOPY, 0
+   * disables zero copy sends.
+   */
+  size_t zeroCopyThreshold{0};
+
+  /**
+   * Pace the egress of each session to this many bytes per second, in
+   * bursts of up to egressPacingBurst bytes. 0 disables pacing.
+   */
+  uint64_t egressPacingRate{0};
+  uint64_t egressPacingBurst{0};
+
+  /**
+   * Pace sessions with SO_MAX_PACING_RATE where the kernel supports it.
+   */
+  bool useSocketPacing{false};
+
+  /**
+   * Each session is also paced with the first class matching its peer. The
+   * sessions of a class share one bucket per acceptor, that is per thread.
+   */
+  std::vector<EgressPacingClass> egressPacingClasses;
+
+  /**
+   * TCP_NOTSENT_LOWAT of each session, which then only writes when the
+   * socket has less than this many bytes left to send. 0 disables it.
+   */
+  uint32_t notSentLowat{0};
+
+  /**
+   * Bytes and time a session may spend parsing ingress before it yields to
+   * the other connections of the event loop, 0 for no limit.
+   */
+  size_t readByteBudget{0};
+  std::chrono::microseconds readTimeBudget{0};
+
+  /**
+   * Bytes the sessions of a thread may buffer together before the largest
+   * are paused, and below which they resume. 0 disables the budget.
+   */
+  uint64_t memoryBudgetHighWater{0};
+  uint64_t memoryBudgetLowWater{0};
+
+  /**
+   * The thread is overloaded while its event loop runs timeouts this late,
+   * or has this many callbacks queued, sampled every eventLoopCheckInterval.
+   * 0 disables either check.
+   */
+  std::chrono::milliseconds maxEventLoopLag{0};
+  size_t maxEventLoopQueueDepth{0};
+  std::chrono::milliseconds eventLoopCheckInterval{100};
+
+  /**
+   * While overloaded, answer the first request of new connections with a
+   * 503 instead of closing them, and drop up to this many idle connections
+   * per sample.
+   */
+  bool overloadRespondWith503{false};
+  size_t overloadIdleConnectionsToDrop{0};
+
   /**
    * The number of milliseconds a transaction can be idle before we close it.
    */
@@ -96,6 +181,19 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
    * built-in HTTPSession default (64kb)
    */
   int64_t writeBufferLimit{-1};
+
+  /**
+   * Have HTTP/1.x and HTTP/2 codecs reference header values in the ingress
+   * buffer instead of copying them (see setZeroCopyIngressHeaders in
+   * HTTP1xCodec and HTTP2Codec)
+   */
+  bool zeroCopyIngressHeaders{false};
+
+  /**
+   * Have the HPACK tables of HTTP/2 codecs share header values through the
+   * intern pool of their thread (see HTTP2Codec::setHeaderInternPool)
+   */
+  bool internHeaderValues{false};
 };
 
 } // proxygen
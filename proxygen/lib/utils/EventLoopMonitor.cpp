@@ -0,0 +1,54 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/EventLoopMonitor.h>
+
+#include <algorithm>
+#include <glog/logging.h>
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+namespace proxygen {
+
+EventLoopMonitor::EventLoopMonitor(folly::EventBase* evb,
+                                   std::chrono::milliseconds interval,
+                                   Callback* callback)
+    : folly::AsyncTimeout(evb),
+      evb_(evb),
+      interval_(interval),
+      callback_(callback) {}
+
+void EventLoopMonitor::start() {
+  DCHECK(evb_->isInEventBaseThread());
+  schedule();
+}
+
+void EventLoopMonitor::schedule() {
+  deadline_ = steady_clock::now() + interval_;
+  scheduleTimeout(interval_);
+}
+
+void EventLoopMonitor::timeoutExpired() noexcept {
+  auto sample = std::max(
+    std::chrono::duration_cast<microseconds>(steady_clock::now() - deadline_),
+    microseconds(0));
+  if (sample >= lag_) {
+    lag_ = sample;
+  } else {
+    lag_ = (lag_ * 3 + sample) / 4;
+  }
+  queueDepth_ = evb_->getNotificationQueueSize();
+  schedule();
+  if (callback_) {
+    callback_->onEventLoopSample(lag_, queueDepth_);
+  }
+}
+
+}
@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+
+namespace proxygen {
+
+/**
+ * Measures how far behind an event loop is: how late it runs a timeout
+ * scheduled every interval, and how many callbacks other threads have
+ * queued for it.
+ *
+ * The lag follows increases right away and decreases over a few samples,
+ * so that a loop is not deemed idle between two slow iterations.
+ */
+class EventLoopMonitor : private folly::AsyncTimeout {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() {}
+
+    virtual void onEventLoopSample(std::chrono::microseconds lag,
+                                   size_t queueDepth) noexcept = 0;
+  };
+
+  EventLoopMonitor(folly::EventBase* evb,
+                   std::chrono::milliseconds interval,
+                   Callback* callback = nullptr);
+
+  /**
+   * Start sampling, must be called from the event loop's thread. Sampling
+   * stops when the monitor is destroyed.
+   */
+  void start();
+
+  std::chrono::microseconds getLag() const {
+    return lag_;
+  }
+
+  size_t getQueueDepth() const {
+    return queueDepth_;
+  }
+
+ private:
+  void timeoutExpired() noexcept override;
+
+  void schedule();
+
+  folly::EventBase* evb_;
+  const std::chrono::milliseconds interval_;
+  Callback* callback_;
+  std::chrono::steady_clock::time_point deadline_;
+  std::chrono::microseconds lag_{0};
+  size_t queueDepth_{0};
+};
+
+}
@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2017, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/EventLoopMonitor.h>
+#include <thread>
+#include <vector>
+
+using namespace proxygen;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+namespace {
+
+class SampleRecorder : public EventLoopMonitor::Callback {
+ public:
+  void onEventLoopSample(microseconds lag, size_t) noexcept override {
+    lags.push_back(lag);
+  }
+
+  std::vector<microseconds> lags;
+};
+
+}
+
+TEST(EventLoopMonitorTest, LagOfBlockedLoop) {
+  folly::EventBase evb;
+  SampleRecorder recorder;
+  EventLoopMonitor monitor(&evb, milliseconds(10), &recorder);
+  monitor.start();
+
+  // The loop is stuck past the deadline of the first sample
+  evb.runAfterDelay([] { std::this_thread::sleep_for(milliseconds(50)); }, 1);
+  evb.runAfterDelay([&] { evb.terminateLoopSoon(); }, 200);
+  evb.loopForever();
+
+  ASSERT_GE(recorder.lags.size(), 3);
+  EXPECT_GE(recorder.lags.front(), milliseconds(30));
+  EXPECT_EQ(recorder.lags.back(), monitor.getLag());
+  // and catches up over the next samples
+  EXPECT_LT(recorder.lags.back(), recorder.lags.front());
+}